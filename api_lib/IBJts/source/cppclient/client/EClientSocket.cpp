@@ -211,7 +211,13 @@ bool EClientSocket::closeAndSend(std::string msg, unsigned offset)
     encodeMsgLen(msg, offset);
   }
 
-  if (bufferedSend(msg) == -1)
+  int nResult = bufferedSend(msg);
+
+  // let the reader thread flush the rest as soon as the socket drains
+  if (m_pEReader && !getTransport()->isOutBufferEmpty())
+    m_pEReader->wakeUp();
+
+  if (nResult == -1)
     return handleSocketError();
 
   return true;
@@ -382,3 +388,9 @@ void EClientSocket::registerEReader(EReader* reader)
 {
   m_pEReader = reader;
 }
+
+void EClientSocket::unregisterEReader(EReader* reader)
+{
+  if (m_pEReader == reader)
+    m_pEReader = nullptr;
+}
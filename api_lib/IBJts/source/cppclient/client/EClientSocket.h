@@ -77,6 +77,7 @@ public:
 		// Register EReader for safe thread shutdown.
 public:
 	void registerEReader(EReader* reader);
+	void unregisterEReader(EReader* reader);
 
 private:
 	EReader* m_pEReader{ nullptr };
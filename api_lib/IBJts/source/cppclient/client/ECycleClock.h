@@ -0,0 +1,32 @@
+﻿/* Copyright (C) 2019 Interactive Brokers LLC. All rights reserved. This code is subject to the terms
+ * and conditions of the IB API Non-Commercial License or the IB API Commercial License, as applicable. */
+
+#pragma once
+#ifndef TWS_API_CLIENT_ECYCLECLOCK_H
+#define TWS_API_CLIENT_ECYCLECLOCK_H
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+// Cheap monotonic timestamps for latency measurement, in ticks of an unspecified
+// rate. On x86 this reads the time stamp counter, which runs at a constant rate
+// and is synchronized across cores on current CPUs, so stamps taken on different
+// threads can be subtracted. Elsewhere a tick is a steady_clock nanosecond.
+// Consumers convert ticks to time by timing a span against a wall clock.
+struct ECycleClock
+{
+    static unsigned long long now()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+};
+
+#endif
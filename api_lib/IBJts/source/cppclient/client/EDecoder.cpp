@@ -18,6 +18,7 @@
 #include "IneligibilityReason.h"
 
 #include <string.h>
+#include <charconv>
 #include <cstdlib>
 #include <sstream>
 #include <assert.h>
@@ -30,6 +31,11 @@ EDecoder::EDecoder(int serverVersion, EWrapper *callback, EClientMsgSink *client
 	m_pEWrapper = callback;
 	m_serverVersion = serverVersion;
 	m_pClientMsgSink = clientMsgSink;
+	m_pTickBatch = 0;
+}
+
+void EDecoder::setTickBatch(ETickBatch* tickBatch) {
+	m_pTickBatch = tickBatch;
 }
 
 const char* EDecoder::processTickPriceMsg(const char* ptr, const char* endPtr) {
@@ -115,6 +121,71 @@ const char* EDecoder::processTickSizeMsg(const char* ptr, const char* endPtr) {
 	return ptr;
 }
 
+// Fast path of processTickPriceMsg: the fields are decoded into the tick batch
+// as they are, without converting the size or the attributes.
+const char* EDecoder::processTickPriceMsgBatched(const char* ptr, const char* endPtr) {
+	const char* msgPtr = ptr;
+	int version;
+	int tickerId;
+	int tickTypeInt;
+	double price;
+	std::string_view size;
+	int attrMask;
+
+	DECODE_FIELD( version);
+	DECODE_FIELD( tickerId);
+	DECODE_FIELD( tickTypeInt);
+	DECODE_FIELD( price);
+	DECODE_FIELD( size); // ver 2 field
+	DECODE_FIELD( attrMask); // ver 3 field
+
+	if (size.size() >= ETICK_SIZE_LENGTH) {
+		m_pTickBatch->flush();
+		return processTickPriceMsg(msgPtr, endPtr);
+	}
+
+	ETick& tick = m_pTickBatch->append();
+	tick.tickerId = tickerId;
+	tick.price = price;
+	tick.tickType = tickTypeInt;
+	tick.attrMask = attrMask;
+	tick.isPrice = true;
+	memcpy(tick.size, size.data(), size.size());
+	tick.size[size.size()] = '\0';
+
+	return ptr;
+}
+
+// Fast path of processTickSizeMsg.
+const char* EDecoder::processTickSizeMsgBatched(const char* ptr, const char* endPtr) {
+	const char* msgPtr = ptr;
+	int version;
+	int tickerId;
+	int tickTypeInt;
+	std::string_view size;
+
+	DECODE_FIELD( version);
+	DECODE_FIELD( tickerId);
+	DECODE_FIELD( tickTypeInt);
+	DECODE_FIELD( size);
+
+	if (size.size() >= ETICK_SIZE_LENGTH) {
+		m_pTickBatch->flush();
+		return processTickSizeMsg(msgPtr, endPtr);
+	}
+
+	ETick& tick = m_pTickBatch->append();
+	tick.tickerId = tickerId;
+	tick.price = 0;
+	tick.tickType = tickTypeInt;
+	tick.attrMask = 0;
+	tick.isPrice = false;
+	memcpy(tick.size, size.data(), size.size());
+	tick.size[size.size()] = '\0';
+
+	return ptr;
+}
+
 const char* EDecoder::processTickOptionComputationMsg(const char* ptr, const char* endPtr) {
 	int version = m_serverVersion;
 	int tickerId;
@@ -2294,13 +2365,17 @@ int EDecoder::parseAndProcessMsg(const char*& beginPtr, const char* endPtr) {
 		int msgId;
 		DECODE_FIELD( msgId);
 
+		// ticks batched so far are delivered before any other callback, in message order
+		if (m_pTickBatch && msgId != TICK_PRICE && msgId != TICK_SIZE)
+			m_pTickBatch->flush();
+
 		switch( msgId) {
 		case TICK_PRICE:
-			ptr = processTickPriceMsg(ptr, endPtr);
+			ptr = m_pTickBatch ? processTickPriceMsgBatched(ptr, endPtr) : processTickPriceMsg(ptr, endPtr);
 			break;
 
 		case TICK_SIZE:
-			ptr = processTickSizeMsg(ptr, endPtr);
+			ptr = m_pTickBatch ? processTickSizeMsgBatched(ptr, endPtr) : processTickSizeMsg(ptr, endPtr);
 			break;
 
 		case TICK_OPTION_COMPUTATION:
@@ -2645,6 +2720,49 @@ int EDecoder::parseAndProcessMsg(const char*& beginPtr, const char* endPtr) {
 }
 
 
+int EDecoder::peekTickerId(const char* beginPtr, const char* endPtr) const {
+	// return the ticker id of a market data message without processing it;
+	// return -1 for messages that do not belong to a ticker
+
+	if (m_serverVersion == 0)
+		return -1;
+
+	const char* ptr = beginPtr;
+	int msgId;
+	int version;
+	int tickerId;
+
+	if (!DecodeField(msgId, ptr, endPtr))
+		return -1;
+
+	switch (msgId) {
+	case TICK_OPTION_COMPUTATION:
+		if (m_serverVersion >= MIN_SERVER_VER_PRICE_BASED_VOLATILITY)
+			break;
+		// fall through
+	case TICK_PRICE:
+	case TICK_SIZE:
+	case TICK_GENERIC:
+	case TICK_STRING:
+	case TICK_EFP:
+	case TICK_SNAPSHOT_END:
+	case MARKET_DATA_TYPE:
+		if (!DecodeField(version, ptr, endPtr))
+			return -1;
+		break;
+	case TICK_REQ_PARAMS:
+	case TICK_BY_TICK:
+		break;
+	default:
+		return -1;
+	}
+
+	if (!DecodeField(tickerId, ptr, endPtr))
+		return -1;
+
+	return tickerId;
+}
+
 bool EDecoder::CheckOffset(const char* ptr, const char* endPtr)
 {
 	assert (ptr && ptr <= endPtr);
@@ -2656,6 +2774,33 @@ const char* EDecoder::FindFieldEnd(const char* ptr, const char* endPtr)
 	return (const char*)memchr(ptr, 0, endPtr - ptr);
 }
 
+namespace {
+
+	// Converts a whole field with std::from_chars, which neither allocates nor
+	// consults the locale. Returns false if the field is not entirely a number
+	// from_chars accepts (a leading '+' or blank, trailing text, a value out of
+	// range); the caller then falls back to the C library conversion, so every
+	// field still decodes to the value it always did.
+	template<typename T>
+	bool fromChars(T& value, std::string_view field)
+	{
+		const char* fieldEnd = field.data() + field.size();
+		std::from_chars_result result = std::from_chars(field.data(), fieldEnd, value);
+		return result.ec == std::errc() && result.ptr == fieldEnd;
+	}
+
+	// Decimal of a field, converted as DecimalFunctions::stringToDecimal does it
+	// (including mapping the unset sentinels to an empty string) but straight from
+	// the NUL-terminated field in the message rather than from a std::string copy.
+	Decimal fieldToDecimal(std::string_view field)
+	{
+		unsigned int flags;
+		if (field == "2147483647" || field == "9223372036854775807" || field == "1.7976931348623157E308")
+			field = std::string_view("", 0);
+		return __bid64_from_string(const_cast<char*>(field.data()), 0, &flags);
+	}
+}
+
 bool EDecoder::DecodeField(bool& boolValue, const char*& ptr, const char* endPtr)
 {
 	int intValue;
@@ -2667,71 +2812,73 @@ bool EDecoder::DecodeField(bool& boolValue, const char*& ptr, const char* endPtr
 
 bool EDecoder::DecodeField(int& intValue, const char*& ptr, const char* endPtr)
 {
-	if( !CheckOffset(ptr, endPtr))
-		return false;
-	const char* fieldBeg = ptr;
-	const char* fieldEnd = FindFieldEnd(fieldBeg, endPtr);
-	if( !fieldEnd)
+	std::string_view field;
+	if( !DecodeField(field, ptr, endPtr))
 		return false;
-	intValue = atoi(fieldBeg);
-	ptr = ++fieldEnd;
+	if( field.empty())
+		intValue = 0;
+	else if( !fromChars(intValue, field))
+		intValue = atoi(field.data());
 	return true;
 }
 
 bool EDecoder::DecodeFieldTime(time_t& time_tValue, const char*& ptr, const char* endPtr)
 {
-	if( !CheckOffset(ptr, endPtr))
+	long long longLongValue;
+	if( !DecodeField(longLongValue, ptr, endPtr))
 		return false;
-	const char* fieldBeg = ptr;
-	const char* fieldEnd = FindFieldEnd(fieldBeg, endPtr);
-	if( !fieldEnd)
-		return false;
-	time_tValue = atoll(fieldBeg);
-	ptr = ++fieldEnd;
+	time_tValue = longLongValue;
 	return true;
 }
 
 bool EDecoder::DecodeField(long long& longLongValue, const char*& ptr, const char* endPtr)
 {
-	if( !CheckOffset(ptr, endPtr))
+	std::string_view field;
+	if( !DecodeField(field, ptr, endPtr))
 		return false;
-	const char* fieldBeg = ptr;
-	const char* fieldEnd = FindFieldEnd(fieldBeg, endPtr);
-	if( !fieldEnd)
-		return false;
-	longLongValue = atoll(fieldBeg);
-	ptr = ++fieldEnd;
+	if( field.empty())
+		longLongValue = 0;
+	else if( !fromChars(longLongValue, field))
+		longLongValue = atoll(field.data());
 	return true;
 }
 
 bool EDecoder::DecodeField(long& longValue, const char*& ptr, const char* endPtr)
 {
-	if( !CheckOffset(ptr, endPtr))
-		return false;
-	const char* fieldBeg = ptr;
-	const char* fieldEnd = FindFieldEnd(fieldBeg, endPtr);
-	if( !fieldEnd)
+	std::string_view field;
+	if( !DecodeField(field, ptr, endPtr))
 		return false;
-	longValue = atol(fieldBeg);
-	ptr = ++fieldEnd;
+	if( field.empty())
+		longValue = 0;
+	else if( !fromChars(longValue, field))
+		longValue = atol(field.data());
 	return true;
 }
 
 bool EDecoder::DecodeField(double& doubleValue, const char*& ptr, const char* endPtr)
 {
-	if( !CheckOffset(ptr, endPtr))
+	std::string_view field;
+	if( !DecodeField(field, ptr, endPtr))
 		return false;
-	const char* fieldBeg = ptr;
-	const char* fieldEnd = FindFieldEnd(fieldBeg, endPtr);
-	if( !fieldEnd)
-		return false;
-	doubleValue = fieldBeg == INFINITY_STR ? INFINITY : atof(fieldBeg);
-	ptr = ++fieldEnd;
+	if( field.empty())
+		doubleValue = 0;
+	else if( !fromChars(doubleValue, field))
+		doubleValue = atof(field.data());
 	return true;
 }
 
 bool EDecoder::DecodeField(std::string& stringValue,
 						   const char*& ptr, const char* endPtr)
+{
+	std::string_view field;
+	if( !DecodeField(field, ptr, endPtr))
+		return false;
+	stringValue.assign(field.data(), field.size());
+	return true;
+}
+
+bool EDecoder::DecodeField(std::string_view& stringValue,
+						   const char*& ptr, const char* endPtr)
 {
 	if( !CheckOffset(ptr, endPtr))
 		return false;
@@ -2739,7 +2886,7 @@ bool EDecoder::DecodeField(std::string& stringValue,
 	const char* fieldEnd = FindFieldEnd(ptr, endPtr);
 	if( !fieldEnd)
 		return false;
-	stringValue = fieldBeg; // better way?
+	stringValue = std::string_view(fieldBeg, fieldEnd - fieldBeg);
 	ptr = ++fieldEnd;
 	return true;
 }
@@ -2760,23 +2907,22 @@ bool EDecoder::DecodeField(char& charValue,
 
 bool EDecoder::DecodeField(Decimal& decimalValue, const char*& ptr, const char* endPtr)
 {
-	if (!CheckOffset(ptr, endPtr))
+	std::string_view field;
+	if (!DecodeField(field, ptr, endPtr))
 		return false;
-	const char* fieldBeg = ptr;
-	const char* fieldEnd = FindFieldEnd(fieldBeg, endPtr);
-	if (!fieldEnd)
-		return false;
-	decimalValue = DecimalFunctions::stringToDecimal(fieldBeg);
-	ptr = ++fieldEnd;
+	decimalValue = fieldToDecimal(field);
 	return true;
 }
 
 bool EDecoder::DecodeFieldMax(int& intValue, const char*& ptr, const char* endPtr)
 {
-	std::string stringValue;
-	if( !DecodeField(stringValue, ptr, endPtr))
+	std::string_view field;
+	if( !DecodeField(field, ptr, endPtr))
 		return false;
-	intValue = stringValue.empty() ? UNSET_INTEGER : atoi(stringValue.c_str());
+	if( field.empty())
+		intValue = UNSET_INTEGER;
+	else if( !fromChars(intValue, field))
+		intValue = atoi(field.data());
 	return true;
 }
 
@@ -2791,10 +2937,13 @@ bool EDecoder::DecodeFieldMax(long& longValue, const char*& ptr, const char* end
 
 bool EDecoder::DecodeFieldMax(double& doubleValue, const char*& ptr, const char* endPtr)
 {
-	std::string stringValue;
-	if( !DecodeField(stringValue, ptr, endPtr))
+	std::string_view field;
+	if( !DecodeField(field, ptr, endPtr))
 		return false;
-	doubleValue = stringValue.empty() ? UNSET_DOUBLE : atof(stringValue.c_str());
+	if( field.empty())
+		doubleValue = UNSET_DOUBLE;
+	else if( !fromChars(doubleValue, field))
+		doubleValue = atof(field.data());
 	return true;
 }
 
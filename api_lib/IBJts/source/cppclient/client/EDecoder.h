@@ -12,6 +12,9 @@
 #include "HistoricalTickLast.h"
 #include "Decimal.h"
 #include "HistoricalSession.h"
+#include "ETickBatch.h"
+
+#include <string_view>
 
 
 
@@ -277,9 +280,12 @@ class TWSAPIDLLEXP EDecoder
     EWrapper *m_pEWrapper;
     int m_serverVersion;
     EClientMsgSink *m_pClientMsgSink;
+    ETickBatch *m_pTickBatch;
 
     const char* processTickPriceMsg(const char* ptr, const char* endPtr);
     const char* processTickSizeMsg(const char* ptr, const char* endPtr);
+    const char* processTickPriceMsgBatched(const char* ptr, const char* endPtr);
+    const char* processTickSizeMsgBatched(const char* ptr, const char* endPtr);
     const char* processTickOptionComputationMsg(const char* ptr, const char* endPtr);
     const char* processTickGenericMsg(const char* ptr, const char* endPtr);
     const char* processTickStringMsg(const char* ptr, const char* endPtr);
@@ -384,6 +390,8 @@ public:
     static bool DecodeField(long long&, const char*& ptr, const char* endPtr);
     static bool DecodeField(double&, const char*& ptr, const char* endPtr);
     static bool DecodeField(std::string&, const char*& ptr, const char* endPtr);
+    // the view points into the message and is only valid while the message is
+    static bool DecodeField(std::string_view&, const char*& ptr, const char* endPtr);
     static bool DecodeField(char&, const char*& ptr, const char* endPtr);
     static bool DecodeField(Decimal&, const char*& ptr, const char* endPtr);
 
@@ -396,6 +404,10 @@ public:
     EDecoder(int serverVersion, EWrapper *callback, EClientMsgSink *clientMsgSink = 0);
 
     int parseAndProcessMsg(const char*& beginPtr, const char* endPtr);
+    // TICK_PRICE and TICK_SIZE messages go to the batch instead of EWrapper::tickPrice
+    // and tickSize while one is set; 0 restores the callbacks
+    void setTickBatch(ETickBatch* tickBatch);
+    int peekTickerId(const char* beginPtr, const char* endPtr) const;
 };
 
 #define DECODE_FIELD(x) if (!EDecoder::DecodeField(x, ptr, endPtr)) return 0;
@@ -3,18 +3,41 @@
 
 #include "StdAfx.h"
 #include "EMessage.h"
+#include "EMessageSlab.h"
 
 
-EMessage::EMessage(const std::vector<char> &data) {
-    this->data = data;
+EMessage::EMessage(const std::vector<char> &data)
+    : data(data)
+    , m_pSlab(0)
+    , m_receivedTime(0)
+    , m_enqueuedTime(0)
+    , m_dequeuedTime(0)
+{
+    m_pBegin = this->data.data();
+    m_pEnd = m_pBegin + this->data.size();
+}
+
+EMessage::EMessage(EMessageSlab* slab, const char* begin, const char* end)
+    : m_pSlab(slab)
+    , m_pBegin(begin)
+    , m_pEnd(end)
+    , m_receivedTime(0)
+    , m_enqueuedTime(0)
+    , m_dequeuedTime(0)
+{
+}
+
+EMessage::~EMessage() {
+    if (m_pSlab)
+        m_pSlab->release();
 }
 
 const char* EMessage::begin(void) const
 {
-    return data.data();
+    return m_pBegin;
 }
 
 const char* EMessage::end(void) const
 {
-    return data.data() + data.size();
+    return m_pEnd;
 }
@@ -8,13 +8,41 @@
 #include <vector>
 #include "platformspecific.h"
 
+class EMessageSlab;
+
+// A message either owns a copy of its bytes or is a view into an EMessageSlab
+// that it keeps alive until it is destroyed. A view without a slab refers to
+// memory its producer keeps alive, such as a mapped EMessageReplay recording.
+//
+// The reader and the consumers of its queue stamp a message with ECycleClock
+// ticks as it moves through them, for latency measurement. A stamp that was
+// not taken is 0.
 class TWSAPIDLLEXP EMessage
 {
     std::vector<char> data;
+    EMessageSlab* m_pSlab;
+    const char* m_pBegin;
+    const char* m_pEnd;
+    unsigned long long m_receivedTime;  // the recv() that completed the message
+    unsigned long long m_enqueuedTime;  // pushed to the reader queue
+    unsigned long long m_dequeuedTime;  // taken off the reader queue
 public:
     EMessage(const std::vector<char> &data);
+    EMessage(EMessageSlab* slab, const char* begin, const char* end);
+    ~EMessage();
     const char* begin(void) const;
     const char* end(void) const;
+    unsigned long long receivedTime() const { return m_receivedTime; }
+    unsigned long long enqueuedTime() const { return m_enqueuedTime; }
+    unsigned long long dequeuedTime() const { return m_dequeuedTime; }
+    void setReceivedTime(unsigned long long time) { m_receivedTime = time; }
+    void setEnqueuedTime(unsigned long long time) { m_enqueuedTime = time; }
+    void setDequeuedTime(unsigned long long time) { m_dequeuedTime = time; }
+
+private:
+    // disable copy ctor (compatible with pre C++11 compiler hence =delete not used)
+    EMessage(const EMessage&);
+    EMessage& operator=(const EMessage&);
 };
 
 #endif
\ No newline at end of file
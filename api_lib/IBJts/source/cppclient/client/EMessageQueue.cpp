@@ -0,0 +1,189 @@
+﻿/* Copyright (C) 2019 Interactive Brokers LLC. All rights reserved. This code is subject to the terms
+ * and conditions of the IB API Non-Commercial License or the IB API Commercial License, as applicable. */
+
+#include "StdAfx.h"
+#include "EMessageQueue.h"
+#include "EMessage.h"
+
+#include <thread>
+#include <chrono>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <limits.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CPU_RELAX() _mm_pause()
+#else
+#define CPU_RELAX() std::atomic_signal_fence(std::memory_order_seq_cst)
+#endif
+
+EMessageQueue::EMessageQueue(size_t capacity)
+  : m_enqueuePos(0)
+  , m_dequeuePos(0)
+  , m_wakeSeq(0)
+  , m_waiters(0)
+  , m_highWaterMark(0)
+  , m_fullCount(0)
+{
+  size_t size = 2;
+  while (size < capacity)
+    size <<= 1;
+
+  m_cells = new Cell[size];
+  m_mask = size - 1;
+
+  for (size_t i = 0; i < size; i++) {
+    m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    m_cells[i].msg = 0;
+  }
+}
+
+EMessageQueue::~EMessageQueue() {
+  EMessage* msg;
+
+  while ((msg = pop()) != 0)
+    delete msg;
+
+  delete[] m_cells;
+}
+
+bool EMessageQueue::push(EMessage* msg) {
+  Cell* cell;
+  size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+
+  for (;;) {
+    cell = &m_cells[pos & m_mask];
+    size_t seq = cell->sequence.load(std::memory_order_acquire);
+    intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+    if (diff == 0) {
+      if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        break;
+    }
+    else if (diff < 0) {
+      m_fullCount.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    else {
+      pos = m_enqueuePos.load(std::memory_order_relaxed);
+    }
+  }
+
+  cell->msg = msg;
+  cell->sequence.store(pos + 1, std::memory_order_release);
+
+  size_t currentDepth = pos + 1 - m_dequeuePos.load(std::memory_order_relaxed);
+  size_t highWaterMark = m_highWaterMark.load(std::memory_order_relaxed);
+  while (currentDepth > highWaterMark &&
+         !m_highWaterMark.compare_exchange_weak(highWaterMark, currentDepth, std::memory_order_relaxed)) {
+  }
+
+  // pairs with the increment of m_waiters in waitPop: either the waiter sees the message
+  // or we see the waiter
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (m_waiters.load(std::memory_order_relaxed) > 0)
+    wake(1);
+
+  return true;
+}
+
+EMessage* EMessageQueue::pop() {
+  Cell* cell;
+  size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+
+  for (;;) {
+    cell = &m_cells[pos & m_mask];
+    size_t seq = cell->sequence.load(std::memory_order_acquire);
+    intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+
+    if (diff == 0) {
+      if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        break;
+    }
+    else if (diff < 0) {
+      return 0;
+    }
+    else {
+      pos = m_dequeuePos.load(std::memory_order_relaxed);
+    }
+  }
+
+  EMessage* msg = cell->msg;
+  cell->sequence.store(pos + m_mask + 1, std::memory_order_release);
+  return msg;
+}
+
+EMessage* EMessageQueue::waitPop(unsigned long timeoutMs) {
+  EMessage* msg;
+
+  for (int i = 0; i < MSG_QUEUE_SPIN_COUNT; i++) {
+    if ((msg = pop()) != 0)
+      return msg;
+    CPU_RELAX();
+  }
+
+  uint32_t wakeSeq = m_wakeSeq.load(std::memory_order_acquire);
+
+  m_waiters.fetch_add(1, std::memory_order_seq_cst);
+
+  if ((msg = pop()) == 0) {
+#if defined(__linux__)
+    struct timespec ts;
+    ts.tv_sec = timeoutMs / 1000;
+    ts.tv_nsec = (timeoutMs % 1000) * 1000 * 1000;
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_wakeSeq), FUTEX_WAIT_PRIVATE, wakeSeq, &ts, 0, 0);
+#else
+    (void)wakeSeq;
+    std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs < 1 ? timeoutMs : 1));
+#endif
+    msg = pop();
+  }
+
+  m_waiters.fetch_sub(1, std::memory_order_relaxed);
+  return msg;
+}
+
+void EMessageQueue::wakeAll() {
+#if defined(__linux__)
+  wake(INT_MAX);
+#else
+  wake(0);
+#endif
+}
+
+void EMessageQueue::wake(int count) {
+  m_wakeSeq.fetch_add(1, std::memory_order_release);
+#if defined(__linux__)
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_wakeSeq), FUTEX_WAKE_PRIVATE, count, 0, 0, 0);
+#else
+  (void)count;
+#endif
+}
+
+size_t EMessageQueue::depth() const {
+  size_t enqueuePos = m_enqueuePos.load(std::memory_order_relaxed);
+  size_t dequeuePos = m_dequeuePos.load(std::memory_order_relaxed);
+
+  return enqueuePos > dequeuePos ? enqueuePos - dequeuePos : 0;
+}
+
+size_t EMessageQueue::highWaterMark() const {
+  return m_highWaterMark.load(std::memory_order_relaxed);
+}
+
+size_t EMessageQueue::capacity() const {
+  return m_mask + 1;
+}
+
+uint64_t EMessageQueue::fullCount() const {
+  return m_fullCount.load(std::memory_order_relaxed);
+}
+
+void EMessageQueue::resetHighWaterMark() {
+  m_highWaterMark.store(depth(), std::memory_order_relaxed);
+}
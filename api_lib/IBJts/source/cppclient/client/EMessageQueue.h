@@ -0,0 +1,60 @@
+﻿/* Copyright (C) 2019 Interactive Brokers LLC. All rights reserved. This code is subject to the terms
+ * and conditions of the IB API Non-Commercial License or the IB API Commercial License, as applicable. */
+
+#pragma once
+#ifndef TWS_API_CLIENT_EMESSAGEQUEUE_H
+#define TWS_API_CLIENT_EMESSAGEQUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include "platformspecific.h"
+
+#define MSG_QUEUE_CAPACITY_DEFAULT 65536   // must be a power of two
+#define MSG_QUEUE_SPIN_COUNT 2000
+
+class EMessage;
+
+// Bounded lock-free multi-producer/multi-consumer queue of messages.
+// Ownership of a message passes to the queue on push and to the caller on pop.
+// Consumers may block in waitPop, which spins briefly before sleeping on a futex.
+class TWSAPIDLLEXP EMessageQueue
+{
+    struct Cell {
+        std::atomic<size_t> sequence;
+        EMessage* msg;
+    };
+
+    Cell* m_cells;
+    size_t m_mask;
+    alignas(64) std::atomic<size_t> m_enqueuePos;
+    alignas(64) std::atomic<size_t> m_dequeuePos;
+    alignas(64) std::atomic<uint32_t> m_wakeSeq;
+    std::atomic<int> m_waiters;
+    std::atomic<size_t> m_highWaterMark;
+    std::atomic<uint64_t> m_fullCount;
+
+    void wake(int count);
+
+public:
+    explicit EMessageQueue(size_t capacity = MSG_QUEUE_CAPACITY_DEFAULT);
+    ~EMessageQueue();
+
+    bool push(EMessage* msg);
+    EMessage* pop();
+    EMessage* waitPop(unsigned long timeoutMs);
+    void wakeAll();
+
+    size_t depth() const;
+    size_t highWaterMark() const;
+    size_t capacity() const;
+    uint64_t fullCount() const;
+    void resetHighWaterMark();
+
+private:
+    // disable copy ctor (compatible with pre C++11 compiler hence =delete not used)
+    EMessageQueue(const EMessageQueue&);
+    EMessageQueue& operator=(const EMessageQueue&);
+};
+
+#endif
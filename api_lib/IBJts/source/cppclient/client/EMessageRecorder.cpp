@@ -0,0 +1,110 @@
+﻿/* Copyright (C) 2019 Interactive Brokers LLC. All rights reserved. This code is subject to the terms
+ * and conditions of the IB API Non-Commercial License or the IB API Commercial License, as applicable. */
+
+#include "StdAfx.h"
+#include "EMessageRecorder.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+EMessageRecorder::EMessageRecorder()
+  : m_fd(-1)
+  , m_msgCount(0)
+  , m_byteCount(0)
+  , m_failed(false)
+{
+}
+
+EMessageRecorder::~EMessageRecorder() {
+  close();
+}
+
+// Creates the recording file, replacing any file at the path.
+bool EMessageRecorder::open(const char* path, int serverVersion) {
+  close();
+
+  int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+  if (fd < 0)
+    return false;
+
+  EMessageRecordingHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = MSG_RECORDING_MAGIC;
+  header.version = MSG_RECORDING_VERSION;
+  header.serverVersion = serverVersion;
+  header.startTimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+
+  if (write(fd, &header, sizeof(header)) != (ssize_t)sizeof(header)) {
+    ::close(fd);
+    return false;
+  }
+
+  EMutexGuard lock(m_mutex);
+  m_fd = fd;
+  m_buf.clear();
+  m_buf.reserve(MSG_RECORDER_BUF_SIZE);
+  m_start = std::chrono::steady_clock::now();
+  m_msgCount = 0;
+  m_byteCount = 0;
+  m_failed = false;
+  return true;
+}
+
+// Appends one message. Called by the EReader thread for every message it frames.
+void EMessageRecorder::record(const char* begin, const char* end) {
+  EMutexGuard lock(m_mutex);
+
+  if (m_fd < 0 || m_failed)
+    return;
+
+  uint64_t timestampNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now() - m_start).count();
+  uint32_t length = (uint32_t)(end - begin);
+
+  if (m_buf.size() + MSG_RECORD_PREFIX_SIZE + length > MSG_RECORDER_BUF_SIZE && !flush())
+    return;
+
+  size_t pos = m_buf.size();
+  m_buf.resize(pos + MSG_RECORD_PREFIX_SIZE + length);
+  memcpy(&m_buf[pos], &timestampNs, sizeof(timestampNs));
+  memcpy(&m_buf[pos + sizeof(timestampNs)], &length, sizeof(length));
+  memcpy(&m_buf[pos + MSG_RECORD_PREFIX_SIZE], begin, length);
+
+  m_msgCount++;
+  m_byteCount += length;
+}
+
+// Writes out what is staged and closes the file.
+bool EMessageRecorder::close() {
+  EMutexGuard lock(m_mutex);
+
+  if (m_fd < 0)
+    return false;
+
+  bool ok = flush() && !m_failed;
+  ::close(m_fd);
+  m_fd = -1;
+  return ok;
+}
+
+bool EMessageRecorder::flush() {
+  size_t written = 0;
+
+  while (written < m_buf.size()) {
+    ssize_t result = write(m_fd, m_buf.data() + written, m_buf.size() - written);
+    if (result < 0) {
+      if (errno == EINTR)
+        continue;
+      // a failed append leaves a truncated record at the end, which replay treats as the end
+      m_failed = true;
+      return false;
+    }
+    written += result;
+  }
+
+  m_buf.clear();
+  return true;
+}
@@ -0,0 +1,63 @@
+﻿/* Copyright (C) 2019 Interactive Brokers LLC. All rights reserved. This code is subject to the terms
+ * and conditions of the IB API Non-Commercial License or the IB API Commercial License, as applicable. */
+
+#pragma once
+#ifndef TWS_API_CLIENT_EMESSAGERECORDER_H
+#define TWS_API_CLIENT_EMESSAGERECORDER_H
+
+#include <chrono>
+#include <stdint.h>
+#include <vector>
+#include "platformspecific.h"
+#include "EMutex.h"
+
+#define MSG_RECORDING_MAGIC 0x52535754     // "TWSR" in little endian
+#define MSG_RECORDING_VERSION 1
+#define MSG_RECORD_PREFIX_SIZE 12          // uint64 timestamp + uint32 length
+#define MSG_RECORDER_BUF_SIZE (256 * 1024)
+
+// A recording is this header followed by one record per inbound message: the
+// nanoseconds since the recording was opened (monotonic clock), the message
+// length and the framed message bytes without their length prefix. All fields
+// are in host byte order.
+struct EMessageRecordingHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t reserved;
+  int32_t serverVersion;
+  int32_t reserved2;
+  int64_t startTimeNs;   // wall clock when the recording was opened, nanoseconds since the epoch
+};
+
+// Appends every message the EReader frames to a recording file. Records are
+// staged in memory and written out in large appends.
+class TWSAPIDLLEXP EMessageRecorder
+{
+  int m_fd;
+  std::vector<char> m_buf;
+  std::chrono::steady_clock::time_point m_start;
+  uint64_t m_msgCount;
+  uint64_t m_byteCount;
+  bool m_failed;
+  EMutex m_mutex;
+
+  bool flush();
+
+public:
+  EMessageRecorder();
+  ~EMessageRecorder();
+
+  bool open(const char* path, int serverVersion);
+  void record(const char* begin, const char* end);
+  bool close();
+  bool isOpen() const { return m_fd >= 0; }
+  uint64_t messageCount() const { return m_msgCount; }
+  uint64_t byteCount() const { return m_byteCount; }
+
+private:
+  // disable copy ctor (compatible with pre C++11 compiler hence =delete not used)
+  EMessageRecorder(const EMessageRecorder&);
+  EMessageRecorder& operator=(const EMessageRecorder&);
+};
+
+#endif
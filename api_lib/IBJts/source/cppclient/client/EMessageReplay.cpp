@@ -0,0 +1,146 @@
+﻿/* Copyright (C) 2019 Interactive Brokers LLC. All rights reserved. This code is subject to the terms
+ * and conditions of the IB API Non-Commercial License or the IB API Commercial License, as applicable. */
+
+#include "StdAfx.h"
+#include "EMessageReplay.h"
+#include "EMessageRecorder.h"
+#include "EMessageQueue.h"
+#include "EMessage.h"
+#include "ECycleClock.h"
+#include "EReaderSignal.h"
+
+#include <chrono>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+EMessageReplay::EMessageReplay()
+  : m_fd(-1)
+  , m_data(0)
+  , m_size(0)
+  , m_serverVersion(0)
+  , m_speed(1.0)
+  , m_pQueue(0)
+  , m_pSignal(0)
+  , m_isAlive(false)
+  , m_finished(false)
+  , m_msgCount(0)
+  , m_elapsedNs(0)
+{
+}
+
+EMessageReplay::~EMessageReplay() {
+  stop();
+
+  if (m_data)
+    munmap((void*)m_data, m_size);
+  if (m_fd >= 0)
+    close(m_fd);
+}
+
+// Maps a recording and checks its header.
+bool EMessageReplay::open(const char* path) {
+  int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) < 0 || (size_t)fileStat.st_size < sizeof(EMessageRecordingHeader)) {
+    close(fd);
+    return false;
+  }
+
+  void* mapping = mmap(0, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (mapping == MAP_FAILED) {
+    close(fd);
+    return false;
+  }
+
+  EMessageRecordingHeader header;
+  memcpy(&header, mapping, sizeof(header));
+
+  if (header.magic != MSG_RECORDING_MAGIC || header.version != MSG_RECORDING_VERSION) {
+    munmap(mapping, fileStat.st_size);
+    close(fd);
+    return false;
+  }
+
+  madvise(mapping, fileStat.st_size, MADV_SEQUENTIAL);
+
+  m_fd = fd;
+  m_data = (const char*)mapping;
+  m_size = fileStat.st_size;
+  m_serverVersion = header.serverVersion;
+  return true;
+}
+
+void EMessageReplay::start(EMessageQueue& queue, EReaderSignal* signal, double speed) {
+  m_pQueue = &queue;
+  m_pSignal = signal;
+  m_speed = speed;
+  m_isAlive = true;
+  m_finished = false;
+  m_thread = std::thread(&EMessageReplay::replayLoop, this);
+}
+
+void EMessageReplay::stop() {
+  m_isAlive = false;
+  if (m_thread.joinable())
+    m_thread.join();
+}
+
+void EMessageReplay::replayLoop() {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  size_t pos = sizeof(EMessageRecordingHeader);
+
+  while (m_isAlive && pos + MSG_RECORD_PREFIX_SIZE <= m_size) {
+    uint64_t timestampNs;
+    uint32_t length;
+
+    memcpy(&timestampNs, m_data + pos, sizeof(timestampNs));
+    memcpy(&length, m_data + pos + sizeof(timestampNs), sizeof(length));
+
+    // a record cut short by a crash ends the recording
+    if (length > m_size - pos - MSG_RECORD_PREFIX_SIZE)
+      break;
+
+    if (m_speed > 0) {
+      std::chrono::nanoseconds due((int64_t)(timestampNs / m_speed));
+      std::this_thread::sleep_until(start + due);
+    }
+
+    const char* pBegin = m_data + pos + MSG_RECORD_PREFIX_SIZE;
+    EMessage* msg = new EMessage(0, pBegin, pBegin + length);
+    pos += MSG_RECORD_PREFIX_SIZE + length;
+
+    // a replayed message is received when it is pushed
+    unsigned long long now = ECycleClock::now();
+    msg->setReceivedTime(now);
+    msg->setEnqueuedTime(now);
+
+    while (!m_pQueue->push(msg)) {
+      if (!m_isAlive) {
+        delete msg;
+        break;
+      }
+      std::this_thread::yield();
+    }
+
+    if (!m_isAlive)
+      break;
+
+    m_msgCount.fetch_add(1, std::memory_order_relaxed);
+
+    if (m_pSignal && m_pQueue->depth() <= 1)
+      m_pSignal->issueSignal();
+  }
+
+  m_elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+  m_finished = true;
+
+  if (m_pSignal)
+    m_pSignal->issueSignal();
+  m_pQueue->wakeAll();
+}
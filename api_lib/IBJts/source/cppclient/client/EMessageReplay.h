@@ -0,0 +1,58 @@
+﻿/* Copyright (C) 2019 Interactive Brokers LLC. All rights reserved. This code is subject to the terms
+ * and conditions of the IB API Non-Commercial License or the IB API Commercial License, as applicable. */
+
+#pragma once
+#ifndef TWS_API_CLIENT_EMESSAGEREPLAY_H
+#define TWS_API_CLIENT_EMESSAGEREPLAY_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <thread>
+#include "platformspecific.h"
+
+class EMessageQueue;
+struct EReaderSignal;
+
+// Plays a recording made by EMessageRecorder back into a message queue, as if
+// an EReader had just read the messages from TWS. The file is memory mapped
+// and messages are views into the mapping, so it must outlive every message.
+//
+// A speed of 1 keeps the recorded gaps between messages, N replays N times
+// faster and 0 or less pushes messages as fast as the queue takes them.
+class TWSAPIDLLEXP EMessageReplay
+{
+  int m_fd;
+  const char* m_data;
+  size_t m_size;
+  int m_serverVersion;
+  double m_speed;
+  EMessageQueue* m_pQueue;
+  EReaderSignal* m_pSignal;
+  std::thread m_thread;
+  std::atomic<bool> m_isAlive;
+  std::atomic<bool> m_finished;
+  std::atomic<uint64_t> m_msgCount;
+  std::atomic<uint64_t> m_elapsedNs;
+
+  void replayLoop();
+
+public:
+  EMessageReplay();
+  ~EMessageReplay();
+
+  bool open(const char* path);
+  void start(EMessageQueue& queue, EReaderSignal* signal, double speed);
+  void stop();
+  int serverVersion() const { return m_serverVersion; }
+  bool finished() const { return m_finished.load(); }
+  uint64_t messageCount() const { return m_msgCount.load(); }
+  uint64_t elapsedNs() const { return m_elapsedNs.load(); }
+
+private:
+  // disable copy ctor (compatible with pre C++11 compiler hence =delete not used)
+  EMessageReplay(const EMessageReplay&);
+  EMessageReplay& operator=(const EMessageReplay&);
+};
+
+#endif
@@ -0,0 +1,89 @@
+﻿/* Copyright (C) 2019 Interactive Brokers LLC. All rights reserved. This code is subject to the terms
+ * and conditions of the IB API Non-Commercial License or the IB API Commercial License, as applicable. */
+
+#include "StdAfx.h"
+#include "EMessageSlab.h"
+
+EMessageSlab::EMessageSlab(size_t capacity)
+  : m_data(new char[capacity])
+  , m_capacity(capacity)
+  , m_issued(0)
+  , m_refs(0)
+{
+}
+
+EMessageSlab::~EMessageSlab() {
+  delete[] m_data;
+}
+
+void EMessageSlab::retire() {
+  long issued = m_issued;
+
+  if (m_refs.fetch_add(issued, std::memory_order_acq_rel) + issued == 0)
+    recycle();
+}
+
+void EMessageSlab::release() {
+  if (m_refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    recycle();
+}
+
+void EMessageSlab::recycle() {
+  // the pool may go away with this reference once the reader is gone
+  std::shared_ptr<EMessageSlabPool> pool;
+  pool.swap(m_pool);
+
+  if (pool)
+    pool->recycle(this);
+  else
+    delete this;
+}
+
+EMessageSlabPool::EMessageSlabPool(size_t slabSize, size_t maxFree)
+  : m_slabSize(slabSize)
+  , m_maxFree(maxFree)
+  , m_allocated(0)
+{
+}
+
+EMessageSlabPool::~EMessageSlabPool() {
+  for (size_t i = 0; i < m_free.size(); i++)
+    delete m_free[i];
+}
+
+EMessageSlab* EMessageSlabPool::acquire(size_t minCapacity) {
+  EMessageSlab* slab = 0;
+
+  if (minCapacity <= m_slabSize) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!m_free.empty()) {
+      slab = m_free.back();
+      m_free.pop_back();
+    }
+  }
+
+  if (slab == 0) {
+    slab = new EMessageSlab(minCapacity > m_slabSize ? minCapacity : m_slabSize);
+    m_allocated.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  slab->m_issued = 0;
+  slab->m_refs.store(0, std::memory_order_relaxed);
+  slab->m_pool = shared_from_this();
+
+  return slab;
+}
+
+void EMessageSlabPool::recycle(EMessageSlab* slab) {
+  if (slab->m_capacity == m_slabSize) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_free.size() < m_maxFree) {
+      m_free.push_back(slab);
+      return;
+    }
+  }
+
+  delete slab;
+}
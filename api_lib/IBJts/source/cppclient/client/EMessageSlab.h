@@ -0,0 +1,79 @@
+﻿/* Copyright (C) 2019 Interactive Brokers LLC. All rights reserved. This code is subject to the terms
+ * and conditions of the IB API Non-Commercial License or the IB API Commercial License, as applicable. */
+
+#pragma once
+#ifndef TWS_API_CLIENT_EMESSAGESLAB_H
+#define TWS_API_CLIENT_EMESSAGESLAB_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <stddef.h>
+#include "platformspecific.h"
+
+#define MSG_SLAB_SIZE_DEFAULT (1024 * 1024)
+#define MSG_SLAB_POOL_MAX_FREE 16
+
+class EMessageSlabPool;
+
+// Receive buffer that the EReader reads socket data into. Messages are views
+// into a slab, so message bytes are never copied after recv().
+//
+// The reader does not touch the reference count per message. It counts the
+// messages it issues from the slab and adds that count once when it retires the
+// slab; every message subtracts one when it is destroyed. Whichever side brings
+// the count to zero returns the slab to its pool.
+class TWSAPIDLLEXP EMessageSlab
+{
+    friend class EMessageSlabPool;
+
+    char* m_data;
+    size_t m_capacity;
+    long m_issued;                      // reader thread only
+    std::atomic<long> m_refs;
+    std::shared_ptr<EMessageSlabPool> m_pool;
+
+    explicit EMessageSlab(size_t capacity);
+    ~EMessageSlab();
+
+    void recycle();
+
+public:
+    char* data() { return m_data; }
+    size_t capacity() const { return m_capacity; }
+
+    void issue() { ++m_issued; }
+    void retire();
+    void release();
+
+private:
+    // disable copy ctor (compatible with pre C++11 compiler hence =delete not used)
+    EMessageSlab(const EMessageSlab&);
+    EMessageSlab& operator=(const EMessageSlab&);
+};
+
+// Keeps a few default sized slabs around so that a steady stream does not
+// allocate. Slabs larger than the default (for oversized messages) are freed.
+class TWSAPIDLLEXP EMessageSlabPool : public std::enable_shared_from_this<EMessageSlabPool>
+{
+    friend class EMessageSlab;
+
+    std::mutex m_mutex;
+    std::vector<EMessageSlab*> m_free;
+    size_t m_slabSize;
+    size_t m_maxFree;
+    std::atomic<unsigned long> m_allocated;
+
+    void recycle(EMessageSlab* slab);
+
+public:
+    explicit EMessageSlabPool(size_t slabSize = MSG_SLAB_SIZE_DEFAULT, size_t maxFree = MSG_SLAB_POOL_MAX_FREE);
+    ~EMessageSlabPool();
+
+    EMessageSlab* acquire(size_t minCapacity);
+    size_t slabSize() const { return m_slabSize; }
+    unsigned long allocatedCount() const { return m_allocated.load(std::memory_order_relaxed); }
+};
+
+#endif
@@ -10,14 +10,41 @@
 #include "EPosixClientSocketPlatform.h"
 #include "EReaderSignal.h"
 #include "EMessage.h"
+#include "EMessageSlab.h"
+#include "EMessageRecorder.h"
+#include "ECycleClock.h"
 #include "DefaultEWrapper.h"
 
+#include <string.h>
+#include <thread>
+
+#if defined(IB_USE_EPOLL)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
 #define IN_BUF_SIZE_DEFAULT 8192
 
 static DefaultEWrapper defaultWrapper;
 
 EReader::EReader(EClientSocket* clientSocket, EReaderSignal* signal)
   : processMsgsDecoder_(clientSocket->EClient::serverVersion(), clientSocket->getWrapper(), clientSocket)
+  , m_pRecorder(0)
+  , m_pSlabPool(new EMessageSlabPool())
+  , m_readPos(0)
+  , m_writePos(0)
+  , m_carriedBytes(0)
+  , m_receivedTime(0)
+  , m_pollTimeoutMs(READER_POLL_TIMEOUT_MS_DEFAULT)
+  , m_busyPoll(false)
+#if defined(IB_USE_EPOLL)
+  , m_epollFd(epoll_create1(EPOLL_CLOEXEC))
+  , m_wakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+  , m_registeredFd(-1)
+  , m_socketReadable(false)
+  , m_socketWritable(false)
+#endif
 #if defined(IB_POSIX)
   , m_hReadThread(pthread_self())
 #elif defined(IB_WIN32)
@@ -27,8 +54,7 @@ EReader::EReader(EClientSocket* clientSocket, EReaderSignal* signal)
   m_isAlive = true;
   m_pClientSocket = clientSocket;
   m_pEReaderSignal = signal;
-  m_nMaxBufSize = IN_BUF_SIZE_DEFAULT;
-  m_buf.reserve(IN_BUF_SIZE_DEFAULT);
+  m_pSlab = m_pSlabPool->acquire(m_pSlabPool->slabSize());
 
   // Register EReader with clientSocket to ensure tidy reader thread shutdown during eDisconnect()
   clientSocket->registerEReader(this);
@@ -46,6 +72,18 @@ EReader::~EReader(void) {
     m_pClientSocket->eDisconnect();
   }
 #endif
+
+  // messages still held by consumers keep the slab alive
+  m_pSlab->retire();
+
+#if defined(IB_USE_EPOLL)
+  if (m_epollFd >= 0)
+    close(m_epollFd);
+  if (m_wakeFd >= 0)
+    close(m_wakeFd);
+#endif
+
+  m_pClientSocket->unregisterEReader(this);
 }
 
 void EReader::start() {
@@ -62,11 +100,13 @@ void EReader::stop() {
 #if defined(IB_POSIX)
   if (!pthread_equal(pthread_self(), m_hReadThread)) {
     m_isAlive = false;
+    wakeUp();
     pthread_join(m_hReadThread, NULL);
   }
 #elif defined(IB_WIN32)
   if (m_hReadThread) {
     m_isAlive = false;
+    wakeUp();
     WaitForSingleObject(m_hReadThread, INFINITE);
   }
 #endif
@@ -90,7 +130,7 @@ void EReader::readToQueue() {
   //EMessage *msg = 0;
 
   while (m_isAlive) {
-    if (m_buf.size() == 0 && !processNonBlockingSelect() && m_pClientSocket->isSocketOK())
+    if (pendingBytes() == 0 && !processSocketEvents() && m_pClientSocket->isSocketOK())
       continue;
 
     if (!putMessageToQueue())
@@ -99,6 +139,7 @@ void EReader::readToQueue() {
 
   m_pClientSocket->handleSocketError();
   m_pEReaderSignal->issueSignal(); //letting client know that socket was closed
+  m_msgQueue.wakeAll();
 }
 
 bool EReader::putMessageToQueue() {
@@ -110,22 +151,168 @@ bool EReader::putMessageToQueue() {
   if (msg == 0)
     return false;
 
-  {
-    EMutexGuard lock(m_csMsgQueue);
-    m_msgQueue.push_back(std::shared_ptr<EMessage>(msg));
+  // set before start(), so the reader thread is the only one that reads it
+  if (m_pRecorder)
+    m_pRecorder->record(msg->begin(), msg->end());
+
+  msg->setEnqueuedTime(ECycleClock::now());
+
+  // the queue is bounded; wait for the consumers rather than drop a message
+  while (!m_msgQueue.push(msg)) {
+    if (!m_isAlive) {
+      delete msg;
+      return false;
+    }
+    std::this_thread::yield();
+  }
+
+  // consumers that drain the queue before waiting only need a signal when it was empty
+  if (m_msgQueue.depth() <= 1)
+    m_pEReaderSignal->issueSignal();
+
+  return true;
+}
+
+void EReader::setPollTimeout(int timeoutMs) {
+  m_pollTimeoutMs = timeoutMs > 0 ? timeoutMs : READER_POLL_TIMEOUT_MS_DEFAULT;
+}
+
+// Busy polling never sleeps in the kernel: the reader thread spins on a zero
+// timeout poll, trading a core for the wake-up latency of the socket.
+void EReader::setBusyPoll(bool busyPoll) {
+  m_busyPoll = busyPoll;
+}
+
+// Interrupts a poll in progress, e.g. when a request could not be sent in full
+// or when the reader is being stopped.
+void EReader::wakeUp() {
+#if defined(IB_USE_EPOLL)
+  uint64_t one = 1;
+
+  if (m_wakeFd >= 0 && write(m_wakeFd, &one, sizeof(one)) < 0) {
+    // the counter is already non-zero, the reader will wake anyway
+  }
+#endif
+}
+
+bool EReader::processSocketEvents() {
+#if defined(IB_USE_EPOLL)
+  if (m_epollFd >= 0 && m_wakeFd >= 0)
+    return processEpollEvents();
+#endif
+
+  return processNonBlockingSelect();
+}
+
+#if defined(IB_USE_EPOLL)
+bool EReader::registerSocket(int fd) {
+  struct epoll_event ev;
+
+  if (m_registeredFd < 0) {
+    ev.events = EPOLLIN;
+    ev.data.fd = m_wakeFd;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeFd, &ev) < 0)
+      return false;
   }
+  else {
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, m_registeredFd, 0);
+  }
+
+  ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+  ev.data.fd = fd;
+  if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &ev) < 0)
+    return false;
 
-  m_pEReaderSignal->issueSignal();
+  m_registeredFd = fd;
+  m_socketReadable = false;
+  m_socketWritable = false;
 
   return true;
 }
 
+// Edge-triggered: an edge is only reported once, so the readable and writable
+// states are remembered until a short read or a blocked send clears them, and
+// the reader does not sleep while the socket may still hold data.
+bool EReader::processEpollEvents() {
+  int fd = m_pClientSocket->fd();
+
+  if (fd < 0)
+    return false;
+
+  if (fd != m_registeredFd && !registerSocket(fd))
+    return processNonBlockingSelect();
+
+  struct epoll_event events[2];
+  int timeout = (m_socketReadable || m_busyPoll) ? 0 : m_pollTimeoutMs.load();
+  int ret = epoll_wait(m_epollFd, events, 2, timeout);
+
+  if (ret < 0) {
+    if (errno == EINTR)
+      return false;
+
+    m_pClientSocket->eDisconnect();
+    return false;
+  }
+
+  bool woken = false;
+
+  for (int i = 0; i < ret; i++) {
+    if (events[i].data.fd == m_wakeFd) {
+      uint64_t count;
+
+      if (read(m_wakeFd, &count, sizeof(count)) < 0) {
+        // already drained
+      }
+      woken = true;
+      continue;
+    }
+
+    if (events[i].events & EPOLLERR) {
+      int error = 0;
+      socklen_t len = sizeof(error);
+
+      getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len);
+      errno = error;
+      m_pClientSocket->onError();
+    }
+
+    // a hang-up is seen by recv() returning 0
+    if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP))
+      m_socketReadable = true;
+
+    if (events[i].events & EPOLLOUT)
+      m_socketWritable = true;
+  }
+
+  if (m_pClientSocket->fd() < 0)
+    return false;
+
+  if (m_socketWritable && !m_pClientSocket->getTransport()->isOutBufferEmpty()) {
+    onSend();
+
+    if (!m_pClientSocket->getTransport()->isOutBufferEmpty())
+      m_socketWritable = false;
+  }
+
+  if (m_pClientSocket->fd() < 0)
+    return false;
+
+  if (m_socketReadable) {
+    onReceive();
+    return true;
+  }
+
+  return ret > (woken ? 1 : 0);
+}
+#endif
+
 bool EReader::processNonBlockingSelect() {
   fd_set readSet, writeSet, errorSet;
   struct timeval tval;
+  int timeoutMs = m_busyPoll ? 0 : m_pollTimeoutMs.load();
 
-  tval.tv_usec = 100 * 1000; //100 ms
-  tval.tv_sec = 0;
+  tval.tv_usec = (timeoutMs % 1000) * 1000;
+  tval.tv_sec = timeoutMs / 1000;
 
   if (m_pClientSocket->fd() >= 0) {
 
@@ -180,37 +367,57 @@ bool EReader::processNonBlockingSelect() {
 }
 
 void EReader::onSend() {
-  m_pEReaderSignal->issueSignal();
+  // the transport serializes this flush with request threads appending to it
+  m_pClientSocket->onSend();
 }
 
 void EReader::onReceive() {
-  int nOffset = m_buf.size();
+  reserveSlabSpace(pendingBytes() + IN_BUF_SIZE_DEFAULT);
 
-  m_buf.resize(m_nMaxBufSize);
+  size_t space = m_pSlab->capacity() - m_writePos;
+  int nRes = m_pClientSocket->receive(m_pSlab->data() + m_writePos, space);
 
-  int nRes = m_pClientSocket->receive(m_buf.data() + nOffset, m_buf.size() - nOffset);
+#if defined(IB_USE_EPOLL)
+  // a short read means the socket was drained; the next arrival raises a new edge
+  if (nRes < (int)space)
+    m_socketReadable = false;
+#endif
 
   if (nRes <= 0)
     return;
 
-  m_buf.resize(nRes + nOffset);
+  m_writePos += nRes;
+  m_receivedTime = ECycleClock::now();
 }
 
-bool EReader::bufferedRead(char* buf, unsigned int size) {
-  while (size > 0) {
-    while (m_buf.size() < size && m_buf.size() < m_nMaxBufSize) {
-      if (!processNonBlockingSelect() && !m_pClientSocket->isSocketOK())
-        return false;
-    }
+// Makes room for size bytes starting at m_readPos. When the current slab is too
+// short, only the unconsumed tail (at most one partial message) is carried over
+// to a fresh slab and the old slab is retired.
+void EReader::reserveSlabSpace(size_t size) {
+  if (m_readPos + size <= m_pSlab->capacity())
+    return;
 
-    int nBytes = (std::min<unsigned int>)(m_nMaxBufSize, size);
+  EMessageSlab* slab = m_pSlabPool->acquire(size + IN_BUF_SIZE_DEFAULT);
+  size_t pending = pendingBytes();
 
-    std::copy(m_buf.begin(), m_buf.begin() + nBytes, buf);
-    std::copy(m_buf.begin() + nBytes, m_buf.end(), m_buf.begin());
-    m_buf.resize(m_buf.size() - nBytes);
+  memcpy(slab->data(), m_pSlab->data() + m_readPos, pending);
+  m_carriedBytes.fetch_add(pending, std::memory_order_relaxed);
 
-    size -= nBytes;
-    buf += nBytes;
+  m_pSlab->retire();
+  m_pSlab = slab;
+  m_readPos = 0;
+  m_writePos = pending;
+}
+
+bool EReader::fillBuffer(size_t size) {
+  reserveSlabSpace(size);
+
+  while (pendingBytes() < size) {
+    if (!processSocketEvents() && !m_pClientSocket->isSocketOK())
+      return false;
+
+    if (!m_isAlive)
+      return false;
   }
 
   return true;
@@ -220,20 +427,26 @@ EMessage* EReader::readSingleMsg() {
   if (m_pClientSocket->usingV100Plus()) {
     int msgSize;
 
-    if (!bufferedRead((char*)&msgSize, sizeof(msgSize)))
+    if (!fillBuffer(sizeof(msgSize)))
       return 0;
 
+    memcpy(&msgSize, m_pSlab->data() + m_readPos, sizeof(msgSize));
     msgSize = ntohl(msgSize);
 
     if (msgSize <= 0 || msgSize > MAX_MSG_LEN)
       return 0;
 
-    std::vector<char> buf = std::vector<char>(msgSize);
-
-    if (!bufferedRead(buf.data(), buf.size()))
+    if (!fillBuffer(sizeof(msgSize) + msgSize))
       return 0;
 
-    return new EMessage(buf);
+    const char* pBegin = m_pSlab->data() + m_readPos + sizeof(msgSize);
+
+    m_readPos += sizeof(msgSize) + msgSize;
+    m_pSlab->issue();
+
+    EMessage* msg = new EMessage(m_pSlab, pBegin, pBegin + msgSize);
+    msg->setReceivedTime(m_receivedTime);
+    return msg;
   }
   else {
     const char* pBegin = 0;
@@ -242,64 +455,42 @@ EMessage* EReader::readSingleMsg() {
 
     while (msgSize == 0)
     {
-      if (m_buf.size() >= m_nMaxBufSize * 3 / 4)
-        m_nMaxBufSize *= 2;
+      if (!processSocketEvents() && !m_pClientSocket->isSocketOK())
+        return 0;
 
-      if (!processNonBlockingSelect() && !m_pClientSocket->isSocketOK())
+      if (!m_isAlive)
         return 0;
 
-      pBegin = m_buf.data();
-      pEnd = pBegin + m_buf.size();
+      pBegin = m_pSlab->data() + m_readPos;
+      pEnd = m_pSlab->data() + m_writePos;
       msgSize = EDecoder(m_pClientSocket->EClient::serverVersion(), &defaultWrapper).parseAndProcessMsg(pBegin, pEnd);
     }
 
-    std::vector<char> msgData(msgSize);
-
-    if (!bufferedRead(msgData.data(), msgSize))
-      return 0;
-
-    if (m_buf.size() < IN_BUF_SIZE_DEFAULT && m_buf.capacity() > IN_BUF_SIZE_DEFAULT)
-    {
-      m_buf.resize(m_nMaxBufSize = IN_BUF_SIZE_DEFAULT);
-      m_buf.shrink_to_fit();
-    }
+    pBegin = m_pSlab->data() + m_readPos;
 
-    EMessage* msg = new EMessage(msgData);
+    m_readPos += msgSize;
+    m_pSlab->issue();
 
+    EMessage* msg = new EMessage(m_pSlab, pBegin, pBegin + msgSize);
+    msg->setReceivedTime(m_receivedTime);
     return msg;
   }
 }
 
-std::shared_ptr<EMessage> EReader::getMsg(void) {
-  EMutexGuard lock(m_csMsgQueue);
-
-  if (m_msgQueue.size() == 0) {
-    return std::shared_ptr<EMessage>();
-  }
-
-  std::shared_ptr<EMessage> msg = m_msgQueue.front();
-  m_msgQueue.pop_front();
-
-  return msg;
+std::unique_ptr<EMessage> EReader::getMsg(void) {
+  return std::unique_ptr<EMessage>(m_msgQueue.pop());
 }
 
 
 void EReader::processMsgs(void) {
   m_pClientSocket->onSend();
 
-  std::shared_ptr<EMessage> msg = getMsg();
-
-  if (!msg.get())
-    return;
-
-  const char* pBegin = msg->begin();
-
-  while (processMsgsDecoder_.parseAndProcessMsg(pBegin, msg->end()) > 0) {
-    msg = getMsg();
-
-    if (!msg.get())
-      break;
+  // drain the whole queue: the reader only signals when the queue was empty,
+  // so messages left behind here would not be announced again
+  std::unique_ptr<EMessage> msg;
 
-    pBegin = msg->begin();
+  while ((msg = getMsg()).get()) {
+    const char* pBegin = msg->begin();
+    processMsgsDecoder_.parseAndProcessMsg(pBegin, msg->end());
   }
 }
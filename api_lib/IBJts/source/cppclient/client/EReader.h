@@ -7,34 +7,64 @@
 
 #include <atomic>
 #include <deque>
+#include <memory>
 #include "platformspecific.h"
 #include "EDecoder.h"
 #include "EMutex.h"
+#include "EMessageQueue.h"
+#include "EMessageSlab.h"
 #include "EReaderOSSignal.h"
 
+#if defined(__linux__)
+#define IB_USE_EPOLL
+#endif
+
+#define READER_POLL_TIMEOUT_MS_DEFAULT 100
+
 class EClientSocket;
 struct EReaderSignal;
 class EMessage;
+class EMessageRecorder;
 
 class TWSAPIDLLEXP EReader
 {  
     EClientSocket *m_pClientSocket;
     EReaderSignal *m_pEReaderSignal;
     EDecoder processMsgsDecoder_;
-    std::deque<std::shared_ptr<EMessage>> m_msgQueue;
-    EMutex m_csMsgQueue;
-    std::vector<char> m_buf;
+    EMessageQueue m_msgQueue;
+    EMessageRecorder* m_pRecorder;
+    std::shared_ptr<EMessageSlabPool> m_pSlabPool;
+    EMessageSlab* m_pSlab;
+    size_t m_readPos;       // first slab byte not yet handed out in a message
+    size_t m_writePos;      // end of the bytes received into the slab
+    std::atomic<unsigned long long> m_carriedBytes;   // bytes copied when a message straddled two slabs
+    unsigned long long m_receivedTime;  // ECycleClock ticks of the last recv() that returned data
     std::atomic<bool> m_isAlive;
+    std::atomic<int> m_pollTimeoutMs;
+    std::atomic<bool> m_busyPoll;
+#if defined(IB_USE_EPOLL)
+    int m_epollFd;
+    int m_wakeFd;
+    int m_registeredFd;
+    bool m_socketReadable;  // edge seen and not yet drained by a short read
+    bool m_socketWritable;  // edge seen and no send has hit EWOULDBLOCK since
+#endif
 #if defined(IB_POSIX)
     pthread_t m_hReadThread;
 #elif defined(IB_WIN32)
     HANDLE m_hReadThread;
 #endif
-	unsigned int m_nMaxBufSize;
 
 	void onReceive();
 	void onSend();
-	bool bufferedRead(char *buf, unsigned int size);
+	size_t pendingBytes() const { return m_writePos - m_readPos; }
+	void reserveSlabSpace(size_t size);
+	bool fillBuffer(size_t size);
+	bool processSocketEvents();
+#if defined(IB_USE_EPOLL)
+	bool registerSocket(int fd);
+	bool processEpollEvents();
+#endif
     
 
 public:
@@ -43,7 +73,7 @@ public:
 
 protected:
 	bool processNonBlockingSelect();
-    std::shared_ptr<EMessage> getMsg(void);
+    std::unique_ptr<EMessage> getMsg(void);
     void readToQueue();
 #if defined(IB_POSIX)
     static void * readToQueueThread(void * lpParam);
@@ -60,9 +90,14 @@ public:
 	bool putMessageToQueue();
 	void start();
     void stop();
-    EMutex& getMsgQueueMutex() { return m_csMsgQueue; }
-    std::deque<std::shared_ptr<EMessage>>& getMsgQueue() { return m_msgQueue; }
+    EMessageQueue& getMsgQueue() { return m_msgQueue; }
     EDecoder& getProcessMsgsDecoder() { return processMsgsDecoder_; }
+    void setPollTimeout(int timeoutMs);
+    void setBusyPoll(bool busyPoll);
+    void wakeUp();
+    void setRecorder(EMessageRecorder* recorder) { m_pRecorder = recorder; }
+    unsigned long getSlabAllocatedCount() const { return m_pSlabPool->allocatedCount(); }
+    unsigned long long getCarriedBytes() const { return m_carriedBytes.load(std::memory_order_relaxed); }
 };
 
 #endif
\ No newline at end of file
@@ -23,6 +23,8 @@ ESocket::~ESocket(void) {
 }
 
 int ESocket::send(EMessage *pMsg) {
+    EMutexGuard lock(m_outBufferMutex);
+
     return bufferedSend(pMsg->begin(), pMsg->end() - pMsg->begin());
 }
 
@@ -33,7 +35,7 @@ int ESocket::bufferedSend(const char* buf, size_t sz)
 
 	if( !m_outBuffer.empty()) {
 		m_outBuffer.insert( m_outBuffer.end(), buf, buf + sz);
-		return sendBufferedData();
+		return flushOutBuffer();
 	}
 
 	int nResult = send(buf, sz);
@@ -47,6 +49,13 @@ int ESocket::bufferedSend(const char* buf, size_t sz)
 }
 
 int ESocket::sendBufferedData()
+{
+	EMutexGuard lock(m_outBufferMutex);
+
+	return flushOutBuffer();
+}
+
+int ESocket::flushOutBuffer()
 {
 	if( m_outBuffer.empty())
 		return 0;
@@ -102,5 +111,7 @@ void ESocket::CleanupBuffer(std::vector<char>& buffer, int processed)
 
 bool ESocket::isOutBufferEmpty() const
 {
+	EMutexGuard lock(m_outBufferMutex);
+
 	return m_outBuffer.empty();
 }
@@ -6,6 +6,7 @@
 #define TWS_API_CLIENT_ESOCKET_H
 
 #include "ETransport.h"
+#include "EMutex.h"
 #include <vector>
 
 class ESocket :
@@ -13,8 +14,10 @@ class ESocket :
 {
     int m_fd;
 	std::vector<char> m_outBuffer;
+	mutable EMutex m_outBufferMutex;   // request threads send while the reader thread flushes
 
     int bufferedSend(const char* buf, size_t sz);
+    int flushOutBuffer();
     int send(const char* buf, size_t sz);
     void CleanupBuffer(std::vector<char>& buffer, int processed);
 
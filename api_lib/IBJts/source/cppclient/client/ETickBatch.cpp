@@ -0,0 +1,25 @@
+﻿/* Copyright (C) 2024 Interactive Brokers LLC. All rights reserved. This code is subject to the terms
+ * and conditions of the IB API Non-Commercial License or the IB API Commercial License, as applicable. */
+
+#include "StdAfx.h"
+#include "ETickBatch.h"
+
+ETickBatch::ETickBatch(ETickBatchCallback callback, void* context, size_t capacity)
+  : m_ticks(capacity > 0 ? capacity : 1)
+  , m_count(0)
+  , m_receivedTime(0)
+  , m_decodedTime(0)
+  , m_callback(callback)
+  , m_context(context)
+{
+}
+
+void ETickBatch::flush()
+{
+  if (m_count == 0)
+    return;
+  // cleared first so that the callback sees an empty batch if it flushes again
+  size_t count = m_count;
+  m_count = 0;
+  m_callback(m_context, m_ticks.data(), count);
+}
@@ -0,0 +1,85 @@
+﻿/* Copyright (C) 2024 Interactive Brokers LLC. All rights reserved. This code is subject to the terms
+ * and conditions of the IB API Non-Commercial License or the IB API Commercial License, as applicable. */
+
+#pragma once
+#ifndef TWS_API_CLIENT_ETICKBATCH_H
+#define TWS_API_CLIENT_ETICKBATCH_H
+
+#include <stddef.h>
+#include <vector>
+#include "platformspecific.h"
+#include "CommonDefs.h"
+#include "Decimal.h"
+
+#define ETICK_SIZE_LENGTH 24            // longest size field kept, including its terminating NUL
+#define ETICK_BATCH_DEFAULT_CAPACITY 256
+
+// A TICK_PRICE or TICK_SIZE message as decoded on the EDecoder fast path. Plain
+// data, so a batch of ticks is one contiguous array.
+//
+// A TICK_PRICE message carries a price and the size that goes with it; its
+// tickType is the price tick type and the size belongs to the matching size
+// tick type (BID_SIZE for BID and so on), as EWrapper::tickSize would report it.
+// A TICK_SIZE message only carries a size. The size is kept as the text TWS
+// sent and only converted to a Decimal by sizeDecimal() when it is needed.
+struct ETick {
+  TickerId tickerId;
+  double price;                   // 0 for a TICK_SIZE message
+  int tickType;
+  int attrMask;                   // TICK_PRICE attribute bits as sent, see TickAttrib; 0 for a TICK_SIZE message
+  bool isPrice;                   // true for a TICK_PRICE message
+  char size[ETICK_SIZE_LENGTH];   // the size field, NUL-terminated
+  unsigned long long receivedTime;  // ECycleClock stamps of the message, see ETickBatch::setMessageTimes;
+  unsigned long long decodedTime;   // 0 if the owner does not stamp messages
+
+  Decimal sizeDecimal() const { return DecimalFunctions::stringToDecimal(size); }
+};
+
+// Receives a batch of ticks. The ticks are only valid during the call.
+typedef void (*ETickBatchCallback)(void* context, const ETick* ticks, size_t count);
+
+// Collects the ticks an EDecoder decodes on its fast path and hands them to a
+// callback in batches: when the batch is full, before the decoder processes a
+// message that is not a tick (so callbacks keep the order of the messages), and
+// whenever the owner calls flush(). One batch per decoder; not thread safe.
+class TWSAPIDLLEXP ETickBatch
+{
+  std::vector<ETick> m_ticks;
+  size_t m_count;
+  unsigned long long m_receivedTime;
+  unsigned long long m_decodedTime;
+  ETickBatchCallback m_callback;
+  void* m_context;
+
+public:
+  ETickBatch(ETickBatchCallback callback, void* context, size_t capacity = ETICK_BATCH_DEFAULT_CAPACITY);
+
+  // The slot for the next tick, delivering the batch first if it is full.
+  ETick& append() {
+    if (m_count == m_ticks.size())
+      flush();
+    ETick& tick = m_ticks[m_count++];
+    tick.receivedTime = m_receivedTime;
+    tick.decodedTime = m_decodedTime;
+    return tick;
+  }
+
+  // The stamps of the message about to be decoded, copied into each of its ticks
+  // so they can be traced when the batch is delivered, which may be after later
+  // messages were decoded.
+  void setMessageTimes(unsigned long long receivedTime, unsigned long long decodedTime) {
+    m_receivedTime = receivedTime;
+    m_decodedTime = decodedTime;
+  }
+
+  void flush();
+  size_t size() const { return m_count; }
+  size_t capacity() const { return m_ticks.size(); }
+
+private:
+  // disable copy ctor (compatible with pre C++11 compiler hence =delete not used)
+  ETickBatch(const ETickBatch&);
+  ETickBatch& operator=(const ETickBatch&);
+};
+
+#endif
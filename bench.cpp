@@ -0,0 +1,790 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+/*
+Micro and macro benchmarks of the tick path, built and run by `make bench`.
+
+Usage: benchmarks [--filter=substring] [--min-time=seconds] [--out=path]
+
+Every benchmark runs with a growing iteration count until one run takes at least
+the minimum time (0.5 seconds by default), in the manner of Google Benchmark.
+A table is printed to stdout and the results are written as Google Benchmark
+compatible JSON to the output file (bench.json by default), with the commit the
+binary was built from in the context, so results can be compared across commits.
+
+The micro benchmarks time single operations of the tick path. The macro
+benchmarks generate a recording of synthetic ticks and replay it as fast as
+possible through the reader queue, the message dispatcher and its workers, and
+My_wrapper into the OptionChainManager, with 1, 2 and 4 workers, both tick by tick
+and with tick batching.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <random>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "EClientSocket.h"
+#include "EDecoder.h"
+#include "EMessageRecorder.h"
+#include "EMessageReplay.h"
+#include "EReader.h"
+#include "EReaderOSSignal.h"
+#include "globals.h"
+#include "messageDispatcher.h"
+#include "quoteSegment.h"
+#include "tickCapture.h"
+
+using namespace std;
+
+#ifndef BENCH_GIT_COMMIT
+#define BENCH_GIT_COMMIT "unknown"
+#endif
+
+#define BENCH_DEFAULT_MIN_TIME 0.5
+#define BENCH_DEFAULT_OUT "bench.json"
+#define BENCH_MAX_ITERATIONS 1000000000ULL
+#define BENCH_STRIKES 200
+#define BENCH_FIRST_STRIKE 5300.0
+#define BENCH_STRIKE_STEP 5.0
+#define BENCH_MESSAGE_POOL 256              // distinct messages cycled through by the micro benchmarks
+#define BENCH_REPLAY_TICKS 200000           // ticks in the recording replayed by the macro benchmarks
+#define BENCH_CAPTURE_TICKS 8192            // ticks captured per file by BM_CaptureTicks, fewer than fit a capture ring
+
+/**
+ * Keeps the compiler from optimizing away a value that is computed but not used.
+ */
+template <class T>
+static inline void doNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+static double cpuSeconds(clockid_t clock) {
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * Iteration state of one benchmark run: the loop condition, the timers and the
+ * counters reported with the result.
+ */
+class BenchmarkState {
+
+private:
+
+    uint64_t iterations;
+    uint64_t remaining;
+    clockid_t cpuClock;
+    chrono::steady_clock::time_point realStart;
+    double cpuStart = 0.0;
+    bool isTiming = false;
+
+    void startTimer() {
+        this->realStart = chrono::steady_clock::now();
+        this->cpuStart = cpuSeconds(this->cpuClock);
+        this->isTiming = true;
+    }
+
+    void stopTimer() {
+        this->realTime += chrono::duration<double>(chrono::steady_clock::now() - this->realStart).count();
+        this->cpuTime += cpuSeconds(this->cpuClock) - this->cpuStart;
+        this->isTiming = false;
+    }
+
+public:
+
+    double realTime = 0.0;
+    double cpuTime = 0.0;
+    uint64_t itemsProcessed = 0;
+    uint64_t bytesProcessed = 0;
+
+    BenchmarkState(uint64_t iterations, clockid_t cpuClock)
+        : iterations(iterations), remaining(iterations), cpuClock(cpuClock) {}
+
+    /**
+     * The loop condition of a benchmark: while (state.keepRunning()) { ... }
+     */
+    bool keepRunning() {
+        if (this->remaining == this->iterations && !this->isTiming) startTimer();
+        if (this->remaining-- > 0) return true;
+        if (this->isTiming) stopTimer();
+        return false;
+    }
+
+    void pauseTiming() { stopTimer(); }
+    void resumeTiming() { startTimer(); }
+    uint64_t getIterations() const { return this->iterations; }
+};
+
+struct Benchmark {
+    string name;
+    function<void(BenchmarkState&)> run;
+    bool measureProcessCpu;     // count the CPU time of every thread, for benchmarks that use worker threads
+};
+
+struct BenchmarkResult {
+    string name;
+    uint64_t iterations;
+    double realTimeNs;
+    double cpuTimeNs;
+    double itemsPerSecond;
+    double bytesPerSecond;
+};
+
+/**
+ * Callbacks of the decoder benchmarks. Only counts, so decoding is all that is timed.
+ */
+class CountingWrapper : public DefaultEWrapper {
+public:
+    uint64_t ticks = 0;
+    void tickPrice(TickerId, TickType, double, const TickAttrib&) override { this->ticks++; }
+    void tickSize(TickerId, TickType, Decimal) override { this->ticks++; }
+    void tickOptionComputation(TickerId, TickType, int, double, double, double, double, double, double, double,
+                               double) override { this->ticks++; }
+};
+
+/**
+ * The application's wrapper, counting the ticks it has applied so a replay can
+ * be timed to its last tick.
+ */
+class ReplayWrapper : public My_wrapper {
+public:
+    atomic<uint64_t> ticks{0};
+    void tickPrice(TickerId tickerId, TickType field, double price, const TickAttrib& attrib) override {
+        My_wrapper::tickPrice(tickerId, field, price, attrib);
+        this->ticks.fetch_add(1, memory_order_release);
+    }
+};
+
+/**
+ * A client that is connected as far as EClient is concerned but keeps what it
+ * sends, so requests can be encoded without a socket.
+ */
+class EncodingClient : public EClientSocket {
+public:
+    size_t bytesSent = 0;
+
+    EncodingClient(EWrapper* wrapper, EReaderSignal* signal) : EClientSocket(wrapper, signal) {
+        asyncEConnect(true);
+        serverVersion(MAX_CLIENT_VER, "");
+    }
+
+protected:
+    bool closeAndSend(std::string message, unsigned) override {
+        this->bytesSent += message.size();
+        doNotOptimize(message);
+        return true;
+    }
+};
+
+static void appendField(string& message, const string& field) {
+    message.append(field);
+    message.push_back('\0');
+}
+
+/**
+ * Builds the body of a delayed tick price message, as EReader hands it to the decoder.
+ */
+static string tickPriceMessage(TickerId tickerId, int tickType, double price) {
+
+    char text[32];
+    string message;
+
+    snprintf(text, sizeof(text), "%.2f", price);
+    appendField(message, to_string(TICK_PRICE));
+    appendField(message, "6");
+    appendField(message, to_string(tickerId));
+    appendField(message, to_string(tickType));
+    appendField(message, text);
+    appendField(message, "1");
+    appendField(message, "0");
+    return message;
+}
+
+/**
+ * Builds random delayed bid, ask and last ticks over the benchmark chain, about
+ * nine bids and nine asks to every last.
+ */
+static vector<string> randomTicks(size_t count, unsigned int seed) {
+
+    static const int tickTypes[] = {DELAYED_BID, DELAYED_ASK, DELAYED_LAST};
+    mt19937 random(seed);
+    uniform_int_distribution<TickerId> tickerChoice(0, 2 * BENCH_STRIKES);
+    uniform_int_distribution<int> fieldChoice(0, 19);
+    uniform_real_distribution<double> priceChoice(0.25, 400.0);
+    vector<string> messages;
+
+    for (size_t i = 0; i < count; i++) {
+        int choice = fieldChoice(random);
+        messages.push_back(tickPriceMessage(tickerChoice(random), tickTypes[choice < 9 ? 0 : choice < 18 ? 1 : 2],
+                                            priceChoice(random)));
+    }
+    return messages;
+}
+
+/**
+ * Builds random delayed bid, ask and last size ticks over the benchmark chain.
+ */
+static vector<string> randomSizeTicks(size_t count, unsigned int seed) {
+
+    static const int tickTypes[] = {DELAYED_BID_SIZE, DELAYED_ASK_SIZE, DELAYED_LAST_SIZE};
+    mt19937 random(seed);
+    uniform_int_distribution<TickerId> tickerChoice(0, 2 * BENCH_STRIKES);
+    uniform_int_distribution<int> fieldChoice(0, 2);
+    uniform_int_distribution<int> sizeChoice(1, 2500);
+    vector<string> messages;
+
+    for (size_t i = 0; i < count; i++) {
+        string message;
+        appendField(message, to_string(TICK_SIZE));
+        appendField(message, "6");
+        appendField(message, to_string(tickerChoice(random)));
+        appendField(message, to_string(tickTypes[fieldChoice(random)]));
+        appendField(message, to_string(sizeChoice(random)));
+        messages.push_back(message);
+    }
+    return messages;
+}
+
+/**
+ * Builds random delayed model option computations over the benchmark chain, with
+ * every Greek and the underlying price filled in as TWS sends them.
+ */
+static vector<string> randomOptionComputationTicks(size_t count, unsigned int seed) {
+
+    mt19937 random(seed);
+    uniform_int_distribution<TickerId> tickerChoice(1, 2 * BENCH_STRIKES);
+    uniform_real_distribution<double> unitChoice(0.0, 1.0);
+    vector<string> messages;
+
+    for (size_t i = 0; i < count; i++) {
+
+        char text[32];
+        string message;
+        appendField(message, to_string(TICK_OPTION_COMPUTATION));
+        appendField(message, to_string(tickerChoice(random)));
+        appendField(message, to_string(DELAYED_MODEL_OPTION_COMPUTATION));
+        appendField(message, "1");
+
+        //implied volatility, delta, option price, dividends, gamma, vega, theta, underlying price
+        double values[] = {0.1 + 0.3 * unitChoice(random), unitChoice(random), 400.0 * unitChoice(random), 0.0,
+                           0.01 * unitChoice(random), 10.0 * unitChoice(random), -5.0 * unitChoice(random),
+                           5800.0 + 10.0 * unitChoice(random)};
+        for (double value : values) {
+            snprintf(text, sizeof(text), "%.17g", value);
+            appendField(message, text);
+        }
+        messages.push_back(message);
+    }
+    return messages;
+}
+
+static set<double> benchmarkStrikes() {
+    set<double> strikes;
+    for (int i = 0; i < BENCH_STRIKES; i++) strikes.insert(BENCH_FIRST_STRIKE + i * BENCH_STRIKE_STEP);
+    return strikes;
+}
+
+//micro benchmarks
+
+static void countBatch(void* context, const ETick*, size_t count) {
+    static_cast<CountingWrapper*>(context)->ticks += count;
+}
+
+static void benchDecode(BenchmarkState& state, const vector<string>& messages, bool batched) {
+
+    CountingWrapper wrapper;
+    EDecoder decoder(MAX_CLIENT_VER, &wrapper);
+    ETickBatch tickBatch(countBatch, &wrapper);
+    size_t i = 0;
+
+    if (batched) decoder.setTickBatch(&tickBatch);
+
+    while (state.keepRunning()) {
+        const string& message = messages[i++ % messages.size()];
+        const char* begin = message.data();
+        doNotOptimize(decoder.parseAndProcessMsg(begin, message.data() + message.size()));
+        state.bytesProcessed += message.size();
+    }
+    state.itemsProcessed = state.getIterations();
+}
+
+static void benchDecodeFieldDouble(BenchmarkState& state) {
+
+    string fields;
+    mt19937 random(2);
+    uniform_real_distribution<double> priceChoice(0.25, 6000.0);
+
+    for (int i = 0; i < BENCH_MESSAGE_POOL; i++) {
+        char text[32];
+        snprintf(text, sizeof(text), "%.2f", priceChoice(random));
+        appendField(fields, text);
+    }
+
+    const char* end = fields.data() + fields.size();
+    const char* ptr = fields.data();
+
+    while (state.keepRunning()) {
+        double value;
+        if (ptr == end) ptr = fields.data();
+        EDecoder::DecodeField(value, ptr, end);
+        doNotOptimize(value);
+    }
+    state.itemsProcessed = state.getIterations();
+    state.bytesProcessed = state.getIterations() * fields.size() / BENCH_MESSAGE_POOL;
+}
+
+static void benchUpdateQuote(BenchmarkState& state, void (OptionChainManager::*update)(TickerId, double)) {
+
+    mt19937 random(3);
+    uniform_int_distribution<TickerId> tickerChoice(0, 2 * BENCH_STRIKES);
+    uniform_real_distribution<double> priceChoice(0.25, 400.0);
+    vector<pair<TickerId, double>> ticks;
+
+    for (int i = 0; i < BENCH_MESSAGE_POOL; i++) ticks.emplace_back(tickerChoice(random), priceChoice(random));
+
+    OptionChainManager& manager = *chainRegistry.getDisplayedChain();
+    size_t i = 0;
+
+    while (state.keepRunning()) {
+        const pair<TickerId, double>& tick = ticks[i++ % BENCH_MESSAGE_POOL];
+        (manager.*update)(tick.first, tick.second);
+    }
+    state.itemsProcessed = state.getIterations();
+}
+
+static void benchGetQuote(BenchmarkState& state) {
+
+    mt19937 random(9);
+    uniform_int_distribution<TickerId> tickerChoice(0, 2 * BENCH_STRIKES);
+    vector<TickerId> tickerIds;
+
+    for (int i = 0; i < BENCH_MESSAGE_POOL; i++) tickerIds.push_back(tickerChoice(random));
+
+    OptionChainManager& manager = *chainRegistry.getDisplayedChain();
+    size_t i = 0;
+
+    while (state.keepRunning()) {
+        QuoteSnapshot quote = manager.getQuote(tickerIds[i++ % BENCH_MESSAGE_POOL]);
+        doNotOptimize(quote);
+    }
+    state.itemsProcessed = state.getIterations();
+}
+
+static void benchLookupContractKey(BenchmarkState& state) {
+
+    OptionChainManager& manager = *chainRegistry.getDisplayedChain();
+    mt19937 random(10);
+    uniform_int_distribution<size_t> strikeChoice(0, BENCH_STRIKES - 1);
+    uniform_int_distribution<int> rightChoice(0, 1);
+    vector<ContractKey> keys;
+
+    for (int i = 0; i < BENCH_MESSAGE_POOL; i++) keys.push_back(manager.getOptionKey(strikeChoice(random), rightChoice(random) == 0));
+
+    size_t i = 0;
+
+    while (state.keepRunning()) {
+        TickerId tickerId = manager.getTickerId(keys[i++ % BENCH_MESSAGE_POOL]);
+        doNotOptimize(tickerId);
+    }
+    state.itemsProcessed = state.getIterations();
+}
+
+static void benchQuoteSegment(BenchmarkState& state, bool isRead) {
+
+    set<double> strikeSet = benchmarkStrikes();
+    vector<double> strikes(strikeSet.begin(), strikeSet.end());
+    string name = "/optionchain-bench." + to_string(getpid());
+    QuoteSegment segment;
+    QuoteSegmentReader reader;
+
+    if (!segment.create(name, "ES", "20250321", strikes, 0.25, 0) || !reader.open(name)) {
+        fprintf(stderr, "Failed to create shared memory segment %s\n", name.c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    mt19937 random(11);
+    uniform_int_distribution<int> strikeChoice(0, BENCH_STRIKES - 1);
+    uniform_real_distribution<double> priceChoice(0.25, 400.0);
+    vector<pair<int, double>> ticks;
+
+    for (int i = 0; i < BENCH_MESSAGE_POOL; i++) ticks.emplace_back(strikeChoice(random), priceChoice(random));
+
+    size_t i = 0;
+
+    while (state.keepRunning()) {
+        const pair<int, double>& tick = ticks[i++ % BENCH_MESSAGE_POOL];
+        if (isRead) {
+            QuoteSegmentQuote quote;
+            reader.readStrike(tick.first, quote);
+            doNotOptimize(quote);
+        } else {
+            double prices[3] = {tick.second, tick.second, tick.second};
+            segment.publish(tick.first, (i & 1) != 0, prices, 1u << (i % 3));
+        }
+    }
+    state.itemsProcessed = state.getIterations();
+}
+
+static void benchCaptureTicks(BenchmarkState& state) {
+
+    static const int tickTypes[] = {DELAYED_BID, DELAYED_ASK, DELAYED_LAST};
+    mt19937 random(12);
+    uniform_int_distribution<TickerId> tickerChoice(0, 2 * BENCH_STRIKES);
+    uniform_int_distribution<int> fieldChoice(0, 19);
+    uniform_int_distribution<int> priceTicks(1, 1600);
+    OptionChainManager& manager = *chainRegistry.getDisplayedChain();
+    vector<TickerId> tickerIds;
+    vector<int> fields;
+    vector<double> prices;
+
+    for (int i = 0; i < BENCH_CAPTURE_TICKS; i++) {
+        int choice = fieldChoice(random);
+        tickerIds.push_back(manager.getUnderlyingTickerId() + tickerChoice(random));
+        fields.push_back(tickTypes[choice < 9 ? 0 : choice < 18 ? 1 : 2]);
+        prices.push_back(priceTicks(random) * 0.25);
+    }
+
+    string path = "/tmp/benchCapture." + to_string(getpid());
+    TickCapture capture;
+
+    //each iteration captures a batch that fits the ring and closes the file, so the
+    //time covers encoding and writing the chunk as well as queueing the ticks
+    while (state.keepRunning()) {
+        if (!capture.open(path)) {
+            fprintf(stderr, "Failed to create capture file %s\n", path.c_str());
+            exit(EXIT_FAILURE);
+        }
+        for (int i = 0; i < BENCH_CAPTURE_TICKS; i++) capture.capture(&manager, tickerIds[i], fields[i], prices[i], 0.0);
+        capture.close();
+        state.bytesProcessed += capture.getWrittenBytes();
+    }
+    state.itemsProcessed = state.getIterations() * BENCH_CAPTURE_TICKS;
+    unlink(path.c_str());
+}
+
+static void benchApplyTicks(BenchmarkState& state, size_t batchSize) {
+
+    static const int tickTypes[] = {DELAYED_BID, DELAYED_ASK, DELAYED_LAST};
+    mt19937 random(8);
+    uniform_int_distribution<TickerId> tickerChoice(0, 2 * BENCH_STRIKES);
+    uniform_int_distribution<int> fieldChoice(0, 19);
+    uniform_real_distribution<double> priceChoice(0.25, 400.0);
+    vector<ETick> ticks(BENCH_MESSAGE_POOL * batchSize);
+
+    for (ETick& tick : ticks) {
+        int choice = fieldChoice(random);
+        tick = ETick();
+        tick.tickerId = tickerChoice(random);
+        tick.tickType = tickTypes[choice < 9 ? 0 : choice < 18 ? 1 : 2];
+        tick.price = priceChoice(random);
+        tick.isPrice = true;
+    }
+
+    OptionChainManager& manager = *chainRegistry.getDisplayedChain();
+    size_t i = 0;
+
+    while (state.keepRunning()) {
+        manager.applyTicks(&ticks[(i++ % BENCH_MESSAGE_POOL) * batchSize], batchSize);
+    }
+    state.itemsProcessed = state.getIterations() * batchSize;
+}
+
+static void benchFormatNumber2(BenchmarkState& state) {
+
+    Table table;
+    mt19937 random(4);
+    uniform_real_distribution<double> priceChoice(0.25, 6000.0);
+    vector<double> prices;
+
+    for (int i = 0; i < BENCH_MESSAGE_POOL; i++) prices.push_back(priceChoice(random));
+
+    size_t i = 0;
+    while (state.keepRunning()) {
+        string text = table.formatNumber2(prices[i++ % BENCH_MESSAGE_POOL]);
+        doNotOptimize(text);
+    }
+    state.itemsProcessed = state.getIterations();
+}
+
+static void benchEncodeReqMktData(BenchmarkState& state) {
+
+    CountingWrapper wrapper;
+    EReaderOSSignal signal;
+    EncodingClient client(&wrapper, &signal);
+    vector<Contract> contracts;
+
+    for (const double& strike : benchmarkStrikes()) {
+        for (const char* right : {"C", "P"}) {
+            Contract contract;
+            contract.symbol = "ES";
+            contract.secType = "FOP";
+            contract.exchange = "CME";
+            contract.currency = "USD";
+            contract.lastTradeDateOrContractMonth = "20250321";
+            contract.strike = strike;
+            contract.right = right;
+            contract.tradingClass = "ES";
+            contracts.push_back(contract);
+        }
+    }
+
+    size_t i = 0;
+    while (state.keepRunning()) {
+        client.reqMktData(i + 1, contracts[i % contracts.size()], "", false, false, TagValueListSPtr());
+        i++;
+    }
+    state.itemsProcessed = state.getIterations();
+    state.bytesProcessed = client.bytesSent;
+}
+
+//macro benchmarks
+
+/**
+ * Writes the recording replayed by the macro benchmarks.
+ *
+ * @return The path of the recording, removed when the benchmarks finish.
+ */
+static string writeReplayRecording() {
+
+    char path[] = "/tmp/benchRecordingXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) return "";
+    close(fd);
+
+    EMessageRecorder recorder;
+    if (!recorder.open(path, MAX_CLIENT_VER)) return "";
+
+    for (const string& message : randomTicks(BENCH_REPLAY_TICKS, 5)) {
+        recorder.record(message.data(), message.data() + message.size());
+    }
+    return recorder.close() ? string(path) : string();
+}
+
+static void countAppliedBatch(void* context, const ETick* ticks, size_t count) {
+    My_wrapper::onTicks(context, ticks, count);
+    static_cast<ReplayWrapper*>(static_cast<My_wrapper*>(context))->ticks.fetch_add(count, memory_order_release);
+}
+
+static void benchReplayPipeline(BenchmarkState& state, const string& recordingPath, unsigned int workerCount,
+                                size_t tickBatchCapacity) {
+
+    ReplayWrapper wrapper;
+
+    while (state.keepRunning()) {
+
+        state.pauseTiming();
+        EReaderOSSignal signal;
+        EClientSocket clientSocket(&wrapper, &signal);
+        clientSocket.asyncEConnect(true);
+        clientSocket.serverVersion(MAX_CLIENT_VER, "");
+        EReader reader(&clientSocket, &signal);
+        MessageDispatcher dispatcher(&reader, &wrapper, &clientSocket, workerCount);
+        if (tickBatchCapacity > 0) {
+            dispatcher.setTickBatching(countAppliedBatch, static_cast<My_wrapper*>(&wrapper), tickBatchCapacity, 0);
+        }
+        EMessageReplay replay;
+        replay.open(recordingPath.c_str());
+        dispatcher.start();
+        wrapper.ticks.store(0);
+        state.resumeTiming();
+
+        replay.start(reader.getMsgQueue(), &signal, 0);
+        while (wrapper.ticks.load(memory_order_acquire) < BENCH_REPLAY_TICKS) this_thread::yield();
+
+        state.pauseTiming();
+        replay.stop();
+        dispatcher.stop();
+        state.itemsProcessed += BENCH_REPLAY_TICKS;
+        state.resumeTiming();
+    }
+}
+
+//runner
+
+/**
+ * Runs a benchmark with growing iteration counts until a run takes at least the minimum time.
+ */
+static BenchmarkResult runBenchmark(const Benchmark& benchmark, double minTime) {
+
+    clockid_t cpuClock = benchmark.measureProcessCpu ? CLOCK_PROCESS_CPUTIME_ID : CLOCK_THREAD_CPUTIME_ID;
+    uint64_t iterations = 1;
+
+    while (true) {
+
+        BenchmarkState state(iterations, cpuClock);
+        benchmark.run(state);
+
+        if (state.realTime >= minTime || iterations >= BENCH_MAX_ITERATIONS) {
+            BenchmarkResult result;
+            result.name = benchmark.name;
+            result.iterations = iterations;
+            result.realTimeNs = state.realTime * 1e9 / iterations;
+            result.cpuTimeNs = state.cpuTime * 1e9 / iterations;
+            result.itemsPerSecond = state.itemsProcessed / state.realTime;
+            result.bytesPerSecond = state.bytesProcessed / state.realTime;
+            return result;
+        }
+
+        //aim 40% past the minimum, growing at most tenfold per run
+        double multiplier = state.realTime > 0.0 ? minTime * 1.4 / state.realTime : 10.0;
+        iterations = min<uint64_t>(BENCH_MAX_ITERATIONS, max<uint64_t>(iterations + 1, iterations * min(multiplier, 10.0)));
+    }
+}
+
+static string jsonContext(const char* executable) {
+
+    char hostName[256] = "";
+    char date[64];
+    time_t now = time(nullptr);
+
+    gethostname(hostName, sizeof(hostName) - 1);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+
+    return string("  \"context\": {\n")
+           + "    \"date\": \"" + date + "\",\n"
+           + "    \"host_name\": \"" + hostName + "\",\n"
+           + "    \"executable\": \"" + executable + "\",\n"
+           + "    \"num_cpus\": " + to_string(thread::hardware_concurrency()) + ",\n"
+           + "    \"git_commit\": \"" + BENCH_GIT_COMMIT + "\",\n"
+           + "    \"library_build_type\": \"release\"\n"
+           + "  },\n";
+}
+
+static bool writeJson(const char* path, const char* executable, const vector<BenchmarkResult>& results) {
+
+    FILE* file = fopen(path, "w");
+    if (file == nullptr) return false;
+
+    fprintf(file, "{\n%s  \"benchmarks\": [\n", jsonContext(executable).c_str());
+
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchmarkResult& result = results[i];
+        fprintf(file, "    {\n"
+                      "      \"name\": \"%s\",\n"
+                      "      \"run_name\": \"%s\",\n"
+                      "      \"run_type\": \"iteration\",\n"
+                      "      \"repetitions\": 1,\n"
+                      "      \"iterations\": %llu,\n"
+                      "      \"real_time\": %.4f,\n"
+                      "      \"cpu_time\": %.4f,\n"
+                      "      \"time_unit\": \"ns\",\n"
+                      "      \"items_per_second\": %.4f",
+                result.name.c_str(), result.name.c_str(), (unsigned long long)result.iterations, result.realTimeNs,
+                result.cpuTimeNs, result.itemsPerSecond);
+        if (result.bytesPerSecond > 0.0) fprintf(file, ",\n      \"bytes_per_second\": %.4f", result.bytesPerSecond);
+        fprintf(file, "\n    }%s\n", i + 1 < results.size() ? "," : "");
+    }
+
+    fprintf(file, "  ]\n}\n");
+    return fclose(file) == 0;
+}
+
+int main(int argc, char** argv) {
+
+    string filter;
+    double minTime = BENCH_DEFAULT_MIN_TIME;
+    const char* outPath = BENCH_DEFAULT_OUT;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--filter=", 9) == 0) filter = argv[i] + 9;
+        else if (strncmp(argv[i], "--min-time=", 11) == 0) minTime = atof(argv[i] + 11);
+        else if (strncmp(argv[i], "--out=", 6) == 0) outPath = argv[i] + 6;
+        else {
+            fprintf(stderr, "Usage: %s [--filter=substring] [--min-time=seconds] [--out=path]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    //the quote benchmarks pay for the tick records the application logs at its default level
+    logger.open("/dev/null");
+    OptionChainManager* chain = chainRegistry.addChain("ES", "20250321");
+    chain->setUnderlyingContract("ES", DEFAULT_EXCHANGE, FUTURES_CODE, DEFAULT_CURRENCY, "20250321");
+    chain->createChain(benchmarkStrikes());
+
+    string recordingPath = writeReplayRecording();
+    if (recordingPath.empty()) {
+        fprintf(stderr, "Failed to write the replay recording\n");
+        return 1;
+    }
+
+    vector<Benchmark> benchmarks = {
+        {"BM_DecodeTickPrice", [](BenchmarkState& state) {
+            benchDecode(state, randomTicks(BENCH_MESSAGE_POOL, 1), false);
+        }, false},
+        {"BM_DecodeTickPriceBatched", [](BenchmarkState& state) {
+            benchDecode(state, randomTicks(BENCH_MESSAGE_POOL, 1), true);
+        }, false},
+        {"BM_DecodeTickSize", [](BenchmarkState& state) {
+            benchDecode(state, randomSizeTicks(BENCH_MESSAGE_POOL, 6), false);
+        }, false},
+        {"BM_DecodeTickSizeBatched", [](BenchmarkState& state) {
+            benchDecode(state, randomSizeTicks(BENCH_MESSAGE_POOL, 6), true);
+        }, false},
+        {"BM_DecodeTickOptionComputation", [](BenchmarkState& state) {
+            benchDecode(state, randomOptionComputationTicks(BENCH_MESSAGE_POOL, 7), false);
+        }, false},
+        {"BM_DecodeFieldDouble", benchDecodeFieldDouble, false},
+        {"BM_UpdateBid", [](BenchmarkState& state) { benchUpdateQuote(state, &OptionChainManager::updateBid); }, false},
+        {"BM_UpdateAsk", [](BenchmarkState& state) { benchUpdateQuote(state, &OptionChainManager::updateAsk); }, false},
+        {"BM_UpdateLast", [](BenchmarkState& state) { benchUpdateQuote(state, &OptionChainManager::updateLast); }, false},
+        {"BM_GetQuote", benchGetQuote, false},
+        {"BM_LookupContractKey", benchLookupContractKey, false},
+        {"BM_PublishQuoteSegment", [](BenchmarkState& state) { benchQuoteSegment(state, false); }, false},
+        {"BM_ReadQuoteSegment", [](BenchmarkState& state) { benchQuoteSegment(state, true); }, false},
+        {"BM_CaptureTicks", benchCaptureTicks, false},
+        {"BM_ApplyTicks/batch:1", [](BenchmarkState& state) { benchApplyTicks(state, 1); }, false},
+        {"BM_ApplyTicks/batch:64", [](BenchmarkState& state) { benchApplyTicks(state, 64); }, false},
+        {"BM_ApplyTicks/batch:256", [](BenchmarkState& state) { benchApplyTicks(state, 256); }, false},
+        {"BM_FormatNumber2", benchFormatNumber2, false},
+        {"BM_EncodeReqMktData", benchEncodeReqMktData, false},
+    };
+    for (unsigned int workerCount : {1, 2, 4}) {
+        benchmarks.push_back({"BM_ReplayPipeline/workers:" + to_string(workerCount), [&recordingPath, workerCount](BenchmarkState& state) {
+            benchReplayPipeline(state, recordingPath, workerCount, 0);
+        }, true});
+    }
+    for (unsigned int workerCount : {1, 2, 4}) {
+        benchmarks.push_back({"BM_ReplayPipelineBatched/workers:" + to_string(workerCount), [&recordingPath, workerCount](BenchmarkState& state) {
+            benchReplayPipeline(state, recordingPath, workerCount, ETICK_BATCH_DEFAULT_CAPACITY);
+        }, true});
+    }
+
+    vector<BenchmarkResult> results;
+
+    printf("%-36s %15s %15s %12s %16s\n", "Benchmark", "Time (ns)", "CPU (ns)", "Iterations", "Items/s");
+    printf("%s\n", string(98, '-').c_str());
+
+    for (const Benchmark& benchmark : benchmarks) {
+
+        if (!filter.empty() && benchmark.name.find(filter) == string::npos) continue;
+
+        BenchmarkResult result = runBenchmark(benchmark, minTime);
+        results.push_back(result);
+        printf("%-36s %15.1f %15.1f %12llu %16.0f\n", result.name.c_str(), result.realTimeNs, result.cpuTimeNs,
+               (unsigned long long)result.iterations, result.itemsPerSecond);
+        fflush(stdout);
+    }
+
+    unlink(recordingPath.c_str());
+    logger.close();
+
+    if (!writeJson(outPath, argv[0], results)) {
+        fprintf(stderr, "Failed to write %s\n", outPath);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,217 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#include "chainRegistry.h"
+
+using namespace std;
+
+//public methods
+
+/**
+ * Adds the option chain of an underlying and expiry, or finds it if it was already added.
+ *
+ * The first chain added is the displayed one. Every chain shares the registry's contract
+ * cache. The chain's underlying contract and strikes are set when its option chain is
+ * requested.
+ *
+ * @param symbol The symbol of the underlying, e.g. "ES".
+ * @param expiry The expiry of the chain, e.g. "20250321".
+ * @return The chain.
+ */
+OptionChainManager* ChainRegistry::addChain(const string& symbol, const string& expiry) {
+
+    unique_ptr<OptionChainManager>& chain = this->chains[make_pair(symbol, expiry)];
+    if (chain) return chain.get();
+
+    chain = make_unique<OptionChainManager>();
+    chain->isDisplayed = this->chainOrder.empty();
+    chain->setContractCache(&this->contractCache, this->contractCachePath);
+    this->chainOrder.push_back(chain.get());
+
+    return chain.get();
+}
+
+/**
+ * Finds the option chain of an underlying and expiry.
+ *
+ * @param symbol The symbol of the underlying.
+ * @param expiry The expiry of the chain.
+ * @return The chain, or nullptr if it was not added.
+ */
+OptionChainManager* ChainRegistry::findChain(const string& symbol, const string& expiry) {
+
+    map<pair<string, string>, unique_ptr<OptionChainManager>>::iterator it = this->chains.find(make_pair(symbol, expiry));
+    return it == this->chains.end() ? nullptr : it->second.get();
+}
+
+/**
+ * @return the chain shown in the table, or nullptr if no chain was added.
+ */
+OptionChainManager* ChainRegistry::getDisplayedChain() {
+    return this->chainOrder.empty() ? nullptr : this->chainOrder.front();
+}
+
+/**
+ * @return every chain, in the order they were added.
+ */
+const vector<OptionChainManager*>& ChainRegistry::getChains() {
+    return this->chainOrder;
+}
+
+/**
+ * Allocates a contiguous block of ticker IDs to a chain and routes them to it.
+ *
+ * Ticker IDs are handed out from 0 in the order the blocks are allocated, so a session
+ * allocates the same IDs every time its chains are initialized in the same order, and a
+ * recorded session replays onto the chains that recorded it.
+ *
+ * @param chain The chain the ticker IDs are for.
+ * @param count The number of ticker IDs.
+ * @return The first ticker ID of the block.
+ */
+TickerId ChainRegistry::allocateTickerIds(OptionChainManager* chain, size_t count) {
+
+    TickerId firstTickerId = this->nextTickerId;
+
+    this->nextTickerId += count;
+    TickerRoute route;
+    route.chain = chain;
+    route.chainIndex = find(this->chainOrder.begin(), this->chainOrder.end(), chain) - this->chainOrder.begin();
+    this->tickerRoutes.resize(this->nextTickerId, route);
+
+    return firstTickerId;
+}
+
+/**
+ * Routes the replies to a request to the chain that sent it.
+ *
+ * @param reqId The request ID the request was sent with.
+ * @param chain The chain that sent the request.
+ */
+void ChainRegistry::routeRequest(int reqId, OptionChainManager* chain) {
+
+    if (reqId < 0) return;
+    if ((size_t)reqId >= this->requestRoutes.size()) this->requestRoutes.resize(reqId + 1, nullptr);
+    this->requestRoutes[reqId] = chain;
+}
+
+/**
+ * Finds the chain that sent a request.
+ *
+ * @param reqId The request ID of a reply.
+ * @return The chain, or nullptr if the request was not sent for a chain.
+ */
+OptionChainManager* ChainRegistry::findRequestChain(int reqId) {
+
+    if (reqId < 0 || (size_t)reqId >= this->requestRoutes.size()) return nullptr;
+    return this->requestRoutes[reqId];
+}
+
+/**
+ * Maps the contract cache file that every chain looks its contracts up in. A missing or
+ * invalid file leaves the cache empty and it is written from scratch once a chain is loaded.
+ * Must be called before any chain is added.
+ *
+ * @param path The path of the cache file.
+ * @return true if the cache file was loaded.
+ */
+bool ChainRegistry::loadContractCache(const char* path) {
+    this->contractCachePath = path;
+    return this->contractCache.load(path);
+}
+
+/**
+ * Sets how many contract details requests each chain keeps in flight while it is initialized.
+ *
+ * @param window The window size.
+ */
+void ChainRegistry::setBootstrapWindow(unsigned int window) {
+    for (OptionChainManager* chain : this->chainOrder) chain->setBootstrapWindow(window);
+}
+
+/**
+ * Sets the risk-free rate the Greeks of every chain are discounted with.
+ *
+ * @param rate The continuously compounded annual rate, e.g. 0.04 for 4%.
+ */
+void ChainRegistry::setRiskFreeRate(double rate) {
+    for (OptionChainManager* chain : this->chainOrder) chain->setRiskFreeRate(rate);
+}
+
+/**
+ * Sets how many strikes around the underlying price each chain that is not displayed subscribes to.
+ *
+ * @param strikeCount The number of strikes, 0 for every strike of the chain.
+ */
+void ChainRegistry::setChainStrikes(size_t strikeCount) {
+    for (OptionChainManager* chain : this->chainOrder) chain->setChainStrikes(strikeCount);
+}
+
+/**
+ * Makes every chain publish its quotes in a shared memory segment once it is initialized.
+ *
+ * @param prefix The prefix of the segment names, e.g. "optionchain" for /optionchain.ES.20250321.
+ */
+void ChainRegistry::setQuoteSegmentPrefix(const string& prefix) {
+    for (OptionChainManager* chain : this->chainOrder) chain->setQuoteSegmentPrefix(prefix);
+}
+
+/**
+ * Applies a batch of price ticks to the chains they are for.
+ *
+ * A batch for a single chain, the usual case, is passed on as it is. Otherwise the ticks
+ * are split by chain, keeping their order, and each chain applies its ticks in one pass.
+ * Ticks for ticker IDs that were never allocated are dropped.
+ *
+ * @param ticks The ticks, in the order their messages arrived.
+ * @param count The number of ticks.
+ */
+void ChainRegistry::applyTicks(const ETick* ticks, size_t count) {
+
+    //ticks of each chain in a batch that spans chains, indexed like chainOrder
+    static thread_local vector<vector<ETick>> chainTicks;
+
+    OptionChainManager* firstChain = count > 0 ? findTickerChain(ticks[0].tickerId) : nullptr;
+    size_t i = 1;
+
+    while (i < count && findTickerChain(ticks[i].tickerId) == firstChain) i++;
+
+    if (i >= count) {
+        if (firstChain != nullptr) firstChain->applyTicks(ticks, count);
+        return;
+    }
+
+    if (chainTicks.size() < this->chainOrder.size()) chainTicks.resize(this->chainOrder.size());
+
+    for (i = 0; i < count; i++) {
+
+        TickerId tickerId = ticks[i].tickerId;
+        if (findTickerChain(tickerId) == nullptr) continue;
+
+        chainTicks[this->tickerRoutes[tickerId].chainIndex].push_back(ticks[i]);
+    }
+
+    for (size_t chainIndex = 0; chainIndex < this->chainOrder.size(); chainIndex++) {
+
+        vector<ETick>& batch = chainTicks[chainIndex];
+        if (batch.empty()) continue;
+
+        this->chainOrder[chainIndex]->applyTicks(batch.data(), batch.size());
+        batch.clear();
+    }
+}
+
+/**
+ * @return the number of contracts market data is requested for across every chain,
+ *         underlyings included.
+ */
+size_t ChainRegistry::getSubscribedCount() {
+
+    size_t count = 0;
+    for (OptionChainManager* chain : this->chainOrder) count += 1 + 2 * chain->getWindowSize();
+    return count;
+}
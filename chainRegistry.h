@@ -0,0 +1,84 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#ifndef CHAIN_REGISTRY_H
+#define CHAIN_REGISTRY_H
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "contractCache.h"
+#include "ETickBatch.h"
+#include "optionChainManager.h"
+
+using namespace std;
+
+/**
+ * Where the ticks of a ticker ID go.
+ */
+struct TickerRoute {
+    OptionChainManager* chain = nullptr;
+    size_t chainIndex = 0;      // position of the chain in the order chains were added
+};
+
+/**
+ * The option chains of every monitored (underlying, expiry), and the routes from
+ * TWS IDs to the chain they belong to.
+ *
+ * Ticker IDs come from one allocator, so every contract of every chain has its own.
+ * Each chain is given a contiguous block of them, and a flat table indexed by ticker
+ * ID takes a tick to its chain in O(1); the chain then indexes its quote slots with
+ * the ticker ID's offset into its block. Contract details and option chain requests
+ * are routed back to the chain that sent them the same way, by request ID. The first
+ * chain added is the one displayed in the table. Chains are only added and ticker
+ * IDs only allocated while starting up, before messages are processed on worker
+ * threads, so the routes are read without locking.
+ */
+class ChainRegistry {
+
+private:
+
+    map<pair<string, string>, unique_ptr<OptionChainManager>> chains;
+    vector<OptionChainManager*> chainOrder;      // in the order they were added, the displayed chain first
+    vector<TickerRoute> tickerRoutes;            // indexed by TickerId
+    vector<OptionChainManager*> requestRoutes;   // indexed by request ID
+    TickerId nextTickerId = 0;
+    ContractCache contractCache;
+    string contractCachePath;
+
+public:
+
+    OptionChainManager* addChain(const string& symbol, const string& expiry);
+    OptionChainManager* findChain(const string& symbol, const string& expiry);
+    OptionChainManager* getDisplayedChain();
+    const vector<OptionChainManager*>& getChains();
+    TickerId allocateTickerIds(OptionChainManager* chain, size_t count);
+    void routeRequest(int reqId, OptionChainManager* chain);
+    OptionChainManager* findRequestChain(int reqId);
+    bool loadContractCache(const char* path);
+    void setBootstrapWindow(unsigned int window);
+    void setRiskFreeRate(double rate);
+    void setChainStrikes(size_t strikeCount);
+    void setQuoteSegmentPrefix(const string& prefix);
+    void applyTicks(const ETick* ticks, size_t count);
+    size_t getSubscribedCount();
+
+    /**
+     * Finds the chain a ticker ID was allocated to.
+     *
+     * @param tickerId The Ticker ID of a tick.
+     * @return The chain, or nullptr if the ticker ID was never allocated.
+     */
+    OptionChainManager* findTickerChain(TickerId tickerId) {
+        if (tickerId < 0 || tickerId >= (TickerId)this->tickerRoutes.size()) return nullptr;
+        return this->tickerRoutes[tickerId].chain;
+    }
+};
+
+#endif
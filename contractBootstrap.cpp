@@ -0,0 +1,284 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#include "contractBootstrap.h"
+#include "globals.h"
+
+using namespace std;
+
+//public methods
+
+/**
+ * Constructs a ContractBootstrap.
+ *
+ * @param sendRequest Sends a contract details request for a contract and returns its request ID.
+ * @param pumpMessages Processes incoming messages, returning after a bounded wait if there are none.
+ */
+ContractBootstrap::ContractBootstrap(function<int(const Contract&)> sendRequest, function<void()> pumpMessages) :
+    sendRequest(sendRequest),
+    pumpMessages(pumpMessages)
+{}
+
+/**
+ * Sets the maximum number of requests in flight at once.
+ *
+ * @param window The window size, at least one.
+ */
+void ContractBootstrap::setWindow(unsigned int window) {
+    this->window = window > 0 ? window : 1;
+}
+
+/**
+ * Sets the maximum number of requests sent in any one second.
+ *
+ * @param requestsPerSecond The request rate, at least one.
+ */
+void ContractBootstrap::setRequestsPerSecond(int requestsPerSecond) {
+    this->requestsPerSecond = requestsPerSecond > 0 ? requestsPerSecond : 1;
+}
+
+/**
+ * Sets how long a request may go unanswered before it is sent again.
+ *
+ * @param timeoutMs The timeout in milliseconds.
+ */
+void ContractBootstrap::setTimeout(int timeoutMs) {
+    this->timeoutMs = timeoutMs;
+}
+
+/**
+ * Sets how many times a request is sent before it is given up on.
+ *
+ * @param maxAttempts The number of attempts, at least one.
+ */
+void ContractBootstrap::setMaxAttempts(int maxAttempts) {
+    this->maxAttempts = maxAttempts > 0 ? maxAttempts : 1;
+}
+
+/**
+ * Sets a function that is called from run() whenever more requests have finished.
+ *
+ * @param progressCallback Receives the number of finished (completed or failed) requests and the total.
+ */
+void ContractBootstrap::setProgressCallback(function<void(size_t completed, size_t total)> progressCallback) {
+    this->progressCallback = progressCallback;
+}
+
+/**
+ * Adds a contract to request details for. Must be called before run().
+ *
+ * @param contract The contract to request.
+ */
+void ContractBootstrap::add(const Contract& contract) {
+    this->requests.push_back(make_unique<BootstrapRequest>());
+    this->requests.back()->contract = contract;
+}
+
+/**
+ * Requests details for every contract added and returns once each request has
+ * completed or failed.
+ *
+ * Messages are processed through the pump function while waiting, so this can
+ * be called from the thread that would otherwise process them.
+ *
+ * @return The number of requests that failed.
+ */
+size_t ContractBootstrap::run() {
+
+    deque<BootstrapRequest*> pending;
+    vector<BootstrapRequest*> inFlight;
+    deque<chrono::steady_clock::time_point> recentSends;
+    size_t reported = SIZE_MAX;
+
+    for (auto& request : this->requests) pending.push_back(request.get());
+
+    while (true) {
+
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+
+        //retire finished requests and queue again the ones that timed out or hit an error
+        for (size_t i = 0; i < inFlight.size();) {
+
+            BootstrapRequest* request = inFlight[i];
+            uint8_t state = request->state.load();
+
+            if (state == BOOTSTRAP_IN_FLIGHT && now - request->sentAt >= chrono::milliseconds(this->timeoutMs)) {
+                if (request->state.compare_exchange_strong(state, BOOTSTRAP_PENDING)) {
+                    state = BOOTSTRAP_PENDING;
+                    string toLog = "Contract details request timed out for strike " + to_string(request->contract.strike)
+                                   + " Right: " + request->contract.right + "\n";
+                    logger.log(LOG_WARNING, toLog);
+                }
+            }
+
+            if (state == BOOTSTRAP_IN_FLIGHT) {
+                i++;
+                continue;
+            }
+
+            inFlight[i] = inFlight.back();
+            inFlight.pop_back();
+
+            if (state == BOOTSTRAP_PENDING) {
+                if (request->attempts >= this->maxAttempts) finish(request, BOOTSTRAP_PENDING, BOOTSTRAP_FAILED);
+                else pending.push_front(request);
+            }
+        }
+
+        //send while the window has room and the last second has not used up the rate
+        while (!recentSends.empty() && now - recentSends.front() >= chrono::seconds(1)) recentSends.pop_front();
+
+        while (inFlight.size() < this->window && !pending.empty()
+               && recentSends.size() < (size_t)this->requestsPerSecond) {
+
+            BootstrapRequest* request = pending.front();
+            pending.pop_front();
+
+            uint8_t expected = BOOTSTRAP_PENDING;
+            if (!request->state.compare_exchange_strong(expected, BOOTSTRAP_IN_FLIGHT)) continue;
+
+            send(request);
+            inFlight.push_back(request);
+            recentSends.push_back(now);
+        }
+
+        size_t finished = this->completedCount + this->failedCount;
+
+        if (finished != reported) {
+            reported = finished;
+            if (this->progressCallback) this->progressCallback(finished, this->requests.size());
+        }
+
+        if (finished == this->requests.size()) break;
+
+        this->pumpMessages();
+    }
+
+    {
+        lock_guard<mutex> lock(this->reqIdMutex);
+        this->reqIdToRequest.clear();
+    }
+
+    string toLog = "Contract details bootstrap finished. Completed: " + to_string(this->completedCount)
+                   + ", Failed: " + to_string(this->failedCount) + "\n";
+    logger.log(this->failedCount > 0 ? LOG_WARNING : LOG_INFO, toLog);
+
+    return this->failedCount;
+}
+
+/**
+ * Completes the request with the given ID. Called from the contractDetailsEnd callback.
+ *
+ * A response to an earlier attempt of a request that has since been sent again
+ * still completes it.
+ *
+ * @param reqId The request ID.
+ */
+void ContractBootstrap::contractDetailsEnd(int reqId) {
+
+    BootstrapRequest* request = findRequest(reqId);
+    if (request == nullptr) return;
+
+    if (!finish(request, BOOTSTRAP_IN_FLIGHT, BOOTSTRAP_DONE)) finish(request, BOOTSTRAP_PENDING, BOOTSTRAP_DONE);
+}
+
+/**
+ * Handles an error reported for a request. Called from the error callback.
+ *
+ * A contract that TWS does not know fails at once. Any other error sends the
+ * request again if it has attempts left.
+ *
+ * @param reqId The request ID, which may belong to something else entirely.
+ * @param errorCode The TWS error code.
+ */
+void ContractBootstrap::requestError(int reqId, int errorCode) {
+
+    BootstrapRequest* request = findRequest(reqId);
+    if (request == nullptr) return;
+
+    if (errorCode == NO_SECURITY_DEFINITION_ERROR) {
+        finish(request, BOOTSTRAP_IN_FLIGHT, BOOTSTRAP_FAILED);
+    } else {
+        uint8_t expected = BOOTSTRAP_IN_FLIGHT;
+        request->state.compare_exchange_strong(expected, BOOTSTRAP_PENDING);
+    }
+}
+
+/**
+ * @return the number of requests that have completed.
+ */
+size_t ContractBootstrap::getCompletedCount() {
+    return this->completedCount;
+}
+
+/**
+ * @return the number of requests that have failed.
+ */
+size_t ContractBootstrap::getFailedCount() {
+    return this->failedCount;
+}
+
+/**
+ * @return the number of requests added.
+ */
+size_t ContractBootstrap::getTotalCount() {
+    return this->requests.size();
+}
+
+//private methods
+
+/**
+ * Finds the request an ID was sent for.
+ *
+ * @param reqId The request ID.
+ * @return The request, or nullptr if the ID was not sent by this bootstrap.
+ */
+BootstrapRequest* ContractBootstrap::findRequest(int reqId) {
+
+    lock_guard<mutex> lock(this->reqIdMutex);
+
+    auto it = this->reqIdToRequest.find(reqId);
+    return it == this->reqIdToRequest.end() ? nullptr : it->second;
+}
+
+/**
+ * Sends one attempt of a request under a new request ID.
+ *
+ * @param request The request, already marked in flight.
+ */
+void ContractBootstrap::send(BootstrapRequest* request) {
+
+    request->attempts++;
+    request->sentAt = chrono::steady_clock::now();
+
+    //the ID is registered under the lock before the request goes out, so its reply always finds it
+    lock_guard<mutex> lock(this->reqIdMutex);
+    this->reqIdToRequest[this->sendRequest(request->contract)] = request;
+}
+
+/**
+ * Moves a request to a final state if it is still in the expected state.
+ *
+ * @param request The request.
+ * @param expected The state the request must be in.
+ * @param state BOOTSTRAP_DONE or BOOTSTRAP_FAILED.
+ * @return true if this call made the transition.
+ */
+bool ContractBootstrap::finish(BootstrapRequest* request, uint8_t expected, BootstrapState state) {
+
+    if (!request->state.compare_exchange_strong(expected, state)) return false;
+
+    if (state == BOOTSTRAP_DONE) {
+        this->completedCount++;
+    } else {
+        this->failedCount++;
+        string toLog = "Giving up on contract details for strike " + to_string(request->contract.strike)
+                       + " Right: " + request->contract.right + "\n";
+        logger.log(LOG_ERROR, toLog);
+    }
+    return true;
+}
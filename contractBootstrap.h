@@ -0,0 +1,95 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#ifndef CONTRACT_BOOTSTRAP_H
+#define CONTRACT_BOOTSTRAP_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "Contract.h"
+
+using namespace std;
+
+#define BOOTSTRAP_WINDOW 40                 // contract details requests in flight at once
+#define BOOTSTRAP_REQUESTS_PER_SECOND 40    // TWS allows 50 messages per second
+#define BOOTSTRAP_TIMEOUT_MS 10000
+#define BOOTSTRAP_MAX_ATTEMPTS 3
+#define NO_SECURITY_DEFINITION_ERROR 200
+
+enum BootstrapState : uint8_t {
+    BOOTSTRAP_PENDING,      // waiting to be sent, or to be sent again
+    BOOTSTRAP_IN_FLIGHT,
+    BOOTSTRAP_DONE,         // contractDetailsEnd received
+    BOOTSTRAP_FAILED        // out of attempts, or TWS has no such contract
+};
+
+/**
+ * One contract whose details are being requested.
+ */
+struct BootstrapRequest {
+    Contract contract;
+    atomic<uint8_t> state{BOOTSTRAP_PENDING};
+    int attempts = 0;
+    chrono::steady_clock::time_point sentAt;
+};
+
+/**
+ * Requests contract details for a list of contracts as a pipeline.
+ *
+ * Up to a window of requests is kept in flight, new requests are paced to stay
+ * under the TWS message rate, and each request is completed by its
+ * contractDetailsEnd callback. Requests that time out or fail with a transient
+ * error are sent again under a new request ID, up to a maximum number of
+ * attempts. The callbacks may arrive on any thread.
+ */
+class ContractBootstrap {
+
+private:
+
+    function<int(const Contract&)> sendRequest;
+    function<void()> pumpMessages;
+    function<void(size_t, size_t)> progressCallback;
+    vector<unique_ptr<BootstrapRequest>> requests;
+    mutex reqIdMutex;
+    unordered_map<int, BootstrapRequest*> reqIdToRequest;
+    atomic<size_t> completedCount{0};
+    atomic<size_t> failedCount{0};
+    unsigned int window = BOOTSTRAP_WINDOW;
+    int requestsPerSecond = BOOTSTRAP_REQUESTS_PER_SECOND;
+    int timeoutMs = BOOTSTRAP_TIMEOUT_MS;
+    int maxAttempts = BOOTSTRAP_MAX_ATTEMPTS;
+
+    BootstrapRequest* findRequest(int reqId);
+    void send(BootstrapRequest* request);
+    bool finish(BootstrapRequest* request, uint8_t expected, BootstrapState state);
+
+public:
+
+    ContractBootstrap(function<int(const Contract&)> sendRequest, function<void()> pumpMessages);
+
+    void setWindow(unsigned int window);
+    void setRequestsPerSecond(int requestsPerSecond);
+    void setTimeout(int timeoutMs);
+    void setMaxAttempts(int maxAttempts);
+    void setProgressCallback(function<void(size_t completed, size_t total)> progressCallback);
+    void add(const Contract& contract);
+    size_t run();
+    void contractDetailsEnd(int reqId);
+    void requestError(int reqId, int errorCode);
+    size_t getCompletedCount();
+    size_t getFailedCount();
+    size_t getTotalCount();
+};
+
+#endif
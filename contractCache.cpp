@@ -0,0 +1,333 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#include "contractCache.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+/**
+ * Copies a string into a fixed size field.
+ *
+ * @return false if the string does not fit with its terminator.
+ */
+template <size_t N>
+static bool copyField(char (&field)[N], const string& value) {
+
+    if (value.size() >= N) return false;
+
+    memset(field, 0, N);
+    memcpy(field, value.data(), value.size());
+    return true;
+}
+
+/**
+ * Orders records by (symbol, expiry, strike, right).
+ */
+static int compareRecordKey(const ContractCacheRecord& record, const char* symbol, const char* expiry, double strike,
+                            char right) {
+
+    int result = strncmp(record.symbol, symbol, sizeof(record.symbol));
+    if (result != 0) return result;
+
+    result = strncmp(record.expiry, expiry, sizeof(record.expiry));
+    if (result != 0) return result;
+
+    if (record.strike != strike) return record.strike < strike ? -1 : 1;
+    if (record.right != right) return record.right < right ? -1 : 1;
+    return 0;
+}
+
+static bool recordLess(const ContractCacheRecord& a, const ContractCacheRecord& b) {
+    return compareRecordKey(a, b.symbol, b.expiry, b.strike, b.right) < 0;
+}
+
+//public methods
+
+/**
+ * Destroys the cache, unmapping the file.
+ */
+ContractCache::~ContractCache() {
+    unload();
+}
+
+/**
+ * Maps a cache file. A missing, truncated or foreign file leaves the cache empty.
+ *
+ * @param path The path of the cache file.
+ * @return true if the file was mapped.
+ */
+bool ContractCache::load(const char* path) {
+
+    unload();
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) < 0 || (size_t)fileStat.st_size < sizeof(ContractCacheHeader)) {
+        close(fd);
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+
+    const ContractCacheHeader* header = (const ContractCacheHeader*)mapping;
+    if (header->magic != CONTRACT_CACHE_MAGIC || header->version != CONTRACT_CACHE_VERSION
+        || header->recordSize != sizeof(ContractCacheRecord)
+        || (size_t)fileStat.st_size != sizeof(ContractCacheHeader) + header->recordCount * sizeof(ContractCacheRecord)) {
+        munmap(mapping, fileStat.st_size);
+        close(fd);
+        return false;
+    }
+
+    this->fd = fd;
+    this->mapping = mapping;
+    this->mappingSize = fileStat.st_size;
+    this->records = (const ContractCacheRecord*)((const char*)mapping + sizeof(ContractCacheHeader));
+    this->recordCount = header->recordCount;
+    return true;
+}
+
+/**
+ * Unmaps the cache file. Details stored since the last save are kept.
+ */
+void ContractCache::unload() {
+
+    if (this->mapping != nullptr) munmap(this->mapping, this->mappingSize);
+    if (this->fd >= 0) close(this->fd);
+
+    this->fd = -1;
+    this->mapping = nullptr;
+    this->mappingSize = 0;
+    this->records = nullptr;
+    this->recordCount = 0;
+}
+
+/**
+ * Looks up the cached details of an underlying contract.
+ *
+ * @param symbol The underlying symbol.
+ * @param expiry The contract month requested.
+ * @param details Receives the details on a hit.
+ * @return true on a hit.
+ */
+bool ContractCache::findUnderlying(const string& symbol, const string& expiry, ContractDetails& details) const {
+
+    const ContractCacheRecord* record = findRecord(symbol, expiry, 0.0, 0);
+    if (record == nullptr) return false;
+
+    toDetails(*record, details);
+    return true;
+}
+
+/**
+ * Looks up the cached details of an option, validated against the underlying
+ * reported by securityDefinitionOptionalParameter.
+ *
+ * @param symbol The underlying symbol.
+ * @param expiry The contract month of the underlying.
+ * @param strike The strike, as listed by securityDefinitionOptionalParameter.
+ * @param right 'C' or 'P'.
+ * @param underConId The underlying contract ID the chain was listed for.
+ * @param details Receives the details on a hit.
+ * @return true on a hit whose underlying matches.
+ */
+bool ContractCache::findOption(const string& symbol, const string& expiry, double strike, char right, int underConId,
+                               ContractDetails& details) const {
+
+    const ContractCacheRecord* record = findRecord(symbol, expiry, strike, right);
+    if (record == nullptr || record->underConId != underConId || record->conId == 0) return false;
+
+    toDetails(*record, details);
+    return true;
+}
+
+/**
+ * Stores the details of an underlying contract for the next save.
+ *
+ * @param symbol The underlying symbol.
+ * @param expiry The contract month requested.
+ * @param details The details received from TWS.
+ */
+void ContractCache::storeUnderlying(const string& symbol, const string& expiry, const ContractDetails& details) {
+
+    ContractCacheRecord record;
+    if (!toRecord(symbol, expiry, details, record)) return;
+
+    record.strike = 0.0;
+    record.right = 0;
+
+    lock_guard<mutex> lock(this->pendingMutex);
+    this->pending[make_tuple(symbol, expiry, 0.0, (char)0)] = record;
+}
+
+/**
+ * Stores the details of a whole option chain for the next save. Options of the
+ * same symbol and expiry that are cached but not in the chain are dropped.
+ *
+ * @param symbol The underlying symbol.
+ * @param expiry The contract month of the underlying.
+ * @param chain The details of every option in the chain. Options without a contract ID are skipped.
+ */
+void ContractCache::storeChain(const string& symbol, const string& expiry, const vector<ContractDetails>& chain) {
+
+    lock_guard<mutex> lock(this->pendingMutex);
+
+    this->replacedChains.insert(make_pair(symbol, expiry));
+
+    for (const ContractDetails& details : chain) {
+
+        ContractCacheRecord record;
+        if (details.contract.conId == 0 || details.contract.right.size() != 1) continue;
+        if (!toRecord(symbol, expiry, details, record)) continue;
+
+        this->pending[make_tuple(symbol, expiry, record.strike, record.right)] = record;
+    }
+}
+
+/**
+ * Writes the mapped records merged with the stored details to a new cache file
+ * and renames it over the old one, so a reader never sees a partial file.
+ *
+ * @param path The path of the cache file.
+ * @return true if the file was written.
+ */
+bool ContractCache::save(const char* path) {
+
+    vector<ContractCacheRecord> merged;
+    {
+        lock_guard<mutex> lock(this->pendingMutex);
+
+        for (size_t i = 0; i < this->recordCount; i++) {
+
+            const ContractCacheRecord& record = this->records[i];
+            string symbol(record.symbol, strnlen(record.symbol, sizeof(record.symbol)));
+            string expiry(record.expiry, strnlen(record.expiry, sizeof(record.expiry)));
+
+            if (record.right != 0 && this->replacedChains.count(make_pair(symbol, expiry))) continue;
+            if (this->pending.count(make_tuple(symbol, expiry, record.strike, record.right))) continue;
+            merged.push_back(record);
+        }
+
+        for (const auto& entry : this->pending) merged.push_back(entry.second);
+    }
+
+    sort(merged.begin(), merged.end(), recordLess);
+
+    ContractCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = CONTRACT_CACHE_MAGIC;
+    header.version = CONTRACT_CACHE_VERSION;
+    header.recordSize = sizeof(ContractCacheRecord);
+    header.recordCount = merged.size();
+
+    string tempPath = string(path) + ".tmp";
+    int fd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+
+    bool written = write(fd, &header, sizeof(header)) == (ssize_t)sizeof(header);
+    size_t bytes = merged.size() * sizeof(ContractCacheRecord);
+    if (written && bytes > 0) written = write(fd, merged.data(), bytes) == (ssize_t)bytes;
+    written = fsync(fd) == 0 && written;
+    close(fd);
+
+    if (!written || rename(tempPath.c_str(), path) != 0) {
+        unlink(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @return the number of records in the mapped file.
+ */
+size_t ContractCache::getRecordCount() const {
+    return this->recordCount;
+}
+
+//private methods
+
+/**
+ * Binary searches the mapped records for a key.
+ *
+ * @return The record, or nullptr if the key is not cached.
+ */
+const ContractCacheRecord* ContractCache::findRecord(const string& symbol, const string& expiry, double strike,
+                                                     char right) const {
+
+    size_t low = 0;
+    size_t high = this->recordCount;
+
+    while (low < high) {
+
+        size_t middle = low + (high - low) / 2;
+        int result = compareRecordKey(this->records[middle], symbol.c_str(), expiry.c_str(), strike, right);
+
+        if (result == 0) return &this->records[middle];
+        if (result < 0) low = middle + 1;
+        else high = middle;
+    }
+    return nullptr;
+}
+
+/**
+ * Packs contract details into a record.
+ *
+ * @return false if a value does not fit its field.
+ */
+bool ContractCache::toRecord(const string& symbol, const string& expiry, const ContractDetails& details,
+                             ContractCacheRecord& record) {
+
+    const Contract& contract = details.contract;
+
+    memset(&record, 0, sizeof(record));
+    record.strike = contract.strike;
+    record.right = contract.right.empty() ? 0 : contract.right[0];
+    record.conId = contract.conId;
+    record.underConId = details.underConId;
+    record.minTick = details.minTick;
+
+    return copyField(record.symbol, symbol) && copyField(record.expiry, expiry)
+           && copyField(record.secType, contract.secType) && copyField(record.currency, contract.currency)
+           && copyField(record.exchange, contract.exchange) && copyField(record.tradingClass, contract.tradingClass)
+           && copyField(record.multiplier, contract.multiplier) && copyField(record.localSymbol, contract.localSymbol)
+           && copyField(record.lastTradeDate, contract.lastTradeDateOrContractMonth)
+           && copyField(record.marketName, details.marketName);
+}
+
+/**
+ * Unpacks a record into contract details.
+ */
+void ContractCache::toDetails(const ContractCacheRecord& record, ContractDetails& details) {
+
+    Contract& contract = details.contract;
+
+    contract.conId = record.conId;
+    contract.symbol = string(record.symbol, strnlen(record.symbol, sizeof(record.symbol)));
+    contract.secType = string(record.secType, strnlen(record.secType, sizeof(record.secType)));
+    contract.lastTradeDateOrContractMonth = string(record.lastTradeDate, strnlen(record.lastTradeDate, sizeof(record.lastTradeDate)));
+    contract.strike = record.strike;
+    contract.right = record.right != 0 ? string(1, record.right) : string();
+    contract.multiplier = string(record.multiplier, strnlen(record.multiplier, sizeof(record.multiplier)));
+    contract.exchange = string(record.exchange, strnlen(record.exchange, sizeof(record.exchange)));
+    contract.currency = string(record.currency, strnlen(record.currency, sizeof(record.currency)));
+    contract.localSymbol = string(record.localSymbol, strnlen(record.localSymbol, sizeof(record.localSymbol)));
+    contract.tradingClass = string(record.tradingClass, strnlen(record.tradingClass, sizeof(record.tradingClass)));
+    details.marketName = string(record.marketName, strnlen(record.marketName, sizeof(record.marketName)));
+    details.minTick = record.minTick;
+    details.underConId = record.underConId;
+}
@@ -0,0 +1,101 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#ifndef CONTRACT_CACHE_H
+#define CONTRACT_CACHE_H
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "Contract.h"
+
+using namespace std;
+
+#define CONTRACT_CACHE_MAGIC 0x43434443     // "CDCC" in little endian
+#define CONTRACT_CACHE_VERSION 1
+#define CONTRACT_CACHE_RECORD_SIZE 192
+
+/**
+ * Fixed size cache record. The file is a header followed by records sorted by
+ * (symbol, expiry, strike, right), so it can be searched where it is mapped.
+ * Strings are NUL terminated; values that do not fit are not cached.
+ */
+struct ContractCacheRecord {
+    char symbol[16];            // key: underlying symbol
+    char expiry[16];            // key: contract month the chain was requested for
+    double strike;              // key: 0 for the underlying
+    int32_t conId;
+    int32_t underConId;
+    double minTick;
+    char right;                 // key: 'C', 'P', or 0 for the underlying
+    char reserved[7];
+    char secType[8];
+    char currency[8];
+    char exchange[16];
+    char tradingClass[16];
+    char multiplier[16];
+    char localSymbol[32];
+    char lastTradeDate[16];
+    char marketName[16];
+};
+
+static_assert(sizeof(ContractCacheRecord) == CONTRACT_CACHE_RECORD_SIZE, "ContractCacheRecord layout changed");
+
+struct ContractCacheHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+    uint64_t recordCount;
+};
+
+typedef tuple<string, string, double, char> ContractCacheKey;
+
+/**
+ * Persistent cache of contract details keyed by (symbol, expiry, strike, right).
+ *
+ * The cache file is memory mapped read-only on load and looked up in place.
+ * Details learned during a session are kept in memory and merged into a new
+ * file by save(), which replaces the old file atomically.
+ */
+class ContractCache {
+
+private:
+
+    int fd = -1;
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+    const ContractCacheRecord* records = nullptr;
+    size_t recordCount = 0;
+    mutex pendingMutex;
+    map<ContractCacheKey, ContractCacheRecord> pending;
+    set<pair<string, string>> replacedChains;
+
+    const ContractCacheRecord* findRecord(const string& symbol, const string& expiry, double strike, char right) const;
+    static bool toRecord(const string& symbol, const string& expiry, const ContractDetails& details,
+                         ContractCacheRecord& record);
+    static void toDetails(const ContractCacheRecord& record, ContractDetails& details);
+
+public:
+
+    ~ContractCache();
+
+    bool load(const char* path);
+    void unload();
+    bool findUnderlying(const string& symbol, const string& expiry, ContractDetails& details) const;
+    bool findOption(const string& symbol, const string& expiry, double strike, char right, int underConId,
+                    ContractDetails& details) const;
+    void storeUnderlying(const string& symbol, const string& expiry, const ContractDetails& details);
+    void storeChain(const string& symbol, const string& expiry, const vector<ContractDetails>& chain);
+    bool save(const char* path);
+    size_t getRecordCount() const;
+};
+
+#endif
@@ -0,0 +1,84 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#ifndef CONTRACT_KEY_H
+#define CONTRACT_KEY_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+#define CONTRACT_KEY_PUT_BIT 1u
+#define CONTRACT_KEY_MAX_TICKS 0x7FFFFFFFu     // strikes take the upper 31 bits of a key
+#define CONTRACT_KEY_TICK_TOLERANCE 1e-6        // fraction of a tick a strike may be off the grid
+#define DEFAULT_STRIKE_TICK 0.01                // used when the underlying has no minimum tick
+
+/**
+ * An option of a chain interned as 32 bits: its strike as a whole number of price
+ * ticks of the underlying in the upper 31 bits, and its right in the lowest bit,
+ * 0 for a call and 1 for a put. Keys of a chain order like its quote slots, by
+ * strike and then calls before puts, and are compared and hashed as integers.
+ */
+typedef uint32_t ContractKey;
+
+/**
+ * Makes the key of an option.
+ *
+ * @param strikeTicks The strike as a number of price ticks.
+ * @param isCall true for a call, false for a put.
+ * @return The key.
+ */
+inline ContractKey makeContractKey(uint32_t strikeTicks, bool isCall) {
+    return (strikeTicks << 1) | (isCall ? 0u : CONTRACT_KEY_PUT_BIT);
+}
+
+/**
+ * @return the strike of a key, as a number of price ticks.
+ */
+inline uint32_t getKeyStrikeTicks(ContractKey key) {
+    return key >> 1;
+}
+
+/**
+ * @return true if a key is a call's.
+ */
+inline bool isCallKey(ContractKey key) {
+    return (key & CONTRACT_KEY_PUT_BIT) == 0;
+}
+
+/**
+ * Converts a strike to a number of price ticks.
+ *
+ * @param strike The strike price.
+ * @param tick The price tick.
+ * @param strikeTicks Receives the number of ticks.
+ * @return false if the strike is negative, too large for a key or not a whole number of ticks.
+ */
+inline bool toStrikeTicks(double strike, double tick, uint32_t& strikeTicks) {
+
+    double ticks = strike / tick;
+    double rounded = nearbyint(ticks);
+
+    if (rounded < 0.0 || rounded > CONTRACT_KEY_MAX_TICKS || fabs(ticks - rounded) > CONTRACT_KEY_TICK_TOLERANCE) return false;
+
+    strikeTicks = (uint32_t)rounded;
+    return true;
+}
+
+/**
+ * Hashes contract keys. Keys of neighbouring strikes differ in their low bits only,
+ * so they are spread over the table by a multiplicative hash.
+ */
+struct ContractKeyHash {
+    size_t operator()(ContractKey key) const {
+        return (size_t)key * 0x9E3779B97F4A7C15ull;
+    }
+};
+
+#endif
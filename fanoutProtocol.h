@@ -0,0 +1,72 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#ifndef FANOUT_PROTOCOL_H
+#define FANOUT_PROTOCOL_H
+
+#include <cstdint>
+
+/*
+ * The messages a fanout server sends its viewers over a Unix domain stream socket, in the
+ * byte order of the host they both run on. Every message is a FanoutHeader followed by
+ * its body of header.length bytes.
+ *
+ * A viewer that connects is sent a snapshot: a FANOUT_CHAIN and a FANOUT_WINDOW for every
+ * streaming chain, a FANOUT_QUOTES with every quote slot that has a price, and then
+ * FANOUT_SNAPSHOT_END. From then on it is sent deltas: a FANOUT_QUOTES with the slots whose
+ * prices changed since the last one, and a FANOUT_WINDOW when a window of strikes moves.
+ * Deltas are conflated: a slot that changed several times between two sends is sent once,
+ * with its newest prices.
+ */
+
+#define FANOUT_PROTOCOL_VERSION 1
+#define FANOUT_NAME_LENGTH 16
+
+enum FanoutMessageType : uint16_t {
+    FANOUT_CHAIN = 1,           // FanoutChain, then strikeCount strikes as doubles in ascending order
+    FANOUT_WINDOW = 2,          // FanoutWindow
+    FANOUT_QUOTES = 3,          // FanoutQuotes, then count FanoutQuote
+    FANOUT_SNAPSHOT_END = 4     // no body
+};
+
+struct FanoutHeader {
+    uint16_t type;
+    uint16_t version;
+    uint32_t length;            // bytes in the body
+};
+
+/**
+ * A chain as it is streamed by the server. Quote slots are numbered as in the server's
+ * chain: 0 for the underlying, then the options by strike, calls before puts.
+ */
+struct FanoutChain {
+    uint32_t chainIndex;        // identifies the chain in the messages that follow
+    uint32_t strikeCount;
+    char symbol[FANOUT_NAME_LENGTH];
+    char expiry[FANOUT_NAME_LENGTH];            // as it was entered, e.g. 20250321
+    char lastTradeDate[FANOUT_NAME_LENGTH];     // of the options, for their time to expiry
+};
+
+struct FanoutWindow {
+    uint32_t chainIndex;
+    uint32_t windowStart;       // index of the first subscribed strike
+    uint32_t windowSize;        // number of subscribed strikes
+    uint32_t reserved;
+};
+
+struct FanoutQuotes {
+    uint32_t chainIndex;
+    uint32_t count;
+};
+
+struct FanoutQuote {
+    uint32_t slotIndex;
+    uint32_t fields;            // bit n set if prices[n] changed
+    double prices[3];           // indexed by QuoteField
+};
+
+#endif
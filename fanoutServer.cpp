@@ -0,0 +1,356 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#include "fanoutServer.h"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "fixedName.h"
+#include "globals.h"
+
+using namespace std;
+
+/**
+ * Appends a message to a buffer.
+ *
+ * @param out The buffer.
+ * @param type The message type.
+ * @param body The fixed part of the body.
+ * @param length The bytes in the fixed part.
+ * @param extra The records that follow the fixed part, or nullptr.
+ * @param extraLength The bytes in the records.
+ */
+static void appendMessage(string& out, FanoutMessageType type, const void* body, size_t length,
+                          const void* extra = nullptr, size_t extraLength = 0) {
+
+    FanoutHeader header;
+    header.type = type;
+    header.version = FANOUT_PROTOCOL_VERSION;
+    header.length = length + extraLength;
+
+    out.append((const char*)&header, sizeof(header));
+    if (length > 0) out.append((const char*)body, length);
+    if (extraLength > 0) out.append((const char*)extra, extraLength);
+}
+
+/**
+ * Appends the window of a chain to a buffer.
+ */
+static void appendWindow(string& out, uint32_t chainIndex, size_t start, size_t size) {
+
+    FanoutWindow window;
+    window.chainIndex = chainIndex;
+    window.windowStart = start;
+    window.windowSize = size;
+    window.reserved = 0;
+    appendMessage(out, FANOUT_WINDOW, &window, sizeof(window));
+}
+
+/**
+ * Appends the quotes of a chain to a buffer, if there are any.
+ */
+static void appendQuotes(string& out, uint32_t chainIndex, const vector<FanoutQuote>& quotes) {
+
+    if (quotes.empty()) return;
+
+    FanoutQuotes header;
+    header.chainIndex = chainIndex;
+    header.count = quotes.size();
+    appendMessage(out, FANOUT_QUOTES, &header, sizeof(header), quotes.data(), quotes.size() * sizeof(FanoutQuote));
+}
+
+//public methods
+
+/**
+ * Destroys the server, stopping it if it was started.
+ */
+FanoutServer::~FanoutServer() {
+    stop();
+}
+
+/**
+ * Listens on a Unix domain socket and starts publishing the chains of the chain registry
+ * that are streaming. A file left at the path by an earlier run is replaced.
+ *
+ * @param socketPath The path of the socket.
+ * @return true if the server is listening.
+ */
+bool FanoutServer::start(const string& socketPath) {
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) {
+        string toLog = "Fanout socket path is empty or longer than " + to_string(sizeof(address.sun_path) - 1) + " characters\n";
+        logger.log(LOG_ERROR, toLog);
+        return false;
+    }
+    memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+
+    this->listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (this->listenFd < 0) return false;
+
+    unlink(socketPath.c_str());
+    if (bind(this->listenFd, (struct sockaddr*)&address, sizeof(address)) < 0
+        || listen(this->listenFd, FANOUT_LISTEN_BACKLOG) < 0) {
+
+        string toLog = "Failed to listen on fanout socket " + socketPath + ": " + strerror(errno) + "\n";
+        logger.log(LOG_ERROR, toLog);
+        close(this->listenFd);
+        this->listenFd = -1;
+        return false;
+    }
+    this->socketPath = socketPath;
+
+    this->chains.clear();
+    for (OptionChainManager* chain : chainRegistry.getChains()) {
+        if (!chain->isInitialized) continue;
+        FanoutChainState state;
+        state.chain = chain;
+        state.sent.resize(chain->getQuoteCount());
+        this->chains.push_back(move(state));
+    }
+
+    this->stopFlag.store(false, memory_order_relaxed);
+    this->publishThread = thread(&FanoutServer::publishLoop, this);
+
+    string toLog = "Fanout server publishing " + to_string(this->chains.size()) + " chains on " + socketPath + "\n";
+    logger.log(LOG_INFO, toLog);
+    return true;
+}
+
+/**
+ * Stops publishing, disconnects every viewer and removes the socket.
+ */
+void FanoutServer::stop() {
+
+    if (this->listenFd < 0) return;
+
+    this->stopFlag.store(true, memory_order_relaxed);
+    if (this->publishThread.joinable()) this->publishThread.join();
+
+    for (FanoutClient& client : this->clients) close(client.fd);
+    this->clients.clear();
+
+    close(this->listenFd);
+    this->listenFd = -1;
+    unlink(this->socketPath.c_str());
+
+    string toLog = "Fanout server stopped: " + to_string(this->viewersServed) + " viewers served, "
+                   + to_string(this->viewersDropped) + " dropped for falling behind\n";
+    logger.log(LOG_INFO, toLog);
+}
+
+//private methods
+
+/**
+ * Publishes the changes and accepts new viewers every FANOUT_INTERVAL_MS until stopped.
+ */
+void FanoutServer::publishLoop() {
+
+    while (!this->stopFlag.load(memory_order_relaxed)) {
+        publishChanges();
+        acceptViewers();
+        this_thread::sleep_for(chrono::milliseconds(FANOUT_INTERVAL_MS));
+    }
+}
+
+/**
+ * Sends every viewer the windows that moved and the quote slots whose prices changed
+ * since the last round, and remembers them as sent. Viewers are only sent what changed
+ * if there are any; otherwise the changes are only remembered. Every round also sends
+ * the viewers the bytes their sockets did not take before, such as the rest of a large
+ * snapshot, even when nothing changed.
+ */
+void FanoutServer::publishChanges() {
+
+    string message;
+    vector<FanoutQuote> changes;
+
+    for (uint32_t chainIndex = 0; chainIndex < this->chains.size(); chainIndex++) {
+
+        FanoutChainState& state = this->chains[chainIndex];
+        OptionChainManager* chain = state.chain;
+
+        StrikeWindow window = chain->getWindow();
+        size_t windowStart = window.start;
+        size_t windowSize = window.size;
+        if (windowStart != state.windowStart || windowSize != state.windowSize) {
+            state.windowStart = windowStart;
+            state.windowSize = windowSize;
+            appendWindow(message, chainIndex, windowStart, windowSize);
+        }
+
+        changes.clear();
+        TickerId firstTickerId = chain->getUnderlyingTickerId();
+
+        for (size_t slotIndex = 0; slotIndex < state.sent.size(); slotIndex++) {
+
+            QuoteSnapshot quote = chain->getQuote(firstTickerId + slotIndex);
+            QuoteSnapshot& sent = state.sent[slotIndex];
+
+            FanoutQuote change;
+            change.fields = (quote.bid != sent.bid ? 1u << QUOTE_BID : 0u)
+                          | (quote.ask != sent.ask ? 1u << QUOTE_ASK : 0u)
+                          | (quote.last != sent.last ? 1u << QUOTE_LAST : 0u);
+            if (change.fields == 0) continue;
+
+            change.slotIndex = slotIndex;
+            change.prices[QUOTE_BID] = quote.bid;
+            change.prices[QUOTE_ASK] = quote.ask;
+            change.prices[QUOTE_LAST] = quote.last;
+            changes.push_back(change);
+            sent = quote;
+        }
+        appendQuotes(message, chainIndex, changes);
+    }
+
+    if (!this->clients.empty()) broadcast(message);
+}
+
+/**
+ * Accepts the viewers waiting to connect and queues a snapshot for each.
+ */
+void FanoutServer::acceptViewers() {
+
+    while (true) {
+
+        int fd = accept4(this->listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;
+
+        FanoutClient client;
+        client.fd = fd;
+        appendSnapshot(client.pending);
+        this->viewersServed++;
+
+        string toLog = "Fanout viewer connected, " + to_string(this->clients.size() + 1) + " connected\n";
+        logger.log(LOG_INFO, toLog);
+
+        if (flush(client)) this->clients.push_back(move(client));
+    }
+}
+
+/**
+ * Appends a snapshot of every chain, as the viewers were last sent it, to a buffer.
+ *
+ * @param out The buffer.
+ */
+void FanoutServer::appendSnapshot(string& out) {
+
+    vector<FanoutQuote> quotes;
+
+    for (uint32_t chainIndex = 0; chainIndex < this->chains.size(); chainIndex++) {
+
+        FanoutChainState& state = this->chains[chainIndex];
+        OptionChainManager* chain = state.chain;
+        const vector<double>& strikes = chain->getStrikesByIndex();
+        vector<OptionData>& options = chain->getOptionChain();
+
+        FanoutChain header;
+        header.chainIndex = chainIndex;
+        header.strikeCount = strikes.size();
+        copyName(header.symbol, chain->getUnderlyingContract().symbol);
+        copyName(header.expiry, chain->getContractDate());
+        copyName(header.lastTradeDate, options.empty() ? string() : options.front().contractDetails.contract.lastTradeDateOrContractMonth);
+        appendMessage(out, FANOUT_CHAIN, &header, sizeof(header), strikes.data(), strikes.size() * sizeof(double));
+        appendWindow(out, chainIndex, state.windowStart, state.windowSize);
+
+        quotes.clear();
+        for (size_t slotIndex = 0; slotIndex < state.sent.size(); slotIndex++) {
+
+            const QuoteSnapshot& sent = state.sent[slotIndex];
+            if (sent.bid == 0.0 && sent.ask == 0.0 && sent.last == 0.0) continue;
+
+            FanoutQuote quote;
+            quote.slotIndex = slotIndex;
+            quote.fields = (1u << QUOTE_BID) | (1u << QUOTE_ASK) | (1u << QUOTE_LAST);
+            quote.prices[QUOTE_BID] = sent.bid;
+            quote.prices[QUOTE_ASK] = sent.ask;
+            quote.prices[QUOTE_LAST] = sent.last;
+            quotes.push_back(quote);
+        }
+        appendQuotes(out, chainIndex, quotes);
+    }
+
+    appendMessage(out, FANOUT_SNAPSHOT_END, nullptr, 0);
+}
+
+/**
+ * Queues a message for every viewer and sends what each can take of its unsent bytes,
+ * disconnecting the viewers that went away or fell too far behind.
+ *
+ * @param message The message, empty to only send the bytes already queued.
+ */
+void FanoutServer::broadcast(const string& message) {
+
+    size_t kept = 0;
+
+    for (size_t i = 0; i < this->clients.size(); i++) {
+
+        FanoutClient& client = this->clients[i];
+        client.pending.append(message);
+        if (!flush(client)) continue;
+
+        if (kept != i) this->clients[kept] = move(client);
+        kept++;
+    }
+    this->clients.resize(kept);
+}
+
+/**
+ * Sends a viewer as much of its unsent bytes as its socket takes without blocking.
+ *
+ * @param client The viewer.
+ * @return false if the viewer was disconnected.
+ */
+bool FanoutServer::flush(FanoutClient& client) {
+
+    size_t sentBytes = 0;
+
+    while (sentBytes < client.pending.size()) {
+
+        ssize_t result = send(client.fd, client.pending.data() + sentBytes, client.pending.size() - sentBytes, MSG_NOSIGNAL);
+        if (result > 0) {
+            sentBytes += result;
+        } else if (result < 0 && errno == EINTR) {
+            continue;
+        } else if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            closeClient(client, "disconnected");
+            return false;
+        }
+    }
+    client.pending.erase(0, sentBytes);
+
+    if (client.pending.size() > FANOUT_MAX_PENDING_BYTES) {
+        this->viewersDropped++;
+        closeClient(client, "dropped for falling behind");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Closes the socket of a viewer and logs why.
+ *
+ * @param client The viewer.
+ * @param reason Why it was closed.
+ */
+void FanoutServer::closeClient(FanoutClient& client, const char* reason) {
+
+    close(client.fd);
+    client.fd = -1;
+
+    string toLog = string("Fanout viewer ") + reason + "\n";
+    logger.log(LOG_INFO, toLog);
+}
@@ -0,0 +1,83 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#ifndef FANOUT_SERVER_H
+#define FANOUT_SERVER_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "fanoutProtocol.h"
+#include "optionChainManager.h"
+
+using namespace std;
+
+#define FANOUT_INTERVAL_MS 10                       // how often the quotes are checked for changes
+#define FANOUT_MAX_PENDING_BYTES (8 * 1024 * 1024)  // unsent bytes after which a viewer is dropped
+#define FANOUT_LISTEN_BACKLOG 16
+
+/**
+ * A viewer connected to the fanout server, and the bytes it was not sent yet.
+ */
+struct FanoutClient {
+    int fd = -1;
+    string pending;
+};
+
+/**
+ * What the viewers were last sent of one chain.
+ */
+struct FanoutChainState {
+    OptionChainManager* chain = nullptr;
+    vector<QuoteSnapshot> sent;     // indexed by quote slot
+    size_t windowStart = 0;
+    size_t windowSize = 0;
+};
+
+/**
+ * Publishes the quotes of every streaming chain to local viewers over a Unix domain
+ * socket, so that any number of viewers share the market data subscriptions of the one
+ * process that is connected to TWS.
+ *
+ * A thread of its own compares the quote slots of every chain with what the viewers were
+ * last sent, every FANOUT_INTERVAL_MS, reading them through their sequence locks, so the
+ * tick path does no work for the viewers. The changes are sent to every viewer, then new
+ * viewers are accepted and sent a snapshot, see fanoutProtocol.h. Sockets never block:
+ * what a viewer cannot take is kept for the next round, and a viewer that falls more than
+ * FANOUT_MAX_PENDING_BYTES behind is disconnected.
+ */
+class FanoutServer {
+
+private:
+
+    int listenFd = -1;
+    string socketPath;
+    vector<FanoutClient> clients;
+    vector<FanoutChainState> chains;
+    atomic<bool> stopFlag{false};
+    thread publishThread;
+    size_t viewersServed = 0;
+    size_t viewersDropped = 0;
+
+    void publishLoop();
+    void publishChanges();
+    void acceptViewers();
+    void appendSnapshot(string& out);
+    void broadcast(const string& message);
+    bool flush(FanoutClient& client);
+    void closeClient(FanoutClient& client, const char* reason);
+
+public:
+
+    ~FanoutServer();
+
+    bool start(const string& socketPath);
+    void stop();
+};
+
+#endif
@@ -0,0 +1,253 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#include "fanoutViewer.h"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "globals.h"
+
+using namespace std;
+
+//public methods
+
+/**
+ * Destroys the viewer, disconnecting it.
+ */
+FanoutViewer::~FanoutViewer() {
+
+    stop();
+    if (this->fd >= 0) close(this->fd);
+}
+
+/**
+ * Connects to a fanout server.
+ *
+ * @param socketPath The path of the server's socket.
+ * @return true if the viewer is connected.
+ */
+bool FanoutViewer::connect(const string& socketPath) {
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) return false;
+    memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+
+    this->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (this->fd < 0) return false;
+
+    if (::connect(this->fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        string toLog = "Failed to connect to fanout server " + socketPath + ": " + strerror(errno) + "\n";
+        logger.log(LOG_ERROR, toLog);
+        close(this->fd);
+        this->fd = -1;
+        return false;
+    }
+
+    string toLog = "Connected to fanout server " + socketPath + "\n";
+    logger.log(LOG_INFO, toLog);
+    return true;
+}
+
+/**
+ * Loads a chain from the server's snapshot and initializes it for streaming, on the
+ * server's window of strikes.
+ *
+ * @param chain The chain, with its underlying contract set.
+ * @return false if the server does not stream the chain, or its snapshot did not arrive
+ *         within FANOUT_SNAPSHOT_TIMEOUT_MS.
+ */
+bool FanoutViewer::loadChain(OptionChainManager* chain) {
+
+    this->chain = chain;
+    chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::milliseconds(FANOUT_SNAPSHOT_TIMEOUT_MS);
+
+    while (!this->snapshotEnded) {
+        if (chrono::steady_clock::now() >= deadline || !readMessages(FANOUT_READ_TIMEOUT_MS)) {
+            logger.log(LOG_ERROR, "No snapshot from the fanout server\n");
+            return false;
+        }
+    }
+
+    if (this->chainIndex < 0) {
+        string toLog = "The fanout server does not stream " + chain->getUnderlyingContract().symbol + " "
+                       + chain->getContractDate() + "\n";
+        logger.log(LOG_ERROR, toLog);
+        return false;
+    }
+
+    chain->initializeChain();
+    chain->moveWindow(this->windowStart, this->windowSize);
+    return true;
+}
+
+/**
+ * Applies the server's deltas to the chain until the user presses the quit key.
+ */
+void FanoutViewer::run() {
+
+    this->stopFlag.store(false, memory_order_relaxed);
+    this->readThread = thread(&FanoutViewer::readLoop, this);
+    while (!this->chain->waitForQuitKey(FANOUT_READ_TIMEOUT_MS));
+    stop();
+}
+
+/**
+ * Stops applying deltas.
+ */
+void FanoutViewer::stop() {
+
+    this->stopFlag.store(true, memory_order_relaxed);
+    if (this->readThread.joinable()) this->readThread.join();
+}
+
+//private methods
+
+/**
+ * Reads and applies messages until stopped or the server goes away.
+ */
+void FanoutViewer::readLoop() {
+
+    while (!this->stopFlag.load(memory_order_relaxed)) {
+        if (!readMessages(FANOUT_READ_TIMEOUT_MS)) {
+            logger.log(LOG_WARNING, "Fanout server went away, the table shows the last prices it sent\n");
+            return;
+        }
+    }
+}
+
+/**
+ * Waits for the socket, reads what arrived and handles every complete message.
+ *
+ * @param timeoutMs The longest time to wait.
+ * @return false if the server closed the connection or sent a malformed message.
+ */
+bool FanoutViewer::readMessages(int timeoutMs) {
+
+    struct pollfd pollFd = {this->fd, POLLIN, 0};
+    int ready = poll(&pollFd, 1, timeoutMs);
+    if (ready < 0) return errno == EINTR;
+    if (ready == 0) return true;
+
+    char data[FANOUT_READ_SIZE];
+    ssize_t count = recv(this->fd, data, sizeof(data), 0);
+    if (count < 0) return errno == EINTR || errno == EAGAIN;
+    if (count == 0) return false;
+    this->buffer.append(data, count);
+
+    size_t offset = 0;
+    while (this->buffer.size() - offset >= sizeof(FanoutHeader)) {
+
+        FanoutHeader header;
+        memcpy(&header, this->buffer.data() + offset, sizeof(header));
+
+        if (header.version != FANOUT_PROTOCOL_VERSION) {
+            string toLog = "Fanout server speaks protocol version " + to_string(header.version) + ", expected "
+                           + to_string(FANOUT_PROTOCOL_VERSION) + "\n";
+            logger.log(LOG_ERROR, toLog);
+            return false;
+        }
+        if (this->buffer.size() - offset - sizeof(header) < header.length) break;
+
+        handleMessage(header, this->buffer.data() + offset + sizeof(header));
+        offset += sizeof(header) + header.length;
+    }
+    this->buffer.erase(0, offset);
+    return true;
+}
+
+/**
+ * Handles one message of the server. Messages about other chains are ignored.
+ *
+ * @param header The message header.
+ * @param body The message body, header.length bytes.
+ */
+void FanoutViewer::handleMessage(const FanoutHeader& header, const char* body) {
+
+    switch (header.type) {
+
+        case FANOUT_CHAIN: {
+            FanoutChain message;
+            if (header.length < sizeof(message)) return;
+            memcpy(&message, body, sizeof(message));
+            if (header.length != sizeof(message) + message.strikeCount * sizeof(double) || this->chainIndex >= 0) return;
+
+            string symbol(message.symbol, strnlen(message.symbol, FANOUT_NAME_LENGTH));
+            string expiry(message.expiry, strnlen(message.expiry, FANOUT_NAME_LENGTH));
+            if (symbol != this->chain->getUnderlyingContract().symbol || expiry != this->chain->getContractDate()) return;
+
+            set<double> strikes;
+            for (uint32_t i = 0; i < message.strikeCount; i++) {
+                double strike;
+                memcpy(&strike, body + sizeof(message) + i * sizeof(double), sizeof(strike));
+                strikes.insert(strike);
+            }
+
+            this->chainIndex = message.chainIndex;
+            this->chain->loadPublishedChain(strikes, string(message.lastTradeDate, strnlen(message.lastTradeDate, FANOUT_NAME_LENGTH)));
+
+            string toLog = "Loaded " + symbol + " " + expiry + " from the fanout server: " + to_string(strikes.size()) + " strikes\n";
+            logger.log(LOG_INFO, toLog);
+            break;
+        }
+
+        case FANOUT_WINDOW: {
+            FanoutWindow message;
+            if (header.length != sizeof(message)) return;
+            memcpy(&message, body, sizeof(message));
+            if ((int64_t)message.chainIndex != this->chainIndex) return;
+
+            this->windowStart = message.windowStart;
+            this->windowSize = message.windowSize;
+            if (this->chain->isInitialized) this->chain->moveWindow(this->windowStart, this->windowSize);
+            break;
+        }
+
+        case FANOUT_QUOTES: {
+            FanoutQuotes message;
+            if (header.length < sizeof(message)) return;
+            memcpy(&message, body, sizeof(message));
+            if (header.length != sizeof(message) + message.count * sizeof(FanoutQuote)) return;
+            if ((int64_t)message.chainIndex != this->chainIndex) return;
+
+            applyQuotes(message, (const FanoutQuote*)(body + sizeof(message)));
+            break;
+        }
+
+        case FANOUT_SNAPSHOT_END:
+            this->snapshotEnded = true;
+            break;
+    }
+}
+
+/**
+ * Applies the prices of a quotes message to the chain.
+ *
+ * @param quotes The message.
+ * @param records The quote records that follow it, which may be unaligned.
+ */
+void FanoutViewer::applyQuotes(const FanoutQuotes& quotes, const FanoutQuote* records) {
+
+    TickerId firstTickerId = this->chain->getUnderlyingTickerId();
+
+    for (uint32_t i = 0; i < quotes.count; i++) {
+
+        FanoutQuote quote;
+        memcpy(&quote, records + i, sizeof(quote));
+        if (quote.slotIndex >= this->chain->getQuoteCount()) continue;
+
+        TickerId tickerId = firstTickerId + quote.slotIndex;
+        if (quote.fields & (1u << QUOTE_BID)) this->chain->updateBid(tickerId, quote.prices[QUOTE_BID]);
+        if (quote.fields & (1u << QUOTE_ASK)) this->chain->updateAsk(tickerId, quote.prices[QUOTE_ASK]);
+        if (quote.fields & (1u << QUOTE_LAST)) this->chain->updateLast(tickerId, quote.prices[QUOTE_LAST]);
+    }
+}
@@ -0,0 +1,62 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#ifndef FANOUT_VIEWER_H
+#define FANOUT_VIEWER_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include "fanoutProtocol.h"
+#include "optionChainManager.h"
+
+using namespace std;
+
+#define FANOUT_SNAPSHOT_TIMEOUT_MS 5000     // for the snapshot after connecting
+#define FANOUT_READ_TIMEOUT_MS 100          // longest wait for the socket before checking for stop
+#define FANOUT_READ_SIZE 65536
+
+/**
+ * Feeds a chain from a fanout server instead of TWS, so that it is displayed without
+ * subscribing to anything.
+ *
+ * The viewer connects to the server's Unix domain socket and waits for its snapshot. The
+ * server's chain with the same symbol and expiry is loaded with its strikes, its quotes
+ * are applied through the same update methods the TWS callbacks use, and its window is
+ * followed as the server moves it. Deltas are then applied by a thread of the viewer's
+ * own until the user quits. If the server goes away the table keeps its last prices.
+ */
+class FanoutViewer {
+
+private:
+
+    int fd = -1;
+    OptionChainManager* chain = nullptr;
+    int64_t chainIndex = -1;        // the server's index of the chain, -1 until it was found
+    size_t windowStart = 0;
+    size_t windowSize = 0;
+    bool snapshotEnded = false;
+    string buffer;
+    atomic<bool> stopFlag{false};
+    thread readThread;
+
+    void readLoop();
+    bool readMessages(int timeoutMs);
+    void handleMessage(const FanoutHeader& header, const char* body);
+    void applyQuotes(const FanoutQuotes& quotes, const FanoutQuote* records);
+
+public:
+
+    ~FanoutViewer();
+
+    bool connect(const string& socketPath);
+    bool loadChain(OptionChainManager* chain);
+    void run();
+    void stop();
+};
+
+#endif
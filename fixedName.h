@@ -0,0 +1,27 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#ifndef FIXED_NAME_H
+#define FIXED_NAME_H
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+using namespace std;
+
+/**
+ * Copies a string into a fixed size field, cutting it short if it does not fit with its terminator.
+ */
+template <size_t N>
+inline void copyName(char (&field)[N], const string& value) {
+
+    memset(field, 0, N);
+    memcpy(field, value.data(), min(value.size(), N - 1));
+}
+
+#endif
@@ -8,6 +8,6 @@ December 6, 2024
 #include "globals.h"
 
 My_wrapper my_wrapper;
-unique_ptr<OptionChainManager> optionChainManager = make_unique<OptionChainManager>();
-int logFileFd;
-mutex logFileMutex;
+ChainRegistry chainRegistry;
+Logger logger;
+LatencyTracker latencyTracker;
@@ -9,7 +9,9 @@ December 6, 2024
 #define GLOBALS_H
 
 #include "my_wrapper.h"
-#include "optionChainManager.h"
+#include "chainRegistry.h"
+#include "logger.h"
+#include "latencyTracker.h"
 
 #define DELAYED_DATA_TYPE 3
 #define FUTURES_CODE "FUT"
@@ -18,10 +20,12 @@ December 6, 2024
 #define DEFAULT_CURRENCY "USD"
 #define PORT_LIVE 7497
 #define PORT_PAPER 7496
+#define LOG_FILE_NAME "logFile.bin"
+#define CONTRACT_CACHE_FILE_NAME "contractCache.bin"
 
 extern My_wrapper my_wrapper;
-extern unique_ptr<OptionChainManager> optionChainManager;
-extern int logFileFd;
-extern mutex logFileMutex;
+extern ChainRegistry chainRegistry;
+extern Logger logger;
+extern LatencyTracker latencyTracker;
 
 #endif
\ No newline at end of file
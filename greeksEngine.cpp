@@ -0,0 +1,271 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#include "greeksEngine.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+static const double SQRT_TWO_PI = 2.506628274631000502;
+static const double INV_SQRT_TWO = 0.707106781186547524;
+
+static inline double normalPdf(double x) {
+    return exp(-0.5 * x * x) / SQRT_TWO_PI;
+}
+
+static inline double normalCdf(double x) {
+    return 0.5 * erfc(-x * INV_SQRT_TWO);
+}
+
+/**
+ * Prices an option on a futures contract with the Black-76 model.
+ *
+ * @param forward The futures price.
+ * @param strike The strike.
+ * @param timeToExpiry The time to expiry in years.
+ * @param rate The continuously compounded risk-free rate.
+ * @param volatility The annualized volatility.
+ * @param isCall true for a call, false for a put.
+ * @return The option price.
+ */
+double black76Price(double forward, double strike, double timeToExpiry, double rate, double volatility, bool isCall) {
+
+    double sign = isCall ? 1.0 : -1.0;
+    double deviation = volatility * sqrt(timeToExpiry);
+    double d1 = (log(forward / strike) + 0.5 * deviation * deviation) / deviation;
+    double d2 = d1 - deviation;
+
+    return exp(-rate * timeToExpiry) * sign * (forward * normalCdf(sign * d1) - strike * normalCdf(sign * d2));
+}
+
+//public methods
+
+/**
+ * Sizes the engine for a chain and clears all results.
+ *
+ * @param strikes The strikes of the chain, indexed the same way as every other call.
+ */
+void GreeksEngine::initialize(const vector<double>& strikes) {
+
+    this->strikeCount = strikes.size();
+    this->strikes = strikes;
+
+    for (vector<double>* column : {&this->callPrices, &this->putPrices, &this->callVolatility, &this->putVolatility,
+                                   &this->callDelta, &this->putDelta, &this->callTheta, &this->putTheta,
+                                   &this->gamma, &this->vega}) {
+        column->assign(this->strikeCount, NAN);
+    }
+
+    for (vector<double>* column : {&this->batchStrike, &this->batchPrice, &this->batchSign, &this->batchVolatility,
+                                   &this->batchDelta, &this->batchTheta, &this->batchGamma, &this->batchVega}) {
+        column->assign(2 * this->strikeCount, 0.0);
+    }
+
+    this->dirtyWordCount = (this->strikeCount + 63) / 64;
+    this->dirtyWords.reset(new atomic<uint64_t>[this->dirtyWordCount]);
+    for (size_t i = 0; i < this->dirtyWordCount; i++) this->dirtyWords[i].store(0, memory_order_relaxed);
+}
+
+/**
+ * Sets the risk-free rate used for discounting.
+ *
+ * @param rate The continuously compounded annual rate.
+ */
+void GreeksEngine::setRate(double rate) {
+    this->rate = rate;
+}
+
+/**
+ * Sets the futures price and time to expiry used by the next compute.
+ *
+ * @param forward The futures price.
+ * @param timeToExpiry The time to expiry in years.
+ */
+void GreeksEngine::setMarket(double forward, double timeToExpiry) {
+    this->forward = forward;
+    this->timeToExpiry = timeToExpiry;
+}
+
+/**
+ * Sets the option prices of a strike used by the next compute.
+ *
+ * @param strikeIndex The index of the strike.
+ * @param callPrice The call's mid price, or NaN if it has none.
+ * @param putPrice The put's mid price, or NaN if it has none.
+ */
+void GreeksEngine::setPrices(size_t strikeIndex, double callPrice, double putPrice) {
+    this->callPrices[strikeIndex] = callPrice;
+    this->putPrices[strikeIndex] = putPrice;
+}
+
+/**
+ * Marks a strike whose option quotes changed.
+ *
+ * @param strikeIndex The index of the strike.
+ */
+void GreeksEngine::markDirty(size_t strikeIndex) {
+    if (strikeIndex >= this->strikeCount) return;
+    this->dirtyWords[strikeIndex / 64].fetch_or(1ULL << (strikeIndex % 64), memory_order_relaxed);
+}
+
+/**
+ * Marks every strike, e.g. after the underlying price changed.
+ */
+void GreeksEngine::markAllDirty() {
+    this->allDirty.store(true, memory_order_relaxed);
+}
+
+/**
+ * Takes the strikes marked since the last call and clears their marks.
+ *
+ * @return The indices of the marked strikes in ascending order.
+ */
+vector<size_t> GreeksEngine::takeDirty() {
+
+    vector<size_t> strikeIndices;
+    bool all = this->allDirty.exchange(false, memory_order_relaxed);
+
+    for (size_t word = 0; word < this->dirtyWordCount; word++) {
+
+        uint64_t bits = this->dirtyWords[word].exchange(0, memory_order_relaxed);
+        if (all) bits = ~0ULL;
+
+        while (bits != 0) {
+            size_t strikeIndex = word * 64 + __builtin_ctzll(bits);
+            if (strikeIndex >= this->strikeCount) break;
+            strikeIndices.push_back(strikeIndex);
+            bits &= bits - 1;
+        }
+    }
+    return strikeIndices;
+}
+
+/**
+ * Recomputes implied volatility and Greeks for the given strikes.
+ *
+ * Both options of each strike are gathered into one batch and solved together.
+ * An option whose price is missing, not above intrinsic value or that cannot be
+ * repriced within GREEKS_PRICE_TOLERANCE gets NaN results.
+ *
+ * @param strikeIndices The strikes to recompute.
+ */
+void GreeksEngine::compute(const vector<size_t>& strikeIndices) {
+
+    size_t count = 0;
+
+    for (size_t strikeIndex : strikeIndices) {
+        this->batchStrike[count] = this->strikes[strikeIndex];
+        this->batchPrice[count] = this->callPrices[strikeIndex];
+        this->batchSign[count] = 1.0;
+        count++;
+        this->batchStrike[count] = this->strikes[strikeIndex];
+        this->batchPrice[count] = this->putPrices[strikeIndex];
+        this->batchSign[count] = -1.0;
+        count++;
+    }
+
+    solveBatch(count);
+
+    for (size_t i = 0; i < strikeIndices.size(); i++) {
+
+        size_t strikeIndex = strikeIndices[i];
+        size_t call = 2 * i;
+        size_t put = 2 * i + 1;
+
+        this->callVolatility[strikeIndex] = this->batchVolatility[call];
+        this->putVolatility[strikeIndex] = this->batchVolatility[put];
+        this->callDelta[strikeIndex] = this->batchDelta[call];
+        this->putDelta[strikeIndex] = this->batchDelta[put];
+        this->callTheta[strikeIndex] = this->batchTheta[call];
+        this->putTheta[strikeIndex] = this->batchTheta[put];
+
+        //gamma and vega of the strike come from the out of the money option, which carries the smile
+        size_t outOfTheMoney = this->strikes[strikeIndex] >= this->forward ? call : put;
+        if (isnan(this->batchGamma[outOfTheMoney])) outOfTheMoney = outOfTheMoney == call ? put : call;
+        this->gamma[strikeIndex] = this->batchGamma[outOfTheMoney];
+        this->vega[strikeIndex] = this->batchVega[outOfTheMoney];
+    }
+}
+
+//private methods
+
+/**
+ * Solves the first count options of the batch for implied volatility and Greeks.
+ *
+ * The first guess is the Corrado-Miller approximation on the undiscounted price,
+ * refined by a fixed number of Newton steps on volatility using vega.
+ *
+ * @param count The number of options in the batch.
+ */
+void GreeksEngine::solveBatch(size_t count) {
+
+    const double forward = this->forward;
+    const double timeToExpiry = this->timeToExpiry;
+    const double sqrtTime = sqrt(timeToExpiry);
+    const double discount = exp(-this->rate * timeToExpiry);
+    const double* strike = this->batchStrike.data();
+    const double* sign = this->batchSign.data();
+    double* price = this->batchPrice.data();
+    double* volatility = this->batchVolatility.data();
+
+    if (!(forward > 0.0) || !(timeToExpiry > 0.0)) {
+        fill_n(this->batchVolatility.begin(), count, NAN);
+        fill_n(this->batchDelta.begin(), count, NAN);
+        fill_n(this->batchTheta.begin(), count, NAN);
+        fill_n(this->batchGamma.begin(), count, NAN);
+        fill_n(this->batchVega.begin(), count, NAN);
+        return;
+    }
+
+    //work on undiscounted prices from here on
+    for (size_t i = 0; i < count; i++) {
+        price[i] /= discount;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        double halfIntrinsic = 0.5 * sign[i] * (forward - strike[i]);
+        double excess = price[i] - halfIntrinsic;
+        double root = excess * excess - (forward - strike[i]) * (forward - strike[i]) / M_PI;
+        double guess = SQRT_TWO_PI / (sqrtTime * (forward + strike[i])) * (excess + sqrt(max(root, 0.0)));
+        volatility[i] = min(max(guess, GREEKS_MIN_VOLATILITY), GREEKS_MAX_VOLATILITY);
+    }
+
+    for (int iteration = 0; iteration < GREEKS_NEWTON_ITERATIONS; iteration++) {
+        for (size_t i = 0; i < count; i++) {
+            double deviation = volatility[i] * sqrtTime;
+            double d1 = (log(forward / strike[i]) + 0.5 * deviation * deviation) / deviation;
+            double d2 = d1 - deviation;
+            double model = sign[i] * (forward * normalCdf(sign[i] * d1) - strike[i] * normalCdf(sign[i] * d2));
+            double vega = max(forward * normalPdf(d1) * sqrtTime, 1e-12);
+            double next = volatility[i] - (model - price[i]) / vega;
+            volatility[i] = min(max(next, GREEKS_MIN_VOLATILITY), GREEKS_MAX_VOLATILITY);
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+
+        double deviation = volatility[i] * sqrtTime;
+        double d1 = (log(forward / strike[i]) + 0.5 * deviation * deviation) / deviation;
+        double d2 = d1 - deviation;
+        double model = sign[i] * (forward * normalCdf(sign[i] * d1) - strike[i] * normalCdf(sign[i] * d2));
+        double density = normalPdf(d1);
+        double intrinsic = max(sign[i] * (forward - strike[i]), 0.0);
+        double upperBound = sign[i] > 0.0 ? forward : strike[i];
+
+        bool valid = price[i] > intrinsic && price[i] < upperBound
+                     && fabs(model - price[i]) <= GREEKS_PRICE_TOLERANCE;
+
+        this->batchVolatility[i] = valid ? volatility[i] : NAN;
+        this->batchDelta[i] = valid ? discount * sign[i] * normalCdf(sign[i] * d1) : NAN;
+        this->batchGamma[i] = valid ? discount * density / (forward * deviation) : NAN;
+        this->batchVega[i] = valid ? discount * forward * density * sqrtTime / 100.0 : NAN;
+        this->batchTheta[i] = valid ? (this->rate * discount * model
+                                       - discount * forward * density * volatility[i] / (2.0 * sqrtTime)) / DAYS_PER_YEAR
+                                    : NAN;
+    }
+}
@@ -0,0 +1,96 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#ifndef GREEKS_ENGINE_H
+#define GREEKS_ENGINE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+#define GREEKS_RISK_FREE_RATE 0.04
+#define GREEKS_NEWTON_ITERATIONS 10
+#define GREEKS_MIN_VOLATILITY 0.001
+#define GREEKS_MAX_VOLATILITY 5.0
+#define GREEKS_PRICE_TOLERANCE 0.001       // largest accepted repricing error, in price points
+#define DAYS_PER_YEAR 365.0
+
+/**
+ * Black-76 implied volatility and Greeks for every strike of one option chain
+ * on a futures contract.
+ *
+ * Inputs and results are kept as structure-of-arrays indexed by strike. A
+ * recompute gathers the dirty strikes into contiguous batches, runs a fixed
+ * number of Newton iterations on all of them at once from a rational first
+ * guess, and scatters the results back, so the inner loops are straight-line
+ * arithmetic over arrays.
+ *
+ * markDirty and markAllDirty may be called from any thread. Everything else
+ * must be called from the single thread that owns the engine.
+ */
+class GreeksEngine {
+
+private:
+
+    size_t strikeCount = 0;
+    vector<double> strikes;
+    vector<double> callPrices;          // mid prices, NaN if the option has no price
+    vector<double> putPrices;
+    vector<double> callVolatility;
+    vector<double> putVolatility;
+    vector<double> callDelta;
+    vector<double> putDelta;
+    vector<double> callTheta;           // per calendar day
+    vector<double> putTheta;
+    vector<double> gamma;               // at the out of the money side's volatility
+    vector<double> vega;                // per volatility point, at the out of the money side's volatility
+    unique_ptr<atomic<uint64_t>[]> dirtyWords;
+    size_t dirtyWordCount = 0;
+    atomic<bool> allDirty{false};
+    double forward = 0.0;
+    double timeToExpiry = 0.0;
+    double rate = GREEKS_RISK_FREE_RATE;
+
+    //batch scratch space, two options per strike
+    vector<double> batchStrike;
+    vector<double> batchPrice;
+    vector<double> batchSign;           // +1 for calls, -1 for puts
+    vector<double> batchVolatility;
+    vector<double> batchDelta;
+    vector<double> batchTheta;
+    vector<double> batchGamma;
+    vector<double> batchVega;
+
+    void solveBatch(size_t count);
+
+public:
+
+    void initialize(const vector<double>& strikes);
+    void setRate(double rate);
+    void setMarket(double forward, double timeToExpiry);
+    void setPrices(size_t strikeIndex, double callPrice, double putPrice);
+    void markDirty(size_t strikeIndex);
+    void markAllDirty();
+    vector<size_t> takeDirty();
+    void compute(const vector<size_t>& strikeIndices);
+    size_t getStrikeCount() const { return this->strikeCount; }
+    double getCallVolatility(size_t strikeIndex) const { return this->callVolatility[strikeIndex]; }
+    double getPutVolatility(size_t strikeIndex) const { return this->putVolatility[strikeIndex]; }
+    double getCallDelta(size_t strikeIndex) const { return this->callDelta[strikeIndex]; }
+    double getPutDelta(size_t strikeIndex) const { return this->putDelta[strikeIndex]; }
+    double getCallTheta(size_t strikeIndex) const { return this->callTheta[strikeIndex]; }
+    double getPutTheta(size_t strikeIndex) const { return this->putTheta[strikeIndex]; }
+    double getGamma(size_t strikeIndex) const { return this->gamma[strikeIndex]; }
+    double getVega(size_t strikeIndex) const { return this->vega[strikeIndex]; }
+};
+
+double black76Price(double forward, double strike, double timeToExpiry, double rate, double volatility, bool isCall);
+
+#endif
@@ -0,0 +1,111 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#include "hdrHistogram.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+//public methods
+
+/**
+ * Constructs an empty histogram.
+ */
+HdrHistogram::HdrHistogram() {
+    reset();
+}
+
+/**
+ * Counts a value. Safe to call from any thread.
+ *
+ * @param value The value to count.
+ */
+void HdrHistogram::record(uint64_t value) {
+
+    value = min<uint64_t>(value, (1ULL << HDR_MAX_VALUE_BITS) - 1);
+    this->counts[bucketIndex(value)].fetch_add(1, memory_order_relaxed);
+
+    uint64_t currentMax = this->maxValue.load(memory_order_relaxed);
+    while (value > currentMax && !this->maxValue.compare_exchange_weak(currentMax, value, memory_order_relaxed)) {}
+}
+
+/**
+ * Clears every count. Values recorded concurrently may or may not survive.
+ */
+void HdrHistogram::reset() {
+    for (size_t i = 0; i < HDR_BUCKET_COUNT; i++) this->counts[i].store(0, memory_order_relaxed);
+    this->maxValue.store(0, memory_order_relaxed);
+}
+
+/**
+ * @return the number of values recorded.
+ */
+uint64_t HdrHistogram::getCount() const {
+
+    uint64_t total = 0;
+    for (size_t i = 0; i < HDR_BUCKET_COUNT; i++) total += this->counts[i].load(memory_order_relaxed);
+    return total;
+}
+
+/**
+ * @return the largest value recorded, exactly.
+ */
+uint64_t HdrHistogram::getMax() const {
+    return this->maxValue.load(memory_order_relaxed);
+}
+
+/**
+ * Finds the value that the given percentage of recorded values are at or below.
+ *
+ * @param percentile The percentile, from 0 to 100.
+ * @return The highest value of the bucket the percentile falls in, no more than
+ *         the largest value recorded, or 0 if the histogram is empty.
+ */
+uint64_t HdrHistogram::getValueAtPercentile(double percentile) const {
+
+    uint64_t total = getCount();
+    if (total == 0) return 0;
+
+    uint64_t rank = max<uint64_t>(1, (uint64_t)ceil(min(max(percentile, 0.0), 100.0) / 100.0 * total));
+    uint64_t seen = 0;
+
+    for (size_t i = 0; i < HDR_BUCKET_COUNT; i++) {
+        seen += this->counts[i].load(memory_order_relaxed);
+        if (seen >= rank) return min(highestEquivalentValue(i), getMax());
+    }
+    return getMax();
+}
+
+//private methods
+
+/**
+ * Maps a value to its bucket.
+ *
+ * Values below 2^HDR_SUB_BUCKET_BITS are their own bucket. A larger value is
+ * shifted right until it fits in HDR_SUB_BUCKET_BITS bits; the shift selects
+ * the group of buckets and the remaining top bits the bucket within it.
+ */
+size_t HdrHistogram::bucketIndex(uint64_t value) {
+
+    if (value < (1ULL << HDR_SUB_BUCKET_BITS)) return value;
+
+    int shift = (63 - __builtin_clzll(value)) - (HDR_SUB_BUCKET_BITS - 1);
+    return ((size_t)shift << (HDR_SUB_BUCKET_BITS - 1)) + (value >> shift);
+}
+
+/**
+ * @return the largest value that maps to a bucket.
+ */
+uint64_t HdrHistogram::highestEquivalentValue(size_t index) {
+
+    if (index < (1ULL << HDR_SUB_BUCKET_BITS)) return index;
+
+    int shift = (int)(index >> (HDR_SUB_BUCKET_BITS - 1)) - 1;
+    uint64_t subBucket = index - ((size_t)shift << (HDR_SUB_BUCKET_BITS - 1));
+    return ((subBucket + 1) << shift) - 1;
+}
@@ -0,0 +1,51 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#ifndef HDR_HISTOGRAM_H
+#define HDR_HISTOGRAM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+#define HDR_SUB_BUCKET_BITS 8       // 256 buckets per power of two: values are kept within 1/128 of their size
+#define HDR_MAX_VALUE_BITS 42       // larger values are clamped to 2^42 - 1
+#define HDR_BUCKET_COUNT ((HDR_MAX_VALUE_BITS - HDR_SUB_BUCKET_BITS + 2) << (HDR_SUB_BUCKET_BITS - 1))
+
+/**
+ * High dynamic range histogram of unsigned integer values.
+ *
+ * Values below 256 are counted exactly. Above that every power of two is split
+ * into 128 linear buckets, so a reported value is never more than 1% above the
+ * value recorded, whatever its magnitude. Buckets are fixed, so recording is an
+ * index computation and one relaxed atomic increment, and any thread may record
+ * while another reads percentiles.
+ */
+class HdrHistogram {
+
+private:
+
+    atomic<uint64_t> counts[HDR_BUCKET_COUNT];
+    atomic<uint64_t> maxValue{0};
+
+    static size_t bucketIndex(uint64_t value);
+    static uint64_t highestEquivalentValue(size_t index);
+
+public:
+
+    HdrHistogram();
+
+    void record(uint64_t value);
+    void reset();
+    uint64_t getCount() const;
+    uint64_t getMax() const;
+    uint64_t getValueAtPercentile(double percentile) const;
+};
+
+#endif
@@ -0,0 +1,196 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#include "latencyTracker.h"
+#include <csignal>
+#include <cstdio>
+#include "ECycleClock.h"
+#include "globals.h"
+
+using namespace std;
+
+static thread_local LatencyTrace currentTrace;
+static atomic<bool> dumpRequested{false};
+
+static const char* stageNames[LATENCY_STAGE_COUNT] = {
+    "receive->enqueue", "enqueue->dequeue", "dequeue->decode", "decode->apply", "apply->render",
+    "receive->apply", "receive->render"
+};
+
+/**
+ * Handler of LATENCY_DUMP_SIGNAL. Only sets a flag; the report is made by dumpIfRequested.
+ */
+static void requestDump(int) {
+    dumpRequested.store(true, memory_order_relaxed);
+}
+
+//public methods
+
+/**
+ * Starts counting latencies and installs the LATENCY_DUMP_SIGNAL handler.
+ * Must be called before the dispatcher and the table are started.
+ */
+void LatencyTracker::enable() {
+
+    this->startTicks = ECycleClock::now();
+    this->startTime = chrono::steady_clock::now();
+    signal(LATENCY_DUMP_SIGNAL, requestDump);
+    this->enabled.store(true, memory_order_relaxed);
+}
+
+/**
+ * @return true if latencies are being counted.
+ */
+bool LatencyTracker::isEnabled() const {
+    return this->enabled.load(memory_order_relaxed);
+}
+
+/**
+ * Publishes the stamps of a message a worker is about to decode and counts the
+ * intervals up to its decode.
+ *
+ * @param message The message, stamped by the reader and the dispatcher.
+ */
+void LatencyTracker::beginMessage(const EMessage& message) {
+
+    currentTrace.received = message.receivedTime();
+    currentTrace.enqueued = message.enqueuedTime();
+    currentTrace.dequeued = message.dequeuedTime();
+    currentTrace.decoded = ECycleClock::now();
+    currentTrace.applied = 0;
+
+    recordInterval(LATENCY_RECEIVE_TO_ENQUEUE, currentTrace.received, currentTrace.enqueued);
+    recordInterval(LATENCY_ENQUEUE_TO_DEQUEUE, currentTrace.enqueued, currentTrace.dequeued);
+    recordInterval(LATENCY_DEQUEUE_TO_DECODE, currentTrace.dequeued, currentTrace.decoded);
+}
+
+/**
+ * Clears the trace published by beginMessage once the message is decoded.
+ */
+void LatencyTracker::endMessage() {
+    currentTrace = LatencyTrace();
+}
+
+/**
+ * Stamps the trace of the message being decoded when it has updated a quote.
+ * Does nothing on a thread that is not decoding a traced message.
+ */
+void LatencyTracker::recordApply() {
+
+    if (currentTrace.received == 0) return;
+
+    currentTrace.applied = ECycleClock::now();
+    recordInterval(LATENCY_DECODE_TO_APPLY, currentTrace.decoded, currentTrace.applied);
+    recordInterval(LATENCY_RECEIVE_TO_APPLY, currentTrace.received, currentTrace.applied);
+}
+
+/**
+ * Counts the intervals up to the quote update of a tick applied in a batch, from
+ * the stamps of the message the tick was decoded from. Ticks of untraced messages
+ * carry no stamps and are skipped.
+ *
+ * @param received The receive stamp of the tick's message.
+ * @param decoded The decode stamp of the tick's message.
+ * @param applied When the tick's quote was updated.
+ */
+void LatencyTracker::recordTickApply(uint64_t received, uint64_t decoded, uint64_t applied) {
+
+    if (received == 0) return;
+
+    recordInterval(LATENCY_DECODE_TO_APPLY, decoded, applied);
+    recordInterval(LATENCY_RECEIVE_TO_APPLY, received, applied);
+}
+
+/**
+ * Counts the cells of a frame that has just reached the terminal.
+ *
+ * @param paintedTraces The receive and apply stamps of the oldest update of every traced cell painted.
+ */
+void LatencyTracker::recordRender(const vector<pair<uint64_t, uint64_t>>& paintedTraces) {
+
+    uint64_t rendered = ECycleClock::now();
+
+    for (const pair<uint64_t, uint64_t>& trace : paintedTraces) {
+        recordInterval(LATENCY_RECEIVE_TO_RENDER, trace.first, rendered);
+        if (trace.second >= trace.first) recordInterval(LATENCY_APPLY_TO_RENDER, trace.second, rendered);
+    }
+}
+
+/**
+ * Formats the count, median, tail percentiles and maximum of every stage.
+ *
+ * @return One line per stage, in microseconds.
+ */
+vector<string> LatencyTracker::report() const {
+
+    vector<string> lines;
+    double elapsedNs = chrono::duration<double, nano>(chrono::steady_clock::now() - this->startTime).count();
+    uint64_t elapsedTicks = ECycleClock::now() - this->startTicks;
+    double microsecondsPerTick = elapsedTicks > 0 ? elapsedNs / elapsedTicks / 1000.0 : 0.0;
+
+    for (int stage = 0; stage < LATENCY_STAGE_COUNT; stage++) {
+
+        const HdrHistogram& histogram = this->histograms[stage];
+        char line[160];
+
+        snprintf(line, sizeof(line), "Latency %-16s count %llu p50 %.1f us p99 %.1f us p99.9 %.1f us max %.1f us",
+                 stageNames[stage], (unsigned long long)histogram.getCount(),
+                 histogram.getValueAtPercentile(50.0) * microsecondsPerTick,
+                 histogram.getValueAtPercentile(99.0) * microsecondsPerTick,
+                 histogram.getValueAtPercentile(99.9) * microsecondsPerTick,
+                 histogram.getMax() * microsecondsPerTick);
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+/**
+ * Logs a report if LATENCY_DUMP_SIGNAL arrived since the last call. Called by
+ * the render thread every frame.
+ */
+void LatencyTracker::dumpIfRequested() {
+    if (dumpRequested.exchange(false, memory_order_relaxed)) dump();
+}
+
+/**
+ * Logs a report of every stage.
+ */
+void LatencyTracker::dump() {
+    for (const string& line : report()) logger.log(LOG_INFO, line + "\n");
+}
+
+/**
+ * @return the trace of the message the calling thread is decoding, all 0 if there is none.
+ */
+const LatencyTrace& LatencyTracker::getCurrentTrace() {
+    return currentTrace;
+}
+
+/**
+ * Replaces the calling thread's trace, so the cells a batch of ticks sets carry the
+ * stamps of those ticks rather than of the message being decoded when the batch was
+ * delivered.
+ *
+ * @param trace The trace to publish.
+ * @return The trace it replaced, to be published again afterwards.
+ */
+LatencyTrace LatencyTracker::exchangeCurrentTrace(const LatencyTrace& trace) {
+
+    LatencyTrace previous = currentTrace;
+    currentTrace = trace;
+    return previous;
+}
+
+//private methods
+
+/**
+ * Counts the interval between two stamps. Intervals with a missing stamp are skipped.
+ */
+void LatencyTracker::recordInterval(LatencyStage stage, uint64_t from, uint64_t to) {
+    if (from == 0 || to == 0) return;
+    this->histograms[stage].record(to > from ? to - from : 0);
+}
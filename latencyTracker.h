@@ -0,0 +1,87 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#ifndef LATENCY_TRACKER_H
+#define LATENCY_TRACKER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "EMessage.h"
+#include "hdrHistogram.h"
+
+using namespace std;
+
+#define LATENCY_DUMP_SIGNAL SIGUSR1
+
+enum LatencyStage {
+    LATENCY_RECEIVE_TO_ENQUEUE = 0,     // framing the message in the reader thread
+    LATENCY_ENQUEUE_TO_DEQUEUE = 1,     // waiting in the reader queue
+    LATENCY_DEQUEUE_TO_DECODE = 2,      // dispatch to and waiting in a worker queue
+    LATENCY_DECODE_TO_APPLY = 3,        // decoding and the wrapper callback, up to the quote update
+    LATENCY_APPLY_TO_RENDER = 4,        // waiting for the next frame and painting it
+    LATENCY_RECEIVE_TO_APPLY = 5,
+    LATENCY_RECEIVE_TO_RENDER = 6,
+    LATENCY_STAGE_COUNT = 7
+};
+
+/**
+ * ECycleClock stamps of the message a worker thread is decoding. Stamps not
+ * taken are 0.
+ */
+struct LatencyTrace {
+    uint64_t received = 0;
+    uint64_t enqueued = 0;
+    uint64_t dequeued = 0;
+    uint64_t decoded = 0;
+    uint64_t applied = 0;
+};
+
+/**
+ * End to end tick latency, from the socket read to the cell on screen.
+ *
+ * The reader and the dispatcher stamp each message as it passes through them.
+ * A worker publishes the stamps in a thread local trace while it decodes the
+ * message, the quote update that the message causes stamps the trace again, and
+ * the table keeps the stamps of the oldest update of every cell until the cell
+ * is painted. Batched ticks carry their message's stamps instead, since a batch
+ * is applied after its messages were decoded. Each interval between stamps is
+ * counted in its own histogram, in ECycleClock ticks; ticks are converted to
+ * time when a report is made, from the ticks and the steady clock time elapsed
+ * since tracking was enabled.
+ */
+class LatencyTracker {
+
+private:
+
+    atomic<bool> enabled{false};
+    HdrHistogram histograms[LATENCY_STAGE_COUNT];
+    uint64_t startTicks = 0;
+    chrono::steady_clock::time_point startTime;
+
+    void recordInterval(LatencyStage stage, uint64_t from, uint64_t to);
+
+public:
+
+    void enable();
+    bool isEnabled() const;
+    void beginMessage(const EMessage& message);
+    void endMessage();
+    void recordApply();
+    void recordTickApply(uint64_t received, uint64_t decoded, uint64_t applied);
+    void recordRender(const vector<pair<uint64_t, uint64_t>>& paintedTraces);
+    vector<string> report() const;
+    void dumpIfRequested();
+    void dump();
+    static const LatencyTrace& getCurrentTrace();
+    static LatencyTrace exchangeCurrentTrace(const LatencyTrace& trace);
+};
+
+#endif
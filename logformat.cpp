@@ -0,0 +1,132 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+/*
+Offline formatter for the binary log written by Logger.
+
+Usage: logformat [logFile.bin]
+
+Reads every record, orders them by timestamp and prints one line of text
+per message to standard output.
+*/
+
+#include "logger.h"
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <time.h>
+
+using namespace std;
+
+static const char* levelNames[] = {"DEBUG", "INFO", "WARNING", "ERROR", "OFF"};
+static const char* quoteFieldNames[] = {"Bid", "Ask", "Last"};
+
+/**
+ * Prints the timestamp and level prefix of a log line.
+ *
+ * @param record The first record of the message.
+ */
+static void printPrefix(const LogRecord& record) {
+
+    time_t seconds = record.timestamp / 1000000000ULL;
+    struct tm local;
+    char timeText[32];
+
+    localtime_r(&seconds, &local);
+    strftime(timeText, sizeof(timeText), "%Y-%m-%d %H:%M:%S", &local);
+    printf("%s.%06llu [%s] [%u] ", timeText, (unsigned long long)(record.timestamp % 1000000000ULL) / 1000,
+           levelNames[min<int>(record.level, LOG_OFF)], record.threadId);
+}
+
+/**
+ * Prints a single structured record.
+ *
+ * @param record The record to print.
+ */
+static void printRecord(const LogRecord& record) {
+
+    string symbol(record.text, min<int>(record.textLength, LOG_TEXT_SIZE));
+
+    printPrefix(record);
+
+    switch (record.event) {
+
+    case LOG_EVENT_TICK_PRICE:
+        printf("Tick Price. Ticker Id: %lld, Field: %d, Price: %f\n", (long long)record.id, record.field, record.value);
+        break;
+
+    case LOG_EVENT_QUOTE_UPDATE:
+        if (record.right == 0) {
+            printf("'%s' updated for underlying contract: %s, Price: %f\n",
+                   quoteFieldNames[record.field % 3], symbol.c_str(), record.value);
+        } else {
+            printf("'%s' updated for Ticker ID: %lld Symbol: %s Strike: %f Type: %c, Price: %f\n",
+                   quoteFieldNames[record.field % 3], (long long)record.id, symbol.c_str(), record.strike,
+                   record.right, record.value);
+        }
+        break;
+
+    default:
+        printf("Unknown event %u\n", record.event);
+        break;
+    }
+}
+
+int main(int argc, char** argv) {
+
+    const char* path = argc > 1 ? argv[1] : "logFile.bin";
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return 1;
+    }
+
+    LogFileHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != LOG_FILE_MAGIC) {
+        fprintf(stderr, "%s is not a binary log file\n", path);
+        return 1;
+    }
+    if (header.version != LOG_FILE_VERSION || header.recordSize != sizeof(LogRecord)) {
+        fprintf(stderr, "Unsupported log file version %u\n", header.version);
+        return 1;
+    }
+
+    vector<LogRecord> records;
+    LogRecord record;
+    while (fread(&record, sizeof(record), 1, file) == 1) {
+        records.push_back(record);
+    }
+    fclose(file);
+
+    stable_sort(records.begin(), records.end(), [](const LogRecord& a, const LogRecord& b) {
+        return a.timestamp < b.timestamp;
+    });
+
+    map<uint32_t, pair<LogRecord, string>> pendingText;    //continued text per thread
+
+    for (const LogRecord& current : records) {
+
+        if (current.event != LOG_EVENT_TEXT) {
+            printRecord(current);
+            continue;
+        }
+
+        auto it = pendingText.find(current.threadId);
+        if (it == pendingText.end()) {
+            it = pendingText.emplace(current.threadId, make_pair(current, string())).first;
+        }
+        it->second.second.append(current.text, min<int>(current.textLength, LOG_TEXT_SIZE));
+
+        if (!(current.flags & LOG_FLAG_CONTINUED)) {
+            printPrefix(it->second.first);
+            printf("%s\n", it->second.second.c_str());
+            pendingText.erase(it);
+        }
+    }
+
+    return 0;
+}
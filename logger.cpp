@@ -0,0 +1,443 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#include "logger.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace std;
+
+#define LOG_RING_MASK (LOG_RING_CAPACITY - 1)
+#define LOG_MAX_IOVECS 256
+
+static thread_local LogRing* threadRing = nullptr;
+
+/**
+ * @return The current CLOCK_REALTIME time in nanoseconds.
+ */
+static uint64_t nowNanoseconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * Writes every byte described by the given iovecs, retrying on partial writes.
+ *
+ * @param fd The file descriptor to write to.
+ * @param iov The buffers to write. The array is modified on partial writes.
+ * @param count The number of buffers.
+ * @return true if everything was written, false on error.
+ */
+static bool writeAll(int fd, struct iovec* iov, int count) {
+
+    while (count > 0) {
+        ssize_t written = writev(fd, iov, count);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        while (count > 0 && (size_t)written >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char*)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+    return true;
+}
+
+//public methods
+
+/**
+ * Destroys the logger, flushing any records that are still buffered.
+ */
+Logger::~Logger() {
+    close();
+}
+
+/**
+ * Opens the binary log file and starts the background writer thread.
+ *
+ * The file is truncated and starts with a LogFileHeader so that the
+ * logformat tool can check it is reading a compatible file.
+ *
+ * @param path The path of the binary log file.
+ * @return true if the file was opened, false otherwise.
+ */
+bool Logger::open(const char* path) {
+
+    this->fd = ::open(path, O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (this->fd < 0) return false;
+
+    LogFileHeader header = {LOG_FILE_MAGIC, LOG_FILE_VERSION, LOG_RECORD_SIZE};
+    if (write(this->fd, &header, sizeof(header)) != sizeof(header)) {
+        ::close(this->fd);
+        this->fd = -1;
+        return false;
+    }
+
+    this->stopFlag = false;
+    this->writerThread = thread(&Logger::writerLoop, this);
+    return true;
+}
+
+/**
+ * Stops the writer thread, flushes every remaining record and closes the file.
+ *
+ * A final record with the written, dropped, failed and backpressure counters
+ * is appended so that lost records are visible in the formatted log.
+ */
+void Logger::close() {
+
+    if (!this->writerThread.joinable()) return;
+
+    log(LOG_INFO, "Logger stopped. Written: " + to_string(getWrittenCount())
+                  + ", Dropped: " + to_string(getDroppedCount())
+                  + ", Failed: " + to_string(getFailedCount())
+                  + ", Backpressure: " + to_string(getBackpressureCount()));
+
+    {
+        lock_guard<mutex> lock(this->writerMutex);
+        this->stopFlag = true;
+    }
+    this->writerCondition.notify_one();
+    this->writerThread.join();
+
+    ::close(this->fd);
+    this->fd = -1;
+}
+
+/**
+ * Sets the minimum level a record must have to be logged.
+ *
+ * @param level The new minimum level.
+ */
+void Logger::setLevel(LogLevel level) {
+    this->minLevel.store(level, memory_order_relaxed);
+}
+
+/**
+ * Sets what producers do when their ring is full.
+ *
+ * @param policy LOG_OVERFLOW_DROP to drop the record, LOG_OVERFLOW_BLOCK to wait for space.
+ */
+void Logger::setOverflowPolicy(LogOverflowPolicy policy) {
+    this->overflowPolicy.store(policy, memory_order_relaxed);
+}
+
+/**
+ * Logs a line of free text.
+ *
+ * Text longer than one record is split over consecutive records from the
+ * same thread, which the formatter joins back together. A trailing newline
+ * is stripped because the formatter adds its own.
+ *
+ * @param level The level of the message.
+ * @param text The text to log.
+ */
+void Logger::log(LogLevel level, const string& text) {
+
+    if (!isEnabled(level)) return;
+
+    size_t length = text.length();
+    if (length > 0 && text[length - 1] == '\n') length--;
+
+    unsigned int count = max<size_t>(1, (length + LOG_TEXT_SIZE - 1) / LOG_TEXT_SIZE);
+    LogRing* ring = getThreadRing();
+    LogRecord* firstRecord = reserve(ring, count);
+    if (firstRecord == nullptr) return;
+
+    uint64_t timestamp = nowNanoseconds();
+    uint64_t head = ring->head.load(memory_order_relaxed);
+
+    for (unsigned int i = 0; i < count; i++) {
+        LogRecord& record = ring->records[(head + i) & LOG_RING_MASK];
+        size_t chunk = min<size_t>(LOG_TEXT_SIZE, length - i * LOG_TEXT_SIZE);
+
+        record.timestamp = timestamp;
+        record.threadId = ring->threadId;
+        record.event = LOG_EVENT_TEXT;
+        record.level = level;
+        record.flags = (i + 1 < count) ? LOG_FLAG_CONTINUED : 0;
+        record.textLength = chunk;
+        memcpy(record.text, text.data() + i * LOG_TEXT_SIZE, chunk);
+    }
+
+    ring->head.store(head + count, memory_order_release);
+}
+
+/**
+ * Logs a raw tick price received from TWS.
+ *
+ * @param level The level of the message.
+ * @param tickerId The ticker ID the tick belongs to.
+ * @param field The TickType of the tick.
+ * @param price The price of the tick.
+ */
+void Logger::logTick(LogLevel level, long tickerId, int field, double price) {
+
+    if (!isEnabled(level)) return;
+
+    LogRing* ring = getThreadRing();
+    LogRecord* record = reserve(ring, 1);
+    if (record == nullptr) return;
+
+    record->timestamp = nowNanoseconds();
+    record->threadId = ring->threadId;
+    record->event = LOG_EVENT_TICK_PRICE;
+    record->level = level;
+    record->flags = 0;
+    record->id = tickerId;
+    record->field = field;
+    record->value = price;
+    record->strike = 0.0;
+    record->right = 0;
+    record->reserved = 0;
+    record->textLength = 0;
+
+    ring->head.store(ring->head.load(memory_order_relaxed) + 1, memory_order_release);
+}
+
+/**
+ * Logs an update to the bid, ask or last price of a contract in the option chain.
+ *
+ * @param level The level of the message.
+ * @param tickerId The ticker ID of the contract, 0 for the underlying.
+ * @param field Which quote field was updated.
+ * @param price The new price.
+ * @param strike The strike of the option, ignored for the underlying.
+ * @param right 'C' or 'P' for options, 0 for the underlying.
+ * @param symbol The symbol of the contract.
+ */
+void Logger::logQuote(LogLevel level, long tickerId, QuoteField field, double price, double strike, char right,
+                      const string& symbol) {
+
+    if (!isEnabled(level)) return;
+
+    LogRing* ring = getThreadRing();
+    LogRecord* record = reserve(ring, 1);
+    if (record == nullptr) return;
+
+    size_t length = min<size_t>(LOG_TEXT_SIZE, symbol.length());
+
+    record->timestamp = nowNanoseconds();
+    record->threadId = ring->threadId;
+    record->event = LOG_EVENT_QUOTE_UPDATE;
+    record->level = level;
+    record->flags = 0;
+    record->id = tickerId;
+    record->field = field;
+    record->value = price;
+    record->strike = strike;
+    record->right = right;
+    record->reserved = 0;
+    record->textLength = length;
+    memcpy(record->text, symbol.data(), length);
+
+    ring->head.store(ring->head.load(memory_order_relaxed) + 1, memory_order_release);
+}
+
+/**
+ * @return The number of records written to the log file so far.
+ */
+uint64_t Logger::getWrittenCount() {
+    return this->writtenCount.load(memory_order_relaxed);
+}
+
+/**
+ * @return The number of records dropped because a producer ring was full.
+ */
+uint64_t Logger::getDroppedCount() {
+    return this->droppedCount.load(memory_order_relaxed);
+}
+
+/**
+ * @return The number of records lost because writing them to the log file failed.
+ */
+uint64_t Logger::getFailedCount() {
+    return this->failedCount.load(memory_order_relaxed);
+}
+
+/**
+ * @return The number of times a producer had to wait for space in its ring.
+ */
+uint64_t Logger::getBackpressureCount() {
+    return this->backpressureCount.load(memory_order_relaxed);
+}
+
+/**
+ * Converts a level name such as "debug" or "ERROR" to a LogLevel.
+ *
+ * @param name The name of the level.
+ * @return The matching level, or LOG_DEBUG if the name is not recognised.
+ */
+LogLevel parseLogLevel(const string& name) {
+
+    string upper = name;
+    transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+
+    if (upper == "INFO") return LOG_INFO;
+    if (upper == "WARNING") return LOG_WARNING;
+    if (upper == "ERROR") return LOG_ERROR;
+    if (upper == "OFF") return LOG_OFF;
+    return LOG_DEBUG;
+}
+
+//private methods
+
+/**
+ * Returns the ring owned by the calling thread, creating and registering it on first use.
+ *
+ * @return The calling thread's ring.
+ */
+LogRing* Logger::getThreadRing() {
+
+    if (threadRing != nullptr) return threadRing;
+
+    unique_ptr<LogRing> ring = make_unique<LogRing>();
+    ring->threadId = syscall(SYS_gettid);
+    threadRing = ring.get();
+
+    lock_guard<mutex> lock(this->ringsMutex);
+    this->rings.push_back(move(ring));
+    this->ringCount.store(this->rings.size(), memory_order_release);
+    return threadRing;
+}
+
+/**
+ * Reserves space for a number of consecutive records in a ring.
+ *
+ * The records are published by advancing the ring's head once they are filled in.
+ * Either all of the records are reserved or none are, so a multi-record message is
+ * never half written.
+ *
+ * @param ring The calling thread's ring.
+ * @param count The number of records needed.
+ * @return A pointer to the first reserved record, or nullptr if the records were dropped.
+ */
+LogRecord* Logger::reserve(LogRing* ring, unsigned int count) {
+
+    uint64_t head = ring->head.load(memory_order_relaxed);
+    bool stalled = false;
+
+    while (head + count - ring->tail.load(memory_order_acquire) > LOG_RING_CAPACITY) {
+        if (count > LOG_RING_CAPACITY || this->fd.load(memory_order_relaxed) < 0 || this->stopFlag.load(memory_order_relaxed)
+            || this->overflowPolicy.load(memory_order_relaxed) == LOG_OVERFLOW_DROP) {
+            this->droppedCount.fetch_add(count, memory_order_relaxed);
+            return nullptr;
+        }
+        if (!stalled) {
+            this->backpressureCount.fetch_add(1, memory_order_relaxed);
+            this->writerCondition.notify_one();
+            stalled = true;
+        }
+        this_thread::yield();
+    }
+
+    return &ring->records[head & LOG_RING_MASK];
+}
+
+/**
+ * Writes every published record in every ring to the log file with writev.
+ *
+ * The records are written straight out of the rings, at most two iovecs per
+ * ring, and the space is handed back to the producers once the write completes.
+ * Records whose write failed are counted as failed rather than written.
+ *
+ * @return The number of records taken off the rings.
+ */
+size_t Logger::drain() {
+
+    struct iovec iov[LOG_MAX_IOVECS];
+    LogRing* drained[LOG_MAX_IOVECS / 2];
+    uint64_t heads[LOG_MAX_IOVECS / 2];
+    size_t total = 0;
+    size_t ringCount = this->ringCount.load(memory_order_acquire);
+    size_t ringIndex = 0;
+
+    while (ringIndex < ringCount) {
+
+        int iovCount = 0;
+        int drainedCount = 0;
+        size_t batch = 0;
+
+        unique_lock<mutex> lockRings(this->ringsMutex);
+        for (; ringIndex < ringCount && drainedCount < LOG_MAX_IOVECS / 2; ringIndex++) {
+
+            LogRing* ring = this->rings[ringIndex].get();
+            uint64_t tail = ring->tail.load(memory_order_relaxed);
+            uint64_t head = ring->head.load(memory_order_acquire);
+            if (head == tail) continue;
+
+            uint64_t start = tail & LOG_RING_MASK;
+            uint64_t available = head - tail;
+            uint64_t firstPart = min<uint64_t>(available, LOG_RING_CAPACITY - start);
+
+            iov[iovCount].iov_base = &ring->records[start];
+            iov[iovCount].iov_len = firstPart * sizeof(LogRecord);
+            iovCount++;
+            if (available > firstPart) {
+                iov[iovCount].iov_base = &ring->records[0];
+                iov[iovCount].iov_len = (available - firstPart) * sizeof(LogRecord);
+                iovCount++;
+            }
+
+            drained[drainedCount] = ring;
+            heads[drainedCount] = head;
+            drainedCount++;
+            batch += available;
+        }
+        lockRings.unlock();
+
+        if (iovCount == 0) break;
+
+        //a batch that failed to write is still released, so that producers are never stuck behind a broken file
+        if (writeAll(this->fd, iov, iovCount)) {
+            this->writtenCount.fetch_add(batch, memory_order_relaxed);
+        } else {
+            this->failedCount.fetch_add(batch, memory_order_relaxed);
+        }
+
+        for (int i = 0; i < drainedCount; i++) {
+            drained[i]->tail.store(heads[i], memory_order_release);
+        }
+        total += batch;
+    }
+
+    return total;
+}
+
+/**
+ * Body of the background writer thread.
+ *
+ * Wakes every LOG_FLUSH_INTERVAL_MS, or sooner if a blocked producer asks for
+ * space, and drains all rings. Performs a final drain once stopped.
+ */
+void Logger::writerLoop() {
+
+    unique_lock<mutex> lock(this->writerMutex);
+
+    while (!this->stopFlag) {
+        this->writerCondition.wait_for(lock, chrono::milliseconds(LOG_FLUSH_INTERVAL_MS));
+        lock.unlock();
+        drain();
+        lock.lock();
+    }
+    lock.unlock();
+
+    drain();
+}
@@ -0,0 +1,145 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+#define LOG_FILE_MAGIC 0x474F4C42       // "BLOG" in little endian
+#define LOG_FILE_VERSION 1
+#define LOG_RECORD_SIZE 128
+#define LOG_TEXT_SIZE 80
+#define LOG_RING_CAPACITY 4096          // records per producer thread, must be a power of two
+#define LOG_FLUSH_INTERVAL_MS 20
+#define LOG_FLAG_CONTINUED 0x01         // text continues in the next record from the same thread
+
+enum LogLevel : uint8_t {
+    LOG_DEBUG = 0,
+    LOG_INFO = 1,
+    LOG_WARNING = 2,
+    LOG_ERROR = 3,
+    LOG_OFF = 4
+};
+
+enum LogEvent : uint16_t {
+    LOG_EVENT_TEXT = 0,             // free text
+    LOG_EVENT_TICK_PRICE = 1,       // id = tickerId, field = TickType, value = price
+    LOG_EVENT_QUOTE_UPDATE = 2      // id = tickerId, field = QuoteField, value = price, strike, right, text = symbol
+};
+
+enum QuoteField : int32_t {
+    QUOTE_BID = 0,
+    QUOTE_ASK = 1,
+    QUOTE_LAST = 2
+};
+
+enum LogOverflowPolicy {
+    LOG_OVERFLOW_DROP,      // drop the record and count it
+    LOG_OVERFLOW_BLOCK      // spin until the writer frees space and count the stall
+};
+
+/**
+ * Fixed size binary log record. Records are written to disk exactly as they
+ * sit in memory and turned back into text by the logformat tool.
+ */
+struct LogRecord {
+    uint64_t timestamp;     // CLOCK_REALTIME, nanoseconds
+    uint32_t threadId;
+    uint16_t event;
+    uint8_t level;
+    uint8_t flags;
+    int64_t id;
+    int32_t field;
+    uint16_t textLength;
+    char right;
+    uint8_t reserved;
+    double value;
+    double strike;
+    char text[LOG_TEXT_SIZE];
+};
+
+static_assert(sizeof(LogRecord) == LOG_RECORD_SIZE, "LogRecord layout changed");
+
+struct LogFileHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+};
+
+/**
+ * Single producer, single consumer ring of log records owned by one producer thread.
+ */
+struct LogRing {
+    alignas(64) atomic<uint64_t> head{0};      // next record to be written by the producer
+    alignas(64) atomic<uint64_t> tail{0};      // next record to be flushed by the writer thread
+    uint32_t threadId = 0;
+    unique_ptr<LogRecord[]> records{new LogRecord[LOG_RING_CAPACITY]()};
+};
+
+class Logger {
+
+private:
+
+    atomic<int> fd{-1};             // read by producers in reserve while close changes it
+    atomic<uint8_t> minLevel{LOG_DEBUG};
+    atomic<int> overflowPolicy{LOG_OVERFLOW_DROP};
+    atomic<bool> stopFlag{false};
+    atomic<uint64_t> writtenCount{0};
+    atomic<uint64_t> droppedCount{0};
+    atomic<uint64_t> failedCount{0};
+    atomic<uint64_t> backpressureCount{0};
+    mutex ringsMutex;
+    vector<unique_ptr<LogRing>> rings;
+    atomic<size_t> ringCount{0};
+    mutex writerMutex;
+    condition_variable writerCondition;
+    thread writerThread;
+
+    LogRing* getThreadRing();
+    LogRecord* reserve(LogRing* ring, unsigned int count);
+    size_t drain();
+    void writerLoop();
+
+public:
+
+    ~Logger();
+
+    bool open(const char* path);
+    void close();
+    void setLevel(LogLevel level);
+    void setOverflowPolicy(LogOverflowPolicy policy);
+
+    /**
+     * @return true if a record at the given level would be kept.
+     */
+    bool isEnabled(LogLevel level) const {
+        return level >= minLevel.load(memory_order_relaxed);
+    }
+
+    void log(LogLevel level, const string& text);
+    void logTick(LogLevel level, long tickerId, int field, double price);
+    void logQuote(LogLevel level, long tickerId, QuoteField field, double price, double strike, char right,
+                  const string& symbol);
+    uint64_t getWrittenCount();
+    uint64_t getDroppedCount();
+    uint64_t getFailedCount();
+    uint64_t getBackpressureCount();
+};
+
+LogLevel parseLogLevel(const string& name);
+
+#endif
@@ -6,27 +6,80 @@ December 6, 2024
 */
 
 #include "my_wrapper.h"
+#include "fanoutServer.h"
+#include "fanoutViewer.h"
 #include "globals.h"
 
 int main() {
 
     resizeTerminal(TERMINAL_HEIGHT + 1, TERMINAL_WIDTH);
     
-    string host = getDefaultGateway();
-    string symbol = getSymbol();
-    string expiry = getExpiry();
+    string host = getenv("TWS_HOST") ? getenv("TWS_HOST") : getDefaultGateway();
+    int port = getenv("TWS_PORT") ? atoi(getenv("TWS_PORT")) : PORT_LIVE;
+    vector<string> symbols = getSymbols();
+    vector<string> expiries = getExpiries();
     int clientId = 1;    
     
     write(STDOUT_FILENO, "Loading...\n", 11);
 
-    logFileFd = open("logFile.log", O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR);       
-    if (logFileFd < 0) {
+    if (!logger.open(getenv("LOG_FILE") ? getenv("LOG_FILE") : LOG_FILE_NAME)) {
         write(STDERR_FILENO,"Failed to open log file", 23);
         exit(EXIT_FAILURE);
-    }    
+    }
+    chainRegistry.loadContractCache(CONTRACT_CACHE_FILE_NAME);
+    for (const string& symbol : symbols) {
+        for (const string& expiry : expiries) {
+            OptionChainManager* chain = chainRegistry.addChain(symbol, expiry);
+            chain->setUnderlyingContract(symbol, DEFAULT_EXCHANGE, FUTURES_CODE, DEFAULT_CURRENCY, expiry);
+        }
+    }
+    if (getenv("LOG_LEVEL") != nullptr) logger.setLevel(parseLogLevel(getenv("LOG_LEVEL")));
+    if (getenv("RENDER_FPS") != nullptr) chainRegistry.getDisplayedChain()->setFrameRate(atoi(getenv("RENDER_FPS")));
+    if (getenv("LATENCY_STATS") != nullptr && atoi(getenv("LATENCY_STATS")) != 0) latencyTracker.enable();
+    if (getenv("RISK_FREE_RATE") != nullptr) chainRegistry.setRiskFreeRate(atof(getenv("RISK_FREE_RATE")));
+    if (getenv("BOOTSTRAP_WINDOW") != nullptr) chainRegistry.setBootstrapWindow(atoi(getenv("BOOTSTRAP_WINDOW")));
+    if (getenv("CHAIN_STRIKES") != nullptr) chainRegistry.setChainStrikes(atoi(getenv("CHAIN_STRIKES")));
+    if (getenv("QUOTE_SEGMENT_PREFIX") != nullptr) chainRegistry.setQuoteSegmentPrefix(getenv("QUOTE_SEGMENT_PREFIX"));
+    if (getenv("MARKET_DATA_LINES") != nullptr) my_wrapper.setMarketDataLines(atoi(getenv("MARKET_DATA_LINES")));
+    if (getenv("RECENTER_HYSTERESIS") != nullptr) my_wrapper.setRecenterHysteresis(atoi(getenv("RECENTER_HYSTERESIS")));
+    if (getenv("READER_POLL_TIMEOUT_MS") != nullptr || getenv("READER_BUSY_POLL") != nullptr) {
+        int pollTimeoutMs = getenv("READER_POLL_TIMEOUT_MS") ? atoi(getenv("READER_POLL_TIMEOUT_MS")) : 0;
+        my_wrapper.setReaderPolling(pollTimeoutMs, getenv("READER_BUSY_POLL") && atoi(getenv("READER_BUSY_POLL")) != 0);
+    }
+    
+    if (getenv("TICK_BATCH") != nullptr) {
+        int flushIdleMicros = getenv("TICK_BATCH_FLUSH_US") ? atoi(getenv("TICK_BATCH_FLUSH_US")) : 0;
+        my_wrapper.setTickBatching(atoi(getenv("TICK_BATCH")), flushIdleMicros);
+    }
+    if (getenv("WORKER_QUEUE_DEPTH") != nullptr) my_wrapper.setMaxWorkerQueueDepth(atoi(getenv("WORKER_QUEUE_DEPTH")));
+    
+    if (getenv("FANOUT_VIEWER") != nullptr) {
+        FanoutViewer viewer;
+        if (!viewer.connect(getenv("FANOUT_VIEWER")) || !viewer.loadChain(chainRegistry.getDisplayedChain())) {
+            write(STDERR_FILENO,"Failed to load option chain from fanout server\n", 47);
+            logger.close();
+            return 1;
+        }
+        viewer.run();
+        logger.close();
+        write(STDOUT_FILENO, "disconnected\n", 13);
+        return 0;
+    }
+
+    if (getenv("RECORD_FILE") != nullptr) my_wrapper.setRecordFile(getenv("RECORD_FILE"));
+    if (getenv("CAPTURE_FILE") != nullptr && !my_wrapper.setCaptureFile(getenv("CAPTURE_FILE"))) {
+        write(STDERR_FILENO,"Failed to open capture file\n", 28);
+        return 1;
+    }
     
-    if (host != "") {
-        if(!my_wrapper.connect(host.c_str(), PORT_LIVE, clientId)) {
+    if (getenv("REPLAY_FILE") != nullptr) {
+        double speed = getenv("REPLAY_SPEED") ? atof(getenv("REPLAY_SPEED")) : 1.0;
+        if(!my_wrapper.startReplay(getenv("REPLAY_FILE"), speed)) {
+            write(STDERR_FILENO,"Failed to open recording\n", 25);
+            return 1;
+        }
+    } else if (host != "") {
+        if(!my_wrapper.connect(host.c_str(), port, clientId)) {
             write(STDERR_FILENO,"Failed to connect\n", 18);
             return 1;
         }
@@ -34,16 +87,27 @@ int main() {
         write(STDERR_FILENO,"Failed to get default gateway\n", 30);
         return 1;
     }
-    sleep(1);                     // wait for callback from different datafarms
-    my_wrapper.processMessages(); // process callbacks from datafarms
 
-    my_wrapper.requestOptionChain(symbol, DEFAULT_EXCHANGE, FUTURES_CODE, DEFAULT_CURRENCY, expiry);
-    while(optionChainManager->isInitialized == false) my_wrapper.processMessages();
+    if (!my_wrapper.startUp()) {
+        write(STDERR_FILENO,"Failed to load option chain\n", 28);
+        my_wrapper.disconnect();
+        logger.close();
+        return 1;
+    }
 
     my_wrapper.requestMarketData();
+
+    FanoutServer fanoutServer;
+    if (getenv("FANOUT_SOCKET") != nullptr && !fanoutServer.start(getenv("FANOUT_SOCKET"))) {
+        write(STDERR_FILENO,"Failed to start fanout server\n", 30);
+    }
+
     my_wrapper.processMessagesMultithreaded();
+    fanoutServer.stop();
     my_wrapper.cancelMarketData();
     my_wrapper.disconnect();
+    if (latencyTracker.isEnabled()) latencyTracker.dump();
+    logger.close();
     write(STDOUT_FILENO, "disconnected\n", 13);
 
     return 0;
@@ -0,0 +1,293 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#include "messageDispatcher.h"
+#include "EDecoder.h"
+#include "ECycleClock.h"
+#include <algorithm>
+#include <chrono>
+
+using namespace std;
+
+//public methods
+
+/**
+ * Constructs a MessageDispatcher. No threads are started until start() is called.
+ *
+ * @param reader The EReader whose message queue is drained.
+ * @param wrapper The wrapper that receives the decoded callbacks.
+ * @param clientSocket The client socket, used for the server version and by the decoders.
+ * @param workerCount The number of worker threads to decode with, at least one.
+ */
+MessageDispatcher::MessageDispatcher(EReader* reader, EWrapper* wrapper, EClientSocket* clientSocket,
+                                     unsigned int workerCount) :
+    m_pReader(reader),
+    m_pWrapper(wrapper),
+    m_pClientSocket(clientSocket),
+    latencyTracker(nullptr),
+    tickBatchCallback(nullptr),
+    tickBatchContext(nullptr),
+    tickBatchCapacity(0),
+    flushIdleMicros(0),
+    maxQueueDepth(0),
+    workerCount(workerCount > 0 ? workerCount : 1),
+    stopFlag(false),
+    sharedQueueSize(0)
+{
+    for (unsigned int i = 0; i < this->workerCount; i++) {
+        this->workerQueues.push_back(make_unique<WorkerQueue>());
+    }
+}
+
+/**
+ * Destroys the dispatcher, stopping its threads if they are still running.
+ */
+MessageDispatcher::~MessageDispatcher() {
+    stop();
+}
+
+/**
+ * Sets the tracker that messages are stamped for. Must be called before start().
+ *
+ * @param latencyTracker The tracker, or nullptr to not stamp messages.
+ */
+void MessageDispatcher::setLatencyTracker(LatencyTracker* latencyTracker) {
+    this->latencyTracker = latencyTracker;
+}
+
+/**
+ * Turns on tick batching. Must be called before start().
+ *
+ * @param callback The function every batch of ticks is delivered to, on the worker that decoded them.
+ * @param context Passed to the callback with every batch.
+ * @param capacity The most ticks delivered in one batch, and the most messages a worker
+ *                 takes off its queue at a time; 0 turns batching off.
+ * @param flushIdleMicros How long a worker that has run out of messages waits for more
+ *                        before delivering a partial batch, 0 to deliver it at once.
+ */
+void MessageDispatcher::setTickBatching(ETickBatchCallback callback, void* context, size_t capacity,
+                                        unsigned int flushIdleMicros) {
+    this->tickBatchCallback = callback;
+    this->tickBatchContext = context;
+    this->tickBatchCapacity = callback != nullptr ? capacity : 0;
+    this->flushIdleMicros = flushIdleMicros;
+}
+
+/**
+ * Bounds the number of messages waiting for each worker. Must be called before start().
+ *
+ * @param maxQueueDepth The most messages queued for one worker, 0 for no limit.
+ */
+void MessageDispatcher::setMaxQueueDepth(size_t maxQueueDepth) {
+    this->maxQueueDepth = maxQueueDepth;
+}
+
+/**
+ * Starts the dispatch thread and the worker threads.
+ */
+void MessageDispatcher::start() {
+
+    this->stopFlag = false;
+
+    for (unsigned int i = 0; i < this->workerCount; i++) {
+        this->workerThreads.emplace_back(&MessageDispatcher::workerLoop, this, i);
+    }
+    this->dispatchThread = thread(&MessageDispatcher::dispatchLoop, this);
+}
+
+/**
+ * Stops the dispatch thread and the worker threads and waits for them to exit.
+ *
+ * Messages still waiting in the worker queues are discarded.
+ */
+void MessageDispatcher::stop() {
+
+    this->stopFlag = true;
+    this->m_pReader->getMsgQueue().wakeAll();
+
+    for (auto& workerQueue : this->workerQueues) {
+        lock_guard<mutex> lock(workerQueue->queueMutex);
+        workerQueue->queueCondition.notify_all();
+        workerQueue->spaceCondition.notify_all();
+    }
+
+    if (this->dispatchThread.joinable()) this->dispatchThread.join();
+
+    for (auto& workerThread : this->workerThreads) {
+        if (workerThread.joinable()) workerThread.join();
+    }
+    this->workerThreads.clear();
+}
+
+//private methods
+
+/**
+ * Body of the dispatch thread.
+ *
+ * Takes messages off the EReader's lock-free queue in arrival order, sleeping on
+ * the queue when it is empty, and moves each one to the queue of the worker that
+ * owns its ticker.
+ */
+void MessageDispatcher::dispatchLoop() {
+
+    EMessageQueue& readerQueue = this->m_pReader->getMsgQueue();
+    EDecoder peekDecoder(this->m_pClientSocket->EClient::serverVersion(), this->m_pWrapper, this->m_pClientSocket);
+
+    while (!this->stopFlag) {
+
+        unique_ptr<EMessage> message(readerQueue.waitPop(DISPATCH_WAIT_TIMEOUT_MS));
+        if (!message) continue;
+
+        if (this->latencyTracker) message->setDequeuedTime(ECycleClock::now());
+        dispatch(move(message), peekDecoder);
+    }
+}
+
+/**
+ * Queues a message for decoding.
+ *
+ * Messages with a ticker ID go to worker (tickerId % workerCount), waiting for
+ * room if the worker's queue is at its maximum depth. Messages without one go to
+ * the shared queue and every worker is woken so that the first idle one can take it.
+ *
+ * @param message The message to queue.
+ * @param peekDecoder A decoder used to read the ticker ID of the message.
+ */
+void MessageDispatcher::dispatch(unique_ptr<EMessage> message, const EDecoder& peekDecoder) {
+
+    int tickerId = peekDecoder.peekTickerId(message->begin(), message->end());
+
+    if (tickerId >= 0) {
+        WorkerQueue& workerQueue = *this->workerQueues[tickerId % this->workerCount];
+        {
+            unique_lock<mutex> lock(workerQueue.queueMutex);
+            if (this->maxQueueDepth > 0) {
+                workerQueue.spaceCondition.wait(lock, [&]() {
+                    return workerQueue.messages.size() < this->maxQueueDepth || this->stopFlag;
+                });
+            }
+            workerQueue.messages.push_back(move(message));
+        }
+        workerQueue.queueCondition.notify_one();
+    } else {
+        {
+            lock_guard<mutex> lock(this->sharedQueue.queueMutex);
+            this->sharedQueue.messages.push_back(move(message));
+            this->sharedQueueSize++;
+        }
+        for (auto& workerQueue : this->workerQueues) {
+            { lock_guard<mutex> lock(workerQueue->queueMutex); }
+            workerQueue->queueCondition.notify_one();
+        }
+    }
+}
+
+/**
+ * Body of a worker thread.
+ *
+ * Decodes messages from the worker's own queue with the worker's own EDecoder,
+ * stealing from the shared queue whenever its own queue is empty. Ticks waiting
+ * in the worker's batch are delivered once there is nothing left to decode and
+ * nothing arrives within the flush delay.
+ *
+ * @param workerIndex The index of the worker.
+ */
+void MessageDispatcher::workerLoop(unsigned int workerIndex) {
+
+    EDecoder decoder(this->m_pClientSocket->EClient::serverVersion(), this->m_pWrapper, this->m_pClientSocket);
+    unique_ptr<ETickBatch> tickBatch;
+    vector<unique_ptr<EMessage>> messages;
+
+    if (this->tickBatchCapacity > 0) {
+        tickBatch = make_unique<ETickBatch>(this->tickBatchCallback, this->tickBatchContext, this->tickBatchCapacity);
+        decoder.setTickBatch(tickBatch.get());
+    }
+
+    while (true) {
+
+        bool ticksWaiting = tickBatch && tickBatch->size() > 0;
+
+        if (!popMessages(workerIndex, ticksWaiting ? (long)this->flushIdleMicros : -1, messages)) {
+            if (!ticksWaiting) break;
+            tickBatch->flush();
+            continue;
+        }
+
+        for (unique_ptr<EMessage>& message : messages) {
+            const char* pBegin = message->begin();
+            if (this->latencyTracker) {
+                this->latencyTracker->beginMessage(*message);
+                const LatencyTrace& trace = LatencyTracker::getCurrentTrace();
+                if (tickBatch) tickBatch->setMessageTimes(trace.received, trace.decoded);
+            }
+            decoder.parseAndProcessMsg(pBegin, message->end());
+            if (this->latencyTracker) this->latencyTracker->endMessage();
+        }
+        messages.clear();
+    }
+}
+
+/**
+ * Takes the next messages for a worker: up to a tick batch worth from the worker's
+ * own queue under one lock, or else one message from the shared queue.
+ *
+ * @param workerIndex The index of the worker.
+ * @param waitMicros How long to wait for a message, or -1 to wait until one is available.
+ * @param messages Receives the messages.
+ * @return True if any messages were taken, false if none arrived in time or the
+ *         dispatcher is stopped.
+ */
+bool MessageDispatcher::popMessages(unsigned int workerIndex, long waitMicros,
+                                    vector<unique_ptr<EMessage>>& messages) {
+
+    WorkerQueue& workerQueue = *this->workerQueues[workerIndex];
+    size_t maxCount = this->tickBatchCapacity > 0 ? this->tickBatchCapacity : 1;
+    chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::microseconds(max(waitMicros, 0L));
+
+    auto hasWork = [&]() {
+        return !workerQueue.messages.empty() || this->sharedQueueSize > 0 || this->stopFlag;
+    };
+
+    while (!this->stopFlag) {
+
+        {
+            unique_lock<mutex> lock(workerQueue.queueMutex);
+            if (waitMicros < 0) {
+                workerQueue.queueCondition.wait(lock, hasWork);
+            } else if (waitMicros > 0) {
+                workerQueue.queueCondition.wait_until(lock, deadline, hasWork);
+            }
+
+            if (!workerQueue.messages.empty()) {
+                bool wasFull = this->maxQueueDepth > 0 && workerQueue.messages.size() >= this->maxQueueDepth;
+                size_t count = min(maxCount, workerQueue.messages.size());
+
+                for (size_t i = 0; i < count; i++) {
+                    messages.push_back(move(workerQueue.messages.front()));
+                    workerQueue.messages.pop_front();
+                }
+                lock.unlock();
+                if (wasFull) workerQueue.spaceCondition.notify_one();
+                return true;
+            }
+        }
+
+        {
+            lock_guard<mutex> lock(this->sharedQueue.queueMutex);
+            if (!this->sharedQueue.messages.empty()) {
+                messages.push_back(move(this->sharedQueue.messages.front()));
+                this->sharedQueue.messages.pop_front();
+                this->sharedQueueSize--;
+                return true;
+            }
+        }
+
+        if (waitMicros >= 0 && chrono::steady_clock::now() >= deadline) break;
+    }
+
+    return false;
+}
@@ -0,0 +1,94 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#ifndef MESSAGE_DISPATCHER_H
+#define MESSAGE_DISPATCHER_H
+
+#include "EReader.h"
+#include "EClientSocket.h"
+#include "EMessage.h"
+#include "ETickBatch.h"
+#include "latencyTracker.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+#define DISPATCH_WAIT_TIMEOUT_MS 100
+
+/**
+ * Messages waiting to be decoded by one worker.
+ */
+struct WorkerQueue {
+    mutex queueMutex;
+    condition_variable queueCondition;
+    condition_variable spaceCondition;      // signalled when a full queue is drained
+    deque<unique_ptr<EMessage>> messages;
+};
+
+/**
+ * Moves messages from the EReader queue to a pool of worker threads.
+ *
+ * Every worker decodes with its own EDecoder. Market data messages are sharded
+ * by ticker ID so that all messages for a ticker are decoded by the same worker,
+ * in the order they arrived. Messages that do not belong to a ticker go to a
+ * shared queue that any idle worker steals from.
+ *
+ * With tick batching on, workers take up to a batch worth of messages off their
+ * queue at a time and decode price and size ticks into a batch of plain tick
+ * records instead of calling tickPrice and tickSize. The batch is delivered when
+ * it is full, or when the worker has run out of messages and none arrived within
+ * the flush delay.
+ *
+ * Worker queues are unbounded unless a maximum depth is set, in which case the
+ * dispatch thread waits for a full worker queue to drain, and the EReader's queue
+ * absorbs the burst.
+ */
+class MessageDispatcher {
+
+private:
+
+    EReader* m_pReader;
+    EWrapper* m_pWrapper;
+    EClientSocket* m_pClientSocket;
+    LatencyTracker* latencyTracker;
+    ETickBatchCallback tickBatchCallback;
+    void* tickBatchContext;
+    size_t tickBatchCapacity;
+    unsigned int flushIdleMicros;
+    size_t maxQueueDepth;
+    unsigned int workerCount;
+    atomic<bool> stopFlag;
+    vector<unique_ptr<WorkerQueue>> workerQueues;
+    WorkerQueue sharedQueue;
+    atomic<size_t> sharedQueueSize;
+    thread dispatchThread;
+    vector<thread> workerThreads;
+
+    void dispatchLoop();
+    void dispatch(unique_ptr<EMessage> message, const EDecoder& peekDecoder);
+    void workerLoop(unsigned int workerIndex);
+    bool popMessages(unsigned int workerIndex, long waitMicros, vector<unique_ptr<EMessage>>& messages);
+
+public:
+
+    MessageDispatcher(EReader* reader, EWrapper* wrapper, EClientSocket* clientSocket, unsigned int workerCount);
+    ~MessageDispatcher();
+
+    void setLatencyTracker(LatencyTracker* latencyTracker);
+    void setTickBatching(ETickBatchCallback callback, void* context, size_t capacity, unsigned int flushIdleMicros);
+    void setMaxQueueDepth(size_t maxQueueDepth);
+    void start();
+    void stop();
+};
+
+#endif
@@ -16,18 +16,32 @@ using namespace std;
  * Constructs a My_wrapper object.
  *
  * This constructor will create a new EClientSocket and link it to an
- * EReaderOSSignal. It will also initialize all required member variables.
+ * EReaderOSSignal. It will also initialize all required member variables,
+ * and the subscription manager that sends market data requests through the
+ * socket unless a recording is being replayed.
  *
  * @see EClientSocket
  * @see EReaderOSSignal
  */
 My_wrapper::My_wrapper() :
+	m_osSignal(SIGNAL_WAIT_TIMEOUT_MS),
     m_pClientSocket(new EClientSocket(this, &m_osSignal)),
 	m_pReader(nullptr),
 	m_sleepDeadline(0),
 	m_currentReqId(1),
-	m_currentTickerId(1), 
-	maxThreads(getMaxThreads())
+	maxThreads(getMaxThreads()),
+	m_readerPollTimeoutMs(READER_POLL_TIMEOUT_MS_DEFAULT),
+	m_readerBusyPoll(false),
+	m_tickBatchCapacity(0),
+	m_tickBatchFlushIdleMicros(0),
+	m_maxWorkerQueueDepth(0),
+	m_subscriptions(
+		[this](TickerId tickerId, const Contract& contract) {
+			if (!isReplaying()) m_pClientSocket->reqMktData(tickerId, contract, "", false, false, TagValueListSPtr());
+		},
+		[this](TickerId tickerId) {
+			if (!isReplaying()) m_pClientSocket->cancelMktData(tickerId);
+		})
 {}
 
 /**
@@ -50,24 +64,11 @@ My_wrapper::~My_wrapper() {
 }
 
 /**
- * Cancels all market data requests for both the underlying contract and all option contracts
- * managed by the optionChainManager. This function iterates over the option chain and cancels
- * market data using the ticker ID associated with each option.
+ * Cancels all market data requests for both the underlying contract and the subscribed option 
+ * contracts of every chain in the chain registry, through the subscription manager.
  */
 void My_wrapper::cancelMarketData() {
-
-	const map<pair<double, string>, unique_ptr<OptionData>>& optionChain = optionChainManager->getOptionChain();
-
-	m_pClientSocket->cancelMktData(0);
-
-	for(const auto& pair : optionChain) {
-		m_pClientSocket->cancelMktData(optionChainManager->pairToTicker(pair.first));
-	}
-
-	string toLog = "Cancelled all market data requests\n";
-	unique_lock<mutex> lockLogFile(logFileMutex);
-	write(logFileFd, toLog.c_str(), toLog.length());
-	lockLogFile.unlock();
+	m_subscriptions.cancelAll();
 }
 
 /**
@@ -75,19 +76,43 @@ void My_wrapper::cancelMarketData() {
  *
  * This function will disconnect the current connection to the TWS server. If
  * the connection is successful, the function will return true. Otherwise, it
- * will return false.
+ * will return false. A session that was being recorded has its recording closed, 
+ * and a replay is stopped instead of disconnecting.
  *
  * @return true if the disconnection was successful, false otherwise
  */
 void My_wrapper::disconnect() {
+
+	if (m_capture.isOpen()) {
+		m_capture.close();
+
+		string toLog = "Captured " + to_string(m_capture.getCapturedCount()) + " ticks (" + to_string(m_capture.getWrittenBytes())
+					   + " bytes) to " + m_capture.getPath() + ", dropped " + to_string(m_capture.getDroppedCount()) + "\n";
+		logger.log(m_capture.getDroppedCount() == 0 ? LOG_INFO : LOG_WARNING, toLog);
+	}
+
+	if (isReplaying()) {
+		m_pReplay->stop();
+
+		string toLog = "Replay stopped after " + to_string(m_pReplay->messageCount()) + " messages"
+					   + (m_pReplay->finished() ? " in " + to_string(m_pReplay->elapsedNs() / 1000000) + " ms" : string()) + "\n";
+		logger.log(LOG_INFO, toLog);
+		return;
+	}
 	
 	m_pClientSocket->eDisconnect();
 
 	string toLog = "Disconnected\n";
 
-	unique_lock<mutex> lockLogFile(logFileMutex);
-	write(logFileFd, toLog.c_str(), toLog.length());
-	lockLogFile.unlock();
+	logger.log(LOG_INFO, toLog);
+
+	if (m_recorder.isOpen()) {
+		bool written = m_recorder.close();
+
+		toLog = "Recorded " + to_string(m_recorder.messageCount()) + " messages (" + to_string(m_recorder.byteCount())
+				+ " bytes) to " + m_recordPath + (written ? "\n" : ", but writing the recording failed\n");
+		logger.log(written ? LOG_INFO : LOG_ERROR, toLog);
+	}
 }
 
 /**
@@ -109,10 +134,12 @@ void My_wrapper::processMessages() {
 /**
  * Processes incoming messages from the TWS server using multiple threads.
  *
- * This function waits for a signal indicating that there are messages to be 
- * processed, and then processes the messages from the EReader message queue. 
- * Each thread processes messages until the queue is empty or the stopProcessingFlag 
- * is set to true.
+ * Messages are handed from the EReader's lock-free message queue to a MessageDispatcher.
+ * Each worker thread decodes with its own EDecoder, and every message for a 
+ * given ticker ID is decoded by the same worker in the order it arrived, so 
+ * the bid/ask/last updates of a contract are never applied out of order.
+ * Processing continues until the user presses the quit key. Meanwhile, the windows of 
+ * subscribed strikes are moved with the underlying every RECENTER_INTERVAL_MS.
  * 
  * @note This function processes messages using multiple threads, up to the
  * maximum number of threads available on the platform. 
@@ -121,58 +148,23 @@ void My_wrapper::processMessages() {
  */
 void My_wrapper::processMessagesMultithreaded() {
 
-    stopProcessingFlag = false;
-    deque<shared_ptr<EMessage>>& m_msgQueue = m_pReader->getMsgQueue();
-    EDecoder& processMsgsDecoder = m_pReader->getProcessMsgsDecoder();
-    EMutex& messageQueueMutex = m_pReader->getMsgQueueMutex();
-
-    auto worker = [&]() {	//worker lambda function
-        while (true) {
-			
-            shared_ptr<EMessage> message;
-
-            m_osSignal.waitForSignal();
-
-            if (stopProcessingFlag) break;
-
-            {
-                EMutexGuard lock(messageQueueMutex);
-                if (!m_msgQueue.empty()) {
-                    message = m_msgQueue.front();
-                    m_msgQueue.pop_front();
-                }
-            }
-
-            if (message) {
-                const char* pBegin = message->begin();
-                while (processMsgsDecoder.parseAndProcessMsg(pBegin, message->end()) > 0) {
-                    {
-                        EMutexGuard lock(messageQueueMutex);
-                        if (m_msgQueue.empty()) break;
-                        message = m_msgQueue.front();
-                        m_msgQueue.pop_front();
-                    }
-                    pBegin = message->begin();
-                }
-            }
-        }
-    };
-
-    vector<thread> threads;		//make thread pool
-    for (int i = 0; i < maxThreads; ++i) {
-        threads.emplace_back(worker);
-    }
-
-	while(getch() != 'q');
-
-	stopProcessingFlag = true;
-    m_osSignal.issueSignalAllThreads(); // wake up all threads
-
-    for (auto& thread : threads) {
-        if (thread.joinable()) {
-            thread.join();
-        }
-    }
+	MessageDispatcher dispatcher(m_pReader, this, m_pClientSocket, maxThreads);
+
+	if (latencyTracker.isEnabled()) dispatcher.setLatencyTracker(&latencyTracker);
+	if (m_tickBatchCapacity > 0) {
+		dispatcher.setTickBatching(&My_wrapper::onTicks, this, m_tickBatchCapacity, m_tickBatchFlushIdleMicros);
+	}
+	dispatcher.setMaxQueueDepth(m_maxWorkerQueueDepth);
+	dispatcher.start();
+	while (!chainRegistry.getDisplayedChain()->waitForQuitKey(RECENTER_INTERVAL_MS)) m_subscriptions.update();
+	dispatcher.stop();
+
+	EMessageQueue& messageQueue = m_pReader->getMsgQueue();
+	string toLog = "Reader queue high-water mark: " + to_string(messageQueue.highWaterMark()) + " of "
+				   + to_string(messageQueue.capacity()) + ", full stalls: " + to_string(messageQueue.fullCount())
+				   + ", receive slabs allocated: " + to_string(m_pReader->getSlabAllocatedCount())
+				   + ", bytes carried between slabs: " + to_string(m_pReader->getCarriedBytes()) + "\n";
+	logger.log(LOG_INFO, toLog);
 }
 
 /**
@@ -181,54 +173,58 @@ void My_wrapper::processMessagesMultithreaded() {
  * This function generates a unique request ID and logs the details of the request.
  * It then sends a request to retrieve contract details via the client socket.
  * 
- * The callback for this request is handled in the `contractDetails` function.
+ * The callback for this request is handled in the `contractDetails` function, and the
+ * request is complete once `contractDetailsEnd` is called with the same ID.
  *
  * @param contract The contract for which details are being requested. It includes information
  * such as the symbol, strike, and right.
+ * @return The request ID the request was sent with.
  */
-void My_wrapper::requestContractDetails(const Contract& contract) {
+int My_wrapper::requestContractDetails(const Contract& contract) {
 
 	int reqId = getNextReqId();
 
 	string toLog = "ReqID: " + to_string(reqId) + " - Requesting contract details for " + contract.symbol + " Strike " + to_string(contract.strike) + " Right: " + contract.right + "\n";
-	unique_lock<mutex> lockLogFile(logFileMutex);
-	write(logFileFd, toLog.c_str(), toLog.length());
-	lockLogFile.unlock();
+	logger.log(LOG_INFO, toLog);
+
+	if (!isReplaying()) m_pClientSocket->reqContractDetails(reqId, contract);
 
-    m_pClientSocket->reqContractDetails(reqId, contract);
+	return reqId;
 }
 
 /**
- * Requests an option chain for the given underlying contract.
+ * Requests the option chain of a chain's underlying contract.
  *
- * This function first requests the details of the underlying contract and then waits for the callback
- * to be processed. Once the underlying contract details are known, it requests the option chain associated
- * with that contract.
+ * This function requests the strikes and expirations listed for the underlying contract, whose 
+ * details must be known. The request is routed back to the chain, and its reply is handled by 
+ * the startup sequence.
  *
- * @param underlyingSymbol The symbol of the underlying contract, e.g. "ES"
- * @param futFopExchange The exchange on which the underlying contract is traded, e.g. "GLOBEX"
- * @param underlyingSecurityType The type of underlying security, e.g. "FUT"
- * @param currency The currency in which the underlying contract is traded, e.g. "USD"
- * @param contractDate The last trade date/contract month for the underlying contract, e.g. "202003"
+ * @param chain The chain the option chain is requested for.
+ * @return The request ID the request was sent with.
  */
-void My_wrapper::requestOptionChain(string underlyingSymbol, string futFopExchange, string underlyingSecurityType,
-		 							string currency, string contractDate) {
-    
-	
-	optionChainManager->setUnderlyingContract(underlyingSymbol, futFopExchange, underlyingSecurityType,
-											  currency, contractDate);
+int My_wrapper::requestOptionChain(OptionChainManager* chain) {
 
-	requestContractDetails(optionChainManager->getUnderlyingContract());
-	processMessages();
-	
 	int reqId = getNextReqId();
-	string toLog = "ReqID: " + to_string(reqId) + " - Requesting option chain for: " + to_string(optionChainManager->getUnderlyingContractId()) + "\n";
-	unique_lock<mutex> lockLogFile(logFileMutex);
-	write(logFileFd, toLog.c_str(), toLog.length());
-	lockLogFile.unlock();
+	chainRegistry.routeRequest(reqId, chain);
+
+	Contract underlying = chain->getUnderlyingContract();
+	string toLog = "ReqID: " + to_string(reqId) + " - Requesting option chain for: " + to_string(underlying.conId) + "\n";
+	logger.log(LOG_INFO, toLog);
 	
-    m_pClientSocket->reqSecDefOptParams(reqId, underlyingSymbol, futFopExchange, underlyingSecurityType, 
-										optionChainManager->getUnderlyingContractId());
+	if (!isReplaying()) {
+		m_pClientSocket->reqSecDefOptParams(reqId, underlying.symbol, underlying.exchange, underlying.secType, underlying.conId);
+	}
+	return reqId;
+}
+
+/**
+ * Runs the startup sequence: waits for TWS to be ready, then resolves, loads and starts 
+ * streaming every chain in the chain registry. Their underlying contracts must be set.
+ *
+ * @return true if the displayed chain is streaming.
+ */
+bool My_wrapper::startUp() {
+	return m_startup.run();
 }
 
 /**
@@ -242,66 +238,35 @@ void My_wrapper::requestOptionChain(string underlyingSymbol, string futFopExchan
 void My_wrapper::requestDelayedDataType() {
 
 	string toLog = "Requesting delayed data type\n";
-	unique_lock<mutex> lockLogFile(logFileMutex);
-	write(logFileFd, toLog.c_str(), toLog.length());
-	lockLogFile.unlock();
+	logger.log(LOG_INFO, toLog);
 
 	m_pClientSocket->reqMarketDataType(DELAYED_DATA_TYPE);
 }
 
 /**
- * Requests market data for the underlying contract.
+ * Requests market data for the underlying contract of a chain.
+ *
+ * This function sends a request to TWS for market data on the underlying contract,
+ * with the chain's underlying ticker ID. The market data type is set to delayed data type.
  *
- * This function sends a request to TWS for market data on the underlying contract.
- * The market data type is set to delayed data type. The request is logged to the
- * log file.
+ * @param chain The chain whose underlying market data is requested.
  */
-void My_wrapper::requestUnderlyingMarketData() {
+void My_wrapper::requestUnderlyingMarketData(OptionChainManager* chain) {
+	if (isReplaying()) return;
 	m_pClientSocket->reqMarketDataType(DELAYED_DATA_TYPE);
-	m_pClientSocket->reqMktData(0, optionChainManager->getUnderlyingContract(), "", false, false, TagValueListSPtr());
+	m_pClientSocket->reqMktData(chain->getUnderlyingTickerId(), chain->getUnderlyingContract(), "", false, false, TagValueListSPtr());
 }
 
 /**
- * Requests market data for all active strikes in the option chain.
+ * Requests market data for the subscribed strikes of every chain in the chain registry.
  *
- * This function iterates over the active strikes in the option chain and requests
- * market data for both calls and puts associated with each strike. The market data
- * type is set to delayed data type. The requests are logged to the log file.
+ * The subscription manager requests market data for both calls and puts of the window of
+ * strikes of each chain: the strikes in the table for the displayed chain, and the strikes 
+ * around the underlying price for the others, cut down to fit the market data line budget. 
+ * The requests are logged to the log file.
  */
 void My_wrapper::requestMarketData() {
-
-	const map<pair<double, string>, unique_ptr<OptionData>>& optionChain = optionChainManager->getOptionChain();
-	const map<double, int> activeStrikes = optionChainManager->getActiveStrikes();
-	
-	for(const auto& pair : activeStrikes) {
-		
-		//Request calls
-		TickerId callTickerId = optionChainManager->pairToTicker(make_pair(pair.first, "C"));
-
-		m_pClientSocket->reqMktData(callTickerId, optionChain.find(make_pair(pair.first, "C"))->second->contractDetails.contract,
-									"", false, false, TagValueListSPtr());
-		
-		string toLog = "ReqID: " + to_string(callTickerId) + " - Requesting market data for " 
-					   + to_string(optionChain.find(make_pair(pair.first, "C"))->second->contractDetails.contract.conId) + "\n";
-
-		unique_lock<mutex> lockLogFile(logFileMutex);
-		write(logFileFd, toLog.c_str(), toLog.length());
-		lockLogFile.unlock();
-
-
-		//Request puts
-		TickerId putTickerId = optionChainManager->pairToTicker(make_pair(pair.first, "P"));
-		
-		m_pClientSocket->reqMktData(putTickerId, optionChain.find(make_pair(pair.first, "P"))->second->contractDetails.contract,
-									"", false, false, TagValueListSPtr());
-	
-		toLog = "ReqID: " + to_string(putTickerId) + " - Requesting market data for " 
-				+ to_string(optionChain.find(make_pair(pair.first, "P"))->second->contractDetails.contract.conId) + "\n";
-		
-		lockLogFile.lock();
-		write(logFileFd, toLog.c_str(), toLog.length());
-		lockLogFile.unlock();
-	}
+	m_subscriptions.subscribeAll();
 }
 
 /**
@@ -317,31 +282,166 @@ void My_wrapper::requestMarketData() {
  */
 bool My_wrapper::connect(const char *host, int port, int clientId) {
 
+	m_startup.begin();
+
 	string toLog = "Connecting to " + string(host) + ":" + to_string(port) + " clientId:" + to_string(clientId) + "\n";
-	unique_lock<mutex> lockLogFile(logFileMutex);
-	write(logFileFd, toLog.c_str(), toLog.length());
-	lockLogFile.unlock();
+	logger.log(LOG_INFO, toLog);
 	
 	bool connection_status = m_pClientSocket->eConnect(host, port, clientId);
 	
 	if (connection_status) {
 		toLog = "Connected to " + string(host) + ":" + to_string(port) + " clientId:" + to_string(clientId) + "\n";
-		lockLogFile.lock();
-		write(logFileFd, toLog.c_str(), toLog.length());
-		lockLogFile.unlock();
+		logger.log(LOG_INFO, toLog);
 
 		m_pReader = new EReader(m_pClientSocket, &m_osSignal);
+		m_pReader->setPollTimeout(m_readerPollTimeoutMs);
+		m_pReader->setBusyPoll(m_readerBusyPoll);
+
+		if (!m_recordPath.empty()) {
+			if (m_recorder.open(m_recordPath.c_str(), m_pClientSocket->EClient::serverVersion())) {
+				m_pReader->setRecorder(&m_recorder);
+				toLog = "Recording inbound messages to " + m_recordPath + "\n";
+				logger.log(LOG_INFO, toLog);
+			} else {
+				toLog = "Cannot open recording file " + m_recordPath + "\n";
+				logger.log(LOG_ERROR, toLog);
+			}
+		}
+
 		m_pReader->start();
 	}
-	else
+	else {
 		toLog = "Cannot connect to " + string(host) + ":" + to_string(port) + " clientId:" + to_string(clientId) + "\n";
-		lockLogFile.lock();
-		write(logFileFd, toLog.c_str(), toLog.length());
-		lockLogFile.unlock();
+		logger.log(LOG_ERROR, toLog);
+	}
 
 	return connection_status;
 }
 
+/**
+ * Sets how the EReader thread waits for socket events. Takes effect on the next connect.
+ *
+ * @param timeoutMs The longest time the reader sleeps waiting for the socket.
+ * @param busyPoll If true the reader never sleeps and spins on the socket instead,
+ *                 which lowers latency at the cost of a full core.
+ */
+void My_wrapper::setReaderPolling(int timeoutMs, bool busyPoll) {
+	m_readerPollTimeoutMs = timeoutMs;
+	m_readerBusyPoll = busyPoll;
+}
+
+/**
+ * Turns on tick batching for market data: workers take up to a batch of messages
+ * off their queue at a time, decode price and size ticks into plain tick records
+ * and apply them to the option chain in one pass through onTicks, instead of one
+ * tickPrice call per tick. Takes effect on the next processMessagesMultithreaded.
+ *
+ * @param capacity The most ticks applied in one batch, 0 to turn batching off.
+ * @param flushIdleMicros How long a worker that has run out of messages waits for
+ *                        more before applying a partial batch.
+ */
+void My_wrapper::setTickBatching(size_t capacity, unsigned int flushIdleMicros) {
+	m_tickBatchCapacity = capacity;
+	m_tickBatchFlushIdleMicros = flushIdleMicros;
+}
+
+/**
+ * Bounds the number of messages waiting for each worker thread. When a worker falls
+ * behind, the reader's queue fills up instead. Takes effect on the next
+ * processMessagesMultithreaded.
+ *
+ * @param depth The most messages queued for one worker, 0 for no limit.
+ */
+void My_wrapper::setMaxWorkerQueueDepth(size_t depth) {
+	m_maxWorkerQueueDepth = depth;
+}
+
+/**
+ * Sets how many market data lines the chains may use together, underlyings included.
+ * Takes effect on the next requestMarketData.
+ *
+ * @param lines The number of lines, 0 for no limit.
+ */
+void My_wrapper::setMarketDataLines(size_t lines) {
+	m_subscriptions.setLineBudget(lines);
+}
+
+/**
+ * Sets how many strikes the underlying must move from the center of a chain's window of
+ * subscribed strikes before the window is moved.
+ *
+ * @param strikes The number of strikes, 0 for a quarter of the window.
+ */
+void My_wrapper::setRecenterHysteresis(size_t strikes) {
+	m_subscriptions.setHysteresis(strikes);
+}
+
+/**
+ * Sets a file that every inbound message of the next connection is recorded to,
+ * for replay with startReplay. Takes effect on the next connect.
+ *
+ * @param path The path of the recording. An existing file is replaced.
+ */
+void My_wrapper::setRecordFile(const string& path) {
+	m_recordPath = path;
+}
+
+/**
+ * Starts capturing every price and size tick to a columnar file for research, see
+ * tickCaptureFormat.h. Capturing stops on disconnect.
+ *
+ * @param path The path of the capture file. An existing file is replaced.
+ * @return true if the file was created.
+ */
+bool My_wrapper::setCaptureFile(const string& path) {
+	return m_capture.open(path);
+}
+
+/**
+ * Replays a recorded session instead of connecting to TWS.
+ *
+ * The recorded messages are pushed into the queue of an EReader that is never
+ * started, so they are decoded and processed exactly like live messages. Requests
+ * are not sent while replaying; request and ticker IDs are still assigned in the 
+ * same order as in a live session, so they match the recorded replies.
+ *
+ * @param path The path of a recording made with setRecordFile.
+ * @param speed 1 replays at the recorded pace, N replays N times faster and 0 as fast
+ *              as the messages are processed.
+ * @return true if the recording was opened and the replay started.
+ */
+bool My_wrapper::startReplay(const char* path, double speed) {
+
+	m_startup.begin();
+	m_pReplay = make_unique<EMessageReplay>();
+
+	if (!m_pReplay->open(path)) {
+		m_pReplay.reset();
+		string toLog = "Cannot open recording " + string(path) + "\n";
+		logger.log(LOG_ERROR, toLog);
+		return false;
+	}
+
+	//the server version is normally learned in the handshake; asynchronous mode keeps it from starting the API
+	m_pClientSocket->asyncEConnect(true);
+	m_pClientSocket->serverVersion(m_pReplay->serverVersion(), "");
+
+	m_pReader = new EReader(m_pClientSocket, &m_osSignal);
+	m_pReplay->start(m_pReader->getMsgQueue(), &m_osSignal, speed);
+
+	string toLog = "Replaying " + string(path) + " at speed " + to_string(speed) + ", server version "
+				   + to_string(m_pReplay->serverVersion()) + "\n";
+	logger.log(LOG_INFO, toLog);
+	return true;
+}
+
+/**
+ * @return true if messages come from a recording rather than from TWS.
+ */
+bool My_wrapper::isReplaying() const {
+	return m_pReplay != nullptr;
+}
+
 /**
  * Generates a unique request ID that can be used for requests to the TWS server.
  *
@@ -358,29 +458,14 @@ int My_wrapper::getNextReqId() {
 	return reqId;
 }
 
-/**
- * Generates a unique ticker ID for market data requests.
- *
- * This function is thread-safe and uses a mutex to ensure that only one ticker ID
- * is generated at a time. The ticker ID is incremented after each call to this
- * function to maintain uniqueness.
- *
- * @return a unique ticker ID.
- */
-TickerId My_wrapper::getNextTickerId() {
-	lock_guard<mutex> lock(m_tickerIdMutex);
-	int tickerId = m_currentTickerId;
-	m_currentTickerId++;
-	return tickerId;
-}
-
 //interface overrides
 
 /**
  * Processes the contract details received from the server.
  *
  * This function is invoked as a callback to a request made by the `requestContractDetails` function. 
- * It updates the optionChainMangager with the contract details.
+ * It updates the chain that sent the request with the contract details, if they are for the chain's 
+ * trading class.
  *
  * @param reqId The unique request identifier associated with the contract details.
  * @param contractDetails The full details of the contract received, including contract ID, symbol, 
@@ -388,27 +473,46 @@ TickerId My_wrapper::getNextTickerId() {
  */
 void My_wrapper::contractDetails(int reqId, const ContractDetails& contractDetails) {
 
-	if(contractDetails.contract.tradingClass == selectedSymbol) {
+	OptionChainManager* chain = chainRegistry.findRequestChain(reqId);
+
+	if(chain != nullptr && contractDetails.contract.tradingClass == chain->getUnderlyingContract().symbol) {
 
 		string toLog = "ReqID: " + to_string(reqId) + " - Received contract details for " + contractDetails.contract.symbol 
 						+ ", Contract ID: " + to_string(contractDetails.contract.conId) + " Trading Class: " + contractDetails.contract.tradingClass 
 						+ " Strike: " + to_string(contractDetails.contract.strike) + " Right: " + contractDetails.contract.right
 						+ " Last Trade Date: " + contractDetails.contract.lastTradeDateOrContractMonth + "\n";
 
-		unique_lock<mutex> lockLogFile(logFileMutex);
-		write(logFileFd, toLog.c_str(), toLog.length());
-		lockLogFile.unlock();
+		logger.log(LOG_INFO, toLog);
 
 		if(contractDetails.contract.secType == FUTURES_CODE){
-			optionChainManager->setUnderlyingContractDetails(contractDetails);
+			chain->setUnderlyingContractDetails(contractDetails);
 
 		} else if(contractDetails.contract.secType == FUTURES_OPTION_CODE){
-			optionChainManager->setContractDetails(contractDetails);
-			optionChainManager->incrementInitCallbackCount();
+			chain->setContractDetails(contractDetails);
 		}	
 	}
 }
 
+/**
+ * Marks the end of the contract details sent for a request.
+ *
+ * This function is invoked after the last `contractDetails` callback for a request made by
+ * the `requestContractDetails` function, and completes that request in the startup sequence
+ * if it was for an underlying contract, or in the bootstrap of the chain that sent it.
+ *
+ * @param reqId The unique request identifier associated with the contract details.
+ */
+void My_wrapper::contractDetailsEnd(int reqId) {
+
+	string toLog = "ReqID: " + to_string(reqId) + " - Contract details end\n";
+	logger.log(LOG_DEBUG, toLog);
+
+	m_startup.underlyingDetailsEnd(reqId);
+
+	OptionChainManager* chain = chainRegistry.findRequestChain(reqId);
+	if (chain != nullptr) chain->contractDetailsEnd(reqId);
+}
+
 /**
  * Handles error messages by logging them to a file.
  *
@@ -426,9 +530,26 @@ void My_wrapper::error(int id, int errorCode, const string& errorString, const s
 	
 	string toLog = "Error. Id: " + to_string(id) + ", Code: " + to_string(errorCode) + ", Msg: " + errorString + "\n";
 	
-	unique_lock<mutex> lockLogFile(logFileMutex);
-	write(logFileFd, toLog.c_str(), toLog.length());
-	lockLogFile.unlock();    
+	logger.log(LOG_ERROR, toLog);
+
+	m_startup.requestError(id, errorCode);
+
+	OptionChainManager* chain = id > 0 ? chainRegistry.findRequestChain(id) : nullptr;
+	if (chain != nullptr) chain->contractDetailsError(id, errorCode);
+}
+
+/**
+ * Handles the next valid order ID, which TWS sends once the API has started and the
+ * connection is ready for requests.
+ *
+ * @param orderId The next valid order ID, not used as no orders are placed.
+ */
+void My_wrapper::nextValidId(OrderId orderId) {
+
+	string toLog = "Next valid ID: " + to_string(orderId) + "\n";
+	logger.log(LOG_INFO, toLog);
+
+	m_startup.nextValidId();
 }
 
 /**
@@ -444,18 +565,17 @@ void My_wrapper::error(int id, int errorCode, const string& errorString, const s
 void My_wrapper::marketDataType(TickerId reqId, int marketDataType) {
 
 	string toLog = "MarketDataType. ReqId: " + to_string(reqId) + ", Type: " + to_string(marketDataType) + "\n";
-	unique_lock<mutex> lockLogFile(logFileMutex);
-	write(logFileFd, toLog.c_str(), toLog.length());
-	lockLogFile.unlock();
+	logger.log(LOG_INFO, toLog);
 }
 
 /**
  * Handles the security definition optional parameter response from the server.
  *
  * This function is a callback invoked when the server responds to a request made by the
- * `requestOptionChain` function. It logs a message indicating the receipt of the option chain
- * for the underlying contract and initializes the option chain manager with the strikes
- * received.
+ * `requestOptionChain` function. It passes the strikes received to the startup sequence, which
+ * loads the chain that requested them, and logs a message indicating the receipt of the option 
+ * chain for the underlying contract. A warning is logged if the chain's expiry is not among the 
+ * listed expirations.
  *
  * @param reqId The unique request identifier associated with the option chain.
  * @param exchange The exchange on which the underlying contract is traded.
@@ -469,14 +589,19 @@ void My_wrapper::securityDefinitionOptionalParameter(int reqId, const string& ex
 													const string& tradingClass, const string& multiplier, 
 													const set<string>& expirations, const set<double>& strikes) {
 
-	if(tradingClass == selectedSymbol) {
+	OptionChainManager* chain = chainRegistry.findRequestChain(reqId);
+
+	if(chain != nullptr && tradingClass == chain->getUnderlyingContract().symbol
+	   && m_startup.optionChainReceived(reqId, strikes, underlyingConId)) {
 
 		string toLog = "ReqID: " + to_string(reqId) + " - Received option chain for " + to_string(underlyingConId) + "\n";
-		unique_lock<mutex> lockLogFile(logFileMutex);
-		write(logFileFd, toLog.c_str(), toLog.length());
-		lockLogFile.unlock();
+		logger.log(LOG_INFO, toLog);
 
-		optionChainManager->initializeChain(strikes);
+		if (expirations.count(chain->getContractDate()) == 0) {
+			toLog = "ReqID: " + to_string(reqId) + " - Expiry " + chain->getContractDate() + " is not listed for " 
+					+ tradingClass + "\n";
+			logger.log(LOG_WARNING, toLog);
+		}
 	}
 }
 
@@ -484,8 +609,8 @@ void My_wrapper::securityDefinitionOptionalParameter(int reqId, const string& ex
  * Handles real-time price updates for a given option contract.
  *
  * This function is a callback invoked by TWS when it receives a price update
- * for an option contract. It logs the received price and updates the
- * prices of the bid, ask, and last fields in the option chain manager.
+ * for an option contract. It logs the received price as a binary tick record
+ * and updates the prices of the bid, ask, and last fields in the option chain manager.
  *
  * @param tickerId The unique identifier associated with the option contract.
  * @param field The type of price update (bid, ask, or last).
@@ -493,32 +618,84 @@ void My_wrapper::securityDefinitionOptionalParameter(int reqId, const string& ex
  * @param attrib The set of attributes associated with the price update.
  */
 void My_wrapper::tickPrice(TickerId tickerId, TickType field, double price, const TickAttrib& attrib) {
+	applyTickPrice(tickerId, field, price);
+}
+
+/**
+ * Captures a size tick, if ticks are captured; sizes are not otherwise used.
+ *
+ * @param tickerId The unique identifier associated with the contract.
+ * @param field The type of size update.
+ * @param size The updated size.
+ */
+void My_wrapper::tickSize(TickerId tickerId, TickType field, Decimal size) {
 
-	string toLog = "Tick Price. Ticker Id: " + to_string(tickerId) + ", Field: " + to_string(field)
-					+ ", Price: " + to_string(price) + "\n";
+	if (!m_capture.isOpen()) return;
+
+	OptionChainManager* chain = chainRegistry.findTickerChain(tickerId);
+	if (chain != nullptr) m_capture.capture(chain, tickerId, field, 0.0, DecimalFunctions::decimalToDouble(size));
+}
 
-	unique_lock<mutex> lockLogFile(logFileMutex);
-	write(logFileFd, toLog.c_str(), toLog.length());
-	lockLogFile.unlock();
+/**
+ * Applies a batch of price and size ticks decoded on the tick batching path.
+ *
+ * Every price tick is logged as tickPrice logs it, then the batch is applied to
+ * the option chains it is for, each in one pass; sizes are only captured. Called on the worker
+ * thread that decoded the ticks.
+ *
+ * @param context The My_wrapper the batch is for.
+ * @param ticks The ticks, in the order their messages arrived.
+ * @param count The number of ticks.
+ */
+void My_wrapper::onTicks(void* context, const ETick* ticks, size_t count) {
+
+	My_wrapper* wrapper = static_cast<My_wrapper*>(context);
+	StartupSequence& startup = wrapper->m_startup;
+
+	for (size_t i = 0; i < count; i++) {
+		if (!ticks[i].isPrice) continue;
+		logger.logTick(LOG_DEBUG, ticks[i].tickerId, ticks[i].tickType, ticks[i].price);
+		if (!startup.hasFirstQuote()) startup.quoteReceived(ticks[i].tickerId);
+	}
+	chainRegistry.applyTicks(ticks, count);
+	if (wrapper->m_capture.isOpen()) wrapper->m_capture.captureTicks(ticks, count);
+}
+
+//private methods
+
+/**
+ * Logs a price tick and updates the bid, ask or last price it is for in the chain its ticker ID
+ * routes to.
+ *
+ * @param tickerId The unique identifier associated with the option contract.
+ * @param field The type of price update (bid, ask, or last).
+ * @param price The updated price.
+ */
+void My_wrapper::applyTickPrice(TickerId tickerId, TickType field, double price) {
+
+	logger.logTick(LOG_DEBUG, tickerId, field, price);
+	if (!m_startup.hasFirstQuote()) m_startup.quoteReceived(tickerId);
+
+	OptionChainManager* chain = chainRegistry.findTickerChain(tickerId);
+	if (chain == nullptr) return;
+	if (m_capture.isOpen()) m_capture.capture(chain, tickerId, field, price, 0.0);
 	
 	switch (field){
 
 	case DELAYED_BID:
-		optionChainManager->updateBid(tickerId, price);
+		chain->updateBid(tickerId, price);
 		break;
 	
 	case DELAYED_ASK:
-		optionChainManager->updateAsk(tickerId, price);
+		chain->updateAsk(tickerId, price);
 		break;
 
 	case DELAYED_LAST:
-		optionChainManager->updateLast(tickerId, price);
+		chain->updateLast(tickerId, price);
 		break;
 	}
 }
 
-//private methods
-
 /**
  * Retrieves the maximum number of threads that can be supported by the hardware.
  *
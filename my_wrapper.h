@@ -14,11 +14,20 @@ December 6, 2024
 #include "EClientSocket.h"
 #include "Contract.h"
 #include "EMessage.h"
+#include "EMessageRecorder.h"
+#include "EMessageReplay.h"
 #include "terminal.h"
+#include "messageDispatcher.h"
+#include "optionChainManager.h"
+#include "startupSequence.h"
+#include "subscriptionManager.h"
+#include "tickCapture.h"
 #include <thread>
 
 using namespace std;
 
+#define SIGNAL_WAIT_TIMEOUT_MS 100
+
 class My_wrapper : public DefaultEWrapper {
 private:
 
@@ -29,12 +38,21 @@ private:
 	string m_bboExchange;
 	mutex m_reqIdMutex;
 	int m_currentReqId;
-	mutex m_tickerIdMutex;
-	TickerId m_currentTickerId;
-	atomic<bool> stopProcessingFlag;
 	unsigned int maxThreads;
+	int m_readerPollTimeoutMs;
+	bool m_readerBusyPoll;
+	size_t m_tickBatchCapacity;
+	unsigned int m_tickBatchFlushIdleMicros;
+	size_t m_maxWorkerQueueDepth;
+	string m_recordPath;
+	EMessageRecorder m_recorder;
+	unique_ptr<EMessageReplay> m_pReplay;
+	SubscriptionManager m_subscriptions;
+	StartupSequence m_startup;
+	TickCapture m_capture;
 
 	unsigned int getMaxThreads();
+	void applyTickPrice(TickerId tickerId, TickType field, double price);
 
 public:
 
@@ -45,24 +63,36 @@ public:
 	void disconnect();
 	void processMessages();
 	void processMessagesMultithreaded();
-	void requestContractDetails(const Contract& contract);
-	void requestOptionChain(string underlyingSymbol, string futFopExchange, string underlyingSecurityType,
-		 					string currency, string contractDate);
+	int requestContractDetails(const Contract& contract);
+	int requestOptionChain(OptionChainManager* chain);
+	bool startUp();
 	void requestDelayedDataType();
-	void requestUnderlyingMarketData();
+	void requestUnderlyingMarketData(OptionChainManager* chain);
 	void requestMarketData();
 	bool connect(const char * host, int port, int clientId = 0);
+	void setReaderPolling(int timeoutMs, bool busyPoll);
+	void setTickBatching(size_t capacity, unsigned int flushIdleMicros);
+	void setMaxWorkerQueueDepth(size_t depth);
+	void setMarketDataLines(size_t lines);
+	void setRecenterHysteresis(size_t strikes);
+	void setRecordFile(const string& path);
+	bool setCaptureFile(const string& path);
+	bool startReplay(const char* path, double speed);
+	bool isReplaying() const;
 	int getNextReqId();
-	TickerId getNextTickerId();
+	static void onTicks(void* context, const ETick* ticks, size_t count);
 
 	//overrides
 	void contractDetails(int reqId, const ContractDetails& contractDetails) override;
+	void contractDetailsEnd(int reqId) override;
 	void error(int id, int errorCode, const string& errorString, const string& advancedOrderRejectJson) override;
+	void nextValidId(OrderId orderId) override;
 	void marketDataType(TickerId reqId, int marketDataType) override;	
 	void securityDefinitionOptionalParameter(int reqId, const string& exchange, int underlyingConId, 
 											const string& tradingClass, const string& multiplier, 
 											const set<string>& expirations, const set<double>& strikes) override;
 	void tickPrice(TickerId tickerId, TickType field, double price, const TickAttrib& attrib) override;
+	void tickSize(TickerId tickerId, TickType field, Decimal size) override;
 
 };
 
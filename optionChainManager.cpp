@@ -6,86 +6,285 @@ December 6, 2024
 */
 
 #include "optionChainManager.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
 #include <iostream>
+#include <ctime>
+#include "ECycleClock.h"
 #include "globals.h"
 
 using namespace std;
 
 /**
- * Increments the initialization callback count.
+ * Loads the option chain with the given set of strikes.
+ *
+ * This function sets up the option chain with createChain and requests market data for the 
+ * underlying contract, so that its price arrives while the rest is loaded. It then finds the 
+ * contract details of every option. Options found in the contract cache for this underlying 
+ * are taken from it; the details of the rest are fetched by a ContractBootstrap, which keeps 
+ * a window of paced requests in flight and processes incoming messages until each request has 
+ * completed or failed, and are then written back to the cache. Every request is routed back 
+ * to this chain through the chain registry. When a recorded session is replayed, no requests 
+ * are sent and the details are filled in by the recorded replies instead. The option expiry 
+ * is taken from the contract details.
+ *
+ * @param strikes The set of strike prices for which to load the option chain.
+ * @param underlyingConId The underlying contract ID the strikes were listed for, used to 
+ * validate cached options.
  */
-void OptionChainManager::incrementInitCallbackCount() {
-    this->initCallbackCount++;
+void OptionChainManager::loadChain(const set<double>& strikes, int underlyingConId) {
+
+    createChain(strikes);
+    my_wrapper.requestUnderlyingMarketData(this);
+
+    this->bootstrap = make_unique<ContractBootstrap>([this](const Contract& contract) {
+        int reqId = my_wrapper.requestContractDetails(contract);
+        chainRegistry.routeRequest(reqId, this);
+        return reqId;
+    }, []() {
+        my_wrapper.processMessages();
+    });
+    this->bootstrap->setWindow(this->bootstrapWindow);
+
+    //progress goes to the terminal only until a table owns it; chains loaded after the displayed one only log it
+    string chainName = this->underlyingContractDetails.contract.symbol + " " + this->contractDate;
+    this->bootstrap->setProgressCallback([chainName](size_t completed, size_t total) {
+        OptionChainManager* displayedChain = chainRegistry.getDisplayedChain();
+        if (displayedChain == nullptr || !displayedChain->isInitialized) {
+            string progress = "\r" + chainName + " contract details: " + to_string(completed) + "/" + to_string(total);
+            if (completed == total) progress += "\n";
+            write(STDOUT_FILENO, progress.c_str(), progress.size());
+        }
+        if (completed == total) {
+            string toLog = chainName + " contract details loaded: " + to_string(total) + "\n";
+            logger.log(LOG_INFO, toLog);
+        }
+    });
+
+    for (OptionData& option : this->options) {
+        ContractDetails& contractDetails = option.contractDetails;
+        if (!this->contractCache->findOption(this->underlyingContractDetails.contract.symbol, this->contractDate,
+                                             contractDetails.contract.strike, contractDetails.contract.right[0],
+                                             underlyingConId, contractDetails)) {
+            this->bootstrap->add(contractDetails.contract);
+        }
+    }
+
+    size_t cachedCount = 2 * strikes.size() - this->bootstrap->getTotalCount();
+    string toLog = chainName + " contract cache hits: " + to_string(cachedCount) + " of " + to_string(2 * strikes.size()) + "\n";
+    logger.log(LOG_INFO, toLog);
+
+    //a replay cannot send requests; the recorded replies fill in the details as they are processed
+    if (this->bootstrap->getTotalCount() > 0 && !my_wrapper.isReplaying()) {
+        this->bootstrap->run();
+        saveContractCache();
+    }
+
+    if (!this->options.empty()) {
+        this->expiryTime = parseExpiryTime(this->options.front().contractDetails.contract.lastTradeDateOrContractMonth);
+    }
+    if (this->expiryTime == 0) this->expiryTime = parseExpiryTime(this->contractDate);
+}
+
+/**
+ * Initializes a loaded option chain for streaming.
+ *
+ * This function centers the window of strikes to subscribe to on the underlying price, or 
+ * on the middle strike if the underlying has no price yet: the table rows if this is the 
+ * displayed chain, which also initializes the table with them, or chainStrikes strikes 
+ * otherwise. If a quote segment prefix is set, the chain's shared memory segment is created
+ * first. Finally, it logs the initialization and marks the chain initialized.
+ */
+void OptionChainManager::initializeChain() {
+
+    size_t windowSize = this->isDisplayed ? STRIKE_ROWS : this->chainStrikes;
+    if (windowSize == 0 || windowSize > this->strikesByIndex.size()) windowSize = this->strikesByIndex.size();
+
+    double underlyingPrice = getUnderlyingPrice();
+    size_t centerIndex = underlyingPrice > 0.0 ? findClosestStrikeIndex(underlyingPrice) : this->strikesByIndex.size() / 2;
+
+    if (!this->quoteSegmentPrefix.empty()) openQuoteSegment();
+
+    vector<ContractKey> added, removed;
+    setWindow(getWindowStartFor(centerIndex, windowSize), windowSize, added, removed);
+
+    if (this->isDisplayed) {
+        this->table.setFrameCallback([this]() {
+            updateGreeks();
+            latencyTracker.dumpIfRequested();
+        });
+        if (latencyTracker.isEnabled()) this->table.setLatencyTracker(&latencyTracker);
+
+        table.initializeTable(getActiveStrikes());
+    }
+
+    string toLog = "Option chain initialized for symbol: " + this->underlyingContractDetails.contract.symbol 
+                   + ", expiry: " + this->contractDate + ", ticker IDs " + to_string(this->firstTickerId) + "-"
+                   + to_string(this->firstTickerId + (TickerId)this->quotes.size() - 1) + "\n";
+    logger.log(LOG_INFO, toLog);
+
+    this->isInitialized = true;
 }
 
 /**
- * Initializes the option chain with the given set of strikes.
+ * Creates the option data and quote slots of a chain and sizes the Greeks engine for it,
+ * without requesting anything from TWS.
  *
- * This function sets up the option chain by creating OptionData entries for each strike 
- * in both call and put directions, initializing their market data values to zero. It assigns 
- * contract details and manages the mapping between ticker IDs and option pairs. The function 
- * requests contract details for each option and processes incoming messages until all callbacks 
- * are completed. It then requests market data for the underlying contract and updates the option 
- * chain's closest strike based on the received underlying price. Finally, it initializes the table 
- * with the strikes and logs the initialization process.
+ * A block of ticker IDs for the underlying and every option is allocated from the chain 
+ * registry. Every option gets an OptionData entry with the contract fields known from the 
+ * strike and its contract key, and the quote array is sized so that every ticker ID of the 
+ * block indexes its own QuoteSlot. Slot 0 is reserved for the underlying and the options 
+ * follow in strike order, calls before puts, as they do in the option data. No slot has a 
+ * table row until the table is initialized. The benchmarks call this on its own to drive 
+ * the tick path without a connection.
  *
- * @param strikes The set of strike prices for which to initialize the option chain.
+ * @param strikes The set of strike prices of the chain.
  */
-void OptionChainManager::initializeChain(const set<double>& strikes) {
+void OptionChainManager::createChain(const set<double>& strikes) {
+
+    setStrikeTick(strikes);
 
-    optionChainManager->strikes = strikes;
-    optionChainManager->underlyingLast = 0;
-    optionChainManager->underlyingTickerId = 0;
+    this->strikes = strikes;
+    this->strikesByIndex = vector<double>(strikes.begin(), strikes.end());
+    this->strikeTicksByIndex.clear();
+    this->options.clear();
+    this->options.reserve(2 * strikes.size());
+    this->keyToOption.clear();
+    this->keyToOption.reserve(2 * strikes.size());
+    this->quotes = vector<QuoteSlot>(2 * strikes.size() + 1);
+    this->firstTickerId = chainRegistry.allocateTickerIds(this, this->quotes.size());
 
-    int i = 1;
+    TickerId tickerId = this->firstTickerId + 1;
+    int strikeIndex = 0;
 
     for (const double& strike : strikes) {
-        this->optionChain[{strike, "C"}] = make_unique<OptionData>();
-        this->optionChain[{strike, "C"}]->ask = 0.0;
-        this->optionChain[{strike, "C"}]->bid = 0.0;
-        this->optionChain[{strike, "C"}]->last = 0.0;
-        this->optionChain[{strike, "C"}]->contractDetails.contract.strike = strike;
-        this->optionChain[{strike, "C"}]->contractDetails.contract.right = "C";
-        this->optionChain[{strike, "C"}]->contractDetails.contract.secType = "FOP";
-        this->optionChain[{strike, "C"}]->contractDetails.contract.symbol = optionChainManager->underlyingContractDetails.contract.symbol;
-        this->optionChain[{strike, "C"}]->contractDetails.contract.lastTradeDateOrContractMonth = optionChainManager->underlyingContractDetails.contract.lastTradeDateOrContractMonth;
-        this->tickerToPairMap[i] = {strike, "C"};
-        this->pairToTickerMap[{strike, "C"}] = i;
-        optionChainManager->contractCount++;
-        i++;
-
-        this->optionChain[{strike, "P"}] = make_unique<OptionData>();
-        this->optionChain[{strike, "P"}]->ask = 0.0;
-        this->optionChain[{strike, "P"}]->bid = 0.0;
-        this->optionChain[{strike, "P"}]->last = 0.0;
-        this->optionChain[{strike, "P"}]->contractDetails.contract.strike = strike;
-        this->optionChain[{strike, "P"}]->contractDetails.contract.right = "P";
-        this->optionChain[{strike, "P"}]->contractDetails.contract.secType = "FOP";
-        this->optionChain[{strike, "P"}]->contractDetails.contract.symbol = optionChainManager->underlyingContractDetails.contract.symbol;
-        this->optionChain[{strike, "P"}]->contractDetails.contract.lastTradeDateOrContractMonth = optionChainManager->underlyingContractDetails.contract.lastTradeDateOrContractMonth;
-        this->tickerToPairMap[i] = {strike, "P"};
-        this->pairToTickerMap[{strike, "P"}] = i;
-        optionChainManager->contractCount++;
-        i++;
-
-        my_wrapper.requestContractDetails(this->optionChain[{strike, "C"}]->contractDetails.contract);
-        my_wrapper.requestContractDetails(this->optionChain[{strike, "P"}]->contractDetails.contract);
+
+        uint32_t strikeTicks = 0;
+        toStrikeTicks(strike, this->strikeTick, strikeTicks);
+        this->strikeTicksByIndex.push_back(strikeTicks);
+
+        for (const char* right : {"C", "P"}) {
+
+            OptionData optionData;
+            Contract& contract = optionData.contractDetails.contract;
+
+            contract.strike = strike;
+            contract.right = right;
+            contract.secType = "FOP";
+            contract.symbol = this->underlyingContractDetails.contract.symbol;
+            contract.lastTradeDateOrContractMonth = this->underlyingContractDetails.contract.lastTradeDateOrContractMonth;
+            optionData.tickerId = tickerId;
+            optionData.key = makeContractKey(strikeTicks, right[0] == 'C');
+
+            if (!this->keyToOption.emplace(optionData.key, this->options.size()).second) {
+                string toLog = "Strike " + to_string(strike) + " has the same contract key as another strike of the chain\n";
+                logger.log(LOG_ERROR, toLog);
+            }
+            this->options.push_back(move(optionData));
+            QuoteSlot& slot = this->quotes[tickerId - this->firstTickerId];
+            slot.strike = strike;
+            slot.isCall = right[0] == 'C';
+            slot.strikeIndex = strikeIndex;
+            tickerId++;
+        }
+        strikeIndex++;
     }
 
-    while(this->initCallbackCount != this->contractCount) my_wrapper.processMessages();
+    this->greeksEngine.initialize(this->strikesByIndex);
+}
 
-    my_wrapper.requestUnderlyingMarketData();
-    while(this->underlyingLast == 0) my_wrapper.processMessages();
-    
-    int closestStrike = findClosestStrike(this->underlyingLast);
-    table.initializeTable(strikes, closestStrike);
+/**
+ * Loads an option chain published by a fanout server: creates it from its strikes, without
+ * requesting anything from TWS, and takes the option expiry from the published last trade
+ * date. The quotes are then applied from the server's messages.
+ *
+ * @param strikes The strikes of the chain.
+ * @param lastTradeDate The last trade date of the options, or empty to use the contract date.
+ */
+void OptionChainManager::loadPublishedChain(const set<double>& strikes, const string& lastTradeDate) {
 
-    string toLog = "Option chain initialized for symbol: " + optionChainManager->underlyingContractDetails.contract.symbol + "\n";
-    unique_lock<mutex> lockLogFile(logFileMutex);
-    write(logFileFd, toLog.c_str(), toLog.length());
-    lockLogFile.unlock();
+    createChain(strikes);
 
-    this->isInitialized = true;
+    this->expiryTime = parseExpiryTime(lastTradeDate);
+    if (this->expiryTime == 0) this->expiryTime = parseExpiryTime(this->contractDate);
+}
+
+/**
+ * Marks a contract details request of the bootstrap as complete.
+ *
+ * @param reqId The request ID passed to the contractDetailsEnd callback.
+ */
+void OptionChainManager::contractDetailsEnd(int reqId) {
+    if (this->bootstrap) this->bootstrap->contractDetailsEnd(reqId);
+}
+
+/**
+ * Passes an error to the bootstrap in case it belongs to one of its contract details requests.
+ *
+ * @param reqId The ID passed to the error callback.
+ * @param errorCode The TWS error code.
+ */
+void OptionChainManager::contractDetailsError(int reqId, int errorCode) {
+    if (this->bootstrap) this->bootstrap->requestError(reqId, errorCode);
+}
+
+/**
+ * Sets the contract cache the chain looks its contracts up in and stores them to. The 
+ * cache is shared by every chain of the registry, so that saving one chain keeps the others.
+ *
+ * @param contractCache The contract cache.
+ * @param path The path the cache file is written to, empty to never write it.
+ */
+void OptionChainManager::setContractCache(ContractCache* contractCache, const string& path) {
+    this->contractCache = contractCache;
+    this->contractCachePath = path;
+}
+
+/**
+ * Sets the underlying contract details from the contract cache, if they are cached.
+ *
+ * @return true on a cache hit, in which case contract details need not be requested.
+ */
+bool OptionChainManager::loadCachedUnderlying() {
+
+    ContractDetails contractDetails;
+    if (!this->contractCache->findUnderlying(this->underlyingContractDetails.contract.symbol, this->contractDate,
+                                             contractDetails)) {
+        return false;
+    }
+
+    this->underlyingContractDetails = contractDetails;
+    return true;
+}
+
+/**
+ * Sets how many contract details requests loadChain keeps in flight at once.
+ *
+ * @param window The window size.
+ */
+void OptionChainManager::setBootstrapWindow(unsigned int window) {
+    this->bootstrapWindow = window;
+}
+
+/**
+ * Sets how many strikes around the underlying price are subscribed to if the chain is
+ * not displayed. The displayed chain subscribes to the strikes in the table.
+ *
+ * @param strikeCount The number of strikes, 0 for every strike of the chain.
+ */
+void OptionChainManager::setChainStrikes(size_t strikeCount) {
+    this->chainStrikes = strikeCount;
+}
+
+/**
+ * Makes the chain publish its quotes in the shared memory segment /<prefix>.<symbol>.<expiry>
+ * once it is initialized, see quoteSegment.h. Takes effect on the next initializeChain.
+ *
+ * @param prefix The prefix of the segment name, empty to publish no segment.
+ */
+void OptionChainManager::setQuoteSegmentPrefix(const string& prefix) {
+    this->quoteSegmentPrefix = prefix;
 }
 
 /**
@@ -94,16 +293,23 @@ void OptionChainManager::initializeChain(const set<double>& strikes) {
  * @param contractDetails The contract details received from TWS.
  */
 void OptionChainManager::setUnderlyingContractDetails(ContractDetails contractDetails) {
+    this->contractCache->storeUnderlying(contractDetails.contract.symbol, this->contractDate, contractDetails);
     this->underlyingContractDetails = contractDetails;
 }
 
 /**
- * Sets the contract details for the option with the given strike and right.
+ * Sets the contract details for the option with the given strike and right. Details of an
+ * option that is not in the chain are ignored.
  *
  * @param contractDetails The contract details received from TWS.
  */
 void OptionChainManager::setContractDetails(ContractDetails contractDetails) {
-    this->optionChain[{contractDetails.contract.strike, contractDetails.contract.right}]->contractDetails = contractDetails;
+
+    ContractKey key;
+    if (!findContractKey(contractDetails.contract.strike, contractDetails.contract.right, key)) return;
+
+    int optionIndex = findOptionIndex(key);
+    if (optionIndex >= 0) this->options[optionIndex].contractDetails = contractDetails;
 }
 
 /**
@@ -123,145 +329,173 @@ void OptionChainManager::setUnderlyingContract(string underlyingSymbol, string f
     this->underlyingContractDetails.contract.secType = underlyingSecurityType;
     this->underlyingContractDetails.contract.currency = currency;
     this->underlyingContractDetails.contract.lastTradeDateOrContractMonth = contractDate;
+    this->contractDate = contractDate;
 }
 
 /**
- * Updates the bid price for the given ticker ID. If the ticker ID is 0, the method updates the
- * underlying contract's bid price. Otherwise, it updates the bid price of the corresponding option
- * contract. The method logs the update and updates the table with the new value.
+ * Updates the bid price for the given ticker ID. If the ticker ID is the underlying's, the method
+ * updates the underlying contract's bid price. Otherwise, it updates the bid price of the corresponding option
+ * contract. The method logs the update and marks the table cell dirty so the render thread repaints it.
+ *
+ * The quote slot is found by indexing the quote array with the ticker ID's offset into the
+ * chain's block, so no map lookups or string comparisons are made on this path.
  *
  * @param tickerId The Ticker ID of the contract for which to update the bid price
  * @param bid The new bid price to update
  */
 void OptionChainManager::updateBid(TickerId tickerId, double bid) {
 
-    pair<double, string> pair = this->tickerToPairMap[tickerId];
-
-    if(tickerId == 0) {
-        lock_guard<mutex> lock_underlying(this->underlyingMutex);
-        this->underlyingBid = bid;
+    QuoteSlot* slot = getQuoteSlot(tickerId);
+    if(slot == nullptr) return;
 
-        string toLog = "'Bid' updated for underlying contract: " + this->underlyingContractDetails.contract.symbol + "\n";
-
-        unique_lock<mutex> lockLogFile(logFileMutex);
-        write(logFileFd, toLog.c_str(), toLog.length());
-        lockLogFile.unlock();
-        return;
-    } else {
-        lock_guard<mutex> lock_option(this->optionChain[pair]->dataMutex);
-        this->optionChain[pair]->bid = bid;
-
-        string toLog = "'Bid' updated for Ticker ID: " + to_string(tickerId) + " Symbol: " 
-                        + this->optionChain[pair]->contractDetails.contract.symbol 
-                        + " Strike: " + to_string(pair.first) + " Type: " + pair.second + "\n";
-    
-        unique_lock<mutex> lockLogFile(logFileMutex);
-        write(logFileFd, toLog.c_str(), toLog.length());
-        lockLogFile.unlock();
-
-        string text = this->table.formatNumber2(bid); 
-        int rowIndex = this->table.getRowIndex(pair.first); 
-
-        if (pair.second == "C") {
-            this->table.drawCell(rowIndex, CALL_BID_COLUMN, text);
-        } else {
-            this->table.drawCell(rowIndex, PUT_BID_COLUMN, text);
-        }
-    }
+    slot->beginWrite();
+    slot->bid.store(bid, memory_order_relaxed);
+    slot->endWrite();
+    latencyTracker.recordApply();
+    markGreeksDirty(slot);
+    publishQuote(tickerId, slot, QUOTE_BID, bid);
+    publishToSegment(slot, QUOTE_BID, bid);
 }
 
 /**
- * Updates the ask price for the given ticker ID. If the ticker ID is 0, the method updates the
- * underlying contract's ask price. Otherwise, it updates the ask price of the corresponding option
- * contract. The method logs the update and updates the table with the new value.
+ * Updates the ask price for the given ticker ID. If the ticker ID is the underlying's, the method
+ * updates the underlying contract's ask price. Otherwise, it updates the ask price of the corresponding option
+ * contract. The method logs the update and marks the table cell dirty so the render thread repaints it.
  *
- * @param tickerId The Ticker ID of the contract for which to update the ask price.
- * @param ask The new ask price to update.
+ * The quote slot is found by indexing the quote array with the ticker ID's offset into the
+ * chain's block, so no map lookups or string comparisons are made on this path.
+ *
+ * @param tickerId The Ticker ID of the contract for which to update the ask price
+ * @param ask The new ask price to update
  */
 void OptionChainManager::updateAsk(TickerId tickerId, double ask) {
 
-    pair<double, string> pair = this->tickerToPairMap[tickerId];
+    QuoteSlot* slot = getQuoteSlot(tickerId);
+    if(slot == nullptr) return;
 
-    if(tickerId == 0) {
-        lock_guard<mutex> lock_underlying(this->underlyingMutex);
-        this->underlyingAsk = ask;
+    slot->beginWrite();
+    slot->ask.store(ask, memory_order_relaxed);
+    slot->endWrite();
+    latencyTracker.recordApply();
+    markGreeksDirty(slot);
+    publishQuote(tickerId, slot, QUOTE_ASK, ask);
+    publishToSegment(slot, QUOTE_ASK, ask);
+}
 
-        string toLog = "'Ask' updated for underlying contract: " + this->underlyingContractDetails.contract.symbol + "\n";
+/**
+ * Updates the last price for the given ticker ID. If the ticker ID is the underlying's, the method
+ * updates the underlying contract's last price. Otherwise, it updates the last price of the corresponding option
+ * contract. The method logs the update and marks the table cell dirty so the render thread repaints it.
+ *
+ * The quote slot is found by indexing the quote array with the ticker ID's offset into the
+ * chain's block, so no map lookups or string comparisons are made on this path.
+ *
+ * @param tickerId The Ticker ID of the contract for which to update the last price
+ * @param last The new last price to update
+ */
+void OptionChainManager::updateLast(TickerId tickerId, double last) {
 
-        unique_lock<mutex> lockLogFile(logFileMutex);
-        write(logFileFd, toLog.c_str(), toLog.length());
-        lockLogFile.unlock();    
-        return;
-    } else {
-        lock_guard<mutex> lock_option(this->optionChain[this->tickerToPairMap[tickerId]]->dataMutex);
-        this->optionChain[this->tickerToPairMap[tickerId]]->ask = ask; 
-    
-        string toLog = "'Ask' updated for Ticker ID: " + to_string(tickerId) + " Symbol: " 
-                        + this->optionChain[this->tickerToPairMap[tickerId]]->contractDetails.contract.symbol 
-                        + " Strike: " + to_string(this->tickerToPairMap[tickerId].first)
-                        + " Type: " + this->tickerToPairMap[tickerId].second + "\n";
-
-        unique_lock<mutex> lockLogFile(logFileMutex);
-        write(logFileFd, toLog.c_str(), toLog.length());
-        lockLogFile.unlock();
-
-        string text = this->table.formatNumber2(ask); 
-        int rowIndex = this->table.getRowIndex(pair.first); 
-
-        if (pair.second == "C") {
-            this->table.drawCell(rowIndex, CALL_ASK_COLUMN, text);
-        } else {
-            this->table.drawCell(rowIndex, PUT_ASK_COLUMN, text);
-        }
-    }
+    QuoteSlot* slot = getQuoteSlot(tickerId);
+    if(slot == nullptr) return;
+
+    slot->beginWrite();
+    slot->last.store(last, memory_order_relaxed);
+    slot->endWrite();
+    latencyTracker.recordApply();
+    markGreeksDirty(slot);
+    publishQuote(tickerId, slot, QUOTE_LAST, last);
+    publishToSegment(slot, QUOTE_LAST, last);
 }
 
 /**
- * Updates the last price for the given ticker ID. If the ticker ID is 0, the method updates the
- * underlying contract's last price. Otherwise, it updates the last price of the corresponding option
- * contract. The method logs the update and updates the table with the new value.
+ * Applies a batch of price ticks in one pass.
  *
- * @param tickerId The Ticker ID of the contract for which to update the last price.
- * @param last The new last price to update.
+ * The ticks are first folded into the newest bid, ask and last of every contract
+ * they are for, then each contract is updated once: its quote slot is written once,
+ * its strike marked for Greeks once and each of its changed cells set once per
+ * batch, rather than once per tick. The applied prices are logged as updateBid,
+ * updateAsk and updateLast log them. Ticks other than delayed bid, ask and last
+ * prices, and ticks of other chains, are ignored. When latencies are tracked, each
+ * tick is counted from the stamps of its own message, which it carries.
+ *
+ * @param ticks The ticks, in the order their messages arrived.
+ * @param count The number of ticks.
  */
-void OptionChainManager::updateLast(TickerId tickerId, double last) {
+void OptionChainManager::applyTicks(const ETick* ticks, size_t count) {
 
-    pair<double, string> pair = this->tickerToPairMap[tickerId];
+    //position of every contract's entry in updates, -1 if it has none; reset after each batch
+    static thread_local vector<int> updateIndices;
+    static thread_local vector<QuoteUpdate> updates;
+    static thread_local vector<int> tickUpdates;    //entry in updates of every tick, -1 if ignored; when tracing
+    bool isTraced = latencyTracker.isEnabled();
 
-    if(tickerId == 0) {
-        lock_guard<mutex> lock_underlying(this->underlyingMutex);
-        this->underlyingLast = last;
+    if (updateIndices.size() < this->quotes.size()) updateIndices.resize(this->quotes.size(), -1);
 
-        string toLog = "'Last' updated for underlying contract: " + this->underlyingContractDetails.contract.symbol + "\n";
+    for (size_t i = 0; i < count; i++) {
 
-        unique_lock<mutex> lockLogFile(logFileMutex);
-        write(logFileFd, toLog.c_str(), toLog.length());
-        lockLogFile.unlock();
-        return;
-    } else {
-        lock_guard<mutex> lock_option(this->optionChain[this->tickerToPairMap[tickerId]]->dataMutex);
-        this->optionChain[this->tickerToPairMap[tickerId]]->last = last;
-    
+        const ETick& tick = ticks[i];
+        QuoteField field;
+
+        if (isTraced) tickUpdates.push_back(-1);
+        if (!tick.isPrice) continue;
+        switch (tick.tickType) {
+        case DELAYED_BID: field = QUOTE_BID; break;
+        case DELAYED_ASK: field = QUOTE_ASK; break;
+        case DELAYED_LAST: field = QUOTE_LAST; break;
+        default: continue;
+        }
 
-        string toLog = "'Last' updated for Ticker ID: " + to_string(tickerId) + " Symbol: " 
-                        + this->optionChain[this->tickerToPairMap[tickerId]]->contractDetails.contract.symbol 
-                        + " Strike: " + to_string(this->tickerToPairMap[tickerId].first)
-                        + " Type: " + this->tickerToPairMap[tickerId].second + "\n";
+        QuoteSlot* slot = getQuoteSlot(tick.tickerId);
+        if (slot == nullptr) continue;
 
+        int& updateIndex = updateIndices[tick.tickerId - this->firstTickerId];
+        if (updateIndex < 0) {
+            updateIndex = updates.size();
+            updates.push_back(QuoteUpdate{tick.tickerId, slot});
+            updates.back().received = tick.receivedTime;
+            updates.back().decoded = tick.decodedTime;
+        }
+        if (isTraced) tickUpdates.back() = updateIndex;
+        updates[updateIndex].prices[field] = tick.price;
+        updates[updateIndex].fields |= 1u << field;
+    }
 
-        unique_lock<mutex> lockLogFile(logFileMutex);
-        write(logFileFd, toLog.c_str(), toLog.length());
-        lockLogFile.unlock();
+    //the cells of an update carry the stamps of its first tick, not of the message being decoded
+    LatencyTrace decodingTrace;
+    if (isTraced) decodingTrace = LatencyTracker::getCurrentTrace();
 
-        string text = this->table.formatNumber2(last); 
-        int rowIndex = this->table.getRowIndex(pair.first); 
+    for (QuoteUpdate& update : updates) {
 
-        if (pair.second == "C") {
-            this->table.drawCell(rowIndex, CALL_LAST_COLUMN, text);
-        } else {
-            this->table.drawCell(rowIndex, PUT_LAST_COLUMN, text);
+        QuoteSlot* slot = update.slot;
+
+        slot->beginWrite();
+        if (update.fields & (1u << QUOTE_BID)) slot->bid.store(update.prices[QUOTE_BID], memory_order_relaxed);
+        if (update.fields & (1u << QUOTE_ASK)) slot->ask.store(update.prices[QUOTE_ASK], memory_order_relaxed);
+        if (update.fields & (1u << QUOTE_LAST)) slot->last.store(update.prices[QUOTE_LAST], memory_order_relaxed);
+        slot->endWrite();
+        if (isTraced) {
+            update.applied = update.received != 0 ? ECycleClock::now() : 0;
+            LatencyTracker::exchangeCurrentTrace(LatencyTrace{update.received, 0, 0, update.decoded, update.applied});
+        }
+        markGreeksDirty(slot);
+
+        for (int field = QUOTE_BID; field <= QUOTE_LAST; field++) {
+            if (update.fields & (1u << field)) publishQuote(update.tickerId, slot, (QuoteField)field, update.prices[field]);
+        }
+        if (this->quoteSegment != nullptr) this->quoteSegment->publish(slot->strikeIndex, slot->isCall, update.prices, update.fields);
+        updateIndices[update.tickerId - this->firstTickerId] = -1;
+    }
+
+    if (isTraced) {
+        LatencyTracker::exchangeCurrentTrace(decodingTrace);
+        for (size_t i = 0; i < tickUpdates.size(); i++) {
+            if (tickUpdates[i] >= 0) {
+                latencyTracker.recordTickApply(ticks[i].receivedTime, ticks[i].decodedTime, updates[tickUpdates[i]].applied);
+            }
         }
+        tickUpdates.clear();
     }
+    updates.clear();
 }
 
 /**
@@ -273,11 +507,31 @@ int OptionChainManager::getUnderlyingContractId() {
     return this->underlyingContractDetails.contract.conId;
 }
 
+/**
+ * Returns the ticker ID market data for the underlying contract is requested with,
+ * the first of the chain's block.
+ *
+ * @return The ticker ID of the underlying contract.
+ */
+TickerId OptionChainManager::getUnderlyingTickerId() {
+    return this->firstTickerId;
+}
+
+/**
+ * Returns the last trade date or contract month the chain was requested for.
+ *
+ * @return The contract date, e.g. "20250321".
+ */
+string OptionChainManager::getContractDate() {
+    return this->contractDate;
+}
+
 /**
  * Finds the strike closest to the given underlying price.
  *
  * This method searches for the closest strike by first finding the lower bound
- * of the underlying price in the set of strikes. If the underlying price is equal
+ * of the underlying price in the set of strikes. If the underlying price is above
+ * every strike, it returns the highest strike. If the underlying price is equal
  * to the lower bound, it returns the lower bound. If the lower bound is the first
  * element of the set or if the lower bound is equal to the underlying price, it
  * returns the lower bound. Otherwise, it checks if the lower bound is closer to
@@ -289,13 +543,13 @@ int OptionChainManager::getUnderlyingContractId() {
  */
 double OptionChainManager::findClosestStrike(double underlyingPrice) {
 
-    set<double>::iterator lowerBound = optionChainManager->strikes.lower_bound(underlyingPrice);
+    set<double>::iterator lowerBound = this->strikes.lower_bound(underlyingPrice);
 
-    if(underlyingPrice == *lowerBound) {    //check if equal to strike
-        return *lowerBound;
-    } else if (lowerBound == optionChainManager->strikes.end()) { //check if higher than all strikes
+    if (lowerBound == this->strikes.end()) { //check if higher than all strikes
         return *prev(lowerBound);
-    } else if (lowerBound == optionChainManager->strikes.begin()) { //check if lower than all strikes
+    } else if(underlyingPrice == *lowerBound) {    //check if equal to strike
+        return *lowerBound;
+    } else if (lowerBound == this->strikes.begin()) { //check if lower than all strikes
         return *lowerBound;
     } else {
         double deltaLower = underlyingPrice - *prev(lowerBound); //check if closer to lower or higher
@@ -309,78 +563,283 @@ double OptionChainManager::findClosestStrike(double underlyingPrice) {
     }
 }
 
+/**
+ * Finds the position of the strike closest to the given underlying price in the chain.
+ *
+ * @param underlyingPrice The underlying price to find the closest strike for.
+ * @return The index of the closest strike, in ascending strike order.
+ */
+size_t OptionChainManager::findClosestStrikeIndex(double underlyingPrice) {
+
+    double closestStrike = findClosestStrike(underlyingPrice);
+    return lower_bound(this->strikesByIndex.begin(), this->strikesByIndex.end(), closestStrike) - this->strikesByIndex.begin();
+}
+
+/**
+ * Returns the price of the underlying futures contract: its bid/ask mid, or its last
+ * price while it has no two-sided quote.
+ *
+ * @return The underlying price, or 0 if no price has been received.
+ */
+double OptionChainManager::getUnderlyingPrice() {
+
+    QuoteSnapshot underlying = this->quotes[UNDERLYING_SLOT_INDEX].read();
+    return underlying.bid > 0.0 && underlying.ask >= underlying.bid ? (underlying.bid + underlying.ask) / 2.0
+                                                                    : underlying.last;
+}
+
+/**
+ * Moves the window of subscribed strikes to center it on the strike closest to the
+ * underlying price, once that strike is at least a given number of strikes away from
+ * the center of the window. The hysteresis keeps the window from moving back and forth
+ * while the underlying hovers around a strike. A window at the lowest or highest strikes
+ * of the chain only moves back towards the middle. If the chain is displayed, the table
+ * rows are given the strikes of the new window and repainted from the cached quotes on
+ * the next frame; quotes of strikes that leave the window are kept, so they are shown at 
+ * once if the window moves back.
+ *
+ * @param hysteresis How many strikes the closest strike must be from the center of the
+ *                   window, 0 for a quarter of the window.
+ * @param added Receives the contract keys of the options that entered the window.
+ * @param removed Receives the contract keys of the options that left the window.
+ * @return true if the window moved; never for an empty window.
+ */
+bool OptionChainManager::recenterWindow(size_t hysteresis, vector<ContractKey>& added, vector<ContractKey>& removed) {
+
+    double underlyingPrice = getUnderlyingPrice();
+    if (underlyingPrice <= 0.0 || this->strikesByIndex.empty()) return false;
+
+    StrikeWindow window = this->window.load(memory_order_acquire);
+    size_t start = window.start;
+    size_t size = window.size;
+    if (size == 0) return false;
+
+    size_t closestIndex = findClosestStrikeIndex(underlyingPrice);
+    size_t centerIndex = start + size / 2;
+    size_t distance = closestIndex > centerIndex ? closestIndex - centerIndex : centerIndex - closestIndex;
+
+    if (hysteresis == 0) hysteresis = max<size_t>(1, size / 4);
+    if (distance < hysteresis) return false;
+
+    size_t newStart = getWindowStartFor(closestIndex, size);
+    if (newStart == start) return false;
+
+    setWindow(newStart, size, added, removed);
+    return true;
+}
+
+/**
+ * Changes the number of subscribed strikes, centering the window on the strike closest
+ * to the underlying price.
+ *
+ * @param size The number of strikes. It is cut down to the strikes of the chain, and to
+ *             the rows of the table if the chain is displayed.
+ * @param added Receives the contract keys of the options that entered the window.
+ * @param removed Receives the contract keys of the options that left the window.
+ */
+void OptionChainManager::resizeWindow(size_t size, vector<ContractKey>& added, vector<ContractKey>& removed) {
+
+    size = min(size, this->strikesByIndex.size());
+    if (this->isDisplayed) size = min<size_t>(size, STRIKE_ROWS);
+
+    double underlyingPrice = getUnderlyingPrice();
+    StrikeWindow window = this->window.load(memory_order_acquire);
+    size_t centerIndex = underlyingPrice > 0.0 ? findClosestStrikeIndex(underlyingPrice) : window.start + window.size / 2;
+
+    setWindow(getWindowStartFor(centerIndex, size), size, added, removed);
+}
+
+/**
+ * Moves the window of subscribed strikes to given strikes, as a fanout viewer does to follow
+ * the window of the server it is fed by. If the chain is displayed and the window has more
+ * strikes than the table has rows, the rows show its middle strikes.
+ *
+ * @param start The index of the first strike of the window.
+ * @param size The number of strikes in the window.
+ */
+void OptionChainManager::moveWindow(size_t start, size_t size) {
+
+    if (start >= this->strikesByIndex.size()) return;
+    size = min(size, this->strikesByIndex.size() - start);
+
+    if (this->isDisplayed && size > STRIKE_ROWS) {
+        start += (size - STRIKE_ROWS) / 2;
+        size = STRIKE_ROWS;
+    }
+    StrikeWindow window = this->window.load(memory_order_acquire);
+    if (start == window.start && size == window.size) return;
+
+    vector<ContractKey> added, removed;
+    setWindow(start, size, added, removed);
+}
+
+/**
+ * @return the first strike and the number of strikes of the window of subscribed strikes,
+ *         read together.
+ */
+StrikeWindow OptionChainManager::getWindow() {
+    return this->window.load(memory_order_acquire);
+}
+
+/**
+ * @return the index of the first strike in the window of subscribed strikes.
+ */
+size_t OptionChainManager::getWindowStart() {
+    return this->window.load(memory_order_acquire).start;
+}
+
+/**
+ * @return the number of strikes in the window of subscribed strikes.
+ */
+size_t OptionChainManager::getWindowSize() {
+    return this->window.load(memory_order_acquire).size;
+}
+
 /**
  * Retrieves the bid price for the specified ticker ID.
  *
- * If the ticker ID is 0, this function returns the bid price of the underlying contract.
+ * If the ticker ID is the underlying's, this function returns the bid price of the underlying contract.
  * Otherwise, it returns the bid price of the option contract associated with the given 
- * ticker ID. Access to the bid prices is thread-safe to ensure data consistency.
+ * ticker ID. The price is read without locking; use getQuote to read the bid, ask and last
+ * of a contract together.
  *
  * @param tickerId The Ticker ID of the contract for which to retrieve the bid price.
- * @return The bid price of the specified contract.
+ * @return The bid price of the specified contract, or 0 if the ticker ID is unknown.
  */
 double OptionChainManager::getBid(TickerId tickerId) {
 
-    if(tickerId == 0) {
-        lock_guard<mutex> lock_underlying(this->underlyingMutex);
-        return this->underlyingBid;
-    } else {
-        lock_guard<mutex> lock_option(this->optionChain[this->tickerToPairMap[tickerId]]->dataMutex);
-        return this->optionChain[this->tickerToPairMap[tickerId]]->bid;
-    }
+    QuoteSlot* slot = getQuoteSlot(tickerId);
+    if(slot == nullptr) return 0.0;
+
+    return slot->bid.load(memory_order_relaxed);
 }
 
 /**
  * Retrieves the ask price for the specified ticker ID.
  *
- * If the ticker ID is 0, this function returns the ask price of the underlying contract.
+ * If the ticker ID is the underlying's, this function returns the ask price of the underlying contract.
  * Otherwise, it returns the ask price of the option contract associated with the given 
- * ticker ID. Access to the ask prices is thread-safe to ensure data consistency.
+ * ticker ID. The price is read without locking; use getQuote to read the bid, ask and last
+ * of a contract together.
  *
  * @param tickerId The Ticker ID of the contract for which to retrieve the ask price.
- * @return The ask price of the specified contract.
+ * @return The ask price of the specified contract, or 0 if the ticker ID is unknown.
  */
 double OptionChainManager::getAsk(TickerId tickerId) {
 
-    if(tickerId == 0) {
-        lock_guard<mutex> lock_underlying(this->underlyingMutex);
-        return this->underlyingAsk;
-    } else {
-        lock_guard<mutex> lock_option(this->optionChain[this->tickerToPairMap[tickerId]]->dataMutex);
-        return this->optionChain[this->tickerToPairMap[tickerId]]->ask;
-    }
+    QuoteSlot* slot = getQuoteSlot(tickerId);
+    if(slot == nullptr) return 0.0;
+
+    return slot->ask.load(memory_order_relaxed);
 }
 
 /**
  * Retrieves the last price for the specified ticker ID.
  *
- * If the ticker ID is 0, this function returns the last price of the underlying contract.
- * Otherwise, it returns the last price of the option contract associated with the given
- * ticker ID. Access to the last prices is thread-safe to ensure data consistency.
+ * If the ticker ID is the underlying's, this function returns the last price of the underlying contract.
+ * Otherwise, it returns the last price of the option contract associated with the given 
+ * ticker ID. The price is read without locking; use getQuote to read the bid, ask and last
+ * of a contract together.
  *
  * @param tickerId The Ticker ID of the contract for which to retrieve the last price.
- * @return The last price of the specified contract.
+ * @return The last price of the specified contract, or 0 if the ticker ID is unknown.
  */
 double OptionChainManager::getLast(TickerId tickerId) {
 
-    if(tickerId == 0) {
-        lock_guard<mutex> lock_underlying(this->underlyingMutex);
-        return this->underlyingLast;
-    } else {
-        lock_guard<mutex> lock_option(this->optionChain[this->tickerToPairMap[tickerId]]->dataMutex);
-        return this->optionChain[this->tickerToPairMap[tickerId]]->last;
-    }
+    QuoteSlot* slot = getQuoteSlot(tickerId);
+    if(slot == nullptr) return 0.0;
+
+    return slot->last.load(memory_order_relaxed);
+}
+
+/**
+ * Retrieves the bid, ask and last price of the specified ticker ID as of one moment.
+ *
+ * The prices are read through the quote slot's sequence lock, so they are never
+ * torn by a concurrent update and reading them never blocks the tick path.
+ *
+ * @param tickerId The Ticker ID of the contract, or the underlying's ticker ID.
+ * @return The prices of the contract, all 0 if the ticker ID is unknown.
+ */
+QuoteSnapshot OptionChainManager::getQuote(TickerId tickerId) {
+
+    QuoteSlot* slot = getQuoteSlot(tickerId);
+    if(slot == nullptr) return QuoteSnapshot();
+
+    return slot->read();
 }
 
 /**
- * Retrieves the contract details for the option with the specified strike and type.
+ * Blocks until the user presses the quit key in the table, or until a timeout.
+ *
+ * @param timeoutMs The longest time to wait.
+ * @return true if the quit key was pressed.
+ */
+bool OptionChainManager::waitForQuitKey(int timeoutMs) {
+    return this->table.waitForQuitKey(timeoutMs);
+}
+
+/**
+ * Sets how many frames per second the table is repainted.
+ *
+ * @param framesPerSecond The new frame rate.
+ */
+void OptionChainManager::setFrameRate(int framesPerSecond) {
+    this->table.setFrameRate(framesPerSecond);
+}
+
+/**
+ * Sets the risk-free rate the Greeks engine discounts with.
+ *
+ * @param rate The continuously compounded annual rate, e.g. 0.04 for 4%.
+ */
+void OptionChainManager::setRiskFreeRate(double rate) {
+    this->greeksEngine.setRate(rate);
+}
+
+/**
+ * Converts a strike and option type to the contract key of an option of this chain.
+ *
+ * This is where strikes and rights received as a double and a string are interned;
+ * every lookup inside the chain is by key.
  *
  * @param strike The strike price of the option.
  * @param optionType The type of option, either "C" for call or "P" for put.
- * @return The contract details of the specified option.
+ * @param key Receives the contract key.
+ * @return false if the strike is not a whole number of price ticks of the chain, or the
+ *         type is neither a call nor a put.
+ */
+bool OptionChainManager::findContractKey(double strike, const string& optionType, ContractKey& key) {
+
+    uint32_t strikeTicks;
+    if (optionType.size() != 1 || (optionType[0] != 'C' && optionType[0] != 'P')) return false;
+    if (!toStrikeTicks(strike, this->strikeTick, strikeTicks)) return false;
+
+    key = makeContractKey(strikeTicks, optionType[0] == 'C');
+    return true;
+}
+
+/**
+ * Returns the contract key of the call or put of a strike of the chain.
+ *
+ * @param strikeIndex The position of the strike in the chain, in ascending order.
+ * @param isCall true for the call, false for the put.
+ * @return The contract key.
+ */
+ContractKey OptionChainManager::getOptionKey(size_t strikeIndex, bool isCall) {
+    return makeContractKey(this->strikeTicksByIndex[strikeIndex], isCall);
+}
+
+/**
+ * Retrieves the contract of the option with the specified contract key.
+ *
+ * @param key The contract key of the option.
+ * @return The contract of the specified option, or an empty contract if it is not in the chain.
  */
-Contract OptionChainManager::getContract(double strike, string optionType) {
-    return this->optionChain[{strike, optionType}]->contractDetails.contract;
+Contract OptionChainManager::getContract(ContractKey key) {
+
+    int optionIndex = findOptionIndex(key);
+    return optionIndex >= 0 ? this->options[optionIndex].contractDetails.contract : Contract();
 }
 
 /**
@@ -397,8 +856,22 @@ Contract OptionChainManager::getUnderlyingContract() {
  *
  * @return The option chain.
  */
-map<pair<double, string>, unique_ptr<OptionData>>& OptionChainManager::getOptionChain() {
-    return this->optionChain;
+vector<OptionData>& OptionChainManager::getOptionChain() {
+    return this->options;
+}
+
+/**
+ * @return the strikes of the chain in ascending order, indexed by strike index.
+ */
+const vector<double>& OptionChainManager::getStrikesByIndex() {
+    return this->strikesByIndex;
+}
+
+/**
+ * @return the number of quote slots of the chain: the underlying's and one per option.
+ */
+size_t OptionChainManager::getQuoteCount() {
+    return this->quotes.size();
 }
 
 /**
@@ -411,15 +884,419 @@ map<double, int> OptionChainManager::getActiveStrikes() {
 }
 
 /**
- * Converts a pair of strike price and option type to a Ticker ID.
+ * Retrieves the strikes in the window of subscribed strikes, whose calls and puts market
+ * data is requested for: the strikes in the table if the chain is displayed, otherwise the 
+ * chainStrikes strikes around the underlying price.
+ *
+ * @return The subscribed strikes, in ascending order.
+ */
+vector<double> OptionChainManager::getSubscribedStrikes() {
+
+    StrikeWindow window = this->window.load(memory_order_acquire);
+    return vector<double>(this->strikesByIndex.begin() + window.start,
+                          this->strikesByIndex.begin() + window.start + window.size);
+}
+
+/**
+ * Retrieves the contract keys of the calls and puts of the window of subscribed strikes.
+ *
+ * @return The contract keys, in the order of their quote slots.
+ */
+vector<ContractKey> OptionChainManager::getSubscribedOptions() {
+
+    StrikeWindow window = this->window.load(memory_order_acquire);
+    size_t start = window.start;
+    size_t end = start + window.size;
+    vector<ContractKey> keys;
+
+    for (size_t strikeIndex = start; strikeIndex < end; strikeIndex++) {
+        keys.push_back(getOptionKey(strikeIndex, true));
+        keys.push_back(getOptionKey(strikeIndex, false));
+    }
+    return keys;
+}
+
+/**
+ * Converts a contract key to a Ticker ID.
+ *
+ * The key is hashed to the option's index, and the option's ticker ID follows from its 
+ * position in the chain's block of ticker IDs.
+ *
+ * @param key The contract key of an option of the chain.
+ * @return The Ticker ID of the option, or -1 if it is not in the chain.
+ */
+TickerId OptionChainManager::getTickerId(ContractKey key) {
+
+    int optionIndex = findOptionIndex(key);
+    return optionIndex >= 0 ? this->firstTickerId + 1 + optionIndex : -1;
+}
+
+/**
+ * Looks up the contract a ticker ID of the chain's block is for, as the tick path sees it.
+ *
+ * @param tickerId The Ticker ID of the contract.
+ * @param conId Receives the contract ID, 0 if its details have not arrived.
+ * @param strike Receives the strike, 0 for the underlying.
+ * @param right Receives 'C' or 'P', 0 for the underlying.
+ * @return false if the ticker ID is not in the chain's block.
+ */
+bool OptionChainManager::getTickerContract(TickerId tickerId, int& conId, double& strike, char& right) {
+
+    QuoteSlot* slot = getQuoteSlot(tickerId);
+    if (slot == nullptr) return false;
+
+    if (slot->strikeIndex < 0) {
+        conId = this->underlyingContractDetails.contract.conId;
+        strike = 0.0;
+        right = 0;
+        return true;
+    }
+
+    conId = this->options[tickerId - this->firstTickerId - 1].contractDetails.contract.conId;
+    strike = slot->strike;
+    right = slot->isCall ? 'C' : 'P';
+    return true;
+}
+
+//private methods
+
+/**
+ * Stores the underlying and every option with a known contract ID in the contract
+ * cache and writes the cache file.
+ */
+void OptionChainManager::saveContractCache() {
+
+    if (this->contractCachePath.empty()) return;
+
+    vector<ContractDetails> chain;
+    for (const OptionData& option : this->options) {
+        chain.push_back(option.contractDetails);
+    }
+    this->contractCache->storeChain(this->underlyingContractDetails.contract.symbol, this->contractDate, chain);
+
+    string toLog = this->contractCache->save(this->contractCachePath.c_str())
+                   ? "Saved contract cache to " + this->contractCachePath + "\n"
+                   : "Failed to save contract cache to " + this->contractCachePath + "\n";
+    logger.log(LOG_INFO, toLog);
+}
+
+/**
+ * Chooses the price tick strikes are interned with: the minimum tick of the underlying, so
+ * that every strike is a whole number of ticks, or DEFAULT_STRIKE_TICK if the underlying has
+ * none or a strike is off its grid.
+ *
+ * @param strikes The strikes of the chain.
+ */
+void OptionChainManager::setStrikeTick(const set<double>& strikes) {
+
+    uint32_t strikeTicks;
+    this->strikeTick = this->underlyingContractDetails.minTick > 0.0 ? this->underlyingContractDetails.minTick
+                                                                      : DEFAULT_STRIKE_TICK;
+
+    for (const double& strike : strikes) {
+        if (toStrikeTicks(strike, this->strikeTick, strikeTicks)) continue;
+
+        string toLog = "Strike " + to_string(strike) + " is not a multiple of the minimum tick "
+                       + to_string(this->strikeTick) + ", interning strikes in ticks of "
+                       + to_string(DEFAULT_STRIKE_TICK) + "\n";
+        logger.log(LOG_WARNING, toLog);
+        this->strikeTick = DEFAULT_STRIKE_TICK;
+        return;
+    }
+}
+
+/**
+ * Finds the option with a contract key.
+ *
+ * @param key The contract key.
+ * @return The index of the option in the option data, or -1 if it is not in the chain.
+ */
+int OptionChainManager::findOptionIndex(ContractKey key) {
+
+    unordered_map<ContractKey, uint32_t, ContractKeyHash>::const_iterator it = this->keyToOption.find(key);
+    return it == this->keyToOption.end() ? -1 : (int)it->second;
+}
+
+/**
+ * Returns the quote slot for the given ticker ID.
+ *
+ * @param tickerId The Ticker ID of the contract.
+ * @return A pointer to the contract's quote slot, or nullptr if the ticker ID is not in the chain's block.
+ */
+QuoteSlot* OptionChainManager::getQuoteSlot(TickerId tickerId) {
+
+    TickerId index = tickerId - this->firstTickerId;
+    if(index < 0 || index >= (TickerId)this->quotes.size()) return nullptr;
+    return &this->quotes[index];
+}
+
+/**
+ * Logs a new bid, ask or last price of a contract and marks its table cell dirty
+ * so the render thread repaints it, if the contract is displayed.
  *
- * This function retrieves the Ticker ID associated with the given pair of strike price 
- * and option type from the internal mapping. The option type is "C" for call 
- * or "P" for put.
+ * @param tickerId The Ticker ID of the contract.
+ * @param slot The quote slot of the contract.
+ * @param field Which price changed.
+ * @param price The new price.
+ */
+void OptionChainManager::publishQuote(TickerId tickerId, QuoteSlot* slot, QuoteField field, double price) {
+
+    static const int callColumns[] = {CALL_BID_COLUMN, CALL_ASK_COLUMN, CALL_LAST_COLUMN};
+    static const int putColumns[] = {PUT_BID_COLUMN, PUT_ASK_COLUMN, PUT_LAST_COLUMN};
+
+    if(slot->strikeIndex < 0) {
+        logger.logQuote(LOG_DEBUG, tickerId, field, price, 0.0, 0, this->underlyingContractDetails.contract.symbol);
+        return;
+    }
+
+    logger.logQuote(LOG_DEBUG, tickerId, field, price, slot->strike, slot->isCall ? 'C' : 'P',
+                    this->underlyingContractDetails.contract.symbol);
+
+    int rowIndex = slot->rowIndex.load(memory_order_relaxed);
+    if(rowIndex < 0) return;
+
+    this->table.setCell(rowIndex, slot->isCall ? callColumns[field] : putColumns[field], price);
+}
+
+/**
+ * Publishes a new bid, ask or last price of a contract in the chain's shared memory
+ * segment, if it has one.
+ *
+ * @param slot The quote slot of the contract.
+ * @param field Which price changed.
+ * @param price The new price.
+ */
+void OptionChainManager::publishToSegment(QuoteSlot* slot, QuoteField field, double price) {
+
+    if (this->quoteSegment == nullptr) return;
+
+    double prices[3] = {};
+    prices[field] = price;
+    this->quoteSegment->publish(slot->strikeIndex, slot->isCall, prices, 1u << field);
+}
+
+/**
+ * Creates the chain's shared memory segment with its strike grid and fills it with the
+ * quotes received so far. The chain publishes no segment if it cannot be created.
+ */
+void OptionChainManager::openQuoteSegment() {
+
+    string name = "/" + this->quoteSegmentPrefix + "." + this->underlyingContractDetails.contract.symbol + "." + this->contractDate;
+    unique_ptr<QuoteSegment> segment = make_unique<QuoteSegment>();
+
+    if (!segment->create(name, this->underlyingContractDetails.contract.symbol, this->contractDate, this->strikesByIndex,
+                         this->strikeTick, this->expiryTime)) {
+        string toLog = "Failed to create shared memory segment " + name + ": " + strerror(errno) + "\n";
+        logger.log(LOG_ERROR, toLog);
+        return;
+    }
+
+    for (QuoteSlot& slot : this->quotes) {
+        QuoteSnapshot quote = slot.read();
+        double prices[3] = {quote.bid, quote.ask, quote.last};
+        segment->publish(slot.strikeIndex, slot.isCall, prices, (1u << QUOTE_BID) | (1u << QUOTE_ASK) | (1u << QUOTE_LAST));
+    }
+    this->quoteSegment = move(segment);
+
+    string toLog = "Publishing quotes in shared memory segment " + name + "\n";
+    logger.log(LOG_INFO, toLog);
+}
+
+/**
+ * Marks the Greeks of the strike a quote slot belongs to for recomputation, or of
+ * every strike if the slot is the underlying's.
+ *
+ * @param slot The quote slot that changed.
+ */
+void OptionChainManager::markGreeksDirty(QuoteSlot* slot) {
+
+    if (slot->strikeIndex < 0) {
+        this->greeksEngine.markAllDirty();
+    } else {
+        this->greeksEngine.markDirty(slot->strikeIndex);
+    }
+}
+
+/**
+ * Recomputes implied volatility and Greeks for the strikes whose quotes or
+ * underlying changed since the last call and sets the displayed ones in the table.
+ *
+ * Runs on the render thread at the start of every frame, so bursts of ticks
+ * between two frames cost one recomputation. Rows that were given other strikes
+ * since the last frame are repainted first. Option prices are bid/ask mids and
+ * the underlying futures price is getUnderlyingPrice.
+ */
+void OptionChainManager::updateGreeks() {
+
+    if (this->rowsMoved.exchange(false, memory_order_acquire)) repaintRows();
+
+    vector<size_t> strikeIndices = this->greeksEngine.takeDirty();
+    if (strikeIndices.empty()) return;
+
+    double forward = getUnderlyingPrice();
+    double timeToExpiry = difftime(this->expiryTime, time(nullptr)) / (DAYS_PER_YEAR * 24.0 * 60.0 * 60.0);
+
+    this->greeksEngine.setMarket(forward, timeToExpiry);
+
+    for (size_t strikeIndex : strikeIndices) {
+
+        double mids[2];
+
+        for (int side = 0; side < 2; side++) {
+            QuoteSnapshot quote = this->quotes[2 * strikeIndex + 1 + side].read();
+            mids[side] = quote.bid > 0.0 && quote.ask >= quote.bid ? (quote.bid + quote.ask) / 2.0 : NAN;
+        }
+        this->greeksEngine.setPrices(strikeIndex, mids[0], mids[1]);
+    }
+
+    this->greeksEngine.compute(strikeIndices);
+
+    for (size_t strikeIndex : strikeIndices) {
+
+        int rowIndex = this->quotes[2 * strikeIndex + 1].rowIndex.load(memory_order_relaxed);
+        if (rowIndex < 0) continue;
+
+        this->table.setCell(rowIndex, CALL_IV_COLUMN, this->greeksEngine.getCallVolatility(strikeIndex));
+        this->table.setCell(rowIndex, CALL_DELTA_COLUMN, this->greeksEngine.getCallDelta(strikeIndex));
+        this->table.setCell(rowIndex, CALL_THETA_COLUMN, this->greeksEngine.getCallTheta(strikeIndex));
+        this->table.setCell(rowIndex, PUT_IV_COLUMN, this->greeksEngine.getPutVolatility(strikeIndex));
+        this->table.setCell(rowIndex, PUT_DELTA_COLUMN, this->greeksEngine.getPutDelta(strikeIndex));
+        this->table.setCell(rowIndex, PUT_THETA_COLUMN, this->greeksEngine.getPutTheta(strikeIndex));
+        this->table.setCell(rowIndex, GAMMA_COLUMN, this->greeksEngine.getGamma(strikeIndex));
+        this->table.setCell(rowIndex, VEGA_COLUMN, this->greeksEngine.getVega(strikeIndex));
+    }
+}
+
+/**
+ * Converts a last trade date to the time the contract is taken to expire.
+ *
+ * @param lastTradeDate A date starting with YYYYMMDD.
+ * @return EXPIRY_HOUR_UTC on that date, or 0 if the date cannot be parsed.
+ */
+time_t OptionChainManager::parseExpiryTime(const string& lastTradeDate) {
+
+    struct tm expiry = {};
+
+    if (lastTradeDate.size() < 8 || sscanf(lastTradeDate.c_str(), "%4d%2d%2d", &expiry.tm_year, &expiry.tm_mon,
+                                           &expiry.tm_mday) != 3) {
+        return 0;
+    }
+
+    expiry.tm_year -= 1900;
+    expiry.tm_mon -= 1;
+    expiry.tm_hour = EXPIRY_HOUR_UTC;
+    return timegm(&expiry);
+}
+
+/**
+ * Sets the window of subscribed strikes and reports how it changed.
+ *
+ * If the chain is displayed, the call and put quote slots of the strikes that left the
+ * window lose their table row and those in the window are given the row they are shown
+ * in, so that tick handlers can draw a cell without looking the strike up in the table.
+ * The rows are then repainted from the quote slots and the Greeks of every strike
+ * recomputed on the next frame. A tick applied while its row changes may paint the row
+ * it had before; the repaint on the next frame overwrites it.
+ *
+ * @param start The index of the first strike of the window.
+ * @param size The number of strikes in the window.
+ * @param added Receives the contract keys of the options that entered the window.
+ * @param removed Receives the contract keys of the options that left the window.
+ */
+void OptionChainManager::setWindow(size_t start, size_t size, vector<ContractKey>& added, vector<ContractKey>& removed) {
+
+    StrikeWindow oldWindow = this->window.load(memory_order_acquire);
+    size_t oldStart = oldWindow.start;
+    size_t oldEnd = oldStart + oldWindow.size;
+
+    for (size_t strikeIndex = oldStart; strikeIndex < oldEnd; strikeIndex++) {
+        if (strikeIndex >= start && strikeIndex < start + size) continue;
+        removed.push_back(getOptionKey(strikeIndex, true));
+        removed.push_back(getOptionKey(strikeIndex, false));
+    }
+    for (size_t strikeIndex = start; strikeIndex < start + size; strikeIndex++) {
+        if (strikeIndex >= oldStart && strikeIndex < oldEnd) continue;
+        added.push_back(getOptionKey(strikeIndex, true));
+        added.push_back(getOptionKey(strikeIndex, false));
+    }
+
+    this->window.store(StrikeWindow{(uint32_t)start, (uint32_t)size}, memory_order_release);
+    if (this->quoteSegment != nullptr) this->quoteSegment->setWindow(start, size);
+
+    if (!this->isDisplayed) return;
+
+    for (size_t strikeIndex = oldStart; strikeIndex < oldEnd; strikeIndex++) {
+        this->quotes[2 * strikeIndex + 1].rowIndex.store(-1, memory_order_relaxed);
+        this->quotes[2 * strikeIndex + 2].rowIndex.store(-1, memory_order_relaxed);
+    }
+
+    int rowIndex = getFirstWindowRow(size);
+    this->table.activeStrikes.clear();
+
+    for (size_t strikeIndex = start; strikeIndex < start + size; strikeIndex++, rowIndex++) {
+        this->quotes[2 * strikeIndex + 1].rowIndex.store(rowIndex, memory_order_relaxed);
+        this->quotes[2 * strikeIndex + 2].rowIndex.store(rowIndex, memory_order_relaxed);
+        this->table.activeStrikes[this->strikesByIndex[strikeIndex]] = rowIndex;
+    }
+
+    this->greeksEngine.markAllDirty();
+    this->rowsMoved.store(true, memory_order_release);
+}
+
+/**
+ * Finds where a window of strikes centered on a strike starts, moving it up or down
+ * where the chain runs out of strikes on one side.
  *
- * @param pair The pair consisting of a strike price and an option type.
- * @return The Ticker ID associated with the specified pair.
+ * @param centerIndex The index of the strike to center the window on.
+ * @param size The number of strikes in the window, no more than the strikes of the chain.
+ * @return The index of the first strike of the window.
+ */
+size_t OptionChainManager::getWindowStartFor(size_t centerIndex, size_t size) {
+
+    size_t start = centerIndex >= size / 2 ? centerIndex - size / 2 : 0;
+    return min(start, this->strikesByIndex.size() - size);
+}
+
+/**
+ * @return the table row of the first strike of a window with the given number of strikes,
+ *         which is centered in the table if it has fewer strikes than the table has rows.
  */
-TickerId OptionChainManager::pairToTicker(pair<double, string> pair) {
-    return this->pairToTickerMap[pair];
+int OptionChainManager::getFirstWindowRow(size_t size) {
+    return FIRST_STRIKE_ROW + (STRIKE_ROWS - (int)min<size_t>(size, STRIKE_ROWS)) / 2;
+}
+
+/**
+ * Repaints every row of the table from the window of subscribed strikes: its strike and the
+ * cached bid, ask and last of its call and put. Rows outside the window are cleared. Runs on
+ * the render thread after the rows were given other strikes.
+ */
+void OptionChainManager::repaintRows() {
+
+    static const int callColumns[] = {CALL_BID_COLUMN, CALL_ASK_COLUMN, CALL_LAST_COLUMN};
+    static const int putColumns[] = {PUT_BID_COLUMN, PUT_ASK_COLUMN, PUT_LAST_COLUMN};
+
+    StrikeWindow window = this->window.load(memory_order_acquire);
+    size_t start = min<size_t>(window.start, this->strikesByIndex.size());
+    size_t size = min<size_t>({window.size, STRIKE_ROWS, this->strikesByIndex.size() - start});
+    int firstRow = getFirstWindowRow(size);
+
+    for (int rowIndex = FIRST_STRIKE_ROW; rowIndex < MAX_ROWS; rowIndex++) {
+        if (rowIndex < firstRow || rowIndex >= firstRow + (int)size) this->table.clearRow(rowIndex);
+    }
+
+    for (size_t i = 0; i < size; i++) {
+
+        int rowIndex = firstRow + i;
+        size_t strikeIndex = start + i;
+        QuoteSnapshot call = this->quotes[2 * strikeIndex + 1].read();
+        QuoteSnapshot put = this->quotes[2 * strikeIndex + 2].read();
+
+        this->table.setCell(rowIndex, STRIKE_COLUMN, this->strikesByIndex[strikeIndex]);
+        this->table.setCell(rowIndex, callColumns[QUOTE_BID], call.bid);
+        this->table.setCell(rowIndex, callColumns[QUOTE_ASK], call.ask);
+        this->table.setCell(rowIndex, callColumns[QUOTE_LAST], call.last);
+        this->table.setCell(rowIndex, putColumns[QUOTE_BID], put.bid);
+        this->table.setCell(rowIndex, putColumns[QUOTE_ASK], put.ask);
+        this->table.setCell(rowIndex, putColumns[QUOTE_LAST], put.last);
+    }
 }
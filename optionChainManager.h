@@ -8,47 +8,178 @@ December 6, 2024
 #ifndef OPTION_CHAIN_MANAGER_H
 #define OPTION_CHAIN_MANAGER_H
 
+#include <atomic>
 #include <map>
-#include <mutex>
 #include <set>
+#include <unordered_map>
+#include <vector>
 #include "Contract.h"
+#include "contractBootstrap.h"
+#include "contractCache.h"
+#include "contractKey.h"
+#include "ETickBatch.h"
+#include "greeksEngine.h"
+#include "logger.h"
+#include "quoteSegment.h"
 #include "table.h"
 
 using namespace std;
 
+#define CACHE_LINE_SIZE 64
+#define UNDERLYING_SLOT_INDEX 0
+#define EXPIRY_HOUR_UTC 21      // approximate settlement time on the expiry date
+#define DEFAULT_CHAIN_STRIKES STRIKE_ROWS     // strikes subscribed in a chain that is not displayed
+
+/**
+ * The bid, ask and last of one contract as they were at one moment.
+ */
+struct QuoteSnapshot {
+    double bid = 0.0;
+    double ask = 0.0;
+    double last = 0.0;
+};
+
+/**
+ * Hot per-contract quote state, indexed directly by the offset of a TickerId
+ * into the block of ticker IDs of its chain.
+ *
+ * Slot 0 holds the underlying, slots 1..N hold the options in the order
+ * they were assigned by createChain. Everything a tick handler needs
+ * (row, column side, strike for logging, index into the Greeks engine) is
+ * precomputed here so the tick path never touches the contract maps.
+ *
+ * The prices are guarded by a sequence lock. A writer makes the sequence odd,
+ * stores the prices and makes it even again; a reader retries until it saw the
+ * same even sequence before and after loading them. Readers never block the
+ * writer or each other, and only retry if they overlap a write.
+ */
+struct alignas(CACHE_LINE_SIZE) QuoteSlot {
+    atomic<uint32_t> sequence{0};   // odd while a write is in progress
+    atomic<double> bid{0.0};
+    atomic<double> ask{0.0};
+    atomic<double> last{0.0};
+    double strike = 0.0;
+    atomic<int> rowIndex{-1};   // table row, -1 if the strike is not displayed
+    int strikeIndex = -1;   // position of the strike in the chain, -1 for the underlying
+    bool isCall = false;
+
+    /**
+     * Starts a write, waiting for a write by another thread to finish. The ticks of a
+     * contract are applied by a single worker, so in practice this never waits.
+     */
+    void beginWrite() {
+        uint32_t current = this->sequence.load(memory_order_relaxed);
+        while ((current & 1) != 0
+               || !this->sequence.compare_exchange_weak(current, current + 1, memory_order_acquire, memory_order_relaxed)) {
+            current = this->sequence.load(memory_order_relaxed);
+        }
+        atomic_thread_fence(memory_order_release);
+    }
+
+    /**
+     * Publishes the prices stored since beginWrite.
+     */
+    void endWrite() {
+        this->sequence.fetch_add(1, memory_order_release);
+    }
+
+    /**
+     * @return the bid, ask and last as of one moment, without blocking the writer.
+     */
+    QuoteSnapshot read() const {
+
+        QuoteSnapshot snapshot;
+        uint32_t before;
+
+        do {
+            before = this->sequence.load(memory_order_acquire);
+            snapshot.bid = this->bid.load(memory_order_relaxed);
+            snapshot.ask = this->ask.load(memory_order_relaxed);
+            snapshot.last = this->last.load(memory_order_relaxed);
+            atomic_thread_fence(memory_order_acquire);
+        } while ((before & 1) != 0 || this->sequence.load(memory_order_relaxed) != before);
+
+        return snapshot;
+    }
+};
+
+/**
+ * The newest prices of one contract in a batch of ticks, see applyTicks.
+ */
+struct QuoteUpdate {
+    TickerId tickerId;
+    QuoteSlot* slot;
+    double prices[3] = {};      // indexed by QuoteField
+    unsigned int fields = 0;    // bit n set if prices[n] is part of the update
+    uint64_t received = 0;      // latency stamps of the update's first tick, 0 if it is not traced
+    uint64_t decoded = 0;
+    uint64_t applied = 0;
+};
+
 typedef struct {
-    double bid;         
-    double ask;         
-    double last;
-    mutex dataMutex;
     ContractDetails contractDetails;
     TickerId tickerId;
+    ContractKey key;
 } OptionData;
 
 class OptionChainManager {
 
 private:
 
-    int contractCount;
-    int initCallbackCount;
-    double underlyingBid;
-    double underlyingAsk;
-    double underlyingLast;
-    map<pair<double, string>, unique_ptr<OptionData>> optionChain;
-    map<TickerId, pair<double, string>> tickerToPairMap;
-    map<pair<double, string>, TickerId> pairToTickerMap;
+    vector<QuoteSlot> quotes;
+    TickerId firstTickerId = 0;     // ticker ID of slot 0
+    vector<OptionData> options;     // indexed by 2 * strike index, + 1 for the put; slot index - 1
+    unordered_map<ContractKey, uint32_t, ContractKeyHash> keyToOption;     // key to index into options
     set<double> strikes;
+    vector<double> strikesByIndex;
+    vector<uint32_t> strikeTicksByIndex;
+    double strikeTick = DEFAULT_STRIKE_TICK;
+    size_t chainStrikes = DEFAULT_CHAIN_STRIKES;
+    atomic<StrikeWindow> window{StrikeWindow{0, 0}};   // the subscribed strikes, read by the render thread
+    atomic<bool> rowsMoved{false};      // the table rows were given other strikes since the last frame
     Table table;
     ContractDetails underlyingContractDetails;
-    mutex underlyingMutex;
-    TickerId underlyingTickerId;
+    unique_ptr<ContractBootstrap> bootstrap;
+    unsigned int bootstrapWindow = BOOTSTRAP_WINDOW;
+    ContractCache* contractCache = nullptr;
+    string contractCachePath;
+    string contractDate;
+    GreeksEngine greeksEngine;
+    time_t expiryTime = 0;
+    string quoteSegmentPrefix;
+    unique_ptr<QuoteSegment> quoteSegment;
+
+    QuoteSlot* getQuoteSlot(TickerId tickerId);
+    void markGreeksDirty(QuoteSlot* slot);
+    void publishQuote(TickerId tickerId, QuoteSlot* slot, QuoteField field, double price);
+    void publishToSegment(QuoteSlot* slot, QuoteField field, double price);
+    void openQuoteSegment();
+    void updateGreeks();
+    time_t parseExpiryTime(const string& lastTradeDate);
+    void setWindow(size_t start, size_t size, vector<ContractKey>& added, vector<ContractKey>& removed);
+    size_t getWindowStartFor(size_t centerIndex, size_t size);
+    int getFirstWindowRow(size_t size);
+    void repaintRows();
+    void saveContractCache();
+    void setStrikeTick(const set<double>& strikes);
+    int findOptionIndex(ContractKey key);
     
 public:
 
     bool isInitialized = false;
+    bool isDisplayed = false;
 
-    void incrementInitCallbackCount();
-    void initializeChain(const set<double>& strikes);
+    void loadChain(const set<double>& strikes, int underlyingConId);
+    void initializeChain();
+    void createChain(const set<double>& strikes);
+    void loadPublishedChain(const set<double>& strikes, const string& lastTradeDate);
+    void contractDetailsEnd(int reqId);
+    void contractDetailsError(int reqId, int errorCode);
+    void setBootstrapWindow(unsigned int window);
+    void setChainStrikes(size_t strikeCount);
+    void setQuoteSegmentPrefix(const string& prefix);
+    void setContractCache(ContractCache* contractCache, const string& path);
+    bool loadCachedUnderlying();
     void setUnderlyingContractDetails(ContractDetails contractDetails);
     void setContractDetails(ContractDetails contractDetails);
     void setUnderlyingContract(string underlyingSymbol, string futFopExchange, string underlyingSecurityType,
@@ -56,16 +187,38 @@ public:
     void updateBid(TickerId tickerId, double bid);
     void updateAsk(TickerId tickerId, double ask);
     void updateLast(TickerId tickerId, double last);
+    void applyTicks(const ETick* ticks, size_t count);
     int getUnderlyingContractId();
+    TickerId getUnderlyingTickerId();
+    string getContractDate();
     double findClosestStrike(double underlyingPrice);
+    size_t findClosestStrikeIndex(double underlyingPrice);
+    double getUnderlyingPrice();
+    bool recenterWindow(size_t hysteresis, vector<ContractKey>& added, vector<ContractKey>& removed);
+    void resizeWindow(size_t size, vector<ContractKey>& added, vector<ContractKey>& removed);
+    void moveWindow(size_t start, size_t size);
+    StrikeWindow getWindow();
+    size_t getWindowStart();
+    size_t getWindowSize();
     double getBid(TickerId tickerId);
     double getAsk(TickerId tickerId);
     double getLast(TickerId tickerId);  
-    Contract getContract(double strike, string optionType);
+    QuoteSnapshot getQuote(TickerId tickerId);
+    bool waitForQuitKey(int timeoutMs);
+    void setFrameRate(int framesPerSecond);
+    void setRiskFreeRate(double rate);
+    bool findContractKey(double strike, const string& optionType, ContractKey& key);
+    ContractKey getOptionKey(size_t strikeIndex, bool isCall);
+    Contract getContract(ContractKey key);
     Contract getUnderlyingContract();
-    map<pair<double, string>, unique_ptr<OptionData>>& getOptionChain();
+    vector<OptionData>& getOptionChain();
+    const vector<double>& getStrikesByIndex();
+    size_t getQuoteCount();
     map<double, int> getActiveStrikes();
-    TickerId pairToTicker(pair<double, string> pair);
+    vector<double> getSubscribedStrikes();
+    vector<ContractKey> getSubscribedOptions();
+    TickerId getTickerId(ContractKey key);
+    bool getTickerContract(TickerId tickerId, int& conId, double& strike, char& right);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,331 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#include "quoteSegment.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "fixedName.h"
+
+using namespace std;
+
+/**
+ * @return an offset rounded up to the next multiple of QUOTE_SEGMENT_ALIGNMENT.
+ */
+static size_t alignOffset(size_t offset) {
+    return (offset + QUOTE_SEGMENT_ALIGNMENT - 1) / QUOTE_SEGMENT_ALIGNMENT * QUOTE_SEGMENT_ALIGNMENT;
+}
+
+//public methods
+
+/**
+ * Destroys the segment, removing it.
+ */
+QuoteSegment::~QuoteSegment() {
+    close();
+}
+
+/**
+ * Creates the segment of a chain, or lays out again a segment of the same name, and
+ * clears every quote. A segment left by an earlier run is taken over with its generation
+ * incremented, so that readers still mapping it start over.
+ *
+ * @param name The name of the segment, starting with a slash.
+ * @param symbol The underlying symbol.
+ * @param expiry The expiry the chain was requested for.
+ * @param strikes The strikes of the chain, in ascending order.
+ * @param strikeTick The price tick the strikes are interned with.
+ * @param expiryTime The option expiry, in UTC seconds.
+ * @return true if the segment is mapped.
+ */
+bool QuoteSegment::create(const string& name, const string& symbol, const string& expiry, const vector<double>& strikes,
+                          double strikeTick, time_t expiryTime) {
+
+    if (this->fd < 0 || name != this->name) {
+        close();
+        this->fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+        if (this->fd < 0) return false;
+        this->name = name;
+    }
+
+    size_t strikesOffset = sizeof(QuoteSegmentHeader);
+    size_t rowsOffset = alignOffset(strikesOffset + strikes.size() * sizeof(double));
+    size_t size = rowsOffset + strikes.size() * sizeof(QuoteSegmentRow);
+
+    struct stat segmentStat;
+    if (fstat(this->fd, &segmentStat) < 0) return false;
+    size = max(size, (size_t)segmentStat.st_size);
+
+    if (size != this->mappedSize) {
+        unmap();
+        if (ftruncate(this->fd, size) < 0) return false;
+
+        void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd, 0);
+        if (address == MAP_FAILED) return false;
+        this->header = (QuoteSegmentHeader*)address;
+        this->mappedSize = size;
+    }
+
+    QuoteSegmentHeader* header = this->header;
+    uint32_t generation = header->magic == QUOTE_SEGMENT_MAGIC ? header->generation.load(memory_order_relaxed) | 1u : 1u;
+    header->generation.store(generation, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    header->magic = QUOTE_SEGMENT_MAGIC;
+    header->version = QUOTE_SEGMENT_VERSION;
+    header->strikeCount = strikes.size();
+    header->segmentSize = size;
+    header->rowSize = sizeof(QuoteSegmentRow);
+    header->strikesOffset = strikesOffset;
+    header->rowsOffset = rowsOffset;
+    header->reserved = 0;
+    header->window.store(StrikeWindow{0, 0}, memory_order_relaxed);
+    header->expiryTime = expiryTime;
+    header->strikeTick = strikeTick;
+    copyName(header->symbol, symbol);
+    copyName(header->expiry, expiry);
+    memset((void*)&header->underlying, 0, sizeof(QuoteSegmentRow));
+
+    memcpy((char*)header + strikesOffset, strikes.data(), strikes.size() * sizeof(double));
+
+    this->rows = (QuoteSegmentRow*)((char*)header + rowsOffset);
+    memset((void*)this->rows, 0, strikes.size() * sizeof(QuoteSegmentRow));
+    for (size_t strikeIndex = 0; strikeIndex < strikes.size(); strikeIndex++) {
+        this->rows[strikeIndex].strikeIndex = strikeIndex;
+        this->rows[strikeIndex].strike = strikes[strikeIndex];
+    }
+
+    header->generation.store(generation + 1, memory_order_release);
+    return true;
+}
+
+/**
+ * Publishes prices of an option or of the underlying.
+ *
+ * @param strikeIndex The index of the option's strike, or -1 for the underlying.
+ * @param isCall true for a call, false for a put. Ignored for the underlying.
+ * @param prices The prices, indexed by bid, ask and last.
+ * @param fields Bit n set if prices[n] is to be published.
+ */
+void QuoteSegment::publish(int strikeIndex, bool isCall, const double prices[3], unsigned int fields) {
+
+    QuoteSegmentRow& row = strikeIndex < 0 ? this->header->underlying : this->rows[strikeIndex];
+    int side = strikeIndex < 0 || isCall ? QUOTE_SEGMENT_CALL : QUOTE_SEGMENT_PUT;
+
+    uint32_t current = row.sequence.load(memory_order_relaxed);
+    while ((current & 1) != 0
+           || !row.sequence.compare_exchange_weak(current, current + 1, memory_order_acquire, memory_order_relaxed)) {
+        current = row.sequence.load(memory_order_relaxed);
+    }
+    atomic_thread_fence(memory_order_release);
+
+    for (int field = 0; field < 3; field++) {
+        if (fields & (1u << field)) row.prices[side][field].store(prices[field], memory_order_relaxed);
+    }
+
+    row.sequence.fetch_add(1, memory_order_release);
+}
+
+/**
+ * Publishes the window of subscribed strikes.
+ *
+ * @param start The index of the first strike of the window.
+ * @param size The number of strikes in the window.
+ */
+void QuoteSegment::setWindow(size_t start, size_t size) {
+
+    this->header->window.store(StrikeWindow{(uint32_t)start, (uint32_t)size}, memory_order_release);
+}
+
+/**
+ * Leaves the generation odd, to tell readers the segment is no longer published, and
+ * removes the segment.
+ */
+void QuoteSegment::close() {
+
+    if (this->fd < 0) return;
+
+    if (this->header != nullptr) this->header->generation.fetch_or(1u, memory_order_release);
+    unmap();
+    ::close(this->fd);
+    this->fd = -1;
+    shm_unlink(this->name.c_str());
+}
+
+/**
+ * @return the name of the segment.
+ */
+const string& QuoteSegment::getName() {
+    return this->name;
+}
+
+//private methods
+
+/**
+ * Unmaps the segment.
+ */
+void QuoteSegment::unmap() {
+
+    if (this->header != nullptr) munmap(this->header, this->mappedSize);
+    this->header = nullptr;
+    this->rows = nullptr;
+    this->mappedSize = 0;
+}
+
+//public methods
+
+/**
+ * Destroys the reader, unmapping the segment.
+ */
+QuoteSegmentReader::~QuoteSegmentReader() {
+    close();
+}
+
+/**
+ * Maps the segment of a chain for reading.
+ *
+ * @param name The name of the segment, starting with a slash.
+ * @return false if there is no such segment or it is not a quote segment of this version.
+ */
+bool QuoteSegmentReader::open(const string& name) {
+
+    close();
+
+    this->fd = shm_open(name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+    if (this->fd < 0) return false;
+
+    if (!remap() || this->header->magic != QUOTE_SEGMENT_MAGIC || this->header->version != QUOTE_SEGMENT_VERSION) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Maps the segment again if it grew since it was mapped. Called after the generation changed.
+ *
+ * @return false if the segment could not be mapped.
+ */
+bool QuoteSegmentReader::remap() {
+
+    if (this->header != nullptr && this->header->segmentSize <= this->mappedSize) return true;
+
+    struct stat segmentStat;
+    if (fstat(this->fd, &segmentStat) < 0 || (size_t)segmentStat.st_size < sizeof(QuoteSegmentHeader)) return false;
+
+    if (this->header != nullptr) munmap((void*)this->header, this->mappedSize);
+    this->header = nullptr;
+    this->mappedSize = 0;
+
+    void* address = mmap(nullptr, segmentStat.st_size, PROT_READ, MAP_SHARED, this->fd, 0);
+    if (address == MAP_FAILED) return false;
+
+    this->header = (const QuoteSegmentHeader*)address;
+    this->mappedSize = segmentStat.st_size;
+    return true;
+}
+
+/**
+ * Unmaps the segment.
+ */
+void QuoteSegmentReader::close() {
+
+    if (this->header != nullptr) munmap((void*)this->header, this->mappedSize);
+    if (this->fd >= 0) ::close(this->fd);
+    this->header = nullptr;
+    this->mappedSize = 0;
+    this->fd = -1;
+}
+
+/**
+ * Returns the generation of the layout, to be compared with isLayoutCurrent after reading.
+ *
+ * @return The generation, odd if the layout is being changed or the segment is no longer published.
+ */
+uint32_t QuoteSegmentReader::getGeneration() {
+    return this->header->generation.load(memory_order_acquire);
+}
+
+/**
+ * @param generation A generation returned by getGeneration before reading.
+ * @return true if the layout did not change since, so that what was read is valid.
+ */
+bool QuoteSegmentReader::isLayoutCurrent(uint32_t generation) {
+
+    atomic_thread_fence(memory_order_acquire);
+    return (generation & 1) == 0 && this->header->generation.load(memory_order_relaxed) == generation;
+}
+
+/**
+ * @return the header of the segment, read in place.
+ */
+const QuoteSegmentHeader* QuoteSegmentReader::getHeader() {
+    return this->header;
+}
+
+/**
+ * @return the strikes of the chain, read in place, header->strikeCount of them.
+ */
+const double* QuoteSegmentReader::getStrikes() {
+    return (const double*)((const char*)this->header + this->header->strikesOffset);
+}
+
+/**
+ * Reads the quote of the underlying, in prices[QUOTE_SEGMENT_CALL].
+ *
+ * @param quote Receives the prices.
+ * @return false if the row was being written for QUOTE_SEGMENT_READ_ATTEMPTS reads.
+ */
+bool QuoteSegmentReader::readUnderlying(QuoteSegmentQuote& quote) {
+    return readRow(this->header->underlying, quote);
+}
+
+/**
+ * Reads the quotes of the call and the put of a strike.
+ *
+ * @param strikeIndex The index of the strike.
+ * @param quote Receives the prices.
+ * @return false if there is no such strike in the mapping, or the row was being written
+ *         for QUOTE_SEGMENT_READ_ATTEMPTS reads.
+ */
+bool QuoteSegmentReader::readStrike(size_t strikeIndex, QuoteSegmentQuote& quote) {
+
+    const QuoteSegmentHeader* header = this->header;
+    size_t offset = header->rowsOffset + strikeIndex * header->rowSize;
+    if (strikeIndex >= header->strikeCount || offset + sizeof(QuoteSegmentRow) > this->mappedSize) return false;
+
+    return readRow(*(const QuoteSegmentRow*)((const char*)header + offset), quote);
+}
+
+//private methods
+
+/**
+ * Copies the prices of a row as of one moment.
+ *
+ * @param row The row.
+ * @param quote Receives the prices.
+ * @return false if the row was being written for QUOTE_SEGMENT_READ_ATTEMPTS reads.
+ */
+bool QuoteSegmentReader::readRow(const QuoteSegmentRow& row, QuoteSegmentQuote& quote) {
+
+    for (int attempt = 0; attempt < QUOTE_SEGMENT_READ_ATTEMPTS; attempt++) {
+
+        uint32_t before = row.sequence.load(memory_order_acquire);
+        if ((before & 1) != 0) continue;
+
+        for (int side = 0; side < 2; side++) {
+            for (int field = 0; field < 3; field++) quote.prices[side][field] = row.prices[side][field].load(memory_order_relaxed);
+        }
+        atomic_thread_fence(memory_order_acquire);
+
+        if (row.sequence.load(memory_order_relaxed) == before) return true;
+    }
+    return false;
+}
@@ -0,0 +1,155 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#ifndef QUOTE_SEGMENT_H
+#define QUOTE_SEGMENT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*
+ * The layout of the POSIX shared memory segment a chain publishes its quotes in, named
+ * "/<prefix>.<symbol>.<expiry>", e.g. /optionchain.ES.20250321. Everything is in the byte
+ * order of the host, and every offset is from the start of the segment:
+ *
+ *   0                 QuoteSegmentHeader, with the underlying's quote row at offset 128
+ *   strikesOffset     strikeCount strikes as doubles, in ascending order
+ *   rowsOffset        strikeCount QuoteSegmentRow of 64 bytes, one per strike, in the same order
+ *
+ * Every row is guarded by its own sequence counter: the publisher makes it odd, stores
+ * the prices and makes it even again, and a reader keeps the prices it copied only if it
+ * saw the same even sequence before and after. Readers map the segment once and then read
+ * it without system calls, and never block the publisher.
+ *
+ * The strike grid and the offsets are the layout. The generation is odd while the layout
+ * changes and is incremented twice by every change; a reader that sees it change starts
+ * over, mapping the segment again if segmentSize grew (it never shrinks). It is left odd
+ * when the publisher exits and removes the segment.
+ */
+
+#define QUOTE_SEGMENT_MAGIC 0x5153434F      // "OCSQ"
+#define QUOTE_SEGMENT_VERSION 2
+#define QUOTE_SEGMENT_NAME_LENGTH 16
+#define QUOTE_SEGMENT_ALIGNMENT 64
+#define QUOTE_SEGMENT_CALL 0
+#define QUOTE_SEGMENT_PUT 1
+#define QUOTE_SEGMENT_READ_ATTEMPTS 1000    // a row still being written after this many reads is given up on
+
+/**
+ * A window of subscribed strikes. It is stored in one atomic word, so that a reader never
+ * sees the start of one window with the size of another.
+ */
+struct StrikeWindow {
+    uint32_t start;     // index of the first subscribed strike
+    uint32_t size;      // number of subscribed strikes
+};
+
+/**
+ * The bid, ask and last of the call and the put of one strike, or of the underlying in
+ * prices[QUOTE_SEGMENT_CALL].
+ */
+struct alignas(QUOTE_SEGMENT_ALIGNMENT) QuoteSegmentRow {
+    atomic<uint32_t> sequence;      // odd while the row is written
+    uint32_t strikeIndex;
+    double strike;
+    atomic<double> prices[2][3];    // [QUOTE_SEGMENT_CALL or QUOTE_SEGMENT_PUT][bid, ask, last]
+};
+
+struct alignas(QUOTE_SEGMENT_ALIGNMENT) QuoteSegmentHeader {
+    uint32_t magic;
+    uint32_t version;
+    atomic<uint32_t> generation;    // odd while the layout changes
+    uint32_t strikeCount;
+    uint64_t segmentSize;
+    uint32_t rowSize;
+    uint32_t strikesOffset;
+    uint32_t rowsOffset;
+    uint32_t reserved;
+    atomic<StrikeWindow> window;    // the subscribed strikes; rows outside keep their last prices
+    int64_t expiryTime;             // UTC seconds
+    double strikeTick;
+    char symbol[QUOTE_SEGMENT_NAME_LENGTH];
+    char expiry[QUOTE_SEGMENT_NAME_LENGTH];
+    QuoteSegmentRow underlying;
+};
+
+static_assert(sizeof(QuoteSegmentRow) == QUOTE_SEGMENT_ALIGNMENT, "a quote segment row is one cache line");
+static_assert(offsetof(QuoteSegmentHeader, underlying) == 128, "the underlying row is at offset 128");
+static_assert(atomic<uint32_t>::is_always_lock_free && atomic<double>::is_always_lock_free
+              && atomic<StrikeWindow>::is_always_lock_free,
+              "quote segment atomics must be lock free to be shared between processes");
+
+/**
+ * The prices of one row as of one moment.
+ */
+struct QuoteSegmentQuote {
+    double prices[2][3];
+};
+
+/**
+ * Publishes the quotes of a chain in a shared memory segment. Any thread may publish a
+ * row; two threads publishing the same row take turns.
+ */
+class QuoteSegment {
+
+private:
+
+    int fd = -1;
+    string name;
+    QuoteSegmentHeader* header = nullptr;
+    QuoteSegmentRow* rows = nullptr;
+    size_t mappedSize = 0;
+
+    void unmap();
+
+public:
+
+    ~QuoteSegment();
+
+    bool create(const string& name, const string& symbol, const string& expiry, const vector<double>& strikes,
+                double strikeTick, time_t expiryTime);
+    void publish(int strikeIndex, bool isCall, const double prices[3], unsigned int fields);
+    void setWindow(size_t start, size_t size);
+    void close();
+    const string& getName();
+};
+
+/**
+ * Reads the quotes a chain publishes in a shared memory segment, from another process.
+ */
+class QuoteSegmentReader {
+
+private:
+
+    int fd = -1;
+    const QuoteSegmentHeader* header = nullptr;
+    size_t mappedSize = 0;
+
+    bool readRow(const QuoteSegmentRow& row, QuoteSegmentQuote& quote);
+
+public:
+
+    ~QuoteSegmentReader();
+
+    bool open(const string& name);
+    bool remap();
+    void close();
+    uint32_t getGeneration();
+    bool isLayoutCurrent(uint32_t generation);
+    const QuoteSegmentHeader* getHeader();
+    const double* getStrikes();
+    bool readUnderlying(QuoteSegmentQuote& quote);
+    bool readStrike(size_t strikeIndex, QuoteSegmentQuote& quote);
+};
+
+#endif
@@ -0,0 +1,103 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+/*
+Prints the quotes a running instance publishes in a shared memory segment.
+
+Usage: segmentdump /optionchain.ES.20250321 [-a]
+
+Maps the segment, reads the underlying and the strikes in the window of subscribed
+strikes (every strike with -a) and prints one line per strike. The read is started
+over if the layout changes while it is made.
+*/
+
+#include "quoteSegment.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+#define DUMP_ATTEMPTS 100
+
+/**
+ * The prices of one strike as they were read.
+ */
+struct DumpRow {
+    double strike;
+    QuoteSegmentQuote quote;
+};
+
+/**
+ * Reads the underlying and a range of strikes, starting over while the layout changes.
+ *
+ * @return false if no consistent read was made within DUMP_ATTEMPTS.
+ */
+static bool readChain(QuoteSegmentReader& reader, bool allStrikes, QuoteSegmentQuote& underlying, vector<DumpRow>& rows) {
+
+    for (int attempt = 0; attempt < DUMP_ATTEMPTS; attempt++) {
+
+        uint32_t generation = reader.getGeneration();
+        if ((generation & 1) != 0 || !reader.remap()) continue;
+
+        const QuoteSegmentHeader* header = reader.getHeader();
+        const double* strikes = reader.getStrikes();
+        StrikeWindow window = header->window.load(memory_order_acquire);
+        size_t start = allStrikes ? 0 : window.start;
+        size_t end = allStrikes ? header->strikeCount : min<size_t>(window.start + window.size, header->strikeCount);
+        bool isRead = reader.readUnderlying(underlying);
+
+        rows.clear();
+        for (size_t strikeIndex = start; strikeIndex < end && isRead; strikeIndex++) {
+            DumpRow row;
+            row.strike = strikes[strikeIndex];
+            isRead = reader.readStrike(strikeIndex, row.quote);
+            rows.push_back(row);
+        }
+
+        if (isRead && reader.isLayoutCurrent(generation)) return true;
+    }
+    return false;
+}
+
+int main(int argc, char* argv[]) {
+
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s /<prefix>.<symbol>.<expiry> [-a]\n", argv[0]);
+        return 1;
+    }
+
+    QuoteSegmentReader reader;
+    if (!reader.open(argv[1])) {
+        fprintf(stderr, "Cannot open quote segment %s\n", argv[1]);
+        return 1;
+    }
+
+    QuoteSegmentQuote underlying;
+    vector<DumpRow> rows;
+    if (!readChain(reader, argc > 2 && strcmp(argv[2], "-a") == 0, underlying, rows)) {
+        fprintf(stderr, "Quote segment %s is not being published\n", argv[1]);
+        return 1;
+    }
+
+    const QuoteSegmentHeader* header = reader.getHeader();
+    printf("%.*s %.*s, %u strikes, generation %u, underlying bid %.2f ask %.2f last %.2f\n",
+           QUOTE_SEGMENT_NAME_LENGTH, header->symbol, QUOTE_SEGMENT_NAME_LENGTH, header->expiry, header->strikeCount,
+           reader.getGeneration(), underlying.prices[QUOTE_SEGMENT_CALL][0], underlying.prices[QUOTE_SEGMENT_CALL][1],
+           underlying.prices[QUOTE_SEGMENT_CALL][2]);
+    printf("%10s %10s %10s %10s | %10s %10s %10s\n", "Strike", "Call Bid", "Call Ask", "Call Last", "Put Bid", "Put Ask", "Put Last");
+
+    for (const DumpRow& row : rows) {
+        const double (*prices)[3] = row.quote.prices;
+        printf("%10.2f %10.2f %10.2f %10.2f | %10.2f %10.2f %10.2f\n", row.strike,
+               prices[QUOTE_SEGMENT_CALL][0], prices[QUOTE_SEGMENT_CALL][1], prices[QUOTE_SEGMENT_CALL][2],
+               prices[QUOTE_SEGMENT_PUT][0], prices[QUOTE_SEGMENT_PUT][1], prices[QUOTE_SEGMENT_PUT][2]);
+    }
+
+    return 0;
+}
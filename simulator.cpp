@@ -0,0 +1,766 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+/*
+Local TWS protocol simulator for load testing the client without a gateway.
+
+Usage: simulator [-p port] [-n strikes] [-w strikeStep] [-u underlyingPrice]
+                 [-r ticksPerSecond] [-v volatility]
+
+Speaks enough of the v100+ framed protocol for the client's startup and
+market data: the handshake, startApi, reqContractDetails, reqSecDefOptParams,
+reqMarketDataType, reqMktData and cancelMktData. Every connection gets a
+futures contract with a chain of options around it, and once market data is
+requested a synthetic quote stream is sent for the subscribed contracts at the
+configured rate. Option quotes are Black-76 prices of a random walk of the
+underlying. Throughput and how far the stream fell behind its schedule are
+printed once per second.
+*/
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <random>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "EClient.h"
+#include "EDecoder.h"
+#include "EWrapper.h"
+#include "greeksEngine.h"
+
+using namespace std;
+using namespace ibapi::client_constants;
+
+#define SIM_DEFAULT_PORT 7497
+#define SIM_DEFAULT_STRIKES 200
+#define SIM_DEFAULT_STRIKE_STEP 5.0
+#define SIM_DEFAULT_UNDERLYING_PRICE 5800.0
+#define SIM_DEFAULT_TICKS_PER_SECOND 100000
+#define SIM_DEFAULT_VOLATILITY 0.15
+#define SIM_EXPIRY_HOUR_UTC 21              // options and futures expire at the close, 4 pm Eastern
+#define SIM_MIN_DAYS_TO_EXPIRY 7            // the default expiry is the first quarterly one at least this far out
+#define SIM_BATCH_INTERVAL_US 1000
+#define SIM_MAX_CATCH_UP_BATCHES 50         // ticks owed beyond this many batches are dropped from the schedule
+#define SIM_UNDERLYING_CON_ID 500000
+#define SIM_OPTION_CON_ID_BASE 1000000
+#define SIM_UNDERLYING_TICK 0.25
+#define SIM_OPTION_TICK 0.05
+#define SIM_MULTIPLIER "50"
+#define SIM_NO_SECURITY_DEFINITION 200
+#define SIM_MAX_MESSAGE_SIZE (1024 * 1024)
+
+struct SimulatorConfig {
+    int port = SIM_DEFAULT_PORT;
+    int strikeCount = SIM_DEFAULT_STRIKES;
+    double strikeStep = SIM_DEFAULT_STRIKE_STEP;
+    double underlyingPrice = SIM_DEFAULT_UNDERLYING_PRICE;
+    long ticksPerSecond = SIM_DEFAULT_TICKS_PER_SECOND;
+    double volatility = SIM_DEFAULT_VOLATILITY;
+};
+
+/**
+ * Appends the fields of one framed message to a buffer.
+ */
+class MessageBuilder {
+
+private:
+
+    string& buffer;
+    size_t start;
+
+public:
+
+    MessageBuilder(string& buffer) : buffer(buffer), start(buffer.size()) {
+        this->buffer.append(4, '\0');
+    }
+
+    ~MessageBuilder() {
+        uint32_t length = htonl(this->buffer.size() - this->start - 4);
+        memcpy(&this->buffer[this->start], &length, sizeof(length));
+    }
+
+    MessageBuilder& add(const string& field) {
+        this->buffer.append(field);
+        this->buffer.push_back('\0');
+        return *this;
+    }
+
+    MessageBuilder& add(const char* field) { return add(string(field)); }
+    MessageBuilder& add(int field) { return add(to_string(field)); }
+    MessageBuilder& add(long field) { return add(to_string(field)); }
+
+    MessageBuilder& add(double field) {
+        char text[32];
+        snprintf(text, sizeof(text), "%.10g", field);
+        return add(string(text));
+    }
+
+    MessageBuilder& addPrice(double field) {
+        char text[32];
+        snprintf(text, sizeof(text), "%.2f", field);
+        return add(string(text));
+    }
+};
+
+/**
+ * Parses a YYYYMMDD expiry into the time it expires, at SIM_EXPIRY_HOUR_UTC.
+ *
+ * @return false if the expiry is not a date.
+ */
+static bool parseExpiry(const string& expiry, time_t& expiresAt) {
+
+    struct tm expiryTime = {};
+    if (sscanf(expiry.c_str(), "%4d%2d%2d", &expiryTime.tm_year, &expiryTime.tm_mon, &expiryTime.tm_mday) != 3) return false;
+
+    expiryTime.tm_year -= 1900;
+    expiryTime.tm_mon -= 1;
+    expiryTime.tm_hour = SIM_EXPIRY_HOUR_UTC;
+    expiresAt = timegm(&expiryTime);
+    return true;
+}
+
+/**
+ * @return the expiry quoted until a client requests a future: the third Friday of the first
+ *         quarterly month (March, June, September, December) at least SIM_MIN_DAYS_TO_EXPIRY
+ *         days from now, as YYYYMMDD.
+ */
+static string getDefaultExpiry() {
+
+    time_t earliest = time(nullptr) + SIM_MIN_DAYS_TO_EXPIRY * 86400;
+    struct tm today;
+    gmtime_r(&earliest, &today);
+
+    for (int month = today.tm_mon - today.tm_mon % 3 + 2; ; month += 3) {
+
+        struct tm expiryTime = {};
+        expiryTime.tm_year = today.tm_year + month / 12;
+        expiryTime.tm_mon = month % 12;
+        expiryTime.tm_mday = 1;
+        expiryTime.tm_hour = SIM_EXPIRY_HOUR_UTC;
+        timegm(&expiryTime);        //fills in the weekday of the 1st
+        expiryTime.tm_mday = 1 + (5 - expiryTime.tm_wday + 7) % 7 + 14;
+
+        time_t expiresAt = timegm(&expiryTime);
+        if (expiresAt < earliest) continue;
+
+        char text[16];
+        strftime(text, sizeof(text), "%Y%m%d", &expiryTime);
+        return text;
+    }
+}
+
+/**
+ * One client connection: answers its requests and streams quotes for its
+ * market data subscriptions.
+ *
+ * Instrument 0 is the futures contract; instrument 1 + 2 * i is the call and
+ * 2 + 2 * i the put of strike i.
+ */
+class SimulatorSession {
+
+private:
+
+    int fd;
+    const SimulatorConfig& config;
+    int serverVersion = 0;
+    string expiry;                          // of the last future requested; used by the request thread only
+    vector<double> strikes;
+    atomic<bool> isAlive{true};
+    mutex sendMutex;
+    mutex subscriptionMutex;
+    map<long, int> tickerToInstrument;
+    vector<pair<long, int>> subscriptions;
+    atomic<int> marketDataType{1};
+    mutex marketMutex;                      // guards the market state below, shared by both threads
+    double forward;
+    double timeToExpiry = 0.0;
+    time_t expiresAt = 0;                   // when the last future requested expires
+    atomic<unsigned long long> ticksSent{0};
+    atomic<unsigned long long> ticksDropped{0};
+    atomic<unsigned long long> bytesSent{0};
+
+    bool handshake();
+    bool readMessage(vector<string>& fields);
+    bool readFully(char* buffer, size_t size);
+    bool sendAll(const string& data);
+    void handleRequest(const vector<string>& fields);
+    void sendContractDetails(string& out, int reqId, int instrument, const string& symbol, const string& expiry);
+    void sendError(int id, int errorCode, const string& message);
+    void setExpiry(const string& expiry);
+    void appendQuote(string& out, long tickerId, int instrument, int field);
+    double theoreticalPrice(int instrument);
+    int findInstrument(const string& secType, double strike, const string& right);
+    void generateLoop(mt19937_64& random);
+
+public:
+
+    SimulatorSession(int fd, const SimulatorConfig& config);
+    ~SimulatorSession();
+
+    void run();
+};
+
+//public methods
+
+/**
+ * Constructs a session for an accepted connection.
+ *
+ * @param fd The connected socket, owned by the session.
+ * @param config The simulator configuration.
+ */
+SimulatorSession::SimulatorSession(int fd, const SimulatorConfig& config) : fd(fd), config(config) {
+
+    double first = round(config.underlyingPrice / config.strikeStep) * config.strikeStep
+                   - (config.strikeCount / 2) * config.strikeStep;
+
+    for (int i = 0; i < config.strikeCount; i++) this->strikes.push_back(first + i * config.strikeStep);
+    this->forward = config.underlyingPrice;
+    setExpiry(getDefaultExpiry());
+}
+
+/**
+ * Closes the connection.
+ */
+SimulatorSession::~SimulatorSession() {
+    close(this->fd);
+}
+
+/**
+ * Runs the session until the client disconnects.
+ *
+ * The calling thread answers requests while a second thread streams quotes.
+ */
+void SimulatorSession::run() {
+
+    if (!handshake()) return;
+
+    mt19937_64 random(this->fd);
+    thread generator(&SimulatorSession::generateLoop, this, ref(random));
+    vector<string> fields;
+
+    while (this->isAlive && readMessage(fields)) handleRequest(fields);
+
+    this->isAlive = false;
+    generator.join();
+    fprintf(stderr, "[client %d] disconnected after %llu ticks\n", this->fd, this->ticksSent.load());
+}
+
+//private methods
+
+/**
+ * Reads the client's "API" prefix and version range and answers with the
+ * server version and connection time.
+ *
+ * @return false if the client did not send a valid v100+ handshake.
+ */
+bool SimulatorSession::handshake() {
+
+    char prefix[4];
+    vector<string> fields;
+
+    if (!readFully(prefix, sizeof(prefix)) || memcmp(prefix, "API", 4) != 0) return false;
+    if (!readMessage(fields) || fields.empty() || fields[0].compare(0, 1, "v") != 0) return false;
+
+    //"v<min>..<max>", optionally followed by connect options
+    size_t range = fields[0].find("..");
+    int clientMax = range == string::npos ? atoi(fields[0].c_str() + 1) : atoi(fields[0].c_str() + range + 2);
+    this->serverVersion = min(clientMax, MAX_CLIENT_VER);
+
+    char connectionTime[64];
+    time_t now = time(nullptr);
+    strftime(connectionTime, sizeof(connectionTime), "%Y%m%d %H:%M:%S UTC", gmtime(&now));
+
+    string out;
+    MessageBuilder(out).add(this->serverVersion).add(connectionTime);
+
+    fprintf(stderr, "[client %d] connected, server version %d\n", this->fd, this->serverVersion);
+    return sendAll(out);
+}
+
+/**
+ * Reads one framed message and splits it into its fields.
+ *
+ * @param fields Receives the fields.
+ * @return false if the connection closed or the frame is invalid.
+ */
+bool SimulatorSession::readMessage(vector<string>& fields) {
+
+    uint32_t length;
+    if (!readFully((char*)&length, sizeof(length))) return false;
+
+    length = ntohl(length);
+    if (length == 0 || length > SIM_MAX_MESSAGE_SIZE) return false;
+
+    string body(length, '\0');
+    if (!readFully(&body[0], length)) return false;
+
+    fields.clear();
+    size_t start = 0;
+    for (size_t end = body.find('\0'); end != string::npos; end = body.find('\0', start)) {
+        fields.push_back(body.substr(start, end - start));
+        start = end + 1;
+    }
+    if (start < body.size()) fields.push_back(body.substr(start));
+    return true;
+}
+
+/**
+ * Reads exactly size bytes from the connection.
+ *
+ * @return false if the connection closed first.
+ */
+bool SimulatorSession::readFully(char* buffer, size_t size) {
+
+    size_t received = 0;
+
+    while (received < size) {
+        ssize_t result = recv(this->fd, buffer + received, size - received, 0);
+        if (result < 0 && errno == EINTR) continue;
+        if (result <= 0) return false;
+        received += result;
+    }
+    return true;
+}
+
+/**
+ * Writes a buffer of messages to the connection. Callable from both threads.
+ *
+ * @return false if the connection failed.
+ */
+bool SimulatorSession::sendAll(const string& data) {
+
+    lock_guard<mutex> lock(this->sendMutex);
+    size_t written = 0;
+
+    while (written < data.size()) {
+        ssize_t result = send(this->fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+        if (result < 0 && errno == EINTR) continue;
+        if (result <= 0) {
+            this->isAlive = false;
+            return false;
+        }
+        written += result;
+    }
+
+    this->bytesSent += data.size();
+    return true;
+}
+
+/**
+ * Answers one client request. Requests the simulator does not know are ignored.
+ *
+ * @param fields The fields of the request, starting with its message ID.
+ */
+void SimulatorSession::handleRequest(const vector<string>& fields) {
+
+    if (fields.empty()) return;
+
+    int messageId = atoi(fields[0].c_str());
+    string out;
+
+    switch (messageId) {
+
+    case START_API: {
+        MessageBuilder(out).add(NEXT_VALID_ID).add(1).add(1);
+        MessageBuilder(out).add(MANAGED_ACCTS).add(1).add("DU0000000");
+        sendAll(out);
+        break;
+    }
+
+    case REQ_CONTRACT_DATA: {
+        //id, version, reqId, conId, symbol, secType, lastTradeDateOrContractMonth, strike, right, ...
+        if (fields.size() < 9) return;
+
+        int reqId = atoi(fields[2].c_str());
+        const string& secType = fields[5];
+        int instrument = findInstrument(secType, atof(fields[7].c_str()), fields[8]);
+
+        if (secType == "FUT" && !fields[6].empty()) setExpiry(fields[6]);
+
+        if (instrument < 0) {
+            sendError(reqId, SIM_NO_SECURITY_DEFINITION, "No security definition has been found for the request");
+            return;
+        }
+
+        sendContractDetails(out, reqId, instrument, fields[4], fields[6].empty() ? this->expiry : fields[6]);
+        MessageBuilder(out).add(CONTRACT_DATA_END).add(1).add(reqId);
+        sendAll(out);
+        break;
+    }
+
+    case REQ_SEC_DEF_OPT_PARAMS: {
+        //id, reqId, underlyingSymbol, futFopExchange, underlyingSecType, underlyingConId
+        if (fields.size() < 6) return;
+
+        int reqId = atoi(fields[1].c_str());
+        {
+            MessageBuilder message(out);
+            message.add(SECURITY_DEFINITION_OPTION_PARAMETER).add(reqId).add(fields[3]).add(SIM_UNDERLYING_CON_ID)
+                   .add(fields[2]).add(SIM_MULTIPLIER).add(1).add(this->expiry).add((int)this->strikes.size());
+            for (double strike : this->strikes) message.add(strike);
+        }
+        MessageBuilder(out).add(SECURITY_DEFINITION_OPTION_PARAMETER_END).add(reqId);
+        sendAll(out);
+        break;
+    }
+
+    case REQ_MARKET_DATA_TYPE: {
+        //id, version, marketDataType
+        if (fields.size() >= 3) this->marketDataType = atoi(fields[2].c_str());
+        break;
+    }
+
+    case REQ_MKT_DATA: {
+        //id, version, tickerId, conId, symbol, secType, lastTradeDateOrContractMonth, strike, right, ...
+        if (fields.size() < 9) return;
+
+        long tickerId = atol(fields[2].c_str());
+        int instrument = findInstrument(fields[5], atof(fields[7].c_str()), fields[8]);
+
+        if (instrument < 0) {
+            sendError(tickerId, SIM_NO_SECURITY_DEFINITION, "No security definition has been found for the request");
+            return;
+        }
+
+        {
+            lock_guard<mutex> lock(this->subscriptionMutex);
+            if (this->tickerToInstrument.emplace(tickerId, instrument).second) {
+                this->subscriptions.push_back(make_pair(tickerId, instrument));
+            }
+        }
+
+        //an initial snapshot, so the client has a full quote before the stream reaches the contract
+        if (this->marketDataType != 1) MessageBuilder(out).add(MARKET_DATA_TYPE).add(1).add(tickerId).add(this->marketDataType.load());
+        for (int field = 0; field < 3; field++) appendQuote(out, tickerId, instrument, field);
+        sendAll(out);
+        break;
+    }
+
+    case CANCEL_MKT_DATA: {
+        //id, version, tickerId
+        if (fields.size() < 3) return;
+
+        long tickerId = atol(fields[2].c_str());
+        lock_guard<mutex> lock(this->subscriptionMutex);
+
+        if (this->tickerToInstrument.erase(tickerId) > 0) {
+            this->subscriptions.erase(remove_if(this->subscriptions.begin(), this->subscriptions.end(),
+                                                [tickerId](const pair<long, int>& s) { return s.first == tickerId; }),
+                                      this->subscriptions.end());
+        }
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
+/**
+ * Appends a contract data message for an instrument, with the fields that the
+ * negotiated server version carries, in the order EDecoder reads them.
+ *
+ * @param out The buffer to append to.
+ * @param reqId The request ID to answer.
+ * @param instrument The instrument.
+ * @param symbol The symbol of the requested contract, which is also its trading class.
+ * @param expiry The expiry of the requested contract.
+ */
+void SimulatorSession::sendContractDetails(string& out, int reqId, int instrument, const string& symbol, const string& expiry) {
+
+    bool isFuture = instrument == 0;
+    int strikeIndex = (instrument - 1) / 2;
+    string right = isFuture ? "" : (instrument % 2 == 1 ? "C" : "P");
+    double strike = isFuture ? 0.0 : this->strikes[strikeIndex];
+    int conId = isFuture ? SIM_UNDERLYING_CON_ID : SIM_OPTION_CON_ID_BASE + instrument;
+    string localSymbol = isFuture ? symbol + expiry.substr(0, 6)
+                                  : symbol + " " + right + to_string((long)strike);
+    int sv = this->serverVersion;
+
+    MessageBuilder message(out);
+    message.add(CONTRACT_DATA);
+    if (sv < MIN_SERVER_VER_SIZE_RULES) message.add(8);
+    message.add(reqId).add(symbol).add(isFuture ? "FUT" : "FOP").add(expiry);
+    if (sv >= MIN_SERVER_VER_LAST_TRADE_DATE) message.add(expiry);
+    message.add(strike).add(right).add("CME").add("USD").add(localSymbol).add(symbol).add(symbol)
+           .add(conId).add(isFuture ? SIM_UNDERLYING_TICK : SIM_OPTION_TICK);
+    if (sv >= MIN_SERVER_VER_MD_SIZE_MULTIPLIER && sv < MIN_SERVER_VER_SIZE_RULES) message.add(1);
+    message.add(SIM_MULTIPLIER).add("LMT,MKT").add("CME").add(1)
+           .add(isFuture ? 0 : SIM_UNDERLYING_CON_ID)
+           .add("Simulated " + symbol).add("")
+           .add(expiry.substr(0, 6)).add("").add("").add("").add("US/Central").add("").add("")
+           .add("").add(0.0)
+           .add(0);
+    if (sv >= MIN_SERVER_VER_AGG_GROUP) message.add(0);
+    if (sv >= MIN_SERVER_VER_UNDERLYING_INFO) message.add(isFuture ? "" : symbol).add(isFuture ? "" : "FUT");
+    if (sv >= MIN_SERVER_VER_MARKET_RULES) message.add("");
+    if (sv >= MIN_SERVER_VER_REAL_EXPIRATION_DATE) message.add(expiry);
+    if (sv >= MIN_SERVER_VER_STOCK_TYPE) message.add("");
+    if (sv >= MIN_SERVER_VER_FRACTIONAL_SIZE_SUPPORT && sv < MIN_SERVER_VER_SIZE_RULES) message.add(1);
+    if (sv >= MIN_SERVER_VER_SIZE_RULES) message.add(1).add(1).add(1);
+    if (sv >= MIN_SERVER_VER_INELIGIBILITY_REASONS) message.add(0);
+}
+
+/**
+ * Sends an error message.
+ *
+ * @param id The request or ticker ID the error is for.
+ * @param errorCode The TWS error code.
+ * @param message The error text.
+ */
+void SimulatorSession::sendError(int id, int errorCode, const string& message) {
+
+    string out;
+    {
+        MessageBuilder error(out);
+        error.add(ERR_MSG).add(2).add(id).add(errorCode).add(message);
+        if (this->serverVersion >= MIN_SERVER_VER_ADVANCED_ORDER_REJECT) error.add("");
+    }
+    sendAll(out);
+}
+
+/**
+ * Sets the expiry of the future, which the quotes' time to expiry is taken from. An
+ * expiry that is not a date is still sent back in replies, but the time to expiry
+ * keeps following the previous one.
+ *
+ * @param expiry The expiry as YYYYMMDD.
+ */
+void SimulatorSession::setExpiry(const string& expiry) {
+
+    this->expiry = expiry;
+
+    time_t expiresAt;
+    if (!parseExpiry(expiry, expiresAt)) return;
+
+    lock_guard<mutex> lock(this->marketMutex);
+    this->expiresAt = expiresAt;
+}
+
+/**
+ * Appends a price tick for a subscription at the instrument's current quote.
+ *
+ * @param out The buffer to append to.
+ * @param tickerId The ticker ID of the subscription.
+ * @param instrument The instrument.
+ * @param field 0 for the bid, 1 for the ask, 2 for the last price.
+ */
+void SimulatorSession::appendQuote(string& out, long tickerId, int instrument, int field) {
+
+    static const int liveTickTypes[] = {BID, ASK, LAST};
+    static const int delayedTickTypes[] = {DELAYED_BID, DELAYED_ASK, DELAYED_LAST};
+
+    double tick = instrument == 0 ? SIM_UNDERLYING_TICK : SIM_OPTION_TICK;
+    double price = theoreticalPrice(instrument);
+    double halfSpread = instrument == 0 ? tick / 2 : max(tick, 0.01 * price) / 2;
+    double value;
+
+    if (field == 0) value = max(tick, floor((price - halfSpread) / tick) * tick);
+    else if (field == 1) value = max(2 * tick, ceil((price + halfSpread) / tick) * tick);
+    else value = max(tick, round(price / tick) * tick);
+
+    int tickType = this->marketDataType == 1 ? liveTickTypes[field] : delayedTickTypes[field];
+    MessageBuilder(out).add(TICK_PRICE).add(6).add(tickerId).add(tickType).addPrice(value).add(1).add(0);
+}
+
+/**
+ * @return the model price of an instrument at the current underlying price.
+ */
+double SimulatorSession::theoreticalPrice(int instrument) {
+
+    double forward, timeToExpiry;
+    {
+        lock_guard<mutex> lock(this->marketMutex);
+        forward = this->forward;
+        timeToExpiry = this->timeToExpiry;
+    }
+
+    if (instrument == 0) return forward;
+
+    double strike = this->strikes[(instrument - 1) / 2];
+    double moneyness = log(strike / forward);
+    double volatility = this->config.volatility + 2.0 * moneyness * moneyness - 0.1 * moneyness;
+
+    return black76Price(forward, strike, timeToExpiry, GREEKS_RISK_FREE_RATE, volatility, instrument % 2 == 1);
+}
+
+/**
+ * Finds the instrument a contract in a request refers to.
+ *
+ * @return The instrument, or -1 if the simulator does not list the contract.
+ */
+int SimulatorSession::findInstrument(const string& secType, double strike, const string& right) {
+
+    if (secType == "FUT") return 0;
+    if (secType != "FOP" || (right != "C" && right != "P") || this->strikes.empty()) return -1;
+
+    long strikeIndex = lround((strike - this->strikes.front()) / this->config.strikeStep);
+    if (strikeIndex < 0 || strikeIndex >= (long)this->strikes.size()) return -1;
+    if (fabs(this->strikes[strikeIndex] - strike) > 1e-6) return -1;
+
+    return 1 + 2 * strikeIndex + (right == "P" ? 1 : 0);
+}
+
+/**
+ * Body of the quote stream thread.
+ *
+ * Every SIM_BATCH_INTERVAL_US the underlying takes a random walk step and the
+ * ticks owed by the configured rate are sent in one write, each for a random
+ * subscription. When the client cannot keep up the writes block; ticks owed
+ * beyond SIM_MAX_CATCH_UP_BATCHES are dropped from the schedule and counted.
+ *
+ * @param random The random number generator of the session.
+ */
+void SimulatorSession::generateLoop(mt19937_64& random) {
+
+    normal_distribution<double> step(0.0, 1.0);
+    uniform_int_distribution<int> fieldChoice(0, 19);
+    string out;
+    double batchSeconds = SIM_BATCH_INTERVAL_US / 1e6;
+    double ticksOwed = 0.0;
+    chrono::steady_clock::time_point nextBatch = chrono::steady_clock::now();
+    chrono::steady_clock::time_point nextReport = nextBatch + chrono::seconds(1);
+    unsigned long long reportedTicks = 0;
+    unsigned long long reportedBytes = 0;
+
+    while (this->isAlive) {
+
+        this_thread::sleep_until(nextBatch);
+        nextBatch += chrono::microseconds(SIM_BATCH_INTERVAL_US);
+
+        double forward;
+        {
+            lock_guard<mutex> lock(this->marketMutex);
+            double secondsLeft = difftime(this->expiresAt, time(nullptr));
+            this->timeToExpiry = secondsLeft > 0 ? secondsLeft / (DAYS_PER_YEAR * 86400.0) : 30.0 / DAYS_PER_YEAR;
+            this->forward *= exp(this->config.volatility * sqrt(batchSeconds / (DAYS_PER_YEAR * 86400.0 / 8.0)) * step(random));
+            forward = this->forward;
+        }
+
+        ticksOwed += this->config.ticksPerSecond * batchSeconds;
+        double maxOwed = this->config.ticksPerSecond * batchSeconds * SIM_MAX_CATCH_UP_BATCHES;
+        if (ticksOwed > maxOwed) {
+            this->ticksDropped += (unsigned long long)(ticksOwed - maxOwed);
+            ticksOwed = maxOwed;
+        }
+
+        out.clear();
+        size_t subscriptionCount;
+        {
+            lock_guard<mutex> lock(this->subscriptionMutex);
+            subscriptionCount = this->subscriptions.size();
+
+            if (this->subscriptions.empty()) {
+                ticksOwed = 0.0;
+            } else {
+                uniform_int_distribution<size_t> subscriptionChoice(0, this->subscriptions.size() - 1);
+
+                for (; ticksOwed >= 1.0; ticksOwed -= 1.0) {
+                    const pair<long, int>& subscription = this->subscriptions[subscriptionChoice(random)];
+                    int choice = fieldChoice(random);
+                    appendQuote(out, subscription.first, subscription.second, choice < 9 ? 0 : choice < 18 ? 1 : 2);
+                    this->ticksSent++;
+                }
+            }
+        }
+
+        if (!out.empty() && !sendAll(out)) break;
+
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        if (now >= nextReport) {
+            fprintf(stderr, "[client %d] %llu ticks/s, %.1f MB/s, %zu subscriptions, %llu ticks dropped, underlying %.2f\n",
+                    this->fd, this->ticksSent - reportedTicks, (this->bytesSent - reportedBytes) / 1e6,
+                    subscriptionCount, this->ticksDropped.load(), forward);
+            reportedTicks = this->ticksSent;
+            reportedBytes = this->bytesSent;
+            nextReport += chrono::seconds(1);
+        }
+
+        //a stalled client pushes the schedule back instead of building up an unbounded burst
+        if (nextBatch < now - chrono::microseconds(SIM_BATCH_INTERVAL_US * SIM_MAX_CATCH_UP_BATCHES)) nextBatch = now;
+    }
+}
+
+/**
+ * Prints the usage of the simulator.
+ */
+static void printUsage(const char* program) {
+    fprintf(stderr, "Usage: %s [-p port] [-n strikes] [-w strikeStep] [-u underlyingPrice] [-r ticksPerSecond] "
+                    "[-v volatility]\n", program);
+}
+
+int main(int argc, char** argv) {
+
+    SimulatorConfig config;
+    int option;
+
+    while ((option = getopt(argc, argv, "p:n:w:u:r:v:h")) != -1) {
+        switch (option) {
+        case 'p': config.port = atoi(optarg); break;
+        case 'n': config.strikeCount = max(1, atoi(optarg)); break;
+        case 'w': config.strikeStep = atof(optarg); break;
+        case 'u': config.underlyingPrice = atof(optarg); break;
+        case 'r': config.ticksPerSecond = max(0L, atol(optarg)); break;
+        case 'v': config.volatility = atof(optarg); break;
+        default:
+            printUsage(argv[0]);
+            return option == 'h' ? 0 : 1;
+        }
+    }
+
+    if (config.strikeStep <= 0 || config.underlyingPrice <= config.strikeStep * (config.strikeCount / 2)) {
+        fprintf(stderr, "Every strike must be positive: raise the underlying price or lower the strike count or step\n");
+        return 1;
+    }
+
+    int listenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int enable = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(config.port);
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    if (bind(listenFd, (sockaddr*)&address, sizeof(address)) < 0 || listen(listenFd, 8) < 0) {
+        perror("simulator");
+        return 1;
+    }
+
+    fprintf(stderr, "Simulating TWS on port %d: %d strikes every %g around %g, %ld ticks/s\n", config.port,
+            config.strikeCount, config.strikeStep, config.underlyingPrice, config.ticksPerSecond);
+
+    while (true) {
+
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            perror("simulator");
+            return 1;
+        }
+
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+        thread([fd, &config]() {
+            SimulatorSession session(fd, config);
+            session.run();
+        }).detach();
+    }
+}
@@ -0,0 +1,342 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#include "startupSequence.h"
+#include "globals.h"
+
+using namespace std;
+
+//public methods
+
+/**
+ * Constructs a StartupSequence.
+ */
+StartupSequence::StartupSequence() :
+    startedAt(chrono::steady_clock::now())
+{}
+
+/**
+ * Starts the clock the startup is timed with. Called when the connection to TWS is made,
+ * or the replay started, so that the time the user took to enter the chains is not counted.
+ */
+void StartupSequence::begin() {
+    this->startedAt = chrono::steady_clock::now();
+}
+
+/**
+ * Runs the startup sequence until every chain of the chain registry is streaming or has
+ * failed, processing incoming messages in between.
+ *
+ * Waits up to STARTUP_SERVER_READY_TIMEOUT_MS for nextValidId unless a recording is
+ * replayed. A chain whose requests go unanswered after STARTUP_MAX_ATTEMPTS, or that TWS
+ * has no contract for, fails and is left out; one whose underlying is not quoted within
+ * STARTUP_QUOTE_TIMEOUT_MS of loading centers its window on its middle strike instead.
+ *
+ * @return true if the displayed chain is streaming.
+ */
+bool StartupSequence::run() {
+
+    this->chains.clear();
+    for (OptionChainManager* chain : chainRegistry.getChains()) {
+        ChainStartup startup;
+        startup.chain = chain;
+        this->chains.push_back(startup);
+    }
+
+    if (my_wrapper.isReplaying()) this->state = STARTUP_SERVER_READY;
+    this->deadline = chrono::steady_clock::now() + chrono::milliseconds(STARTUP_SERVER_READY_TIMEOUT_MS);
+
+    while (this->state == STARTUP_CONNECTING) {
+
+        if (chrono::steady_clock::now() >= this->deadline) {
+            string toLog = "Startup failed: no nextValidId from TWS within " + to_string(STARTUP_SERVER_READY_TIMEOUT_MS) + " ms\n";
+            logger.log(LOG_ERROR, toLog);
+            return false;
+        }
+        my_wrapper.processMessages();
+    }
+
+    while (true) {
+
+        bool isDone = true;
+
+        for (ChainStartup& startup : this->chains) {
+
+            StartupState before;
+            do {
+                before = startup.state;
+                advance(startup);
+            } while (startup.state != before);
+
+            if (startup.state != STARTUP_STREAMING && startup.state != STARTUP_FAILED) isDone = false;
+        }
+
+        if (isDone || this->chains.empty()) break;
+        my_wrapper.processMessages();
+    }
+
+    size_t streamingCount = 0;
+    for (const ChainStartup& startup : this->chains) {
+        if (startup.state == STARTUP_STREAMING) streamingCount++;
+    }
+
+    string toLog = "Startup finished after " + to_string(getElapsedMs()) + " ms: " + to_string(streamingCount) + " of "
+                   + to_string(this->chains.size()) + " chains streaming\n";
+    logger.log(streamingCount == this->chains.size() ? LOG_INFO : LOG_WARNING, toLog);
+
+    return !this->chains.empty() && this->chains.front().state == STARTUP_STREAMING;
+}
+
+/**
+ * Marks the connection ready. Called when TWS sends nextValidId, which it does once the
+ * API has started.
+ */
+void StartupSequence::nextValidId() {
+
+    if (this->state != STARTUP_CONNECTING) return;
+
+    this->state = STARTUP_SERVER_READY;
+
+    string toLog = "Startup: " + string(getStateName(this->state)) + " after " + to_string(getElapsedMs()) + " ms\n";
+    logger.log(LOG_INFO, toLog);
+}
+
+/**
+ * Resolves the underlying of the chain that requested its contract details, once they
+ * were all received. A chain that received no details for its underlying fails.
+ *
+ * @param reqId The request ID passed to the contractDetailsEnd callback.
+ */
+void StartupSequence::underlyingDetailsEnd(int reqId) {
+
+    ChainStartup* startup = findChain(reqId);
+    if (startup == nullptr || startup->state != STARTUP_SERVER_READY) return;
+
+    if (startup->chain->getUnderlyingContractId() == 0) {
+        string toLog = startup->chain->getUnderlyingContract().symbol + " " + startup->chain->getContractDate()
+                       + " startup: TWS returned no contract for the underlying\n";
+        logger.log(LOG_ERROR, toLog);
+        enter(*startup, STARTUP_FAILED);
+        return;
+    }
+    enter(*startup, STARTUP_UNDERLYING_RESOLVED);
+}
+
+/**
+ * Resolves the option chain of the chain that requested it. Only the first list of strikes
+ * received for the request is used.
+ *
+ * @param reqId The request ID passed to the securityDefinitionOptionalParameter callback.
+ * @param strikes The strikes of the option chain.
+ * @param underlyingConId The contract ID of the underlying the strikes are listed for.
+ * @return true if the strikes were used.
+ */
+bool StartupSequence::optionChainReceived(int reqId, const set<double>& strikes, int underlyingConId) {
+
+    ChainStartup* startup = findChain(reqId);
+    if (startup == nullptr || startup->state != STARTUP_UNDERLYING_RESOLVED || strikes.empty()) return false;
+
+    startup->strikes = strikes;
+    startup->underlyingConId = underlyingConId;
+    enter(*startup, STARTUP_CHAIN_RESOLVED);
+    return true;
+}
+
+/**
+ * Handles an error for a request of the startup sequence. The chain fails if TWS has no
+ * such contract; otherwise the request is sent again on the next step.
+ *
+ * @param reqId The ID passed to the error callback.
+ * @param errorCode The TWS error code.
+ */
+void StartupSequence::requestError(int reqId, int errorCode) {
+
+    ChainStartup* startup = findChain(reqId);
+    if (startup == nullptr) return;
+
+    if (errorCode == NO_SECURITY_DEFINITION_ERROR) {
+        enter(*startup, STARTUP_FAILED);
+    } else {
+        startup->deadline = chrono::steady_clock::now();
+    }
+}
+
+/**
+ * Logs the time to the first quote when the first option quote is received. Safe to
+ * call from any thread.
+ *
+ * @param tickerId The ticker ID of a quote.
+ */
+void StartupSequence::quoteReceived(TickerId tickerId) {
+
+    OptionChainManager* chain = chainRegistry.findTickerChain(tickerId);
+    if (chain == nullptr || tickerId == chain->getUnderlyingTickerId()) return;
+    if (this->firstQuoteSeen.exchange(true, memory_order_relaxed)) return;
+
+    string toLog = "Time to first quote: " + to_string(getElapsedMs()) + " ms\n";
+    logger.log(LOG_INFO, toLog);
+}
+
+/**
+ * @return the name of a startup state as it is logged.
+ */
+const char* StartupSequence::getStateName(StartupState state) {
+
+    switch (state) {
+        case STARTUP_CONNECTING: return "Connecting";
+        case STARTUP_SERVER_READY: return "ServerReady";
+        case STARTUP_UNDERLYING_RESOLVED: return "UnderlyingResolved";
+        case STARTUP_CHAIN_RESOLVED: return "ChainResolved";
+        case STARTUP_DETAILS_LOADED: return "DetailsLoaded";
+        case STARTUP_STREAMING: return "Streaming";
+        case STARTUP_FAILED: return "Failed";
+    }
+    return "Unknown";
+}
+
+//private methods
+
+/**
+ * Finds the chain that waits on a request.
+ *
+ * @param reqId The request ID.
+ * @return The chain's startup, or nullptr if no chain waits on the request.
+ */
+ChainStartup* StartupSequence::findChain(int reqId) {
+
+    for (ChainStartup& startup : this->chains) {
+        if (startup.pendingReqId == reqId && reqId >= 0) return &startup;
+    }
+    return nullptr;
+}
+
+/**
+ * Takes the next step of a chain: sends the request its state waits on, or sends it again
+ * once its deadline passed, loads its option details once it is its turn, and starts it
+ * streaming once its underlying is quoted.
+ *
+ * @param startup The chain's startup.
+ */
+void StartupSequence::advance(ChainStartup& startup) {
+
+    OptionChainManager* chain = startup.chain;
+
+    switch (startup.state) {
+
+        case STARTUP_SERVER_READY:
+            if (startup.pendingReqId < 0 && chain->loadCachedUnderlying()) {
+                string toLog = "Underlying contract details for " + chain->getUnderlyingContract().symbol + " "
+                               + chain->getContractDate() + " loaded from the contract cache\n";
+                logger.log(LOG_INFO, toLog);
+                enter(startup, STARTUP_UNDERLYING_RESOLVED);
+            } else if (retry(startup)) {
+                startup.pendingReqId = my_wrapper.requestContractDetails(chain->getUnderlyingContract());
+                chainRegistry.routeRequest(startup.pendingReqId, chain);
+            }
+            break;
+
+        case STARTUP_UNDERLYING_RESOLVED:
+            if (retry(startup)) startup.pendingReqId = my_wrapper.requestOptionChain(chain);
+            break;
+
+        case STARTUP_CHAIN_RESOLVED:
+            if (isTurnToLoad(startup)) {
+                chain->loadChain(startup.strikes, startup.underlyingConId);
+                enter(startup, STARTUP_DETAILS_LOADED);
+                startup.deadline = chrono::steady_clock::now() + chrono::milliseconds(STARTUP_QUOTE_TIMEOUT_MS);
+            }
+            break;
+
+        case STARTUP_DETAILS_LOADED:
+            if (chain->getUnderlyingPrice() > 0.0) {
+                chain->initializeChain();
+                enter(startup, STARTUP_STREAMING);
+            } else if (!my_wrapper.isReplaying() && chrono::steady_clock::now() >= startup.deadline) {
+                string toLog = chain->getUnderlyingContract().symbol + " " + chain->getContractDate() + " startup: no underlying "
+                               "price within " + to_string(STARTUP_QUOTE_TIMEOUT_MS) + " ms, centering on the middle strike\n";
+                logger.log(LOG_WARNING, toLog);
+                chain->initializeChain();
+                enter(startup, STARTUP_STREAMING);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**
+ * @return true if every chain added before a chain has loaded its option details or failed,
+ *         so that chains are given their ticker IDs in the order they were added.
+ */
+bool StartupSequence::isTurnToLoad(const ChainStartup& startup) {
+
+    for (const ChainStartup& earlier : this->chains) {
+        if (&earlier == &startup) return true;
+        if (earlier.state < STARTUP_DETAILS_LOADED) return false;
+    }
+    return true;
+}
+
+/**
+ * Decides whether the request a chain's state waits on is to be sent now: if it was not
+ * sent yet, or its deadline passed and it has attempts left. A chain out of attempts fails.
+ * A replay sends the request once and waits for its recorded reply.
+ *
+ * @param startup The chain's startup.
+ * @return true if the request is to be sent.
+ */
+bool StartupSequence::retry(ChainStartup& startup) {
+
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+
+    if (startup.pendingReqId >= 0) {
+
+        if (my_wrapper.isReplaying() || now < startup.deadline) return false;
+
+        if (startup.attempts >= STARTUP_MAX_ATTEMPTS) {
+            string toLog = startup.chain->getUnderlyingContract().symbol + " " + startup.chain->getContractDate()
+                           + " startup: no reply in " + getStateName(startup.state) + " after "
+                           + to_string(startup.attempts) + " attempts\n";
+            logger.log(LOG_ERROR, toLog);
+            enter(startup, STARTUP_FAILED);
+            return false;
+        }
+
+        string toLog = "ReqID: " + to_string(startup.pendingReqId) + " - No reply within "
+                       + to_string(STARTUP_REQUEST_TIMEOUT_MS) + " ms, sending again\n";
+        logger.log(LOG_WARNING, toLog);
+    }
+
+    startup.attempts++;
+    startup.deadline = now + chrono::milliseconds(STARTUP_REQUEST_TIMEOUT_MS);
+    return true;
+}
+
+/**
+ * Moves a chain to a state and logs the time since the startup began.
+ *
+ * @param startup The chain's startup.
+ * @param state The new state.
+ */
+void StartupSequence::enter(ChainStartup& startup, StartupState state) {
+
+    startup.state = state;
+    startup.pendingReqId = -1;
+    startup.attempts = 0;
+
+    string toLog = startup.chain->getUnderlyingContract().symbol + " " + startup.chain->getContractDate() + " startup: "
+                   + getStateName(state) + " after " + to_string(getElapsedMs()) + " ms\n";
+    logger.log(state == STARTUP_FAILED ? LOG_ERROR : LOG_INFO, toLog);
+}
+
+/**
+ * @return the milliseconds since the startup began.
+ */
+long long StartupSequence::getElapsedMs() {
+    return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - this->startedAt).count();
+}
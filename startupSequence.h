@@ -0,0 +1,105 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#ifndef STARTUP_SEQUENCE_H
+#define STARTUP_SEQUENCE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+#include "CommonDefs.h"
+#include "optionChainManager.h"
+
+using namespace std;
+
+#define STARTUP_SERVER_READY_TIMEOUT_MS 10000     // for nextValidId after connecting
+#define STARTUP_REQUEST_TIMEOUT_MS 5000           // for the underlying details and the option chain
+#define STARTUP_MAX_ATTEMPTS 3
+#define STARTUP_QUOTE_TIMEOUT_MS 10000            // for the first underlying price of a loaded chain
+
+enum StartupState : uint8_t {
+    STARTUP_CONNECTING,
+    STARTUP_SERVER_READY,           // nextValidId received
+    STARTUP_UNDERLYING_RESOLVED,    // underlying contract details known
+    STARTUP_CHAIN_RESOLVED,         // strikes of the option chain received
+    STARTUP_DETAILS_LOADED,         // contract details of every option known
+    STARTUP_STREAMING,              // strike window centered on the underlying price
+    STARTUP_FAILED
+};
+
+/**
+ * Where one chain is in the startup sequence.
+ */
+struct ChainStartup {
+    OptionChainManager* chain = nullptr;
+    StartupState state = STARTUP_SERVER_READY;
+    int pendingReqId = -1;      // the request the chain waits on, -1 if none was sent for its state
+    int attempts = 0;
+    chrono::steady_clock::time_point deadline;
+    set<double> strikes;
+    int underlyingConId = 0;
+};
+
+/**
+ * Brings the connection and every chain of the chain registry from connecting to
+ * streaming, driven by the callbacks of the requests it sends.
+ *
+ * The connection is ready once TWS sends nextValidId. Each chain then resolves its
+ * underlying contract, unless it is cached, and its option chain; these requests are
+ * sent for every chain at once, and are sent again if they are not answered before
+ * their deadline. Chains then load the contract details of their options one at a
+ * time, in the order they were added, so they are given the same ticker IDs every
+ * time, and start streaming once their underlying is quoted. Callbacks move a chain
+ * to the state their reply leads to; the requests and the loading that follow are
+ * done by run, on the thread that starts up, never from inside a callback. When a 
+ * recording is replayed nothing is sent and there are no deadlines. Every state change
+ * is logged with the time since the startup began, as is the time until the first
+ * option quote.
+ */
+class StartupSequence {
+
+private:
+
+    vector<ChainStartup> chains;
+    StartupState state = STARTUP_CONNECTING;
+    chrono::steady_clock::time_point startedAt;
+    chrono::steady_clock::time_point deadline;
+    atomic<bool> firstQuoteSeen{false};
+
+    ChainStartup* findChain(int reqId);
+    void advance(ChainStartup& startup);
+    bool isTurnToLoad(const ChainStartup& startup);
+    bool retry(ChainStartup& startup);
+    void enter(ChainStartup& startup, StartupState state);
+    long long getElapsedMs();
+
+public:
+
+    StartupSequence();
+
+    void begin();
+    bool run();
+    void nextValidId();
+    void underlyingDetailsEnd(int reqId);
+    bool optionChainReceived(int reqId, const set<double>& strikes, int underlyingConId);
+    void requestError(int reqId, int errorCode);
+    void quoteReceived(TickerId tickerId);
+
+    /**
+     * @return true once the first option quote was received.
+     */
+    bool hasFirstQuote() const {
+        return this->firstQuoteSeen.load(memory_order_relaxed);
+    }
+
+    static const char* getStateName(StartupState state);
+};
+
+#endif
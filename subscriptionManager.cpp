@@ -0,0 +1,267 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#include "subscriptionManager.h"
+#include "globals.h"
+#include <algorithm>
+
+using namespace std;
+
+//public methods
+
+/**
+ * Constructs a SubscriptionManager.
+ *
+ * @param subscribe Requests market data for a contract under a ticker ID.
+ * @param unsubscribe Cancels the market data of a ticker ID.
+ */
+SubscriptionManager::SubscriptionManager(function<void(TickerId, const Contract&)> subscribe, function<void(TickerId)> unsubscribe) :
+    subscribe(subscribe),
+    unsubscribe(unsubscribe)
+{}
+
+/**
+ * Sets how many market data lines the chains may use together, underlyings included.
+ * TWS accounts come with 100 lines unless more are bought.
+ *
+ * @param lineBudget The number of lines, 0 for no limit.
+ */
+void SubscriptionManager::setLineBudget(size_t lineBudget) {
+    this->lineBudget = lineBudget;
+}
+
+/**
+ * Sets how many strikes the strike closest to the underlying price must be from the
+ * center of a window before the window is moved.
+ *
+ * @param hysteresis The number of strikes, 0 for a quarter of the window.
+ */
+void SubscriptionManager::setHysteresis(size_t hysteresis) {
+    this->hysteresis = hysteresis;
+}
+
+/**
+ * Requests market data for the window of strikes of every initialized chain.
+ *
+ * The underlyings were subscribed when their chains were initialized. If there is a line
+ * budget, a line is kept for each underlying and the windows are then cut down to fit the
+ * lines left, in the order the chains were added, so the displayed chain is served first.
+ * The requests are paced like any other: the first burst is sent now and the rest on the
+ * following updates.
+ */
+void SubscriptionManager::subscribeAll() {
+
+    vector<OptionChainManager*> chains;
+    for (OptionChainManager* chain : chainRegistry.getChains()) {
+        if (chain->isInitialized) chains.push_back(chain);
+    }
+
+    this->linesInUse = chains.size();
+    size_t linesLeft = this->lineBudget > this->linesInUse ? this->lineBudget - this->linesInUse : 0;
+
+    for (OptionChainManager* chain : chains) {
+
+        if (this->lineBudget > 0 && 2 * chain->getWindowSize() > linesLeft) {
+
+            vector<ContractKey> added, removed;
+            chain->resizeWindow(linesLeft / 2, added, removed);
+
+            string toLog = chain->getUnderlyingContract().symbol + " " + chain->getContractDate() + " window cut to "
+                           + to_string(chain->getWindowSize()) + " strikes to fit " + to_string(this->lineBudget)
+                           + " market data lines\n";
+            logger.log(LOG_WARNING, toLog);
+        }
+
+        queueRequests(chain, chain->getSubscribedOptions());
+        linesLeft -= min(linesLeft, 2 * chain->getWindowSize());
+    }
+
+    size_t linesRequested = this->linesInUse + this->pendingRequests.size();
+    this->tokens = SUBSCRIPTION_MESSAGE_BURST;
+    this->lastRefill = chrono::steady_clock::now();
+    sendPending();
+
+    string toLog = "Market data lines in use: " + to_string(linesRequested)
+                   + (this->lineBudget > 0 ? " of " + to_string(this->lineBudget) : string()) + "\n";
+    logger.log(LOG_INFO, toLog);
+}
+
+/**
+ * Moves the window of each chain whose underlying moved far enough from its center,
+ * queues cancels and requests for the options that left and entered it, and sends as
+ * many queued messages as the TWS rate allows.
+ *
+ * Called periodically on the thread that sends requests.
+ */
+void SubscriptionManager::update() {
+
+    for (OptionChainManager* chain : chainRegistry.getChains()) {
+
+        if (!chain->isInitialized) continue;
+
+        vector<ContractKey> added, removed;
+        if (!chain->recenterWindow(this->hysteresis, added, removed)) continue;
+
+        queueCancels(chain, removed);
+        queueRequests(chain, added);
+        this->windowMoves++;
+
+        vector<double> strikes = chain->getSubscribedStrikes();
+        if (strikes.empty()) continue;
+
+        string toLog = chain->getUnderlyingContract().symbol + " " + chain->getContractDate() + " window moved to strikes "
+                       + to_string(strikes.front()) + "-" + to_string(strikes.back()) + ": "
+                       + to_string(removed.size()) + " options to cancel, " + to_string(added.size()) + " to request\n";
+        logger.log(LOG_INFO, toLog);
+    }
+
+    sendPending();
+}
+
+/**
+ * Cancels the market data of the underlying and the window of strikes of every
+ * initialized chain.
+ *
+ * Queued requests are dropped and queued cancels are sent along with the rest, without
+ * pacing, since the connection is closed right after.
+ */
+void SubscriptionManager::cancelAll() {
+
+    for (TickerId tickerId : this->pendingCancels) {
+        this->unsubscribe(tickerId);
+        this->linesInUse--;
+    }
+    this->pendingCancels.clear();
+
+    for (OptionChainManager* chain : chainRegistry.getChains()) {
+
+        if (!chain->isInitialized) continue;
+
+        this->unsubscribe(chain->getUnderlyingTickerId());
+        this->linesInUse--;
+
+        for (ContractKey key : chain->getSubscribedOptions()) {
+
+            TickerId tickerId = chain->getTickerId(key);
+            bool isPending = false;
+            for (const PendingRequest& request : this->pendingRequests) {
+                if (request.tickerId == tickerId) {
+                    isPending = true;
+                    break;
+                }
+            }
+
+            if (isPending) continue;
+            this->unsubscribe(tickerId);
+            this->linesInUse--;
+        }
+    }
+    this->pendingRequests.clear();
+
+    string toLog = "Cancelled all market data requests after " + to_string(this->windowMoves) + " window moves\n";
+    logger.log(LOG_INFO, toLog);
+}
+
+/**
+ * @return the number of market data lines subscribed, underlyings included.
+ */
+size_t SubscriptionManager::getLinesInUse() {
+    return this->linesInUse;
+}
+
+/**
+ * @return the number of times a window was moved since the windows were subscribed.
+ */
+size_t SubscriptionManager::getWindowMoves() {
+    return this->windowMoves;
+}
+
+//private methods
+
+/**
+ * Queues market data requests for options of a chain. An option whose cancel is still
+ * queued is subscribed already, so its cancel is dropped instead.
+ *
+ * @param chain The chain.
+ * @param keys The contract keys of the options.
+ */
+void SubscriptionManager::queueRequests(OptionChainManager* chain, const vector<ContractKey>& keys) {
+
+    for (ContractKey key : keys) {
+
+        TickerId tickerId = chain->getTickerId(key);
+        auto cancel = find(this->pendingCancels.begin(), this->pendingCancels.end(), tickerId);
+
+        if (cancel != this->pendingCancels.end()) {
+            this->pendingCancels.erase(cancel);
+            continue;
+        }
+
+        this->pendingRequests.push_back({chain, key, tickerId});
+    }
+}
+
+/**
+ * Queues cancels of the market data of options of a chain. An option whose request is
+ * still queued was never subscribed, so its request is dropped instead.
+ *
+ * @param chain The chain.
+ * @param keys The contract keys of the options.
+ */
+void SubscriptionManager::queueCancels(OptionChainManager* chain, const vector<ContractKey>& keys) {
+
+    for (ContractKey key : keys) {
+
+        TickerId tickerId = chain->getTickerId(key);
+        auto request = find_if(this->pendingRequests.begin(), this->pendingRequests.end(),
+                               [tickerId](const PendingRequest& pending) { return pending.tickerId == tickerId; });
+
+        if (request != this->pendingRequests.end()) {
+            this->pendingRequests.erase(request);
+            continue;
+        }
+
+        this->pendingCancels.push_back(tickerId);
+    }
+}
+
+/**
+ * Sends queued messages while the token bucket has tokens, cancels first. No request is
+ * sent while a cancel is queued, so the lines in use never go over the budget.
+ */
+void SubscriptionManager::sendPending() {
+
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    double elapsed = chrono::duration<double>(now - this->lastRefill).count();
+    this->tokens = min<double>(SUBSCRIPTION_MESSAGE_BURST, this->tokens + elapsed * SUBSCRIPTION_MESSAGES_PER_SECOND);
+    this->lastRefill = now;
+
+    while (this->tokens >= 1.0 && !this->pendingCancels.empty()) {
+
+        this->unsubscribe(this->pendingCancels.front());
+        this->pendingCancels.pop_front();
+        this->linesInUse--;
+        this->tokens -= 1.0;
+    }
+
+    if (!this->pendingCancels.empty()) return;
+
+    while (this->tokens >= 1.0 && !this->pendingRequests.empty()) {
+
+        PendingRequest request = this->pendingRequests.front();
+        this->pendingRequests.pop_front();
+        Contract contract = request.chain->getContract(request.key);
+
+        this->subscribe(request.tickerId, contract);
+        this->linesInUse++;
+        this->tokens -= 1.0;
+
+        string toLog = "ReqID: " + to_string(request.tickerId) + " - Requesting market data for "
+                       + to_string(contract.conId) + "\n";
+        logger.log(LOG_INFO, toLog);
+    }
+}
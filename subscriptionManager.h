@@ -0,0 +1,81 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#ifndef SUBSCRIPTION_MANAGER_H
+#define SUBSCRIPTION_MANAGER_H
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <vector>
+#include "Contract.h"
+#include "optionChainManager.h"
+
+using namespace std;
+
+#define RECENTER_INTERVAL_MS 250                // how often the windows are checked against the underlying
+#define SUBSCRIPTION_MESSAGES_PER_SECOND 40     // TWS allows 50 messages per second
+#define SUBSCRIPTION_MESSAGE_BURST 10           // messages sent at once after a pause, one update's worth
+
+/**
+ * A market data request waiting for its turn to be sent.
+ */
+struct PendingRequest {
+    OptionChainManager* chain;
+    ContractKey key;
+    TickerId tickerId;
+};
+
+/**
+ * Keeps the market data subscriptions of every chain in the chain registry on the
+ * strikes around its underlying price.
+ *
+ * Each chain subscribes to a window of consecutive strikes. When the underlying moves
+ * far enough from the center of a window, the window is moved and only the difference
+ * is sent: the strikes that left it are cancelled before the strikes that entered it
+ * are requested, so the number of market data lines in use never goes over the budget.
+ *
+ * Cancels and requests are queued and sent at most as fast as the TWS message rate
+ * allows, paced by a token bucket that holds SUBSCRIPTION_MESSAGE_BURST messages and
+ * fills at SUBSCRIPTION_MESSAGES_PER_SECOND. What does not fit is carried over to later
+ * updates, every queued cancel going out before any queued request. An option that
+ * leaves a window before its request was sent is dropped from the queue rather than
+ * cancelled, and one that comes back before its cancel was sent keeps its line.
+ */
+class SubscriptionManager {
+
+private:
+
+    function<void(TickerId, const Contract&)> subscribe;
+    function<void(TickerId)> unsubscribe;
+    size_t lineBudget = 0;
+    size_t hysteresis = 0;
+    size_t linesInUse = 0;
+    size_t windowMoves = 0;
+    deque<TickerId> pendingCancels;
+    deque<PendingRequest> pendingRequests;
+    double tokens = SUBSCRIPTION_MESSAGE_BURST;
+    chrono::steady_clock::time_point lastRefill;
+
+    void queueRequests(OptionChainManager* chain, const vector<ContractKey>& keys);
+    void queueCancels(OptionChainManager* chain, const vector<ContractKey>& keys);
+    void sendPending();
+
+public:
+
+    SubscriptionManager(function<void(TickerId, const Contract&)> subscribe, function<void(TickerId)> unsubscribe);
+
+    void setLineBudget(size_t lineBudget);
+    void setHysteresis(size_t hysteresis);
+    void subscribeAll();
+    void update();
+    void cancelAll();
+    size_t getLinesInUse();
+    size_t getWindowMoves();
+};
+
+#endif
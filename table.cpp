@@ -12,9 +12,26 @@ using namespace std;
 //public methods
 
 /**
- * Destructor. Closes the table's windows and the ncurses environment.
+ * Constructor. Marks every cell of the table as clean.
+ */
+Table::Table() {
+    for (int row = 0; row < MAX_ROWS; row++) {
+        this->dirtyColumns[row].store(0, memory_order_relaxed);
+        for (int column = 0; column < DATA_COLUMNS; column++) {
+            this->cellValues[row][column].store(0.0, memory_order_relaxed);
+            this->cellReceived[row][column].store(0, memory_order_relaxed);
+            this->cellApplied[row][column].store(0, memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * Destructor. Stops the render thread, then closes the table's windows and the ncurses environment,
+ * if the table was initialized.
  */
 Table::~Table() {
+    stopRenderer();
+    if (this->tableWindow == nullptr) return;
     delwin(headerWindow);
     delwin(tableWindow);
     delwin(footerWindow);
@@ -24,6 +41,10 @@ Table::~Table() {
 /**
  * Draws a cell in the table window.
  *
+ * The text is only written to the window buffer. It reaches the terminal with the
+ * next refresh of the table window. Since ncurses is owned by the render thread once
+ * it is running, this must only be called while the table is being initialized.
+ *
  * @param rowIndex The row index of the cell to draw.
  * @param columnIndex The column index of the cell to draw.
  * @param text The text to draw in the cell.
@@ -32,21 +53,98 @@ void Table::drawCell(int rowIndex, int columnIndex, const string text) {
 
     int textStart = columnIndex * COLUMN_WIDTH + (COLUMN_WIDTH - text.length()) / 2;
 
-    unique_lock<mutex> lockTable(tableMutex);
+    mvwprintw(tableWindow, rowIndex, columnIndex * COLUMN_WIDTH, "%*s", COLUMN_WIDTH, "");
     mvwprintw(tableWindow, rowIndex, textStart, "%s", text.c_str());
-    wrefresh(tableWindow);
-    lockTable.unlock();
+}
+
+/**
+ * Sets the price displayed in a cell and marks the cell dirty.
+ *
+ * This is safe to call from any thread. The cell is repainted by the render
+ * thread on its next frame, so many updates to the same cell within a frame
+ * cost a single repaint.
+ *
+ * @param rowIndex The row index of the cell.
+ * @param columnIndex The column index of the cell.
+ * @param value The price to display.
+ */
+void Table::setCell(int rowIndex, int columnIndex, double value) {
+
+    if (rowIndex < 0 || rowIndex >= MAX_ROWS || columnIndex < 0 || columnIndex >= DATA_COLUMNS) return;
+
+    //a cell painted late is as late as its oldest update, so later updates keep the first stamps
+    const LatencyTrace& trace = LatencyTracker::getCurrentTrace();
+    uint64_t pending = 0;
+    if (trace.received != 0
+        && this->cellReceived[rowIndex][columnIndex].compare_exchange_strong(pending, trace.received, memory_order_relaxed)) {
+        this->cellApplied[rowIndex][columnIndex].store(trace.applied, memory_order_relaxed);
+    }
+
+    this->cellValues[rowIndex][columnIndex].store(value, memory_order_relaxed);
+    this->dirtyColumns[rowIndex].fetch_or(1u << columnIndex, memory_order_release);
+}
+
+/**
+ * Sets how many frames per second the render thread paints.
+ *
+ * @param framesPerSecond The new frame rate. Values below 1 are ignored.
+ */
+void Table::setFrameRate(int framesPerSecond) {
+    if (framesPerSecond > 0) this->frameRate.store(framesPerSecond, memory_order_relaxed);
+}
+
+/**
+ * Sets a function that the render thread calls at the start of every frame,
+ * before dirty cells are repainted. Cells it sets are painted in the same frame.
+ * Must be called before initializeTable.
+ *
+ * @param frameCallback The function to call.
+ */
+void Table::setFrameCallback(function<void()> frameCallback) {
+    this->frameCallback = frameCallback;
+}
+
+/**
+ * Sets the tracker that painted cells are counted in. Must be called before initializeTable.
+ *
+ * @param latencyTracker The tracker, or nullptr to not count painted cells.
+ */
+void Table::setLatencyTracker(LatencyTracker* latencyTracker) {
+    this->latencyTracker = latencyTracker;
+}
+
+/**
+ * Shows every cell of a row as empty, for a row that no longer displays a strike.
+ * Safe to call from any thread.
+ *
+ * @param rowIndex The row index.
+ */
+void Table::clearRow(int rowIndex) {
+    for (int column = 0; column < DATA_COLUMNS; column++) setCell(rowIndex, column, NAN);
+}
+
+/**
+ * Blocks the calling thread until the user presses the quit key, or until a timeout.
+ *
+ * Keyboard input is read by the render thread, which owns the ncurses state.
+ *
+ * @param timeoutMs The longest time to wait.
+ * @return true if the quit key was pressed.
+ */
+bool Table::waitForQuitKey(int timeoutMs) {
+    unique_lock<mutex> lock(this->quitMutex);
+    return this->quitCondition.wait_for(lock, chrono::milliseconds(timeoutMs), [this]() { return this->quitRequested; });
 }
 
 /**
  * Initializes the ncurses environment and the table's windows.
  *
- * @param strikes The set of all possible strikes to be displayed in the table.
- * @param closestStrike The strike that should be at the middle row of the table
+ * @param activeStrikes The strikes to display, each mapped to its row. Rows can be
+ * given other strikes later by setting their strike column.
  */
-void Table::initializeTable(set<double> strikes, int closestStrike) {
+void Table::initializeTable(const map<double, int>& activeStrikes) {
 
-    this->strikes = strikes;
+    this->activeStrikes = activeStrikes;
 
     initscr();
     cbreak();
@@ -61,7 +159,11 @@ void Table::initializeTable(set<double> strikes, int closestStrike) {
     drawBorders();
     drawFooter();
     refresh();
-    drawStrikes(closestStrike);      
+    drawStrikes();
+    wrefresh(this->tableWindow);
+
+    nodelay(this->footerWindow, TRUE);
+    this->renderThread = thread(&Table::renderLoop, this);
 }
 
 /**
@@ -122,6 +224,43 @@ string Table::formatNumber2(double number) {
     return oss.str();
 }
 
+/**
+ * Formats the value of a cell for its column.
+ *
+ * Implied volatility is shown as a percentage, deltas with three decimal places,
+ * gamma with five, strikes as formatNumber formats them and everything else with
+ * two. A value that is not a number is shown as a dash.
+ *
+ * @param columnIndex The column index of the cell.
+ * @param number The value of the cell.
+ * @return A string representation of the formatted value.
+ */
+string Table::formatCell(int columnIndex, double number) {
+
+    if (std::isnan(number)) return "-";
+
+    ostringstream oss;
+
+    switch (columnIndex) {
+        case CALL_IV_COLUMN:
+        case PUT_IV_COLUMN:
+            oss << fixed << setprecision(2) << number * 100.0 << "%";
+            break;
+        case CALL_DELTA_COLUMN:
+        case PUT_DELTA_COLUMN:
+            oss << fixed << setprecision(3) << number;
+            break;
+        case GAMMA_COLUMN:
+            oss << fixed << setprecision(5) << number;
+            break;
+        case STRIKE_COLUMN:
+            return formatNumber(number);
+        default:
+            return formatNumber2(number);
+    }
+    return oss.str();
+}
+
 /**
  * @return The window that displays the header of the table.
  */
@@ -138,6 +277,82 @@ WINDOW* Table::getTableWindow() {
 
 //private methods
 
+/**
+ * Body of the render thread.
+ *
+ * Once per frame the thread checks for the quit key, runs the frame callback and
+ * repaints every dirty cell, then pushes all changes to the terminal with a single
+ * doupdate.
+ */
+void Table::renderLoop() {
+
+    chrono::steady_clock::time_point nextFrame = chrono::steady_clock::now();
+
+    while (!this->stopRenderFlag.load(memory_order_relaxed)) {
+
+        if (wgetch(this->footerWindow) == QUIT_KEY) {
+            lock_guard<mutex> lock(this->quitMutex);
+            this->quitRequested = true;
+            this->quitCondition.notify_all();
+        }
+
+        if (this->frameCallback) this->frameCallback();
+
+        if (renderDirtyCells()) {
+            wnoutrefresh(this->tableWindow);
+            doupdate();
+        }
+
+        if (!this->paintedTraces.empty()) {
+            this->latencyTracker->recordRender(this->paintedTraces);
+            this->paintedTraces.clear();
+        }
+
+        nextFrame += chrono::microseconds(1000000 / this->frameRate.load(memory_order_relaxed));
+        chrono::steady_clock::time_point now = chrono::steady_clock::now();
+        if (nextFrame < now) nextFrame = now;    //skip frames we fell behind on
+        this_thread::sleep_until(nextFrame);
+    }
+}
+
+/**
+ * Repaints every cell marked dirty since the last frame into the table window buffer.
+ * The stamps of traced cells are collected for the latency tracker, which counts
+ * them once the frame has been pushed to the terminal.
+ *
+ * @return true if any cell was repainted.
+ */
+bool Table::renderDirtyCells() {
+
+    bool painted = false;
+
+    for (int row = 0; row < MAX_ROWS; row++) {
+
+        uint32_t dirty = this->dirtyColumns[row].exchange(0, memory_order_acquire);
+
+        for (int column = 0; dirty != 0; column++, dirty >>= 1) {
+            if (dirty & 1) {
+                drawCell(row, column, formatCell(column, this->cellValues[row][column].load(memory_order_relaxed)));
+                painted = true;
+
+                uint64_t received = this->cellReceived[row][column].exchange(0, memory_order_relaxed);
+                if (received != 0 && this->latencyTracker) {
+                    this->paintedTraces.emplace_back(received, this->cellApplied[row][column].load(memory_order_relaxed));
+                }
+            }
+        }
+    }
+    return painted;
+}
+
+/**
+ * Stops the render thread and waits for it to exit.
+ */
+void Table::stopRenderer() {
+    this->stopRenderFlag = true;
+    if (this->renderThread.joinable()) this->renderThread.join();
+}
+
 /**
  * Draws horizontal borders in the table window.
  *
@@ -166,49 +381,30 @@ void Table::drawFooter() {
  * Draws the header of the table window.
  *
  * This function uses ncurses to draw the header of the table window.
- * The header displays column headers for the table.
+ * The header displays column headers for the table: the call side's Greeks and
+ * quotes, the strike, the put side's quotes and Greeks, then the gamma and vega
+ * shared by both sides of a strike.
  */
 void Table::drawHeader() {
-    mvwprintw(headerWindow, 0, CALL_BID_COLUMN * COLUMN_WIDTH + (COLUMN_WIDTH - strlen("Bid")) / 2, "%s", "Bid");
-    mvwprintw(headerWindow, 0, CALL_ASK_COLUMN * COLUMN_WIDTH + (COLUMN_WIDTH - strlen("Ask")) / 2, "%s", "Ask");
-    mvwprintw(headerWindow, 0, CALL_LAST_COLUMN * COLUMN_WIDTH + (COLUMN_WIDTH - strlen("Last")) / 2, "%s", "Last");
-    mvwprintw(headerWindow, 0, STRIKE_COLUMN * COLUMN_WIDTH + (COLUMN_WIDTH - strlen("Strike")) / 2, "%s", "Strike");
-    mvwprintw(headerWindow, 0, PUT_BID_COLUMN * COLUMN_WIDTH + (COLUMN_WIDTH - strlen("Bid")) / 2, "%s", "Bid");
-    mvwprintw(headerWindow, 0, PUT_ASK_COLUMN * COLUMN_WIDTH + (COLUMN_WIDTH - strlen("Ask")) / 2, "%s", "Ask");
-    mvwprintw(headerWindow, 0, PUT_LAST_COLUMN * COLUMN_WIDTH + (COLUMN_WIDTH - strlen("Last")) / 2, "%s", "Last");
+
+    static const char* titles[DATA_COLUMNS] = {"Theta", "Delta", "IV", "Bid", "Ask", "Last", "Strike",
+                                               "Bid", "Ask", "Last", "IV", "Delta", "Theta", "Gamma", "Vega"};
+
+    for (int column = 0; column < DATA_COLUMNS; column++) {
+        mvwprintw(headerWindow, 0, column * COLUMN_WIDTH + (COLUMN_WIDTH - strlen(titles[column])) / 2, "%s", titles[column]);
+    }
     wrefresh(headerWindow); 
 }
 
 /**
  * @brief Draws the strike prices on the table.
  *
- * Draws the strike prices on the table, starting from the closest strike
- * and going up and down. The strike prices are drawn in the strike column
- * and the text is centered in the cell.
- *
- * @param closestStrike The strike closest to the current underlying price.
+ * Draws each active strike in the strike column of its row, with the text
+ * centered in the cell.
  */
-void Table::drawStrikes(int closestStrike) {
+void Table::drawStrikes() {
 
-    set<double>::iterator itClosest = strikes.find(closestStrike);
-    set<double>::iterator it = itClosest;
-    string text = formatNumber(*it);
-
-    for(int i = MAX_ROWS/2 + 1; i < MAX_ROWS; i++) {    //draw second half of strikes
-        drawCell(i, STRIKE_COLUMN, text);
-        activeStrikes.insert(pair<double, int>(*it, i));
-        it.operator++();
-        if(it == strikes.end()) break;
-        text = formatNumber(*it);
+    for (const auto& activeStrike : this->activeStrikes) {
+        drawCell(activeStrike.second, STRIKE_COLUMN, formatNumber(activeStrike.first));
     }
-
-    it = itClosest;     //draw first half of strikes
-    it.operator--();
-    text = formatNumber(*it);
-    for(int i = MAX_ROWS/2; i > 0; i--) {
-        drawCell(i, STRIKE_COLUMN, text);
-        activeStrikes.insert(pair<double, int>(*it, i));
-        it.operator--();
-        text = formatNumber(*it);
-    } 
 }
@@ -14,61 +14,103 @@ December 6, 2024
 #include <map>
 #include <set>
 #include <iomanip>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <vector>
 #include "Contract.h"
 #include "terminal.h"
+#include "latencyTracker.h"
 
 using namespace std;
 
 #define HEADER_HEIGHT 1
-#define HEADER_WIDTH 70
+#define HEADER_WIDTH 120
 #define HEADER_START_Y 0
 #define HEADER_START_X 1
 #define TABLE_HEIGHT 33 //keep odd number for symmetry
-#define TABLE_WIDTH 70
+#define TABLE_WIDTH 120
 #define TABLE_START_Y 1
 #define TABLE_START_X 1
 #define FOOTER_HEIGHT 2
-#define FOOTER_WIDTH 70
+#define FOOTER_WIDTH 120
 #define FOOTER_START_Y 35
 #define FOOTER_START_X 1
 #define MAX_ROWS 33
-#define DATA_COLUMNS 7
+#define FIRST_STRIKE_ROW 1
+#define STRIKE_ROWS (MAX_ROWS - FIRST_STRIKE_ROW)
+#define DATA_COLUMNS 15
 #define COLUMN_WIDTH TABLE_WIDTH / DATA_COLUMNS
-#define CALL_BID_COLUMN 0
-#define CALL_ASK_COLUMN 1
-#define CALL_LAST_COLUMN 2
-#define STRIKE_COLUMN 3
-#define PUT_BID_COLUMN 4
-#define PUT_ASK_COLUMN 5
-#define PUT_LAST_COLUMN 6
+#define CALL_THETA_COLUMN 0
+#define CALL_DELTA_COLUMN 1
+#define CALL_IV_COLUMN 2
+#define CALL_BID_COLUMN 3
+#define CALL_ASK_COLUMN 4
+#define CALL_LAST_COLUMN 5
+#define STRIKE_COLUMN 6
+#define PUT_BID_COLUMN 7
+#define PUT_ASK_COLUMN 8
+#define PUT_LAST_COLUMN 9
+#define PUT_IV_COLUMN 10
+#define PUT_DELTA_COLUMN 11
+#define PUT_THETA_COLUMN 12
+#define GAMMA_COLUMN 13
+#define VEGA_COLUMN 14
+#define RENDER_FPS 30
+#define QUIT_KEY 'q'
 
 class Table {
 
 private:
-    WINDOW* headerWindow;
-    WINDOW* tableWindow;
-    WINDOW* footerWindow;
-    mutex tableMutex;
+    WINDOW* headerWindow = nullptr;
+    WINDOW* tableWindow = nullptr;
+    WINDOW* footerWindow = nullptr;
+    atomic<double> cellValues[MAX_ROWS][DATA_COLUMNS];
+    atomic<uint32_t> dirtyColumns[MAX_ROWS];    // bit n set if column n of the row needs repainting
+    atomic<uint64_t> cellReceived[MAX_ROWS][DATA_COLUMNS];  // receive stamp of the oldest unpainted update, 0 if none
+    atomic<uint64_t> cellApplied[MAX_ROWS][DATA_COLUMNS];   // apply stamp of the same update
+    LatencyTracker* latencyTracker = nullptr;
+    vector<pair<uint64_t, uint64_t>> paintedTraces;
+    atomic<int> frameRate{RENDER_FPS};
+    atomic<bool> stopRenderFlag{false};
+    thread renderThread;
+    mutex quitMutex;
+    condition_variable quitCondition;
+    bool quitRequested = false;
+    function<void()> frameCallback;
 
+    void renderLoop();
+    bool renderDirtyCells();
+    void stopRenderer();
     void drawBorders();
     void drawFooter();
     void drawHeader();
-    void drawStrikes(int closestStrike);
+    void drawStrikes();
     WINDOW* getHeaderWindow();
     WINDOW* getTableWindow();
     
 public:
     map<TickerId, pair<bool, int>> tickerToRowIndex;
-    set<double> strikes;
     map<double, int> activeStrikes;
 
+    Table();
     ~Table();
 
     void drawCell(int rowIndex, int columnIndex, const string text);
-    void initializeTable(set<double> strikes, int closestStrike);
+    void setCell(int rowIndex, int columnIndex, double value);
+    void setFrameRate(int framesPerSecond);
+    void setFrameCallback(function<void()> frameCallback);
+    void setLatencyTracker(LatencyTracker* latencyTracker);
+    void clearRow(int rowIndex);
+    bool waitForQuitKey(int timeoutMs);
+    void initializeTable(const map<double, int>& activeStrikes);
     int getRowIndex(double strike);
     string formatNumber(double number);
     string formatNumber2(double number);
+    string formatCell(int columnIndex, double number);
 };
 
 #endif
@@ -11,10 +11,6 @@ December 6, 2024
 
 using namespace std;
 
-set<string> supportedSymbols = {"ES", "NQ"};
-set<string> supportedExpiries = {"20241220", "20250321"};
-string selectedSymbol;
-
 /**
  * Resizes the terminal to the specified dimensions.
  *
@@ -136,61 +132,85 @@ string getDefaultGateway() {
 }
 
 /**
- * Prompts the user to input a symbol until a valid symbol is entered.
- * A valid symbol is one that is in the set of supportedSymbols.
+ * Prompts the user to input one or more symbols until every symbol entered is valid.
+ * Symbols are separated by commas or spaces. A valid symbol is 1 to MAX_SYMBOL_LENGTH
+ * letters or digits, e.g. ES or NQ. Symbols are converted to upper case and repeated
+ * symbols are only returned once.
  *
- * @return The valid symbol entered by the user.
+ * @return The symbols entered by the user, in the order they were entered.
  */
-string getSymbol() {
+vector<string> getSymbols() {
 
     while (true) {
 
-        write(STDOUT_FILENO, "Supported symbols: ", 19);
-        for (string symbol : supportedSymbols) {
-            write(STDOUT_FILENO, symbol.c_str(), symbol.length());
-            write(STDOUT_FILENO, ", ", 2);
-        }
-        write(STDOUT_FILENO, "\n", 1);
+        string line;
+        write(STDOUT_FILENO, "Enter symbols (e.g. ES, NQ): ", 29);
+        getline(cin, line);
+        transform(line.begin(), line.end(), line.begin(), ::toupper);
 
-        string symbol;
-        write(STDOUT_FILENO, "Enter symbol: ", 14);
-        getline(cin, symbol);
-        transform(symbol.begin(), symbol.end(), symbol.begin(), ::toupper);
+        vector<string> symbols = splitList(line);
+        bool valid = !symbols.empty();
+
+        for (const string& symbol : symbols) {
+            valid = valid && symbol.length() <= MAX_SYMBOL_LENGTH && all_of(symbol.begin(), symbol.end(), ::isalnum);
+        }
 
-        if (supportedSymbols.find(symbol) == supportedSymbols.end()) {
+        if (!valid) {
             write(STDERR_FILENO, "Invalid symbol\n", 15);
         } else {
-            selectedSymbol = symbol;
-            return symbol;
+            return symbols;
         }
     } 
 }
 
 /**
- * Prompts the user to input an expiry date until a valid expiry is entered.
- * A valid expiry is one that is in the set of supportedExpiries.
+ * Prompts the user to input one or more expiry dates until every expiry entered is valid.
+ * Expiries are separated by commas or spaces. A valid expiry is a date in the form YYYYMMDD.
+ * Repeated expiries are only returned once.
  *
- * @return The valid expiry date entered by the user.
+ * @return The expiry dates entered by the user, in the order they were entered.
  */
-string getExpiry() {
+vector<string> getExpiries() {
 
     while (true) {
 
-        write(STDOUT_FILENO, "Supported expiries: ", 20);
-        for (string expiry : supportedExpiries) {
-            write(STDOUT_FILENO, expiry.c_str(), expiry.length());
-            write(STDOUT_FILENO, ", ", 2);
-        }
-        write(STDOUT_FILENO, "\n", 1);
+        string line;
+        write(STDOUT_FILENO, "Enter expiries (e.g. 20250321, 20250620): ", 42);
+        getline(cin, line);
+
+        vector<string> expiries = splitList(line);
+        bool valid = !expiries.empty();
 
-        string expiry;
-        write(STDOUT_FILENO, "Enter expiry: ", 14);
-        getline(cin, expiry);
+        for (const string& expiry : expiries) {
+            valid = valid && expiry.length() == 8 && all_of(expiry.begin(), expiry.end(), ::isdigit);
+        }
 
-        if (supportedExpiries.find(expiry) == supportedExpiries.end()) {
+        if (!valid) {
             write(STDERR_FILENO, "Invalid expiry\n", 15);
         } else {
-            return expiry;
+            return expiries;
+        }
+    }
+}
+
+/**
+ * Splits a line into the words separated by commas or spaces, dropping repeated words.
+ *
+ * @param line The line to split.
+ * @return The words, in the order of their first appearance.
+ */
+vector<string> splitList(const string& line) {
+
+    vector<string> words;
+    string word;
+    istringstream iss(line);
+
+    while (getline(iss, word, ',')) {
+        istringstream wordStream(word);
+        string part;
+        while (wordStream >> part) {
+            if (find(words.begin(), words.end(), part) == words.end()) words.push_back(part);
         }
     }
+    return words;
 }
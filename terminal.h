@@ -15,19 +15,20 @@ December 6, 2024
 #include <iostream>
 #include <algorithm>
 #include <set>
+#include <vector>
 
 #define TERMINAL_HEIGHT 36
-#define TERMINAL_WIDTH 72
+#define TERMINAL_WIDTH 122
+#define MAX_SYMBOL_LENGTH 8
 
 using namespace std;
 
-extern string selectedSymbol;
-
 void resizeTerminal(int x, int y);
 WINDOW* createWindow(int height, int width, int start_y, int start_x);
 string getDefaultGateway();
-string getSymbol();
-string getExpiry();
+vector<string> getSymbols();
+vector<string> getExpiries();
+vector<string> splitList(const string& line);
 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,435 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#include "tickCapture.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <limits>
+#include <time.h>
+#include <unistd.h>
+#include <unordered_map>
+#include "globals.h"
+
+using namespace std;
+
+#define CAPTURE_RING_MASK (CAPTURE_RING_CAPACITY - 1)
+#define CAPTURE_SCALE_TOLERANCE 1e-6    // fraction of a unit a scaled value may be off a whole number
+
+static atomic<uint64_t> nextCaptureId{1};
+
+/**
+ * The ring the calling thread queues to and the capture it belongs to, so a thread that
+ * outlives a capture does not queue to its ring.
+ */
+static thread_local uint64_t threadRingOwner = 0;
+static thread_local CaptureRing* threadRing = nullptr;
+
+/**
+ * @return The current CLOCK_REALTIME time in nanoseconds.
+ */
+static uint64_t nowNanoseconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @return a price or size as it is captured: 0 if it is not finite or beyond CAPTURE_MAX_VALUE.
+ */
+static double sanitize(double value) {
+    return fabs(value) <= CAPTURE_MAX_VALUE ? value : 0.0;
+}
+
+/**
+ * @return the size tick type that goes with a price tick type, as EDecoder reports it to
+ *         tickSize, or NOT_SET if the price tick carries no size.
+ */
+static int getSizeTickType(int priceTickType) {
+
+    switch (priceTickType) {
+        case BID: return BID_SIZE;
+        case ASK: return ASK_SIZE;
+        case LAST: return LAST_SIZE;
+        case DELAYED_BID: return DELAYED_BID_SIZE;
+        case DELAYED_ASK: return DELAYED_ASK_SIZE;
+        case DELAYED_LAST: return DELAYED_LAST_SIZE;
+        default: return NOT_SET;
+    }
+}
+
+/**
+ * Finds the fewest decimals every price, or every size, of a chunk is exact in.
+ *
+ * @return The number of decimals, CAPTURE_MAX_SCALE if none is exact.
+ */
+static uint8_t chooseScale(const vector<CaptureRecord>& records, size_t count, bool isPrice) {
+
+    for (uint8_t scale = 0; scale < CAPTURE_MAX_SCALE; scale++) {
+
+        bool isExact = true;
+        for (size_t i = 0; i < count && isExact; i++) {
+            double scaled = (isPrice ? records[i].price : records[i].size) * capturePowersOfTen[scale];
+            isExact = fabs(scaled - nearbyint(scaled)) <= CAPTURE_SCALE_TOLERANCE;
+        }
+        if (isExact) return scale;
+    }
+    return CAPTURE_MAX_SCALE;
+}
+
+/**
+ * Appends a length byte and up to 255 characters.
+ */
+static void appendShortString(string& out, const string& value) {
+
+    size_t length = min<size_t>(value.size(), 255);
+    out.push_back((char)length);
+    out.append(value, 0, length);
+}
+
+//public methods
+
+/**
+ * Constructs a capture that is not capturing until it is opened.
+ */
+TickCapture::TickCapture() : captureId(nextCaptureId.fetch_add(1, memory_order_relaxed)) {}
+
+/**
+ * Destroys the capture, writing what is still queued.
+ */
+TickCapture::~TickCapture() {
+    close();
+}
+
+/**
+ * Creates a capture file and starts the writer thread.
+ *
+ * @param path The path of the capture file. An existing file is replaced.
+ * @return true if ticks are captured.
+ */
+bool TickCapture::open(const string& path) {
+
+    close();
+
+    this->fd = ::open(path.c_str(), O_CREAT | O_WRONLY | O_TRUNC | O_CLOEXEC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (this->fd < 0) return false;
+
+    TickCaptureFileHeader header = {CAPTURE_FILE_MAGIC, CAPTURE_FILE_VERSION, sizeof(TickChunkHeader), nowNanoseconds()};
+    if (write(this->fd, &header, sizeof(header)) != sizeof(header)) {
+        ::close(this->fd);
+        this->fd = -1;
+        return false;
+    }
+
+    this->path = path;
+    this->writtenBytes = sizeof(header);
+    this->pending.clear();
+    this->pending.reserve(2 * CAPTURE_CHUNK_TICKS);
+    this->chunkStartedAt = chrono::steady_clock::now();
+    this->stopFlag = false;
+    this->isCapturing.store(true, memory_order_release);
+    this->writerThread = thread(&TickCapture::writerLoop, this);
+    return true;
+}
+
+/**
+ * Stops capturing, waits for the producers still pushing a tick, writes every queued
+ * tick and closes the file.
+ */
+void TickCapture::close() {
+
+    if (!this->writerThread.joinable()) return;
+
+    this->isCapturing.store(false, memory_order_seq_cst);
+    while (this->producersInFlight.load(memory_order_acquire) != 0) this_thread::yield();
+    {
+        lock_guard<mutex> lock(this->stopMutex);
+        this->stopFlag = true;
+    }
+    this->stopCondition.notify_one();
+    this->writerThread.join();
+
+    ::close(this->fd);
+    this->fd = -1;
+}
+
+/**
+ * Captures a tick. Called on the thread that received it; never blocks.
+ *
+ * @param chain The chain the tick's ticker ID routes to.
+ * @param tickerId The ticker ID of the tick.
+ * @param field The TickType of the tick.
+ * @param price The price, 0 for a size tick.
+ * @param size The size, 0 for a price tick.
+ */
+void TickCapture::capture(OptionChainManager* chain, TickerId tickerId, int field, double price, double size) {
+
+    if (!isOpen()) return;
+
+    //counted in flight before isCapturing is checked again, so close either waits for the push or stops it
+    this->producersInFlight.fetch_add(1, memory_order_seq_cst);
+    if (this->isCapturing.load(memory_order_seq_cst)) push(chain, tickerId, field, price, size);
+    this->producersInFlight.fetch_sub(1, memory_order_release);
+}
+
+/**
+ * Captures a batch of ticks decoded on the tick batching path, as the EWrapper callbacks
+ * would have reported them: a price tick as its price and then its size.
+ *
+ * @param ticks The ticks.
+ * @param count The number of ticks.
+ */
+void TickCapture::captureTicks(const ETick* ticks, size_t count) {
+
+    if (!isOpen()) return;
+
+    //the whole batch is pushed in flight at once, see capture
+    this->producersInFlight.fetch_add(1, memory_order_seq_cst);
+
+    for (size_t i = 0; i < count && this->isCapturing.load(memory_order_seq_cst); i++) {
+
+        const ETick& tick = ticks[i];
+        OptionChainManager* chain = chainRegistry.findTickerChain(tick.tickerId);
+        if (chain == nullptr) continue;
+
+        int sizeTickType = tick.tickType;
+        if (tick.isPrice) {
+            push(chain, tick.tickerId, tick.tickType, tick.price, 0.0);
+            sizeTickType = getSizeTickType(tick.tickType);
+        }
+        if (sizeTickType != NOT_SET) push(chain, tick.tickerId, sizeTickType, 0.0, strtod(tick.size, nullptr));
+    }
+
+    this->producersInFlight.fetch_sub(1, memory_order_release);
+}
+
+/**
+ * @return the number of ticks queued for writing.
+ */
+uint64_t TickCapture::getCapturedCount() {
+    return this->capturedCount.load(memory_order_relaxed);
+}
+
+/**
+ * @return the number of ticks dropped because a producer ring was full.
+ */
+uint64_t TickCapture::getDroppedCount() {
+    return this->droppedCount.load(memory_order_relaxed);
+}
+
+/**
+ * @return the bytes written to the capture file. Read after close.
+ */
+uint64_t TickCapture::getWrittenBytes() {
+    return this->writtenBytes;
+}
+
+/**
+ * @return the path of the capture file.
+ */
+const string& TickCapture::getPath() {
+    return this->path;
+}
+
+//private methods
+
+/**
+ * Appends a tick to the calling thread's ring, or counts it as dropped if the ring is full.
+ *
+ * @param chain The chain the tick's ticker ID routes to.
+ * @param tickerId The ticker ID of the tick.
+ * @param field The TickType of the tick.
+ * @param price The price, 0 for a size tick.
+ * @param size The size, 0 for a price tick.
+ */
+void TickCapture::push(OptionChainManager* chain, TickerId tickerId, int field, double price, double size) {
+
+    CaptureRecord record;
+    if (!chain->getTickerContract(tickerId, record.conId, record.strike, record.right)) return;
+
+    CaptureRing* ring = getThreadRing();
+    uint64_t head = ring->head.load(memory_order_relaxed);
+
+    if (head - ring->tail.load(memory_order_acquire) >= CAPTURE_RING_CAPACITY) {
+        this->droppedCount.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+
+    record.timestamp = nowNanoseconds();
+    record.chain = chain;
+    record.tickerId = tickerId;
+    record.price = sanitize(price);
+    record.size = sanitize(size);
+    record.field = field;
+    ring->records[head & CAPTURE_RING_MASK] = record;
+
+    ring->head.store(head + 1, memory_order_release);
+    this->capturedCount.fetch_add(1, memory_order_relaxed);
+}
+
+/**
+ * Returns the ring owned by the calling thread, creating and registering it on first use.
+ *
+ * @return The calling thread's ring.
+ */
+CaptureRing* TickCapture::getThreadRing() {
+
+    if (threadRingOwner == this->captureId) return threadRing;
+
+    unique_ptr<CaptureRing> ring = make_unique<CaptureRing>();
+    threadRing = ring.get();
+    threadRingOwner = this->captureId;
+
+    lock_guard<mutex> lock(this->ringsMutex);
+    this->rings.push_back(move(ring));
+    return threadRing;
+}
+
+/**
+ * Takes the queued ticks off the rings every CAPTURE_FLUSH_INTERVAL_MS and writes a chunk
+ * whenever CAPTURE_CHUNK_TICKS are pending, or the oldest pending chunk is older than
+ * CAPTURE_CHUNK_MAX_AGE_MS. Writes what is left as soon as it is stopped.
+ */
+void TickCapture::writerLoop() {
+
+    unique_lock<mutex> lock(this->stopMutex);
+
+    while (!this->stopCondition.wait_for(lock, chrono::milliseconds(CAPTURE_FLUSH_INTERVAL_MS), [this] { return this->stopFlag; })) {
+
+        drain();
+
+        while (this->pending.size() >= CAPTURE_CHUNK_TICKS) writeChunk(CAPTURE_CHUNK_TICKS);
+        if (!this->pending.empty()
+            && chrono::steady_clock::now() - this->chunkStartedAt >= chrono::milliseconds(CAPTURE_CHUNK_MAX_AGE_MS)) {
+            writeChunk(this->pending.size());
+        }
+    }
+
+    drain();
+    while (!this->pending.empty()) writeChunk(min<size_t>(this->pending.size(), CAPTURE_CHUNK_TICKS));
+}
+
+/**
+ * Moves every record queued on the rings to the pending ticks and keeps them all in
+ * timestamp order, so that a chunk cut from their front never overlaps the next one.
+ */
+void TickCapture::drain() {
+
+    lock_guard<mutex> lock(this->ringsMutex);
+    size_t sortedCount = this->pending.size();
+
+    for (unique_ptr<CaptureRing>& ring : this->rings) {
+
+        uint64_t tail = ring->tail.load(memory_order_relaxed);
+        uint64_t head = ring->head.load(memory_order_acquire);
+
+        for (; tail < head; tail++) this->pending.push_back(ring->records[tail & CAPTURE_RING_MASK]);
+        ring->tail.store(tail, memory_order_release);
+    }
+
+    auto byTimestamp = [](const CaptureRecord& a, const CaptureRecord& b) { return a.timestamp < b.timestamp; };
+    stable_sort(this->pending.begin() + sortedCount, this->pending.end(), byTimestamp);
+    inplace_merge(this->pending.begin(), this->pending.begin() + sortedCount, this->pending.end(), byTimestamp);
+}
+
+/**
+ * Encodes the first pending ticks, which drain keeps ordered by timestamp, as a chunk,
+ * appends it to the file and removes them from the pending ticks.
+ *
+ * @param count The number of ticks in the chunk.
+ * @return false if the chunk could not be written; its ticks are lost.
+ */
+bool TickCapture::writeChunk(size_t count) {
+
+    TickChunkHeader header = {};
+    header.magic = CAPTURE_CHUNK_MAGIC;
+    header.tickCount = count;
+    header.firstTimestamp = this->pending.front().timestamp;
+    header.lastTimestamp = this->pending[count - 1].timestamp;
+    header.minStrike = numeric_limits<double>::infinity();
+    header.maxStrike = -numeric_limits<double>::infinity();
+    header.priceScale = chooseScale(this->pending, count, true);
+    header.sizeScale = chooseScale(this->pending, count, false);
+
+    string columns[TICK_COLUMN_COUNT];
+    unordered_map<TickerId, uint32_t> contractIndices;
+    unordered_map<OptionChainManager*, string> chainNames;      //symbol and expiry as the contract table stores them
+    unordered_map<uint64_t, pair<int64_t, int64_t>> previous;    //keyed by contract index << 8 | field
+    uint64_t previousTimestamp = header.firstTimestamp;
+
+    for (int column = TICK_COLUMN_TIMESTAMPS; column < TICK_COLUMN_COUNT; column++) columns[column].reserve(4 * count);
+    contractIndices.reserve(count);
+    previous.reserve(count);
+
+    for (size_t i = 0; i < count; i++) {
+
+        const CaptureRecord& record = this->pending[i];
+
+        auto inserted = contractIndices.emplace(record.tickerId, contractIndices.size());
+        uint32_t contractIndex = inserted.first->second;
+
+        if (inserted.second) {
+            string& contracts = columns[TICK_COLUMN_CONTRACTS];
+            appendVarint(contracts, zigzagEncode(record.conId));
+            contracts.append((const char*)&record.strike, sizeof(double));
+            contracts.push_back(record.right);
+            string& names = chainNames[record.chain];
+            if (names.empty()) {
+                appendShortString(names, record.chain->getUnderlyingContract().symbol);
+                appendShortString(names, record.chain->getContractDate());
+            }
+            contracts.append(names);
+
+            if (record.right == 0) {
+                header.flags |= CAPTURE_CHUNK_UNDERLYING;
+            } else {
+                header.minStrike = min(header.minStrike, record.strike);
+                header.maxStrike = max(header.maxStrike, record.strike);
+            }
+        }
+
+        int64_t price = llround(record.price * capturePowersOfTen[header.priceScale]);
+        int64_t size = llround(record.size * capturePowersOfTen[header.sizeScale]);
+        pair<int64_t, int64_t>& last = previous[(uint64_t)contractIndex << 8 | record.field];
+
+        appendVarint(columns[TICK_COLUMN_TIMESTAMPS], zigzagEncode(record.timestamp - previousTimestamp));
+        appendVarint(columns[TICK_COLUMN_CONTRACT_INDICES], contractIndex);
+        columns[TICK_COLUMN_FIELDS].push_back((char)record.field);
+        appendVarint(columns[TICK_COLUMN_PRICES], zigzagEncode(price - last.first));
+        appendVarint(columns[TICK_COLUMN_SIZES], zigzagEncode(size - last.second));
+
+        previousTimestamp = record.timestamp;
+        last = make_pair(price, size);
+    }
+
+    header.contractCount = contractIndices.size();
+    for (int column = 0; column < TICK_COLUMN_COUNT; column++) header.columnLengths[column] = columns[column].size();
+
+    string chunk((const char*)&header, sizeof(header));
+    for (const string& column : columns) chunk.append(column);
+
+    this->pending.erase(this->pending.begin(), this->pending.begin() + count);
+    this->chunkStartedAt = chrono::steady_clock::now();
+
+    size_t written = 0;
+    while (written < chunk.size()) {
+        ssize_t result = write(this->fd, chunk.data() + written, chunk.size() - written);
+        if (result < 0 && errno == EINTR) continue;
+        if (result <= 0) {
+            string toLog = "Failed to write a chunk of " + to_string(count) + " ticks to " + this->path + ": " + strerror(errno) + "\n";
+            logger.log(LOG_ERROR, toLog);
+            return false;
+        }
+        written += result;
+    }
+
+    this->writtenBytes += chunk.size();
+    return true;
+}
@@ -0,0 +1,112 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#ifndef TICK_CAPTURE_H
+#define TICK_CAPTURE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ETickBatch.h"
+#include "optionChainManager.h"
+#include "tickCaptureFormat.h"
+
+using namespace std;
+
+#define CAPTURE_RING_CAPACITY 65536         // records per producer thread, must be a power of two
+#define CAPTURE_CHUNK_TICKS 65536           // ticks per chunk
+#define CAPTURE_CHUNK_MAX_AGE_MS 10000      // a chunk with fewer ticks is written after this long
+#define CAPTURE_FLUSH_INTERVAL_MS 20
+#define CAPTURE_MAX_VALUE 1e9               // prices and sizes beyond this, or not finite, are captured as 0
+
+/**
+ * A tick as it is queued for the writer thread, with its contract already resolved.
+ */
+struct CaptureRecord {
+    uint64_t timestamp;             // CLOCK_REALTIME, nanoseconds
+    OptionChainManager* chain;
+    TickerId tickerId;              // unique across the chains, so it identifies the contract
+    double price;
+    double size;
+    double strike;                  // 0 for the underlying
+    int32_t conId;
+    uint8_t field;                  // TickType
+    char right;                     // 'C', 'P' or 0 for the underlying
+};
+
+/**
+ * Single producer, single consumer ring of capture records owned by one producer thread.
+ */
+struct CaptureRing {
+    alignas(64) atomic<uint64_t> head{0};      // next record to be written by the producer
+    alignas(64) atomic<uint64_t> tail{0};      // next record to be taken by the writer thread
+    unique_ptr<CaptureRecord[]> records{new CaptureRecord[CAPTURE_RING_CAPACITY]};
+};
+
+/**
+ * Captures every price and size tick to a columnar file for research, see tickCaptureFormat.h.
+ *
+ * The threads that receive ticks only resolve the tick's contract and append a record to a
+ * ring of their own, without locking; a record that does not fit is dropped and counted.
+ * A writer thread takes the records off the rings, sorts them into chunks by timestamp and
+ * writes each chunk's columns compressed, so the tick path never waits for the disk.
+ */
+class TickCapture {
+
+private:
+
+    uint64_t captureId;
+    int fd = -1;
+    string path;
+    atomic<bool> isCapturing{false};
+    atomic<int> producersInFlight{0};  // producers between their check of isCapturing and their push
+    bool stopFlag = false;
+    mutex stopMutex;
+    condition_variable stopCondition;
+    atomic<uint64_t> capturedCount{0};
+    atomic<uint64_t> droppedCount{0};
+    uint64_t writtenBytes = 0;
+    mutex ringsMutex;
+    vector<unique_ptr<CaptureRing>> rings;
+    thread writerThread;
+    vector<CaptureRecord> pending;
+    chrono::steady_clock::time_point chunkStartedAt;
+
+    CaptureRing* getThreadRing();
+    void push(OptionChainManager* chain, TickerId tickerId, int field, double price, double size);
+    void writerLoop();
+    void drain();
+    bool writeChunk(size_t count);
+
+public:
+
+    TickCapture();
+    ~TickCapture();
+
+    bool open(const string& path);
+    void close();
+    void capture(OptionChainManager* chain, TickerId tickerId, int field, double price, double size);
+    void captureTicks(const ETick* ticks, size_t count);
+    uint64_t getCapturedCount();
+    uint64_t getDroppedCount();
+    uint64_t getWrittenBytes();
+    const string& getPath();
+
+    /**
+     * @return true while ticks are captured.
+     */
+    bool isOpen() const {
+        return this->isCapturing.load(memory_order_relaxed);
+    }
+};
+
+#endif
@@ -0,0 +1,205 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#ifndef TICK_CAPTURE_FORMAT_H
+#define TICK_CAPTURE_FORMAT_H
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*
+ * The layout of a tick capture file, in the byte order of the host that wrote it:
+ *
+ *   TickCaptureFileHeader
+ *   chunk, chunk, ...
+ *
+ * A chunk is a TickChunkHeader followed by its contract table and five columns, each
+ * header.columnLengths[n] bytes long, in TickColumn order. A chunk holds up to
+ * CAPTURE_CHUNK_TICKS ticks ordered by timestamp and is decoded on its own. The strike
+ * range of its header covers its options only; its underlyings are flagged apart, so
+ * that an underlying at strike 0 does not widen the range to every chunk:
+ *
+ *   contracts   every contract with a tick in the chunk: zigzag varint conId, its strike as
+ *               a raw double (0 for an underlying), its right ('C', 'P' or 0), then its symbol
+ *               and expiry as a length byte and the characters
+ *   timestamps  zigzag varint difference from the previous timestamp, the first from
+ *               header.firstTimestamp; CLOCK_REALTIME nanoseconds at capture
+ *   contracts   varint index into the contract table
+ *   fields      one byte, the TickType
+ *   prices      zigzag varint difference from the previous price of the same contract and
+ *               field, the first from 0, in units of 10^-header.priceScale
+ *   sizes       the same for sizes, in units of 10^-header.sizeScale
+ *
+ * Ticks are stored as the EWrapper callbacks report them: a price tick carries its price
+ * and a size of 0, and the size sent with it follows as a tick of the matching size type.
+ * The scales are the fewest decimals every price (size) of the chunk is exact in, up to
+ * CAPTURE_MAX_SCALE.
+ */
+
+#define CAPTURE_FILE_MAGIC 0x50414354       // "TCAP"
+#define CAPTURE_CHUNK_MAGIC 0x4B484354      // "TCHK"
+#define CAPTURE_FILE_VERSION 2
+#define CAPTURE_MAX_SCALE 8
+#define CAPTURE_CHUNK_UNDERLYING 0x1        // chunk flag: the chunk has ticks of an underlying
+
+/**
+ * 10 to the power of every scale, to scale values to whole numbers and back.
+ */
+static const double capturePowersOfTen[CAPTURE_MAX_SCALE + 1] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8};
+
+enum TickColumn {
+    TICK_COLUMN_CONTRACTS = 0,
+    TICK_COLUMN_TIMESTAMPS,
+    TICK_COLUMN_CONTRACT_INDICES,
+    TICK_COLUMN_FIELDS,
+    TICK_COLUMN_PRICES,
+    TICK_COLUMN_SIZES,
+    TICK_COLUMN_COUNT
+};
+
+struct TickCaptureFileHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t chunkHeaderSize;
+    uint64_t createdAt;             // CLOCK_REALTIME nanoseconds
+};
+
+struct TickChunkHeader {
+    uint32_t magic;
+    uint32_t tickCount;
+    uint64_t firstTimestamp;        // also the smallest
+    uint64_t lastTimestamp;         // also the largest
+    double minStrike;               // of the options in the chunk, infinity if it has none
+    double maxStrike;               // -infinity if it has no options
+    uint32_t contractCount;
+    uint8_t priceScale;
+    uint8_t sizeScale;
+    uint16_t flags;                 // CAPTURE_CHUNK_UNDERLYING
+    uint32_t columnLengths[TICK_COLUMN_COUNT];
+};
+
+static_assert(sizeof(TickChunkHeader) == 72, "TickChunkHeader layout changed");
+
+/**
+ * A contract of a chunk's contract table.
+ */
+struct CapturedContract {
+    int conId = 0;
+    double strike = 0.0;
+    char right = 0;
+    string symbol;
+    string expiry;
+};
+
+/**
+ * One tick as it is read back.
+ */
+struct CapturedTick {
+    uint64_t timestamp;
+    int field;
+    double price;
+    double size;
+    const CapturedContract* contract;   // valid during the scan callback
+};
+
+/**
+ * What a scan keeps: ticks within a time range, of contracts within a strike range and,
+ * if a symbol is given, of that symbol. The default keeps every tick.
+ */
+struct TickScanFilter {
+    uint64_t fromTimestamp = 0;
+    uint64_t toTimestamp = numeric_limits<uint64_t>::max();    // inclusive
+    double minStrike = -numeric_limits<double>::infinity();
+    double maxStrike = numeric_limits<double>::infinity();
+    string symbol;
+};
+
+/**
+ * The totals of a scan.
+ */
+struct TickScanStats {
+    size_t chunksRead = 0;
+    size_t chunksSkipped = 0;
+    uint64_t ticksDecoded = 0;
+    uint64_t ticksMatched = 0;
+};
+
+/**
+ * Appends an unsigned integer as a varint: 7 bits per byte, lowest first, with the
+ * high bit set on every byte but the last.
+ */
+inline void appendVarint(string& out, uint64_t value) {
+
+    while (value >= 0x80) {
+        out.push_back((char)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((char)value);
+}
+
+/**
+ * Reads a varint.
+ *
+ * @return false if the varint runs past the end.
+ */
+inline bool readVarint(const uint8_t*& ptr, const uint8_t* end, uint64_t& value) {
+
+    value = 0;
+    for (int shift = 0; shift < 64 && ptr < end; shift += 7) {
+        uint8_t byte = *ptr++;
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+/**
+ * Maps signed integers to unsigned ones so that small magnitudes make short varints.
+ */
+inline uint64_t zigzagEncode(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+inline int64_t zigzagDecode(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+/**
+ * Reads the ticks of a capture file.
+ *
+ * The chunk headers are read when the file is opened, so a scan reads and decodes only
+ * the chunks whose time and strike ranges overlap its filter.
+ */
+class TickCaptureReader {
+
+private:
+
+    int fd = -1;
+    vector<TickChunkHeader> chunks;
+    vector<uint64_t> chunkOffsets;
+
+    bool decodeChunk(const TickChunkHeader& header, const string& data, const TickScanFilter& filter,
+                     const function<void(const CapturedTick&)>& callback, TickScanStats& stats);
+
+public:
+
+    ~TickCaptureReader();
+
+    bool open(const char* path);
+    void close();
+    size_t getChunkCount();
+    uint64_t getTickCount();
+    bool getTimeRange(uint64_t& first, uint64_t& last);
+    bool scan(const TickScanFilter& filter, const function<void(const CapturedTick&)>& callback, TickScanStats& stats);
+};
+
+#endif
@@ -0,0 +1,268 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+#include "tickCaptureFormat.h"
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+
+using namespace std;
+
+/**
+ * Reads exactly a number of bytes at an offset.
+ *
+ * @return false on an error or the end of the file.
+ */
+static bool readAt(int fd, void* buffer, size_t length, uint64_t offset) {
+
+    size_t done = 0;
+    while (done < length) {
+        ssize_t count = pread(fd, (char*)buffer + done, length - done, offset + done);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return false;
+        done += count;
+    }
+    return true;
+}
+
+/**
+ * Reads a length byte and that many characters.
+ *
+ * @return false if they run past the end.
+ */
+static bool readShortString(const uint8_t*& ptr, const uint8_t* end, string& value) {
+
+    if (ptr >= end || end - ptr - 1 < *ptr) return false;
+    value.assign((const char*)ptr + 1, *ptr);
+    ptr += 1 + *ptr;
+    return true;
+}
+
+//public methods
+
+/**
+ * Destroys the reader, closing the file.
+ */
+TickCaptureReader::~TickCaptureReader() {
+    close();
+}
+
+/**
+ * Opens a capture file and reads the header of every chunk. A chunk cut short, as the
+ * last one is if the capturing process died while writing it, ends the file.
+ *
+ * @param path The path of the capture file.
+ * @return false if the file cannot be read or is not a capture file of this version.
+ */
+bool TickCaptureReader::open(const char* path) {
+
+    close();
+
+    this->fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (this->fd < 0) return false;
+
+    TickCaptureFileHeader fileHeader;
+    struct stat fileStat;
+
+    if (!readAt(this->fd, &fileHeader, sizeof(fileHeader), 0) || fileHeader.magic != CAPTURE_FILE_MAGIC
+        || fileHeader.version != CAPTURE_FILE_VERSION || fileHeader.chunkHeaderSize != sizeof(TickChunkHeader)
+        || fstat(this->fd, &fileStat) < 0) {
+        close();
+        return false;
+    }
+
+    uint64_t offset = sizeof(fileHeader);
+    TickChunkHeader header;
+
+    while (readAt(this->fd, &header, sizeof(header), offset) && header.magic == CAPTURE_CHUNK_MAGIC) {
+
+        uint64_t length = sizeof(header);
+        for (int column = 0; column < TICK_COLUMN_COUNT; column++) length += header.columnLengths[column];
+        if (offset + length > (uint64_t)fileStat.st_size) break;
+
+        this->chunks.push_back(header);
+        this->chunkOffsets.push_back(offset);
+        offset += length;
+    }
+    return true;
+}
+
+/**
+ * Closes the file.
+ */
+void TickCaptureReader::close() {
+
+    if (this->fd >= 0) ::close(this->fd);
+    this->fd = -1;
+    this->chunks.clear();
+    this->chunkOffsets.clear();
+}
+
+/**
+ * @return the number of complete chunks in the file.
+ */
+size_t TickCaptureReader::getChunkCount() {
+    return this->chunks.size();
+}
+
+/**
+ * @return the number of ticks in the file.
+ */
+uint64_t TickCaptureReader::getTickCount() {
+
+    uint64_t count = 0;
+    for (const TickChunkHeader& header : this->chunks) count += header.tickCount;
+    return count;
+}
+
+/**
+ * Finds the times of the first and the last tick of the file.
+ *
+ * @return false if the file has no ticks.
+ */
+bool TickCaptureReader::getTimeRange(uint64_t& first, uint64_t& last) {
+
+    if (this->chunks.empty()) return false;
+
+    first = numeric_limits<uint64_t>::max();
+    last = 0;
+    for (const TickChunkHeader& header : this->chunks) {
+        first = min(first, header.firstTimestamp);
+        last = max(last, header.lastTimestamp);
+    }
+    return true;
+}
+
+/**
+ * Calls a function with every tick the filter keeps, in file order. Chunks whose time
+ * or strike range lies outside the filter are skipped without being read.
+ *
+ * @param filter What to keep.
+ * @param callback Called with each tick kept.
+ * @param stats Receives the chunks read and skipped and the ticks decoded and kept.
+ * @return false if a chunk could not be read or decoded.
+ */
+bool TickCaptureReader::scan(const TickScanFilter& filter, const function<void(const CapturedTick&)>& callback,
+                             TickScanStats& stats) {
+
+    string data;
+
+    for (size_t i = 0; i < this->chunks.size(); i++) {
+
+        const TickChunkHeader& header = this->chunks[i];
+        bool hasStrikes = header.maxStrike >= filter.minStrike && header.minStrike <= filter.maxStrike;
+        bool hasUnderlying = (header.flags & CAPTURE_CHUNK_UNDERLYING) != 0 && filter.minStrike <= 0.0 && filter.maxStrike >= 0.0;
+
+        if (header.lastTimestamp < filter.fromTimestamp || header.firstTimestamp > filter.toTimestamp
+            || (!hasStrikes && !hasUnderlying)) {
+            stats.chunksSkipped++;
+            continue;
+        }
+
+        size_t length = 0;
+        for (int column = 0; column < TICK_COLUMN_COUNT; column++) length += header.columnLengths[column];
+
+        data.resize(length);
+        if (!readAt(this->fd, &data[0], length, this->chunkOffsets[i] + sizeof(header))) return false;
+        if (!decodeChunk(header, data, filter, callback, stats)) return false;
+        stats.chunksRead++;
+    }
+    return true;
+}
+
+//private methods
+
+/**
+ * Decodes the columns of a chunk and calls a function with every tick the filter keeps.
+ * Prices and sizes are followed for every contract, since each is a difference from the
+ * one before it, but only the ticks of contracts the filter keeps are handed out.
+ *
+ * @return false if the chunk is malformed.
+ */
+bool TickCaptureReader::decodeChunk(const TickChunkHeader& header, const string& data, const TickScanFilter& filter,
+                                    const function<void(const CapturedTick&)>& callback, TickScanStats& stats) {
+
+    const uint8_t* columns[TICK_COLUMN_COUNT];
+    const uint8_t* ends[TICK_COLUMN_COUNT];
+    const uint8_t* ptr = (const uint8_t*)data.data();
+
+    for (int column = 0; column < TICK_COLUMN_COUNT; column++) {
+        columns[column] = ptr;
+        ptr += header.columnLengths[column];
+        ends[column] = ptr;
+    }
+    if (header.priceScale > CAPTURE_MAX_SCALE || header.sizeScale > CAPTURE_MAX_SCALE
+        || header.columnLengths[TICK_COLUMN_FIELDS] != header.tickCount) {
+        return false;
+    }
+
+    vector<CapturedContract> contracts(header.contractCount);
+    vector<bool> isKept(header.contractCount);
+    const uint8_t*& contractPtr = columns[TICK_COLUMN_CONTRACTS];
+
+    for (CapturedContract& contract : contracts) {
+
+        uint64_t conId;
+        if (!readVarint(contractPtr, ends[TICK_COLUMN_CONTRACTS], conId)
+            || ends[TICK_COLUMN_CONTRACTS] - contractPtr < (ptrdiff_t)(sizeof(double) + 1)) {
+            return false;
+        }
+        contract.conId = (int)zigzagDecode(conId);
+        memcpy(&contract.strike, contractPtr, sizeof(double));
+        contract.right = (char)contractPtr[sizeof(double)];
+        contractPtr += sizeof(double) + 1;
+
+        if (!readShortString(contractPtr, ends[TICK_COLUMN_CONTRACTS], contract.symbol)
+            || !readShortString(contractPtr, ends[TICK_COLUMN_CONTRACTS], contract.expiry)) {
+            return false;
+        }
+        isKept[&contract - contracts.data()] = contract.strike >= filter.minStrike && contract.strike <= filter.maxStrike
+                                                && (filter.symbol.empty() || filter.symbol == contract.symbol);
+    }
+
+    //previous price and size of each contract and field, keyed by contract index << 8 | field
+    unordered_map<uint64_t, pair<int64_t, int64_t>> previous;
+    double priceDivisor = capturePowersOfTen[header.priceScale];
+    double sizeDivisor = capturePowersOfTen[header.sizeScale];
+    uint64_t timestamp = header.firstTimestamp;
+
+    for (uint32_t i = 0; i < header.tickCount; i++) {
+
+        uint64_t timeDelta, contractIndex, priceDelta, sizeDelta;
+        if (!readVarint(columns[TICK_COLUMN_TIMESTAMPS], ends[TICK_COLUMN_TIMESTAMPS], timeDelta)
+            || !readVarint(columns[TICK_COLUMN_CONTRACT_INDICES], ends[TICK_COLUMN_CONTRACT_INDICES], contractIndex)
+            || !readVarint(columns[TICK_COLUMN_PRICES], ends[TICK_COLUMN_PRICES], priceDelta)
+            || !readVarint(columns[TICK_COLUMN_SIZES], ends[TICK_COLUMN_SIZES], sizeDelta)
+            || contractIndex >= contracts.size()) {
+            return false;
+        }
+
+        uint8_t field = columns[TICK_COLUMN_FIELDS][i];
+        timestamp += zigzagDecode(timeDelta);
+        stats.ticksDecoded++;
+
+        pair<int64_t, int64_t>& last = previous[contractIndex << 8 | field];
+        last.first += zigzagDecode(priceDelta);
+        last.second += zigzagDecode(sizeDelta);
+
+        if (!isKept[contractIndex] || timestamp < filter.fromTimestamp || timestamp > filter.toTimestamp) continue;
+
+        CapturedTick tick;
+        tick.timestamp = timestamp;
+        tick.field = field;
+        tick.price = last.first / priceDivisor;
+        tick.size = last.second / sizeDivisor;
+        tick.contract = &contracts[contractIndex];
+        stats.ticksMatched++;
+        callback(tick);
+    }
+    return true;
+}
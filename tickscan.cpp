@@ -0,0 +1,95 @@
+/*
+Tyler Pelling
+tpell114@mtroyal.ca
+COMP3659
+December 6, 2024
+*/
+
+/*
+Reads the ticks of a capture file written with CAPTURE_FILE.
+
+Usage: tickscan [-f fromSeconds] [-t toSeconds] [-s minStrike] [-S maxStrike] [-y symbol] [-c] captureFile
+
+Prints one line of CSV per tick within the time range (Unix seconds, inclusive),
+of contracts within the strike range and of the symbol, if given. Chunks outside
+the ranges are skipped without being read. With -c only the totals are printed.
+*/
+
+#include "tickCaptureFormat.h"
+#include <cstdio>
+#include <cstdlib>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+/**
+ * Prints the usage of tickscan.
+ */
+static void printUsage(const char* program) {
+    fprintf(stderr, "Usage: %s [-f fromSeconds] [-t toSeconds] [-s minStrike] [-S maxStrike] [-y symbol] [-c] "
+                    "captureFile\n", program);
+}
+
+/**
+ * Prints a tick as a line of CSV.
+ *
+ * @param tick The tick to print.
+ */
+static void printTick(const CapturedTick& tick) {
+
+    const CapturedContract* contract = tick.contract;
+    printf("%llu.%09llu,%s,%s,%d,%.8g,%c,%d,%.8g,%.8g\n", (unsigned long long)(tick.timestamp / 1000000000ULL),
+           (unsigned long long)(tick.timestamp % 1000000000ULL), contract->symbol.c_str(), contract->expiry.c_str(),
+           contract->conId, contract->strike, contract->right != 0 ? contract->right : 'U', tick.field, tick.price, tick.size);
+}
+
+int main(int argc, char** argv) {
+
+    TickScanFilter filter;
+    bool isCountOnly = false;
+    int option;
+
+    while ((option = getopt(argc, argv, "f:t:s:S:y:ch")) != -1) {
+        switch (option) {
+        case 'f': filter.fromTimestamp = (uint64_t)(atof(optarg) * 1e9); break;
+        case 't': filter.toTimestamp = (uint64_t)(atof(optarg) * 1e9); break;
+        case 's': filter.minStrike = atof(optarg); break;
+        case 'S': filter.maxStrike = atof(optarg); break;
+        case 'y': filter.symbol = optarg; break;
+        case 'c': isCountOnly = true; break;
+        default:
+            printUsage(argv[0]);
+            return option == 'h' ? 0 : 1;
+        }
+    }
+
+    if (optind >= argc) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    TickCaptureReader reader;
+    if (!reader.open(argv[optind])) {
+        fprintf(stderr, "Cannot read capture file %s\n", argv[optind]);
+        return 1;
+    }
+
+    if (!isCountOnly) printf("time,symbol,expiry,conId,strike,right,field,price,size\n");
+
+    TickScanStats stats;
+    bool isScanned = reader.scan(filter, [isCountOnly](const CapturedTick& tick) { if (!isCountOnly) printTick(tick); }, stats);
+
+    struct stat fileStat;
+    uint64_t tickCount = reader.getTickCount();
+    double bytesPerTick = stat(argv[optind], &fileStat) == 0 && tickCount > 0 ? (double)fileStat.st_size / tickCount : 0.0;
+
+    fprintf(stderr, "%zu chunks read, %zu skipped, %llu of %llu ticks matched, %.2f bytes per tick\n", stats.chunksRead,
+            stats.chunksSkipped, (unsigned long long)stats.ticksMatched, (unsigned long long)tickCount, bytesPerTick);
+
+    if (!isScanned) {
+        fprintf(stderr, "Capture file %s has a malformed chunk\n", argv[optind]);
+        return 1;
+    }
+    return 0;
+}